@@ -8,10 +8,15 @@
 #include <stdio.h>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
 #include "dataDumper.h"
 
 int DataDumper::pushData(double timeStamp, std::string info, double val)
 {
+	if (binaryDumpActive.load(std::memory_order_acquire))
+	{
+		return pushData(channelId(info), timeStamp, val);
+	}
 	int retCode = 0;
 	if (pushCounter < maxFifoSize)
 	{
@@ -64,6 +69,271 @@ int DataDumper::writeToFileNameWhenBufferIsFull(std::string filename)
 	return (0);
 }
 
+int DataDumper::channelId(const std::string& info)
+{
+	std::lock_guard<std::mutex> lock(channelMutex);
+	std::map<std::string, int>::iterator iter = channelIds.find(info);
+	if (iter != channelIds.end())
+	{
+		return iter->second;
+	}
+	int id = (int)channelNames.size();
+	channelNames.push_back(info);
+	channelIds[info] = id;
+	return id;
+}
+
+int DataDumper::pushData(int channel, double timeStamp, double val)
+{
+	// Register as active producer before checking the active flag, so that stopBinaryDump() and startBinaryDump()
+	// never release or reset the ring buffer while a record is written
+	activeProducers.fetch_add(1);
+	if (!binaryDumpActive.load())
+	{
+		activeProducers.fetch_sub(1);
+		std::string info;
+		{
+			std::lock_guard<std::mutex> lock(channelMutex);
+			if (channel >= 0 && channel < (int)channelNames.size())
+			{
+				info = channelNames[channel];
+			}
+		}
+		return pushData(timeStamp, info, val);
+	}
+	// Bounded multi-producer queue: claim a slot by incrementing the write index, if the slot has been released by the writer thread
+	uint64_t pos = ringWriteIndex.load(std::memory_order_relaxed);
+	BinaryDumpSlot *slot = 0;
+	while (true)
+	{
+		slot = &ringBuffer[pos & ringBufferMask];
+		uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+		int64_t diff = (int64_t)seq - (int64_t)pos;
+		if (diff == 0)
+		{
+			if (ringWriteIndex.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			droppedRecords.fetch_add(1, std::memory_order_relaxed); // ring buffer full
+			activeProducers.fetch_sub(1);
+			return 2;
+		}
+		else
+		{
+			pos = ringWriteIndex.load(std::memory_order_relaxed);
+		}
+	}
+	slot->record.timeStamp = timeStamp;
+	slot->record.value = val;
+	slot->record.channel = (uint32_t)channel;
+	slot->record.reserved = 0;
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	activeProducers.fetch_sub(1);
+	return 0;
+}
+
+/*
+ * Binary dump file format (little endian):
+ * "SICKDUMP" magic (8 byte), version (uint32), reserved (uint32),
+ * followed by chunks starting with a uint32 chunk type:
+ *   chunk type 1: channel definition with uint32 channel id, uint32 name length and name
+ *   chunk type 2: uint32 number of records and BinaryDumpRecords (timestamp, value, channel id, reserved)
+ * Channel definitions are always written before the first record of the channel.
+ */
+static const char binaryDumpMagic[8] = { 'S', 'I', 'C', 'K', 'D', 'U', 'M', 'P' };
+static const uint32_t binaryDumpVersion = 1;
+static const uint32_t binaryDumpChunkChannel = 1;
+static const uint32_t binaryDumpChunkRecords = 2;
+
+bool DataDumper::startBinaryDump(const std::string& filename, size_t ringBufferSize)
+{
+	stopBinaryDump();
+	size_t size = 1;
+	while (size < ringBufferSize)
+	{
+		size <<= 1;
+	}
+	if (ringBuffer == 0 || ringBufferMask + 1 != size)
+	{
+		delete[] ringBuffer;
+		ringBuffer = new BinaryDumpSlot[size];
+		ringBufferMask = size - 1;
+	}
+	for (size_t n = 0; n < size; n++)
+	{
+		ringBuffer[n].sequence.store(n, std::memory_order_relaxed);
+	}
+	ringWriteIndex.store(0, std::memory_order_relaxed);
+	ringReadIndex = 0;
+	droppedRecords.store(0, std::memory_order_relaxed);
+	FILE *fout = fopen(filename.c_str(), "wb");
+	if (fout == NULL)
+	{
+		return false;
+	}
+	uint32_t header[2] = { binaryDumpVersion, 0 };
+	fwrite(binaryDumpMagic, sizeof(binaryDumpMagic), 1, fout);
+	fwrite(header, sizeof(header), 1, fout);
+	fclose(fout);
+	binaryDumpFileName = filename;
+	binaryDumpActive.store(true);
+	binaryDumpWriter = std::thread(&DataDumper::binaryDumpThread, this);
+	return true;
+}
+
+void DataDumper::stopBinaryDump(void)
+{
+	binaryDumpActive.store(false);
+	// Producers that passed the active check before stop finish their record, no further records are accepted
+	while (activeProducers.load() > 0)
+	{
+		std::this_thread::yield();
+	}
+	// The writer thread drains the ring buffer after the last producer has finished
+	if (binaryDumpWriter.joinable())
+	{
+		binaryDumpWriter.join();
+	}
+}
+
+int DataDumper::writeChannelNames(FILE *fout, size_t& numWrittenChannels)
+{
+	std::lock_guard<std::mutex> lock(channelMutex);
+	for ( ; numWrittenChannels < channelNames.size(); numWrittenChannels++)
+	{
+		uint32_t chunk[3] = { binaryDumpChunkChannel, (uint32_t)numWrittenChannels, (uint32_t)channelNames[numWrittenChannels].size() };
+		fwrite(chunk, sizeof(chunk), 1, fout);
+		fwrite(channelNames[numWrittenChannels].data(), 1, channelNames[numWrittenChannels].size(), fout);
+	}
+	return 0;
+}
+
+void DataDumper::binaryDumpThread(void)
+{
+	FILE *fout = fopen(binaryDumpFileName.c_str(), "ab");
+	if (fout == NULL)
+	{
+		binaryDumpActive.store(false);
+		return;
+	}
+	std::vector<BinaryDumpRecord> batch;
+	batch.reserve(4096);
+	size_t numWrittenChannels = 0;
+	while (true)
+	{
+		bool active = binaryDumpActive.load() || activeProducers.load() > 0; // after stop, the ring buffer is drained completely
+		batch.clear();
+		while (batch.size() < batch.capacity())
+		{
+			BinaryDumpSlot &slot = ringBuffer[ringReadIndex & ringBufferMask];
+			if (slot.sequence.load(std::memory_order_acquire) != ringReadIndex + 1)
+			{
+				break; // ring buffer empty
+			}
+			batch.push_back(slot.record);
+			slot.sequence.store(ringReadIndex + ringBufferMask + 1, std::memory_order_release);
+			ringReadIndex++;
+		}
+		if (!batch.empty())
+		{
+			writeChannelNames(fout, numWrittenChannels);
+			uint32_t chunk[2] = { binaryDumpChunkRecords, (uint32_t)batch.size() };
+			fwrite(chunk, sizeof(chunk), 1, fout);
+			fwrite(batch.data(), sizeof(BinaryDumpRecord), batch.size(), fout);
+		}
+		if (batch.size() == batch.capacity())
+		{
+			continue; // more records pending
+		}
+		if (!active)
+		{
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	fclose(fout);
+}
+
+int DataDumper::convertBinaryDumpToCsv(const std::string& binFilename, const std::string& csvFilename)
+{
+	FILE *fin = fopen(binFilename.c_str(), "rb");
+	if (fin == NULL)
+	{
+		return -1;
+	}
+	char magic[sizeof(binaryDumpMagic)];
+	uint32_t header[2];
+	if (fread(magic, sizeof(magic), 1, fin) != 1 || memcmp(magic, binaryDumpMagic, sizeof(magic)) != 0
+	  || fread(header, sizeof(header), 1, fin) != 1 || header[0] != binaryDumpVersion)
+	{
+		fclose(fin);
+		return -1;
+	}
+	FILE *fout = fopen(csvFilename.c_str(), "w");
+	if (fout == NULL)
+	{
+		fclose(fin);
+		return -1;
+	}
+	std::vector<std::string> names;
+	std::vector<BinaryDumpRecord> records;
+	int numRecords = 0;
+	uint32_t chunkType;
+	while (fread(&chunkType, sizeof(chunkType), 1, fin) == 1)
+	{
+		if (chunkType == binaryDumpChunkChannel)
+		{
+			uint32_t chunk[2];
+			if (fread(chunk, sizeof(chunk), 1, fin) != 1)
+			{
+				break;
+			}
+			std::string name(chunk[1], '\0');
+			if (chunk[1] > 0 && fread(&name[0], 1, chunk[1], fin) != chunk[1])
+			{
+				break;
+			}
+			if (names.size() <= chunk[0])
+			{
+				names.resize(chunk[0] + 1);
+			}
+			names[chunk[0]] = name;
+		}
+		else if (chunkType == binaryDumpChunkRecords)
+		{
+			uint32_t count;
+			if (fread(&count, sizeof(count), 1, fin) != 1)
+			{
+				break;
+			}
+			records.resize(count);
+			size_t numRead = fread(records.data(), sizeof(BinaryDumpRecord), count, fin);
+			for (size_t i = 0; i < numRead; i++)
+			{
+				const char *name = (records[i].channel < names.size()) ? names[records[i].channel].c_str() : "";
+				fprintf(fout, "%8.6lf;%-10s;%12.8lf\n", records[i].timeStamp, name, records[i].value);
+				numRecords++;
+			}
+			if (numRead != count)
+			{
+				break;
+			}
+		}
+		else
+		{
+			numRecords = -1; // unknown chunk type, file corrupted
+			break;
+		}
+	}
+	fclose(fout);
+	fclose(fin);
+	return numRecords;
+}
+
 int DataDumper::dumpUcharBufferToConsole(unsigned char *buffer, int bufLen)
 {
   int ret = 0;
@@ -83,6 +83,8 @@
 #include <sick_scan/sick_scan_common.h>
 #include <sick_scan/sick_generic_field_mon.h>
 
+#include <chrono>
+
 namespace sick_scan
 {
 
@@ -210,4 +212,109 @@ namespace sick_scan
     return (exitCode);
   }
 
+
+  SickScanFieldMonEvaluator::SickScanFieldMonEvaluator(int fields_per_fieldset)
+  : m_fields_per_fieldset(fields_per_fieldset), m_table_num_beams(0), m_table_angle_min(0), m_table_angle_inc(0)
+  {
+  }
+
+  /*!
+  \brief Returns the range of a segmented field at a given angle by linear interpolation between the field points
+  \param field: field points (R in meter, Phi in rad, sick coordinates)
+  \param angle_rad: angle in sick coordinates
+  \return field range in meter, or 0 if the angle is not covered by the field
+  */
+  float SickScanFieldMonEvaluator::fieldRangeAtAngle(const SickScanMonField& field, float angle_rad)
+  {
+    const std::vector<float>& R = field.getRanges();
+    const std::vector<float>& Phi = field.getAnglesRad();
+    for(int n = 1; n < field.getPointCount(); n++)
+    {
+      float phi0 = Phi[n - 1], phi1 = Phi[n];
+      if((angle_rad >= phi0 && angle_rad <= phi1) || (angle_rad >= phi1 && angle_rad <= phi0))
+      {
+        float dphi = phi1 - phi0;
+        if(std::fabs(dphi) < 1.0e-6f)
+          return std::max(R[n - 1], R[n]);
+        float w = (angle_rad - phi0) / dphi;
+        return (1.0f - w) * R[n - 1] + w * R[n];
+      }
+    }
+    return 0;
+  }
+
+  /*!
+  \brief Computes the range threshold per beam for all fields
+  */
+  void SickScanFieldMonEvaluator::updateThresholdTable(const std::vector<SickScanMonField>& fields, int num_ranges, float angle_min, float angle_increment)
+  {
+    m_threshold_table.resize(fields.size());
+    for(size_t field_idx = 0; field_idx < fields.size(); field_idx++)
+    {
+      std::vector<float>& thresholds = m_threshold_table[field_idx];
+      thresholds.resize(num_ranges);
+      for(int beam_idx = 0; beam_idx < num_ranges; beam_idx++)
+      {
+        // ros angle to sick angle: angle_sick = angle_ros + pi/2 (see monFieldToCarthesian in sick_scan_marker.cpp)
+        float angle_sick = angle_min + beam_idx * angle_increment + (float)(M_PI / 2);
+        thresholds[beam_idx] = fieldRangeAtAngle(fields[field_idx], angle_sick);
+      }
+    }
+    m_table_num_beams = num_ranges;
+    m_table_angle_min = angle_min;
+    m_table_angle_inc = angle_increment;
+  }
+
+  bool SickScanFieldMonEvaluator::evaluate(const float* ranges, int num_ranges, float angle_min, float angle_increment, float range_min, int fieldset, sick_scan::FieldEvalMsg& msg)
+  {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    SickScanFieldMonSingleton *fieldMon = SickScanFieldMonSingleton::getInstance();
+    const std::vector<SickScanMonField>& fields = fieldMon->getMonFields();
+    if(ranges == 0 || num_ranges <= 0 || fields.empty() || fieldset < 0 || (fieldset + 1) * m_fields_per_fieldset > (int)fields.size())
+    {
+      return false;
+    }
+
+    // Recompute the threshold table if the scan geometry has changed. Changes of the field configuration are signaled by invalidate().
+    if(m_table_num_beams != num_ranges || m_table_angle_min != angle_min || m_table_angle_inc != angle_increment || m_threshold_table.size() != fields.size())
+    {
+      updateThresholdTable(fields, num_ranges, angle_min, angle_increment);
+    }
+
+    msg.active_fieldset = fieldset;
+    msg.field_index.resize(m_fields_per_fieldset);
+    msg.field_result.resize(m_fields_per_fieldset);
+    msg.intrusion_count.resize(m_fields_per_fieldset);
+    msg.first_intrusion_beam.resize(m_fields_per_fieldset);
+    for(int field_cnt = 0; field_cnt < m_fields_per_fieldset; field_cnt++)
+    {
+      int field_idx = fieldset * m_fields_per_fieldset + field_cnt;
+      const float* thresholds = &m_threshold_table[field_idx][0];
+      // Branchless loop over all beams, vectorized by the compiler
+      uint32_t intrusion_count = 0;
+      for(int beam_idx = 0; beam_idx < num_ranges; beam_idx++)
+      {
+        intrusion_count += ((ranges[beam_idx] > range_min) & (ranges[beam_idx] < thresholds[beam_idx])) ? 1 : 0;
+      }
+      int first_intrusion_beam = -1;
+      for(int beam_idx = 0; intrusion_count > 0 && beam_idx < num_ranges; beam_idx++)
+      {
+        if(ranges[beam_idx] > range_min && ranges[beam_idx] < thresholds[beam_idx])
+        {
+          first_intrusion_beam = beam_idx;
+          break;
+        }
+      }
+      msg.field_index[field_cnt] = field_cnt + 1;
+      if(fields[field_idx].getPointCount() < 2)
+        msg.field_result[field_cnt] = 0; // field not configured
+      else
+        msg.field_result[field_cnt] = ((intrusion_count > 0) ? 2 : 1);
+      msg.intrusion_count[field_cnt] = intrusion_count;
+      msg.first_intrusion_beam[field_cnt] = first_intrusion_beam;
+    }
+    msg.eval_time_usec = 1.0e-3f * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+    return true;
+  }
+
 }
@@ -705,9 +705,12 @@ namespace sick_scan
       float LinearAccelerationZ() const { return linearAccelerationZ; }
       void LinearAccelerationZ(float val) { linearAccelerationZ = val; }
        */
-      DataDumper::instance().pushData((double)imuValue.TimeStamp(), "ACCX", imuValue.LinearAccelerationX());
-      DataDumper::instance().pushData((double)imuValue.TimeStamp(), "ACCY", imuValue.LinearAccelerationY());
-      DataDumper::instance().pushData((double)imuValue.TimeStamp(), "ACCZ", imuValue.LinearAccelerationZ());
+      static int dumpChannelAccX = DataDumper::instance().channelId("ACCX");
+      static int dumpChannelAccY = DataDumper::instance().channelId("ACCY");
+      static int dumpChannelAccZ = DataDumper::instance().channelId("ACCZ");
+      DataDumper::instance().pushData(dumpChannelAccX, (double)imuValue.TimeStamp(), imuValue.LinearAccelerationX());
+      DataDumper::instance().pushData(dumpChannelAccY, (double)imuValue.TimeStamp(), imuValue.LinearAccelerationY());
+      DataDumper::instance().pushData(dumpChannelAccZ, (double)imuValue.TimeStamp(), imuValue.LinearAccelerationZ());
 #endif
         /*
          * The built-in IMU unit provides three parameter sets:
@@ -828,6 +831,10 @@ namespace sick_scan
     if (true == bRet)
     {
       this->commonPtr->imuScan_pub_.publish(imuMsg_);
+      if (this->commonPtr->cloud_deskew_ != NULL)
+      {
+        this->commonPtr->cloud_deskew_->addImu(imuMsg_); // angular velocity of the scanner imu for pointcloud deskew
+      }
     }
     return (exitCode);
 
@@ -75,6 +75,7 @@
 #include <sick_scan/sick_generic_parser.h>
 #include <sick_scan/sick_generic_laser.h>
 #include <sick_scan/sick_scan_services.h>
+#include <sick_scan/dataDumper.h>
 
 
 #ifdef _MSC_VER
@@ -251,6 +252,21 @@ int mainGenericLaser(int argc, char **argv, std::string nodeName)
   nhPriv.param("subscribe_datagram", subscribe_datagram, false);
   nhPriv.param("device_number", device_number, 0);
 
+  // binary dump of debug and timing data (convert to csv by sick_scan_dump_converter)
+  std::string data_dump_file;
+  nhPriv.param<std::string>("data_dump_file", data_dump_file, "");
+  if (!data_dump_file.empty())
+  {
+    if (DataDumper::instance().startBinaryDump(data_dump_file))
+    {
+      ROS_INFO("Binary data dump activated, writing to file \"%s\"", data_dump_file.c_str());
+    }
+    else
+    {
+      ROS_WARN("## ERROR: could not open binary data dump file \"%s\"", data_dump_file.c_str());
+    }
+  }
+
 
   sick_scan::SickGenericParser *parser = new sick_scan::SickGenericParser(scannerName);
 
@@ -402,4 +418,4 @@ int mainGenericLaser(int argc, char **argv, std::string nodeName)
   }
   return result;
 
-}
\ No newline at end of file
+}
\ No newline at end of file
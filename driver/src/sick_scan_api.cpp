@@ -0,0 +1,329 @@
+/*
+ * @brief C API of the ROS independent driver core
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sick_scan/sick_scan_api.h"
+#include "sick_scan/sick_scan_core.h"
+#include "sick_scan/sick_scan_datagram_log.h"
+#include "sick_scan/sick_scan_pcapng_reader.h"
+
+/*!
+\brief Ring buffer slot: scan metadata returned to the application and the preallocated scan and cloud buffers
+*/
+struct SickScanApiSlot
+{
+  SickScanApiScan api_scan;
+  sick_scan::SickScanCoreScan scan;
+  sick_scan::SickScanCoreCloud cloud;
+};
+
+/*!
+\brief Driver instance behind a SickScanApiHandle. The receive (or replay) thread writes scans into the ring buffer,
+the application thread reads them. m_write_index is written by the producer only, m_read_index by the consumer only.
+*/
+struct SickScanApiContext
+{
+  SickScanApiContext(uint32_t num_slots, uint32_t max_points) : m_slots(num_slots), m_max_points(max_points),
+    m_write_index(0), m_read_index(0), m_num_dropped(0), m_replay_running(false), m_replay_sdl(false)
+  {
+    for (size_t n = 0; n < m_slots.size(); n++)
+    {
+      m_slots[n].scan.ranges.reserve(max_points);
+      m_slots[n].scan.intensities.reserve(max_points);
+      m_slots[n].scan.vertical_angles.reserve(max_points);
+      m_slots[n].cloud.points.reserve(4 * max_points);
+    }
+    m_core.setScanCallback([this](const sick_scan::SickScanCoreScan& scan) { writeScan(scan); });
+  }
+
+  ~SickScanApiContext()
+  {
+    stop();
+  }
+
+  void writeScan(const sick_scan::SickScanCoreScan& scan)
+  {
+    uint64_t write_index = m_write_index.load(std::memory_order_relaxed);
+    if (write_index - m_read_index.load(std::memory_order_acquire) >= m_slots.size()
+      || scan.num_echos * scan.num_beams > m_max_points || scan.num_rssi * scan.num_beams > m_max_points)
+    {
+      m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    SickScanApiSlot& slot = m_slots[write_index % m_slots.size()];
+    slot.scan = scan; // buffers are preallocated, copy without allocation
+    m_core.buildCloud(slot.scan, slot.cloud);
+    SickScanApiScan& api_scan = slot.api_scan;
+    api_scan.sequence = write_index;
+    api_scan.recv_time_nsec = scan.recv_time_nsec;
+    api_scan.time_since_startup_usec = scan.time_since_startup_usec;
+    api_scan.time_of_transmission_usec = scan.time_of_transmission_usec;
+    api_scan.serial_number = scan.serial_number;
+    api_scan.telegram_counter = scan.telegram_counter;
+    api_scan.scan_counter = scan.scan_counter;
+    api_scan.layer_angle_x200 = scan.layer_angle_x200;
+    api_scan.elevation = scan.elevation;
+    api_scan.scan_frequency = scan.scan_frequency;
+    api_scan.time_increment = scan.time_increment;
+    api_scan.angle_min = scan.angle_min;
+    api_scan.angle_increment = scan.angle_increment;
+    api_scan.num_beams = scan.num_beams;
+    api_scan.num_echos = scan.num_echos;
+    api_scan.num_rssi = scan.num_rssi;
+    api_scan.num_encoders = scan.num_encoders;
+    for (uint32_t n = 0; n < SICK_SCAN_API_MAX_ENCODERS; n++)
+    {
+      api_scan.encoder_position[n] = (n < scan.num_encoders) ? scan.encoder_position[n] : 0;
+      api_scan.encoder_speed[n] = (n < scan.num_encoders) ? scan.encoder_speed[n] : 0;
+    }
+    api_scan.ranges = slot.scan.ranges.data();
+    api_scan.intensities = slot.scan.intensities.data();
+    api_scan.points = slot.cloud.points.data();
+    api_scan.num_points = slot.cloud.num_beams * slot.cloud.num_echos;
+    api_scan.point_step = 4 * sizeof(float);
+    api_scan.publish_time_nsec = sick_scan::SickScanCore::systemTimeNanoSec();
+    m_write_index.store(write_index + 1, std::memory_order_release);
+  }
+
+  bool readScan(SickScanApiScan* scan)
+  {
+    uint64_t read_index = m_read_index.load(std::memory_order_relaxed);
+    if (read_index == m_write_index.load(std::memory_order_acquire))
+      return false;
+    *scan = m_slots[read_index % m_slots.size()].api_scan;
+    return true;
+  }
+
+  void releaseScan(void)
+  {
+    uint64_t read_index = m_read_index.load(std::memory_order_relaxed);
+    if (read_index != m_write_index.load(std::memory_order_acquire))
+      m_read_index.store(read_index + 1, std::memory_order_release);
+  }
+
+  bool replay(const std::string& filename, double speed, int repeat)
+  {
+    stop();
+    // The file is opened here to report errors, datagrams are read by the replay thread one at a time
+    m_replay_filename = filename;
+    m_replay_sdl = (filename.size() > 4 && filename.substr(filename.size() - 4) == ".sdl");
+    if (m_replay_sdl ? (!m_sdl_reader.open(filename) || m_sdl_reader.numDatagrams() == 0) : !m_pcapng_reader.open(filename))
+      return false;
+    m_replay_running = true;
+    m_replay_thread = std::thread(&SickScanApiContext::replayThreadFunction, this, speed, repeat);
+    return true;
+  }
+
+  /*!
+  \brief Reads the next datagram of the replayed file into m_replay_datagram
+  */
+  bool readReplayDatagram(size_t idx, double& timestamp)
+  {
+    uint32_t sec = 0, nsec = 0;
+    bool success = m_replay_sdl ? (idx < m_sdl_reader.numDatagrams() && m_sdl_reader.read(idx, sec, nsec, m_replay_datagram))
+                                : m_pcapng_reader.read(sec, nsec, m_replay_datagram);
+    timestamp = sec + 1.0e-9 * nsec;
+    return success;
+  }
+
+  void replayThreadFunction(double speed, int repeat)
+  {
+    for (int cnt = 0; m_replay_running && cnt < repeat; cnt++)
+    {
+      if (cnt > 0 && !m_replay_sdl && !m_pcapng_reader.open(m_replay_filename)) // pcapng files are read sequentially, restart from the beginning
+        break;
+      std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+      double first_timestamp = 0, timestamp = 0;
+      for (size_t n = 0; m_replay_running && readReplayDatagram(n, timestamp); n++)
+      {
+        if (n == 0)
+          first_timestamp = timestamp;
+        if (speed > 0)
+        {
+          double delay = (timestamp - first_timestamp) / speed;
+          std::unique_lock<std::mutex> replay_lock(m_replay_mutex); // wait until the send time of the datagram or until stop()
+          if (m_replay_stopped.wait_until(replay_lock, start_time + std::chrono::microseconds((int64_t)(1.0e6 * delay)), [this] { return !m_replay_running; }))
+            break;
+        }
+        m_core.processTelegram(m_replay_datagram.data(), m_replay_datagram.size(), sick_scan::SickScanCore::systemTimeNanoSec());
+      }
+    }
+    m_sdl_reader.close();
+    m_pcapng_reader.close();
+    m_replay_running = false;
+  }
+
+  void stop(void)
+  {
+    {
+      std::lock_guard<std::mutex> replay_lock(m_replay_mutex);
+      m_replay_running = false;
+    }
+    m_replay_stopped.notify_all();
+    if (m_replay_thread.joinable())
+      m_replay_thread.join();
+    if (m_core.isConnected())
+      m_core.stopScandata();
+    m_core.disconnect();
+  }
+
+  sick_scan::SickScanCore m_core;
+  std::vector<SickScanApiSlot> m_slots;
+  uint32_t m_max_points;
+  std::atomic<uint64_t> m_write_index;  // index of the next scan written by the receive thread
+  std::atomic<uint64_t> m_read_index;   // index of the next scan read by the application
+  std::atomic<uint64_t> m_num_dropped;
+  std::thread m_replay_thread;
+  std::atomic<bool> m_replay_running;
+  std::mutex m_replay_mutex;              // mutex of m_replay_stopped
+  std::condition_variable m_replay_stopped; // signalled by stop(), the replay thread waits on it until the send time of the next datagram
+  std::string m_replay_filename;
+  bool m_replay_sdl;                     // replay of a datagram log (*.sdl), otherwise of a network capture (*.pcapng)
+  sick_scan::SickScanDatagramLogReader m_sdl_reader;
+  sick_scan::SickScanPcapngReader m_pcapng_reader;
+  std::vector<uint8_t> m_replay_datagram; // datagram read by the replay thread, buffer reused for all datagrams
+};
+
+SickScanApiHandle SickScanApiCreate(uint32_t num_slots, uint32_t max_points)
+{
+  if (num_slots < 1 || max_points < 1)
+    return NULL;
+  try
+  {
+    return new SickScanApiContext(num_slots, max_points);
+  }
+  catch (const std::exception&)
+  {
+    return NULL;
+  }
+}
+
+void SickScanApiRelease(SickScanApiHandle handle)
+{
+  delete handle;
+}
+
+int SickScanApiSetScanMirroredAndShifted(SickScanApiHandle handle, int mirrored_and_shifted)
+{
+  if (!handle)
+    return SICK_SCAN_API_ERROR;
+  handle->m_core.setScanMirroredAndShifted(mirrored_and_shifted != 0);
+  return SICK_SCAN_API_SUCCESS;
+}
+
+int SickScanApiConnect(SickScanApiHandle handle, const char* hostname, int port, int timeout_msec)
+{
+  if (!handle || !hostname)
+    return SICK_SCAN_API_ERROR;
+  handle->stop();
+  if (!handle->m_core.connect(hostname, port, timeout_msec))
+    return SICK_SCAN_API_NOT_CONNECTED;
+  if (!handle->m_core.startScandata(timeout_msec))
+  {
+    handle->m_core.disconnect();
+    return SICK_SCAN_API_ERROR;
+  }
+  return SICK_SCAN_API_SUCCESS;
+}
+
+int SickScanApiDisconnect(SickScanApiHandle handle)
+{
+  if (!handle)
+    return SICK_SCAN_API_ERROR;
+  handle->stop();
+  return SICK_SCAN_API_SUCCESS;
+}
+
+int SickScanApiReplay(SickScanApiHandle handle, const char* filename, double speed, int repeat)
+{
+  if (!handle || !filename)
+    return SICK_SCAN_API_ERROR;
+  return handle->replay(filename, speed, repeat) ? SICK_SCAN_API_SUCCESS : SICK_SCAN_API_ERROR;
+}
+
+int SickScanApiIsRunning(SickScanApiHandle handle)
+{
+  return (handle && (handle->m_core.isConnected() || handle->m_replay_running)) ? 1 : 0;
+}
+
+int SickScanApiPollScan(SickScanApiHandle handle, SickScanApiScan* scan, int timeout_msec)
+{
+  if (!handle || !scan)
+    return SICK_SCAN_API_ERROR;
+  if (handle->readScan(scan))
+    return SICK_SCAN_API_SUCCESS;
+  std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_msec);
+  while (std::chrono::steady_clock::now() < end_time)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    if (handle->readScan(scan))
+      return SICK_SCAN_API_SUCCESS;
+  }
+  return SICK_SCAN_API_TIMEOUT;
+}
+
+int SickScanApiReleaseScan(SickScanApiHandle handle, SickScanApiScan* scan)
+{
+  if (!handle || !scan)
+    return SICK_SCAN_API_ERROR;
+  handle->releaseScan();
+  return SICK_SCAN_API_SUCCESS;
+}
+
+int SickScanApiGetStatistics(SickScanApiHandle handle, uint64_t* num_scans, uint64_t* num_dropped, uint64_t* num_errors)
+{
+  if (!handle)
+    return SICK_SCAN_API_ERROR;
+  if (num_scans)
+    *num_scans = handle->m_write_index.load(std::memory_order_acquire);
+  if (num_dropped)
+    *num_dropped = handle->m_num_dropped.load(std::memory_order_relaxed);
+  if (num_errors)
+    *num_errors = handle->m_core.getNumErrors();
+  return SICK_SCAN_API_SUCCESS;
+}
+
+uint64_t SickScanApiSystemTimeNanoSec(void)
+{
+  return sick_scan::SickScanCore::systemTimeNanoSec();
+}
@@ -0,0 +1,353 @@
+/*
+ * @brief Compact encodings of pointcloud messages
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 09.02.2021
+ *
+ */
+
+#include <limits>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ros/ros.h>
+
+#include "sick_scan/sick_scan_cloud_encoder.h"
+
+namespace sick_scan
+{
+  enum INPUT_FIELD
+  {
+    FIELD_X,
+    FIELD_Y,
+    FIELD_Z,
+    FIELD_INTENSITY,
+    FIELD_TIME,
+    FIELD_NUM
+  };
+
+  static void addField(sensor_msgs::PointCloud2& cloud, const std::string& name, uint32_t& offset, uint8_t datatype, uint32_t size)
+  {
+    sensor_msgs::PointField field;
+    field.name = name;
+    field.offset = offset;
+    field.datatype = datatype;
+    field.count = 1;
+    cloud.fields.push_back(field);
+    offset += size;
+  }
+
+  static inline uint16_t encodeIntensity(float intensity)
+  {
+    if (!(intensity > 0)) // includes NaN
+      return 0;
+    if (intensity >= 65535.0f)
+      return 65535;
+    return (uint16_t)(intensity + 0.5f);
+  }
+
+  static inline int16_t encodeInt16(float value, float scale)
+  {
+    float v = value * scale;
+    if (!(fabsf(v) < 32767.0f)) // includes NaN
+      return std::numeric_limits<int16_t>::min();
+    return (int16_t)lrintf(v);
+  }
+
+  static inline int32_t encodeInt32(float value, float scale)
+  {
+    float v = value * scale;
+    if (!(fabsf(v) < 2147483520.0f)) // largest float below INT32_MAX, includes NaN
+      return std::numeric_limits<int32_t>::min();
+    return (int32_t)lrintf(v);
+  }
+
+  /*!
+  \brief Encodes all points of a cloud. The encoding is a template parameter, so the per-point switch is resolved at compile time.
+  */
+  template<int ENCODING> static void encodePoints(const sensor_msgs::PointCloud2& cloud, const int* offset, float scale, sensor_msgs::PointCloud2& encoded)
+  {
+    const bool with_intensity = (offset[FIELD_INTENSITY] >= 0);
+    const bool with_time = (offset[FIELD_TIME] >= 0);
+    uint8_t* dst = &encoded.data[0];
+    for (uint32_t row = 0; row < cloud.height; row++)
+    {
+      const uint8_t* src = &cloud.data[0] + (size_t)row * cloud.row_step;
+      for (uint32_t col = 0; col < cloud.width; col++, src += cloud.point_step)
+      {
+        float xyz[3], intensity = 0, time = 0;
+        memcpy(&xyz[0], src + offset[FIELD_X], sizeof(float));
+        memcpy(&xyz[1], src + offset[FIELD_Y], sizeof(float));
+        memcpy(&xyz[2], src + offset[FIELD_Z], sizeof(float));
+        if (with_intensity)
+          memcpy(&intensity, src + offset[FIELD_INTENSITY], sizeof(float));
+        if (with_time)
+          memcpy(&time, src + offset[FIELD_TIME], sizeof(float));
+        uint16_t intensity_value = encodeIntensity(intensity);
+        if (ENCODING == SickScanCloudEncoder::ENCODING_INT16)
+        {
+          int16_t values[4] = { encodeInt16(xyz[0], scale), encodeInt16(xyz[1], scale), encodeInt16(xyz[2], scale), (int16_t)intensity_value };
+          memcpy(dst, values, sizeof(values));
+          dst += sizeof(values);
+        }
+        else if (ENCODING == SickScanCloudEncoder::ENCODING_INT32)
+        {
+          int32_t values[3] = { encodeInt32(xyz[0], scale), encodeInt32(xyz[1], scale), encodeInt32(xyz[2], scale) };
+          memcpy(dst, values, sizeof(values));
+          memcpy(dst + sizeof(values), &intensity_value, sizeof(intensity_value));
+          dst += sizeof(values) + sizeof(intensity_value);
+        }
+        else if (ENCODING == SickScanCloudEncoder::ENCODING_FLOAT16)
+        {
+          uint16_t values[4] = { SickScanCloudEncoder::floatToHalf(xyz[0]), SickScanCloudEncoder::floatToHalf(xyz[1]),
+                                 SickScanCloudEncoder::floatToHalf(xyz[2]), intensity_value };
+          memcpy(dst, values, sizeof(values));
+          dst += sizeof(values);
+        }
+        else if (ENCODING == SickScanCloudEncoder::ENCODING_POLAR)
+        {
+          float range = sqrtf(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]) * scale;
+          uint16_t values[3] = { (uint16_t)((range < 65535.0f) ? (range + 0.5f) : 0), (uint16_t)col, intensity_value }; // NaN and out of range: 0
+          memcpy(dst, values, sizeof(values));
+          dst += sizeof(values);
+        }
+        if (with_time)
+        {
+          memcpy(dst, &time, sizeof(time));
+          dst += sizeof(time);
+        }
+      }
+    }
+  }
+
+  SickScanCloudEncoder::SickScanCloudEncoder(ENCODING encoding, double resolution)
+  {
+    setEncoding(encoding, resolution);
+  }
+
+  bool SickScanCloudEncoder::setEncoding(const std::string& encoding_name, double resolution)
+  {
+    for (int n = 0; n < ENCODING_NUM; n++)
+    {
+      if (encoding_name == encodingName((ENCODING)n))
+      {
+        setEncoding((ENCODING)n, resolution);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void SickScanCloudEncoder::setEncoding(ENCODING encoding, double resolution)
+  {
+    m_encoding = encoding;
+    m_scale = (resolution > 0) ? (float)(1.0 / resolution) : 1000.0f;
+    char field_name[64];
+    snprintf(field_name, sizeof(field_name), "resolution=%.9g", (resolution > 0) ? resolution : 0.001);
+    m_resolution_field_name = field_name;
+  }
+
+  double SickScanCloudEncoder::getResolution(const sensor_msgs::PointCloud2& cloud)
+  {
+    static const std::string prefix = "resolution=";
+    for (size_t field_idx = 0; field_idx < cloud.fields.size(); field_idx++)
+    {
+      if (cloud.fields[field_idx].count == 0 && cloud.fields[field_idx].name.compare(0, prefix.size(), prefix) == 0)
+        return atof(cloud.fields[field_idx].name.c_str() + prefix.size());
+    }
+    return 0;
+  }
+
+  const char* SickScanCloudEncoder::encodingName(ENCODING encoding)
+  {
+    static const char* names[ENCODING_NUM] = { "float32", "int16", "int32", "float16", "polar" };
+    return (encoding >= 0 && encoding < ENCODING_NUM) ? names[encoding] : "unknown";
+  }
+
+  int SickScanCloudEncoder::pointStep(ENCODING encoding, bool with_time)
+  {
+    static const int point_step[ENCODING_NUM] = { 4 * 4, 4 * 2, 3 * 4 + 2, 4 * 2, 3 * 2 };
+    int time_size = with_time ? (int)sizeof(float) : 0;
+    return (encoding >= 0 && encoding < ENCODING_NUM) ? (point_step[encoding] + time_size) : 0;
+  }
+
+  const sensor_msgs::PointCloud2& SickScanCloudEncoder::encode(const sensor_msgs::PointCloud2& cloud)
+  {
+    if (m_encoding == ENCODING_FLOAT32)
+      return cloud;
+
+    // offsets of the input fields (FLOAT32 only)
+    static const char* field_names[FIELD_NUM] = { "x", "y", "z", "intensity", "time" };
+    int offset[FIELD_NUM] = { -1, -1, -1, -1, -1 };
+    for (size_t field_idx = 0; field_idx < cloud.fields.size(); field_idx++)
+    {
+      for (int n = 0; n < FIELD_NUM; n++)
+      {
+        if (cloud.fields[field_idx].name == field_names[n] && cloud.fields[field_idx].datatype == sensor_msgs::PointField::FLOAT32)
+          offset[n] = cloud.fields[field_idx].offset;
+      }
+    }
+    if (offset[FIELD_X] < 0 || offset[FIELD_Y] < 0 || offset[FIELD_Z] < 0)
+    {
+      ROS_WARN_THROTTLE(1.0, "SickScanCloudEncoder: pointcloud without float32 fields x, y, z, pointcloud published unencoded");
+      return cloud;
+    }
+    bool with_time = (offset[FIELD_TIME] >= 0);
+
+    // encoded point layout
+    uint32_t field_offset = 0;
+    m_cloud.fields.clear();
+    switch (m_encoding)
+    {
+      case ENCODING_INT16:
+        addField(m_cloud, "x", field_offset, sensor_msgs::PointField::INT16, 2);
+        addField(m_cloud, "y", field_offset, sensor_msgs::PointField::INT16, 2);
+        addField(m_cloud, "z", field_offset, sensor_msgs::PointField::INT16, 2);
+        break;
+      case ENCODING_INT32:
+        addField(m_cloud, "x", field_offset, sensor_msgs::PointField::INT32, 4);
+        addField(m_cloud, "y", field_offset, sensor_msgs::PointField::INT32, 4);
+        addField(m_cloud, "z", field_offset, sensor_msgs::PointField::INT32, 4);
+        break;
+      case ENCODING_FLOAT16: // PointField has no float16 datatype
+        addField(m_cloud, "x", field_offset, sensor_msgs::PointField::UINT16, 2);
+        addField(m_cloud, "y", field_offset, sensor_msgs::PointField::UINT16, 2);
+        addField(m_cloud, "z", field_offset, sensor_msgs::PointField::UINT16, 2);
+        break;
+      case ENCODING_POLAR:
+        addField(m_cloud, "range", field_offset, sensor_msgs::PointField::UINT16, 2);
+        addField(m_cloud, "beam", field_offset, sensor_msgs::PointField::UINT16, 2);
+        break;
+      default:
+        return cloud;
+    }
+    addField(m_cloud, "intensity", field_offset, sensor_msgs::PointField::UINT16, 2);
+    if (with_time)
+      addField(m_cloud, "time", field_offset, sensor_msgs::PointField::FLOAT32, 4);
+    if (m_encoding == ENCODING_INT16 || m_encoding == ENCODING_INT32 || m_encoding == ENCODING_POLAR)
+    {
+      // scale of the integer fields as metadata field without data (count 0)
+      sensor_msgs::PointField field;
+      field.name = m_resolution_field_name;
+      field.offset = field_offset;
+      field.datatype = sensor_msgs::PointField::FLOAT64;
+      field.count = 0;
+      m_cloud.fields.push_back(field);
+    }
+
+    m_cloud.header = cloud.header;
+    m_cloud.height = cloud.height;
+    m_cloud.width = cloud.width;
+    m_cloud.is_bigendian = false;
+    m_cloud.is_dense = cloud.is_dense;
+    m_cloud.point_step = field_offset;
+    m_cloud.row_step = m_cloud.point_step * m_cloud.width;
+    m_cloud.data.resize((size_t)m_cloud.row_step * m_cloud.height);
+    if (m_cloud.data.empty())
+      return m_cloud;
+
+    switch (m_encoding)
+    {
+      case ENCODING_INT16:
+        encodePoints<ENCODING_INT16>(cloud, offset, m_scale, m_cloud);
+        break;
+      case ENCODING_INT32:
+        encodePoints<ENCODING_INT32>(cloud, offset, m_scale, m_cloud);
+        break;
+      case ENCODING_FLOAT16:
+        encodePoints<ENCODING_FLOAT16>(cloud, offset, m_scale, m_cloud);
+        break;
+      case ENCODING_POLAR:
+        encodePoints<ENCODING_POLAR>(cloud, offset, m_scale, m_cloud);
+        break;
+      default:
+        break;
+    }
+    return m_cloud;
+  }
+
+  uint16_t SickScanCloudEncoder::floatToHalf(float value)
+  {
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint32_t sign = (f >> 16) & 0x8000;
+    uint32_t abs_f = f & 0x7fffffff;
+    if (abs_f >= 0x7f800000) // inf or NaN
+      return (uint16_t)(sign | 0x7c00 | ((abs_f > 0x7f800000) ? 0x200 : 0));
+    if (abs_f >= 0x47800000) // overflow (>= 65536)
+      return (uint16_t)(sign | 0x7c00);
+    if (abs_f < 0x38800000) // subnormal half (< 2^-14)
+    {
+      if (abs_f < 0x33000000) // < 2^-25 rounds to zero
+        return (uint16_t)sign;
+      uint32_t exponent = abs_f >> 23;
+      uint32_t mantissa = (abs_f & 0x7fffff) | 0x800000;
+      uint32_t shift = 126 - exponent;
+      uint32_t h = mantissa >> shift;
+      uint32_t remainder = mantissa & ((1u << shift) - 1);
+      uint32_t halfway = 1u << (shift - 1);
+      if (remainder > halfway || (remainder == halfway && (h & 1)))
+        h++;
+      return (uint16_t)(sign | h);
+    }
+    uint32_t h = (abs_f - 0x38000000) >> 13; // rebias exponent from 127 to 15
+    uint32_t remainder = abs_f & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (h & 1)))
+      h++; // carry into the exponent rounds up to the next power of two resp. inf
+    return (uint16_t)(sign | h);
+  }
+
+  float SickScanCloudEncoder::halfToFloat(uint16_t value)
+  {
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t f;
+    if (exponent == 0x1f) // inf or NaN
+    {
+      f = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent == 0) // zero or subnormal
+    {
+      float v = ldexpf((float)mantissa, -24);
+      return sign ? -v : v;
+    }
+    else
+    {
+      f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    memcpy(&result, &f, sizeof(result));
+    return result;
+  }
+
+} /* namespace sick_scan */
@@ -0,0 +1,294 @@
+/*
+ * @brief Reduction of pointclouds by decimation, range bins or voxel grid
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 11.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#include <ros/ros.h>
+
+#include "sick_scan/sick_scan_cloud_reducer.h"
+
+namespace sick_scan
+{
+  static inline bool readPoint(const uint8_t* point, int offset_x, int offset_y, int offset_z, float& x, float& y, float& z)
+  {
+    memcpy(&x, point + offset_x, sizeof(float));
+    memcpy(&y, point + offset_y, sizeof(float));
+    memcpy(&z, point + offset_z, sizeof(float));
+    return std::isfinite(x) && std::isfinite(y) && std::isfinite(z);
+  }
+
+  SickScanCloudReducer::SickScanCloudReducer()
+  : m_reduction(REDUCTION_NONE), m_decimation(1), m_bin_size(1), m_inv_voxel_size(10.0f), m_voxel_gen(0)
+  {
+  }
+
+  bool SickScanCloudReducer::setReduction(const std::string& reduction_name, int decimation, int bin_size, double voxel_size)
+  {
+    for (int n = 0; n < REDUCTION_NUM; n++)
+    {
+      if (reduction_name == reductionName((REDUCTION)n))
+      {
+        m_reduction = (REDUCTION)n;
+        m_decimation = std::max(1, decimation);
+        m_bin_size = std::max(1, bin_size);
+        m_inv_voxel_size = (voxel_size > 0) ? (float)(1.0 / voxel_size) : 10.0f;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const char* SickScanCloudReducer::reductionName(REDUCTION reduction)
+  {
+    static const char* names[REDUCTION_NUM] = { "none", "decimation", "range_bin", "voxel" };
+    return (reduction >= 0 && reduction < REDUCTION_NUM) ? names[reduction] : "unknown";
+  }
+
+  const sensor_msgs::PointCloud2& SickScanCloudReducer::reduce(const sensor_msgs::PointCloud2& cloud)
+  {
+    int offset_x = -1, offset_y = -1, offset_z = -1;
+    m_float_offsets.clear();
+    for (size_t field_idx = 0; field_idx < cloud.fields.size(); field_idx++)
+    {
+      if (cloud.fields[field_idx].datatype != sensor_msgs::PointField::FLOAT32)
+        continue;
+      const std::string& name = cloud.fields[field_idx].name;
+      if (name == "x")
+        offset_x = cloud.fields[field_idx].offset;
+      else if (name == "y")
+        offset_y = cloud.fields[field_idx].offset;
+      else if (name == "z")
+        offset_z = cloud.fields[field_idx].offset;
+      m_float_offsets.push_back(cloud.fields[field_idx].offset);
+    }
+    if (m_reduction == REDUCTION_NONE || offset_x < 0 || offset_y < 0 || offset_z < 0 || cloud.data.empty())
+      return cloud;
+    switch (m_reduction)
+    {
+      case REDUCTION_DECIMATION:
+        decimate(cloud);
+        break;
+      case REDUCTION_RANGE_BIN:
+        reduceRangeBins(cloud, offset_x, offset_y, offset_z);
+        break;
+      case REDUCTION_VOXEL:
+        reduceVoxelGrid(cloud, offset_x, offset_y, offset_z);
+        break;
+      default:
+        return cloud;
+    }
+    return m_cloud;
+  }
+
+  /*!
+  \brief Initializes the reduced cloud with the header and fields of the input cloud and resizes its data.
+  Resizing a vector does not release its capacity, i.e. data is allocated only once for the largest cloud.
+  */
+  void SickScanCloudReducer::initOutput(const sensor_msgs::PointCloud2& cloud, uint32_t height, uint32_t width)
+  {
+    m_cloud.header = cloud.header;
+    m_cloud.fields = cloud.fields;
+    m_cloud.is_bigendian = cloud.is_bigendian;
+    m_cloud.point_step = cloud.point_step;
+    m_cloud.height = height;
+    m_cloud.width = width;
+    m_cloud.row_step = m_cloud.point_step * m_cloud.width;
+    m_cloud.data.resize((size_t)m_cloud.row_step * m_cloud.height);
+  }
+
+  void SickScanCloudReducer::decimate(const sensor_msgs::PointCloud2& cloud)
+  {
+    uint32_t width = (cloud.width + m_decimation - 1) / m_decimation;
+    initOutput(cloud, cloud.height, width);
+    m_cloud.is_dense = cloud.is_dense;
+    uint8_t* dst = &m_cloud.data[0];
+    for (uint32_t row = 0; row < cloud.height; row++)
+    {
+      const uint8_t* src = &cloud.data[0] + (size_t)row * cloud.row_step;
+      for (uint32_t col = 0; col < cloud.width; col += m_decimation, dst += m_cloud.point_step)
+        memcpy(dst, src + (size_t)col * cloud.point_step, cloud.point_step);
+    }
+  }
+
+  void SickScanCloudReducer::reduceRangeBins(const sensor_msgs::PointCloud2& cloud, int offset_x, int offset_y, int offset_z)
+  {
+    uint32_t num_bins = (cloud.width + m_bin_size - 1) / m_bin_size;
+    initOutput(cloud, 1, 2 * num_bins * cloud.height); // upper bound, shrinked below
+    uint8_t* dst = &m_cloud.data[0];
+    uint32_t num_points = 0;
+    for (uint32_t row = 0; row < cloud.height; row++)
+    {
+      const uint8_t* src_row = &cloud.data[0] + (size_t)row * cloud.row_step;
+      for (uint32_t col_start = 0; col_start < cloud.width; col_start += m_bin_size)
+      {
+        uint32_t col_end = std::min<uint32_t>(col_start + m_bin_size, cloud.width);
+        const uint8_t* min_point = NULL;
+        const uint8_t* max_point = NULL;
+        float min_range_sq = 0, max_range_sq = 0;
+        for (uint32_t col = col_start; col < col_end; col++)
+        {
+          const uint8_t* point = src_row + (size_t)col * cloud.point_step;
+          float x, y, z;
+          if (!readPoint(point, offset_x, offset_y, offset_z, x, y, z))
+            continue;
+          float range_sq = x * x + y * y + z * z;
+          if (min_point == NULL || range_sq < min_range_sq)
+          {
+            min_point = point;
+            min_range_sq = range_sq;
+          }
+          if (max_point == NULL || range_sq > max_range_sq)
+          {
+            max_point = point;
+            max_range_sq = range_sq;
+          }
+        }
+        if (min_point != NULL)
+        {
+          memcpy(dst, min_point, cloud.point_step);
+          dst += cloud.point_step;
+          num_points++;
+        }
+        if (max_point != NULL && max_point != min_point)
+        {
+          memcpy(dst, max_point, cloud.point_step);
+          dst += cloud.point_step;
+          num_points++;
+        }
+      }
+    }
+    m_cloud.width = num_points;
+    m_cloud.row_step = m_cloud.point_step * m_cloud.width;
+    m_cloud.data.resize(m_cloud.row_step);
+    m_cloud.is_dense = true;
+  }
+
+  void SickScanCloudReducer::reduceVoxelGrid(const sensor_msgs::PointCloud2& cloud, int offset_x, int offset_y, int offset_z)
+  {
+    size_t num_input_points = (size_t)cloud.width * cloud.height;
+    size_t num_fields = m_float_offsets.size();
+
+    // Hash table with at least twice as many slots as points, i.e. a load factor <= 0.5
+    int table_bits = 4;
+    while (((size_t)1 << table_bits) < 2 * num_input_points)
+      table_bits++;
+    size_t table_size = (size_t)1 << table_bits;
+    if (m_voxel_keys.size() < table_size)
+    {
+      m_voxel_keys.resize(table_size);
+      m_voxel_slot_index.resize(table_size);
+      m_voxel_slot_gen.assign(table_size, 0);
+      m_voxel_gen = 0;
+    }
+    table_size = m_voxel_keys.size();
+    while (((size_t)1 << table_bits) < table_size)
+      table_bits++;
+    if (m_voxel_count.size() < num_input_points)
+    {
+      m_voxel_count.resize(num_input_points);
+      m_voxel_sum.resize(num_input_points * num_fields);
+    }
+    else if (m_voxel_sum.size() < num_input_points * num_fields)
+    {
+      m_voxel_sum.resize(num_input_points * num_fields);
+    }
+    if (++m_voxel_gen == 0) // generation counter overflow: clear all slots
+    {
+      m_voxel_slot_gen.assign(m_voxel_slot_gen.size(), 0);
+      m_voxel_gen = 1;
+    }
+
+    // Accumulate all float fields per voxel
+    size_t num_voxels = 0;
+    const size_t table_mask = table_size - 1;
+    for (uint32_t row = 0; row < cloud.height; row++)
+    {
+      const uint8_t* point = &cloud.data[0] + (size_t)row * cloud.row_step;
+      for (uint32_t col = 0; col < cloud.width; col++, point += cloud.point_step)
+      {
+        float x, y, z;
+        if (!readPoint(point, offset_x, offset_y, offset_z, x, y, z))
+          continue;
+        // voxel key: 21 bit per coordinate, i.e. +/- 2^20 voxel
+        uint64_t ix = (uint64_t)(int64_t)floorf(x * m_inv_voxel_size) & 0x1FFFFF;
+        uint64_t iy = (uint64_t)(int64_t)floorf(y * m_inv_voxel_size) & 0x1FFFFF;
+        uint64_t iz = (uint64_t)(int64_t)floorf(z * m_inv_voxel_size) & 0x1FFFFF;
+        uint64_t key = (ix << 42) | (iy << 21) | iz;
+        size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits)); // fibonacci hashing
+        while (m_voxel_slot_gen[slot] == m_voxel_gen && m_voxel_keys[slot] != key)
+          slot = (slot + 1) & table_mask;
+        if (m_voxel_slot_gen[slot] != m_voxel_gen) // new voxel
+        {
+          m_voxel_slot_gen[slot] = m_voxel_gen;
+          m_voxel_keys[slot] = key;
+          m_voxel_slot_index[slot] = (int32_t)num_voxels;
+          m_voxel_count[num_voxels] = 0;
+          memset(&m_voxel_sum[num_voxels * num_fields], 0, num_fields * sizeof(float));
+          num_voxels++;
+        }
+        int32_t voxel = m_voxel_slot_index[slot];
+        float* sum = &m_voxel_sum[voxel * num_fields];
+        for (size_t field_idx = 0; field_idx < num_fields; field_idx++)
+        {
+          float value;
+          memcpy(&value, point + m_float_offsets[field_idx], sizeof(float));
+          sum[field_idx] += value;
+        }
+        m_voxel_count[voxel]++;
+      }
+    }
+
+    // Output the centroids in order of their first point
+    initOutput(cloud, 1, (uint32_t)num_voxels);
+    m_cloud.is_dense = true;
+    if (num_voxels == 0)
+      return;
+    memset(&m_cloud.data[0], 0, m_cloud.data.size());
+    uint8_t* dst = &m_cloud.data[0];
+    for (size_t voxel = 0; voxel < num_voxels; voxel++, dst += m_cloud.point_step)
+    {
+      const float* sum = &m_voxel_sum[voxel * num_fields];
+      float scale = 1.0f / m_voxel_count[voxel];
+      for (size_t field_idx = 0; field_idx < num_fields; field_idx++)
+      {
+        float value = sum[field_idx] * scale;
+        memcpy(dst + m_float_offsets[field_idx], &value, sizeof(float));
+      }
+    }
+  }
+
+} /* namespace sick_scan */
@@ -93,6 +93,7 @@
 #include <climits>
 #include <sick_scan/sick_generic_imu.h>
 #include <sick_scan/sick_scan_messages.h>
+#include <sick_scan/sick_scan_realtime.h>
 
 /*!
 \brief Universal swapping function
@@ -367,7 +368,9 @@ namespace sick_scan
       datagram_pub_ = nh_.advertise<std_msgs::String>("datagram", 1000);
     }
 
+    outputChannelFlagId = 1; // first echo, set by initOutputChannelFlags()
     cloud_marker_ = 0;
+    field_evaluator_ = 0;
     publish_lferec_ = false;
     publish_lidoutputstate_ = false;
     const std::string scannername = parser_->getCurrentParamPtr()->getScannerName();
@@ -378,6 +381,14 @@ namespace sick_scan
       publish_lferec_ = true;
       publish_lidoutputstate_ = true;
       cloud_marker_ = new sick_scan::SickScanMarker(&nh_, scannername + "/marker", "cloud");
+      bool field_eval_enable = false;
+      pn.param<bool>("field_eval_enable", field_eval_enable, false);
+      if (field_eval_enable)
+      {
+        field_evaluator_ = new sick_scan::SickScanFieldMonEvaluator();
+        field_eval_pub_ = nh_.advertise<sick_scan::FieldEvalMsg>(scannername + "/field_eval", 100);
+        ROS_INFO_STREAM("Host-side field evaluation activated, publishing field evaluation to " << scannername << "/field_eval");
+      }
     }
 
     // Pointcloud2 publisher
@@ -390,6 +401,148 @@ namespace sick_scan
     ROS_INFO("Publishing laserscan-pointcloud2 to %s", cloud_topic_val.c_str());
     cloud_pub_ = nh_.advertise<sensor_msgs::PointCloud2>(cloud_topic_val, 100);
 
+    // sector angle in degree for cloud_output_mode 2
+    double cloud_sector_angle_deg = 10.0;
+    pn.param<double>("cloud_sector_angle", cloud_sector_angle_deg, 10.0);
+    cloud_sector_angle_ = cloud_sector_angle_deg * M_PI / 180.0;
+
+    // number of threads for the pointcloud build
+    int cloud_build_threads = 1;
+    cloud_build_pool_ = 0;
+    pn.param<int>("cloud_build_threads", cloud_build_threads, 1);
+    if (cloud_build_threads > 1)
+    {
+      cloud_build_pool_ = new sick_scan::SickScanThreadPool(cloud_build_threads);
+    }
+
+    // per point time and motion compensation of the pointcloud
+    bool cloud_deskew = false;
+    cloud_deskew_ = 0;
+    pn.param<bool>("cloud_point_time", cloud_point_time_, false);
+    pn.param<bool>("cloud_deskew", cloud_deskew, false);
+    if (cloud_deskew)
+    {
+      std::string deskew_odom_topic, deskew_imu_topic;
+      pn.param<std::string>("deskew_odom_topic", deskew_odom_topic, "");
+      pn.param<std::string>("deskew_imu_topic", deskew_imu_topic, "");
+      cloud_point_time_ = true; // deskew requires the point times
+      cloud_deskew_ = new sick_scan::SickScanDeskew();
+      if (!deskew_odom_topic.empty())
+      {
+        deskew_odom_sub_ = nh_.subscribe(deskew_odom_topic, 100, &sick_scan::SickScanDeskew::odometryCallback, cloud_deskew_);
+      }
+      if (!deskew_imu_topic.empty())
+      {
+        deskew_imu_sub_ = nh_.subscribe(deskew_imu_topic, 100, &sick_scan::SickScanDeskew::imuCallback, cloud_deskew_);
+      }
+      bool imu_enable = false;
+      pn.getParam("imu_enable", imu_enable);
+      ROS_INFO("Pointcloud deskew activated (odometry: \"%s\", imu: \"%s\", scanner imu: %s)", deskew_odom_topic.c_str(), deskew_imu_topic.c_str(),
+               imu_enable ? "enabled" : "disabled");
+    }
+
+    // host-side echo selection
+    std::string echo_policy = "all";
+    double echo_policy_intensity_threshold = 0;
+    pn.param<std::string>("echo_policy", echo_policy, "all");
+    pn.param<double>("echo_policy_intensity_threshold", echo_policy_intensity_threshold, 0.0);
+    if (!echo_policy_.setPolicy(echo_policy, (float)echo_policy_intensity_threshold))
+    {
+      ROS_WARN("Unknown echo_policy \"%s\", all echos used (supported: all, first, last, strongest, last_above_threshold)", echo_policy.c_str());
+    }
+    else if (echo_policy_.getPolicy() != SickScanEchoPolicy::ECHO_ALL)
+    {
+      ROS_INFO("Echo policy %s", echo_policy.c_str());
+    }
+
+    // reduced pointcloud
+    std::string cloud_reduction = "none", cloud_reduced_topic = "cloud_reduced";
+    int cloud_reduction_decimation = 4, cloud_reduction_bin_size = 10;
+    double cloud_reduction_voxel_size = 0.1;
+    pn.param<std::string>("cloud_reduction", cloud_reduction, "none");
+    pn.param<int>("cloud_reduction_decimation", cloud_reduction_decimation, 4);
+    pn.param<int>("cloud_reduction_bin_size", cloud_reduction_bin_size, 10);
+    pn.param<double>("cloud_reduction_voxel_size", cloud_reduction_voxel_size, 0.1);
+    pn.param<std::string>("cloud_reduced_topic", cloud_reduced_topic, "cloud_reduced");
+    pn.param<bool>("cloud_publish_full", cloud_publish_full_, true);
+    if (!cloud_reducer_.setReduction(cloud_reduction, cloud_reduction_decimation, cloud_reduction_bin_size, cloud_reduction_voxel_size))
+    {
+      ROS_WARN("Unknown cloud_reduction \"%s\", pointcloud not reduced (supported: none, decimation, range_bin, voxel)", cloud_reduction.c_str());
+    }
+    if (cloud_reducer_.getReduction() != SickScanCloudReducer::REDUCTION_NONE)
+    {
+      cloud_reduced_pub_ = nh_.advertise<sensor_msgs::PointCloud2>(cloud_reduced_topic, 100);
+      ROS_INFO("Publishing reduced pointcloud (%s) to %s", cloud_reduction.c_str(), cloud_reduced_topic.c_str());
+    }
+    else
+    {
+      cloud_publish_full_ = true;
+    }
+
+    // shared memory transport of the pointcloud for co-located non-ROS clients
+    std::string cloud_shm_name = "";
+    int cloud_shm_slots = 8, cloud_shm_slot_size = 4 * 1024 * 1024;
+    cloud_shm_ = 0;
+    pn.param<std::string>("cloud_shm_name", cloud_shm_name, "");
+    pn.param<int>("cloud_shm_slots", cloud_shm_slots, 8);
+    pn.param<int>("cloud_shm_slot_size", cloud_shm_slot_size, 4 * 1024 * 1024);
+    if (!cloud_shm_name.empty())
+    {
+      cloud_shm_ = new sick_scan::SickScanShmRingWriter();
+      if (cloud_shm_->open(cloud_shm_name, cloud_shm_slots, cloud_shm_slot_size))
+      {
+        ROS_INFO("Writing pointclouds to shared memory %s (%d slots of %d byte)", cloud_shm_name.c_str(), cloud_shm_slots, cloud_shm_slot_size);
+      }
+      else
+      {
+        ROS_ERROR("## ERROR: could not create shared memory %s for pointclouds", cloud_shm_name.c_str());
+        delete cloud_shm_;
+        cloud_shm_ = 0;
+      }
+    }
+
+    // range and intensity images
+    bool range_image_enable = false;
+    range_image_ = 0;
+    pn.param<bool>("range_image_enable", range_image_enable, false);
+    if (range_image_enable)
+    {
+      std::string range_image_topic = "range_image", intensity_image_topic = "intensity_image";
+      pn.param<std::string>("range_image_topic", range_image_topic, "range_image");
+      pn.param<std::string>("intensity_image_topic", intensity_image_topic, "intensity_image");
+      range_image_ = new sick_scan::SickScanRangeImage();
+      range_image_pub_ = nh_.advertise<sensor_msgs::Image>(range_image_topic, 10);
+      intensity_image_pub_ = nh_.advertise<sensor_msgs::Image>(intensity_image_topic, 10);
+      ROS_INFO("Publishing range images to %s and intensity images to %s", range_image_topic.c_str(), intensity_image_topic.c_str());
+    }
+
+    // point layout of the pointcloud
+    std::string cloud_encoding = "float32";
+    double cloud_encoding_resolution = 0.001;
+    pn.param<std::string>("cloud_encoding", cloud_encoding, "float32");
+    pn.param<double>("cloud_encoding_resolution", cloud_encoding_resolution, 0.001);
+    if (!cloud_encoder_.setEncoding(cloud_encoding, cloud_encoding_resolution))
+    {
+      ROS_WARN("Unknown cloud_encoding \"%s\", using float32 (supported: float32, int16, int32, float16, polar)", cloud_encoding.c_str());
+    }
+    else if (cloud_encoder_.getEncoding() != SickScanCloudEncoder::ENCODING_FLOAT32)
+    {
+      ROS_INFO("Pointcloud encoding %s (%d byte per point, resolution %.4f m)", cloud_encoding.c_str(),
+               SickScanCloudEncoder::pointStep(cloud_encoder_.getEncoding(), cloud_point_time_), cloud_encoding_resolution);
+      // int16 coordinates and polar ranges are limited to 32767 resp. 65535 units, points beyond are invalid
+      double encodingRangeLimit = 0;
+      if (cloud_encoder_.getEncoding() == SickScanCloudEncoder::ENCODING_INT16)
+        encodingRangeLimit = 32767 * cloud_encoding_resolution;
+      else if (cloud_encoder_.getEncoding() == SickScanCloudEncoder::ENCODING_POLAR)
+        encodingRangeLimit = 65535 * cloud_encoding_resolution;
+      if (encodingRangeLimit > 0 && encodingRangeLimit < parser_->get_range_max())
+      {
+        ROS_WARN("Pointcloud encoding %s with resolution %.4f m covers ranges up to %.3f m only, but range_max is %.3f m: points beyond are invalid."
+                 " Increase cloud_encoding_resolution to at least %.4f m to cover range_max.", cloud_encoding.c_str(), cloud_encoding_resolution,
+                 encodingRangeLimit, parser_->get_range_max(), cloud_encoding_resolution * parser_->get_range_max() / encodingRangeLimit);
+      }
+    }
+
     imuScan_pub_ = nh_.advertise<sensor_msgs::Imu>("imu", 100);
 
 
@@ -412,6 +565,51 @@ namespace sick_scan
                                                                                                 config_.time_offset));
     ROS_ASSERT(diagnosticPub_ != NULL);
 #endif
+
+    // Profiling of the receive and publish pipeline
+    bool profiling_enable = false;
+    profiling_dump_interval_ = 0;
+    pn.param<bool>("profiling_enable", profiling_enable, false);
+    pn.param<double>("profiling_dump_interval", profiling_dump_interval_, 10.0);
+    SickScanProfiling::instance().setEnabled(profiling_enable);
+    if (profiling_enable)
+    {
+      diagnostics_.add("profiling", this, &SickScanCommon::profilingDiagnostics);
+      ROS_INFO("Profiling activated, summary published on /diagnostics and logged every %.1f seconds", profiling_dump_interval_);
+    }
+    profiling_last_dump_ = ros::Time::now();
+
+    // Optional realtime mode: cpu affinity and SCHED_FIFO priority of receive thread and main loop,
+    // busy polling of the scan socket, spin-then-block waiting for datagrams and memory locking
+    int rt_receive_cpu = -1, rt_receive_priority = 0, rt_main_cpu = -1, rt_main_priority = 0, rt_busy_poll_usec = 0, rt_spin_usec = 0;
+    bool rt_lock_memory = false;
+    pn.param<int>("rt_receive_cpu", rt_receive_cpu, -1);
+    pn.param<int>("rt_receive_priority", rt_receive_priority, 0);
+    pn.param<int>("rt_main_cpu", rt_main_cpu, -1);
+    pn.param<int>("rt_main_priority", rt_main_priority, 0);
+    pn.param<int>("rt_busy_poll_usec", rt_busy_poll_usec, 0);
+    pn.param<int>("rt_spin_usec", rt_spin_usec, 0);
+    pn.param<bool>("rt_lock_memory", rt_lock_memory, false);
+    SickScanRealtime &realtime = SickScanRealtime::instance();
+    realtime.setThreadConfig(SickScanRealtime::THREAD_RECEIVE, rt_receive_cpu, rt_receive_priority);
+    realtime.setThreadConfig(SickScanRealtime::THREAD_MAIN, rt_main_cpu, rt_main_priority);
+    realtime.setBusyPollUsec(rt_busy_poll_usec);
+    realtime.setSpinUsec(rt_spin_usec);
+    std::string rt_error;
+    if (rt_lock_memory && !SickScanRealtime::lockMemory(rt_error))
+    {
+      ROS_WARN("Realtime mode: %s", rt_error.c_str());
+    }
+    rt_error.clear();
+    if (!realtime.applyThreadConfigToCurrentThread(SickScanRealtime::THREAD_MAIN, rt_error))
+    {
+      ROS_WARN("Realtime mode: %s", rt_error.c_str());
+    }
+    if (rt_receive_cpu >= 0 || rt_receive_priority > 0 || rt_main_cpu >= 0 || rt_main_priority > 0 || rt_busy_poll_usec > 0 || rt_spin_usec > 0 || rt_lock_memory)
+    {
+      ROS_INFO("Realtime mode: receive thread cpu %d priority %d, main loop cpu %d priority %d, busy poll %d usec, spin %d usec, memory %s",
+               rt_receive_cpu, rt_receive_priority, rt_main_cpu, rt_main_priority, rt_busy_poll_usec, rt_spin_usec, rt_lock_memory ? "locked" : "not locked");
+    }
   }
 
   /*!
@@ -567,6 +765,11 @@ namespace sick_scan
   SickScanCommon::~SickScanCommon()
   {
     delete cloud_marker_;
+    delete field_evaluator_;
+    delete cloud_deskew_;
+    delete range_image_;
+    delete cloud_shm_;
+    delete cloud_build_pool_;
     delete diagnosticPub_;
 
     printf("sick_scan driver exiting.\n");
@@ -839,6 +1042,11 @@ namespace sick_scan
       ROS_FATAL("Failed to init device: %d", result);
       return result;
     }
+    if (isDatagramReplayActive())
+    {
+      initOutputChannelFlags(); // echo filter of the replayed scans, the output channels are not configured
+      return ExitSuccess; // no scanner initialization if datagrams are replayed from file
+    }
 
     result = init_scanner();
     if (result != 0)
@@ -1154,23 +1362,79 @@ namespace sick_scan
 
 
   /*!
-  \brief initialize scanner
-  \return exit code
+  \brief Parses parameter active_echos and returns the output channel flags of all echos. Sets outputChannelFlagId,
+  i.e. the mask of the echos transmitted by the device (LMS5xx: first echo only). Called by init_scanner and
+  in replay mode, where the device is not initialized.
+  \return output channel flag of each echo
   */
-  int SickScanCommon::init_scanner()
+  std::vector<bool> SickScanCommon::initOutputChannelFlags(void)
   {
+    ros::NodeHandle pn("~");
+    int maxNumberOfEchos = this->parser_->getCurrentParamPtr()->getNumberOfMaximumEchos();  // 1 for TIM 571, 3 for MRS1104, 5 for 6000
+    int activeEchos = 0;
+    pn.getParam("active_echos", activeEchos);
 
-    const int MAX_STR_LEN = 1024;
+    ROS_INFO("Parameter setting for <active_echo: %d>", activeEchos);
+    std::vector<bool> outputChannelFlag;
+    outputChannelFlag.resize(maxNumberOfEchos);
+    int i;
+    int numOfFlags = 0;
+    for (i = 0; i < outputChannelFlag.size(); i++)
+    {
+      /*
+      After consultation with the company SICK,
+      all flags are set to true because the firmware currently does not support single selection of targets.
+      The selection of the echoes takes place via FREchoFilter.
+       */
+      /* former implementation
+      if (activeEchos & (1 << i))
+      {
+        outputChannelFlag[i] = true;
+        numOfFlags++;
+      }
+      else
+      {
+        outputChannelFlag[i] = false;
+      }
+       */
+      outputChannelFlag[i] = true; // always true (see comment above)
+      numOfFlags++;
+    }
 
-    int maxNumberOfEchos = 1;
+    if (numOfFlags == 0) // Fallback-Solution
+    {
+      outputChannelFlag[0] = true;
+      numOfFlags = 1;
+      ROS_WARN("Activate at least one echo.");
+    }
 
+    outputChannelFlagId = 0x00;
+    for (size_t i = 0; i < outputChannelFlag.size(); i++)
+    {
+      outputChannelFlagId |= ((outputChannelFlag[i] == true) << i);
+    }
+    if (outputChannelFlagId < 1)
+    {
+      outputChannelFlagId = 1;  // at least one channel must be set
+    }
+    if (this->parser_->getCurrentParamPtr()->getScannerName().compare(SICK_SCANNER_LMS_5XX_NAME) == 0)
+    {
+      outputChannelFlagId = 1; // see SICK Telegram listing "Telegram structure: sWN LMDscandatacfg"
+    }
+    return outputChannelFlag;
+  }
 
-    maxNumberOfEchos = this->parser_->getCurrentParamPtr()->getNumberOfMaximumEchos();  // 1 for TIM 571, 3 for MRS1104, 5 for 6000
+  /*!
+  \brief initialize scanner
+  \return exit code
+  */
+  int SickScanCommon::init_scanner()
+  {
 
+    const int MAX_STR_LEN = 1024;
 
     bool rssiFlag = false;
     bool rssiResolutionIs16Bit = true; //True=16 bit Flase=8bit
-    int activeEchos = 0;
     ros::NodeHandle pn("~");
 
     pn.getParam("intensity", rssiFlag);
@@ -1213,42 +1477,8 @@ namespace sick_scan
     }
 
     this->parser_->getCurrentParamPtr()->setIntensityResolutionIs16Bit(rssiResolutionIs16Bit);
-    // parse active_echos entry and set flag array
-    pn.getParam("active_echos", activeEchos);
-
-    ROS_INFO("Parameter setting for <active_echo: %d>", activeEchos);
-    std::vector<bool> outputChannelFlag;
-    outputChannelFlag.resize(maxNumberOfEchos);
-    int i;
-    int numOfFlags = 0;
-    for (i = 0; i < outputChannelFlag.size(); i++)
-    {
-      /*
-      After consultation with the company SICK,
-      all flags are set to true because the firmware currently does not support single selection of targets.
-      The selection of the echoes takes place via FREchoFilter.
-       */
-      /* former implementation
-      if (activeEchos & (1 << i))
-      {
-        outputChannelFlag[i] = true;
-        numOfFlags++;
-      }
-      else
-      {
-        outputChannelFlag[i] = false;
-      }
-       */
-      outputChannelFlag[i] = true; // always true (see comment above)
-      numOfFlags++;
-    }
-
-    if (numOfFlags == 0) // Fallback-Solution
-    {
-      outputChannelFlag[0] = true;
-      numOfFlags = 1;
-      ROS_WARN("Activate at least one echo.");
-    }
+    // parse active_echos entry and set flag array, sets outputChannelFlagId
+    std::vector<bool> outputChannelFlag = initOutputChannelFlags();
 
     //================== DEFINE ENCODER SETTING ==========================
     int EncoderSetings = -1; //Do not use encoder commands as default
@@ -2077,18 +2307,9 @@ namespace sick_scan
       // Prepare flag array for echos
       // Except for the LMS5xx scanner here the mask is hard 00 see SICK Telegram listing "Telegram structure: sWN LMDscandatacfg" for details
 
-      outputChannelFlagId = 0x00;
-      for (size_t i = 0; i < outputChannelFlag.size(); i++)
-      {
-        outputChannelFlagId |= ((outputChannelFlag[i] == true) << i);
-      }
-      if (outputChannelFlagId < 1)
-      {
-        outputChannelFlagId = 1;  // at least one channel must be set
-      }
+      // outputChannelFlagId has been set from outputChannelFlag by initOutputChannelFlags()
       if (this->parser_->getCurrentParamPtr()->getScannerName().compare(SICK_SCANNER_LMS_5XX_NAME) == 0)
       {
-        outputChannelFlagId = 1;
         ROS_INFO("LMS 5xx detected overwriting output channel flag ID");
 
         ROS_INFO("LMS 5xx detected overwriting resolution flag (only 8 bit supported)");
@@ -2124,6 +2345,11 @@ namespace sick_scan
             fieldMon->parseAsciiDatagram(fieldcfgReply);
           }
         }
+        if(field_evaluator_)
+        {
+          field_evaluator_->invalidate(); // field geometry may have changed, recompute the threshold table with the next scan
+          ROS_INFO_STREAM("Host-side field evaluation: " << fieldMon->getMonFields().size() << " fields read, threshold table will be updated");
+        }
         if(cloud_marker_)
         {
           int fieldset = 0;
@@ -2670,6 +2896,94 @@ namespace sick_scan
     return reply_str;
   }
 
+  /*!
+  \brief diagnostic task reporting the profiling counters and latencies (active if profiling_enable is set)
+  \param stat diagnostic status
+  */
+  void sick_scan::SickScanCommon::profilingDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat)
+  {
+    SickScanProfiling &profiling = SickScanProfiling::instance();
+    if (profiling.getCounter(SickScanProfiling::COUNTER_FRAMES_DROPPED) > 0)
+    {
+      stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, "Frames dropped");
+    }
+    else
+    {
+      stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "OK");
+    }
+    stat.add("cloud_encoding", std::string(SickScanCloudEncoder::encodingName(cloud_encoder_.getEncoding())));
+    for (int n = 0; n < SickScanProfiling::COUNTER_NUM; n++)
+    {
+      SickScanProfiling::COUNTER counter = (SickScanProfiling::COUNTER)n;
+      stat.add(SickScanProfiling::counterName(counter), profiling.getCounter(counter));
+      stat.addf(std::string(SickScanProfiling::counterName(counter)) + "_per_sec", "%.1f", profiling.getCounterRate(counter));
+    }
+    for (int n = 0; n < SickScanProfiling::GAUGE_NUM; n++)
+    {
+      SickScanProfiling::GAUGE gauge = (SickScanProfiling::GAUGE)n;
+      stat.add(SickScanProfiling::gaugeName(gauge), profiling.getGauge(gauge));
+      stat.add(std::string(SickScanProfiling::gaugeName(gauge)) + "_max", profiling.getGaugeMax(gauge));
+    }
+    for (int n = 0; n < SickScanProfiling::STAGE_NUM; n++)
+    {
+      SickScanProfiling::STAGE stage = (SickScanProfiling::STAGE)n;
+      std::string name = SickScanProfiling::stageName(stage);
+      stat.add(name + "_count", profiling.getLatencyCount(stage));
+      stat.addf(name + "_mean_usec", "%.1f", profiling.getLatencyMeanMicroSec(stage));
+      stat.addf(name + "_p50_usec", "%.1f", profiling.getLatencyPercentileMicroSec(stage, 50));
+      stat.addf(name + "_p99_usec", "%.1f", profiling.getLatencyPercentileMicroSec(stage, 99));
+      stat.addf(name + "_max_usec", "%.1f", profiling.getLatencyMaxMicroSec(stage));
+    }
+  }
+
+  /*!
+  \brief Writes a pointcloud into the shared memory ring buffer, if parameter cloud_shm_name is set
+  \param publish_time_nsec system time taken before the pointcloud was published by ros, written as header.write_time_nsec
+  */
+  void sick_scan::SickScanCommon::writeCloudToShm(const sensor_msgs::PointCloud2 &cloud, uint64_t publish_time_nsec)
+  {
+    if (cloud_shm_ == NULL)
+    {
+      return;
+    }
+    SickScanShmCloudHeader header;
+    memset(&header, 0, sizeof(header));
+    header.write_time_nsec = publish_time_nsec;
+    header.stamp_sec = cloud.header.stamp.sec;
+    header.stamp_nsec = cloud.header.stamp.nsec;
+    strncpy(header.frame_id, cloud.header.frame_id.c_str(), SickScanShmCloudHeader::MAX_FRAME_ID_LENGTH - 1);
+    header.height = cloud.height;
+    header.width = cloud.width;
+    header.point_step = cloud.point_step;
+    header.row_step = cloud.row_step;
+    header.is_bigendian = cloud.is_bigendian;
+    header.is_dense = cloud.is_dense;
+    header.resolution = SickScanCloudEncoder::getResolution(cloud);
+    header.num_fields = 0;
+    for (uint32_t n = 0; n < cloud.fields.size() && header.num_fields < SickScanShmCloudHeader::MAX_FIELDS; n++)
+    {
+      if (cloud.fields[n].count == 0)
+      {
+        continue; // metadata field "resolution=<meter>", carried by header.resolution
+      }
+      if (cloud.fields[n].name.size() >= SickScanShmCloudHeader::MAX_NAME_LENGTH)
+      {
+        ROS_WARN_THROTTLE(1.0, "Name of pointcloud field \"%s\" too long for the shared memory, field not written", cloud.fields[n].name.c_str());
+        continue;
+      }
+      SickScanShmCloudHeader::Field &field = header.fields[header.num_fields++];
+      strncpy(field.name, cloud.fields[n].name.c_str(), SickScanShmCloudHeader::MAX_NAME_LENGTH - 1);
+      field.offset = cloud.fields[n].offset;
+      field.datatype = cloud.fields[n].datatype;
+      field.count = cloud.fields[n].count;
+    }
+    if (!cloud_shm_->write(header, cloud.data.empty() ? NULL : &cloud.data[0], cloud.data.size()))
+    {
+      ROS_WARN_THROTTLE(1.0, "Pointcloud of %zu byte exceeds the slot size of the shared memory (parameter cloud_shm_slot_size), pointcloud not written",
+                        cloud.data.size());
+    }
+  }
+
   bool sick_scan::SickScanCommon::dumpDatagramForDebugging(unsigned char *buffer, int bufLen)
   {
     bool ret = true;
@@ -2794,6 +3108,13 @@ namespace sick_scan
     static int cnt = 0;
     diagnostics_.update();
 
+    if (profiling_dump_interval_ > 0 && SickScanProfiling::instance().isEnabled()
+        && (ros::Time::now() - profiling_last_dump_).toSec() >= profiling_dump_interval_)
+    {
+      profiling_last_dump_ = ros::Time::now();
+      ROS_INFO_STREAM(SickScanProfiling::instance().toString());
+    }
+
     unsigned char receiveBuffer[65536];
     int actual_length = 0;
     static unsigned int iteration_count = 0;
@@ -2822,6 +3143,12 @@ namespace sick_scan
     static bool slamBundle = false;
     float timeIncrement;
     static std::string echoForSlam = "";
+    // channels of the binary data dump (parameter data_dump_file): datagram size at socket receive and delays
+    // after socket receive at queue pop, end of parsing and after publishing the pointcloud in seconds
+    static const int dumpChannelRecv = DataDumper::instance().channelId("DATAGRAM_RECV_BYTES");
+    static const int dumpChannelPop = DataDumper::instance().channelId("DATAGRAM_POP_DELAY");
+    static const int dumpChannelParsed = DataDumper::instance().channelId("DATAGRAM_PARSED_DELAY");
+    static const int dumpChannelPublished = DataDumper::instance().channelId("CLOUD_PUBLISHED_DELAY");
     if (firstTimeCalled == true)
     {
 
@@ -2850,12 +3177,22 @@ namespace sick_scan
       {
         return ExitSuccess;
       } // return success to continue looping
+      bool dataDumpActive = DataDumper::instance().isBinaryDumpActive();
+      if (dataDumpActive)
+      {
+        double recvTimeSec = recvTimeStamp.toSec();
+        DataDumper::instance().pushData(dumpChannelRecv, recvTimeSec, actual_length);
+        DataDumper::instance().pushData(dumpChannelPop, recvTimeSec, (ros::Time::now() - recvTimeStamp).toSec());
+      }
 
       // ----- if requested, skip frames
       if (iteration_count++ % (config_.skip + 1) != 0)
       {
+        SickScanProfiling::instance().incrementCounter(SickScanProfiling::COUNTER_FRAMES_SKIPPED);
         return ExitSuccess;
       }
+      SickScanProfiling &profiling = SickScanProfiling::instance();
+      uint64_t parseStartNanoSec = profiling.isEnabled() ? SickScanProfiling::nowNanoSec() : 0;
 
       ROS_DEBUG_STREAM("SickScanCommon::loopOnce: received " << actual_length << " byte data " << DataDumper::binDataToAsciiString(&receiveBuffer[0], std::min(32, actual_length)) << " ... ");
 
@@ -2979,8 +3316,15 @@ namespace sick_scan
       }
       else
       {
-
-        sensor_msgs::LaserScan msg;
+        // The laserscan message is a member: its ranges and intensities alternate with the buffers of the decoded scan
+        // (decoded_scan_.assign swaps them) and are reused without reallocation. All other fields are reset for each datagram.
+        std::vector<float> rangeBuffer, intensityBuffer;
+        rangeBuffer.swap(scan_msg_.ranges);
+        intensityBuffer.swap(scan_msg_.intensities);
+        scan_msg_ = sensor_msgs::LaserScan();
+        scan_msg_.ranges.swap(rangeBuffer);
+        scan_msg_.intensities.swap(intensityBuffer);
+        sensor_msgs::LaserScan &msg = scan_msg_;
         sick_scan::Encoder EncoderMsg;
         EncoderMsg.header.stamp = recvTimeStamp + ros::Duration(config_.time_offset);
         //TODO remove this hardcoded variable
@@ -3011,6 +3355,7 @@ namespace sick_scan
           int success = -1;
           int numEchos = 0;
           int echoMask = 0;
+          int echoFilterMask = outputChannelFlagId; // configured output channels
           bool publishPointCloud = true;
 
           if (useBinaryProtocol)
@@ -3057,31 +3402,26 @@ namespace sick_scan
                 // binary message
                 if (lenVal < actual_length)
                 {
-                  short elevAngleX200 = 0;  // signed short (F5 B2  -> Layer 24
+                  // Header and channels are decoded by SickScanCore::decodeScandata, the decoder of the ROS-free driver core.
+                  // Channels not used by echo_policy are not decoded. Ranges, intensities and vertical angles are swapped into
+                  // msg and vang_vec, i.e. the buffers alternate between core_scan_, msg and decoded_scan_ without reallocation.
+                  if (!SickScanCore::decodeScandata(receiveBuffer, actual_length, parser_->getCurrentParamPtr()->getScanMirroredAndShifted(),
+                                                    core_scan_, echo_policy_.decodeEchoMask()))
+                  {
+                    ROS_WARN_THROTTLE(1.0, "## ERROR SickScanCommon: invalid LMDscandata datagram of %d byte, scan dropped", actual_length);
+                    dataToProcess = false;
+                    break;
+                  }
+                  short elevAngleX200 = core_scan_.layer_angle_x200;  // signed short (F5 B2  -> Layer 24
                   // F5B2h -> -2638/200= -13.19°
-                  int scanFrequencyX100 = 0;
-                  double elevAngle = 0.00;
-                  double scanFrequency = 0.0;
-                  long measurementFrequencyDiv100 = 0; // multiply with 100
-                  int numOfEncoders = 0;
-                  int numberOf16BitChannels = 0;
-                  int numberOf8BitChannels = 0;
-                  uint32_t SystemCountScan = 0;
+                  uint32_t SystemCountScan = core_scan_.time_since_startup_usec;
                   static uint32_t lastSystemCountScan = 0;// this variable is used to ensure that only the first time stamp of an multi layer scann is used for PLL updating
-                  uint32_t SystemCountTransmit = 0;
-
-                  memcpy(&elevAngleX200, receiveBuffer + 50, 2);
-                  swap_endian((unsigned char *) &elevAngleX200, 2);
+                  uint32_t SystemCountTransmit = core_scan_.time_of_transmission_usec;
 
                   elevationAngleInRad = -elevAngleX200 / 200.0 * deg2rad_const;
                   //TODO check this ??
                   msg.header.seq = elevAngleX200; // should be multiple of 0.625° starting with -2638 (corresponding to 13.19°)
 
-                  memcpy(&SystemCountScan, receiveBuffer + 0x26, 4);
-                  swap_endian((unsigned char *) &SystemCountScan, 4);
-
-                  memcpy(&SystemCountTransmit, receiveBuffer + 0x2A, 4);
-                  swap_endian((unsigned char *) &SystemCountTransmit, 4);
                   double timestampfloat = recvTimeStamp.sec + recvTimeStamp.nsec * 1e-9;
                   bool bRet;
                   if (SystemCountScan !=
@@ -3141,362 +3481,31 @@ namespace sick_scan
                   // byte 48 + 49: output status (0 0)
                   // byte 50 + 51: reserved
 
-                  memcpy(&scanFrequencyX100, receiveBuffer + 52, 4);
-                  swap_endian((unsigned char *) &scanFrequencyX100, 4);
-
-                  memcpy(&measurementFrequencyDiv100, receiveBuffer + 56, 4);
-                  swap_endian((unsigned char *) &measurementFrequencyDiv100, 4);
-
-
-                  msg.scan_time = 1.0 / (scanFrequencyX100 / 100.0);
-
-                  //due firmware inconsistency
-                  if (measurementFrequencyDiv100 > 10000)
-                  {
-                    measurementFrequencyDiv100 /= 100;
-                  }
-                  msg.time_increment = 1.0 / (measurementFrequencyDiv100 * 100.0);
+                  msg.scan_time = 1.0 / core_scan_.scan_frequency;
+                  msg.time_increment = core_scan_.time_increment; // measurement frequency corrected for firmware inconsistency by the decoder
                   timeIncrement = msg.time_increment;
                   msg.range_min = parser_->get_range_min();
                   msg.range_max = parser_->get_range_max();
 
-                  memcpy(&numOfEncoders, receiveBuffer + 60, 2);
-                  swap_endian((unsigned char *) &numOfEncoders, 2);
-                  int encoderDataOffset = 6 * numOfEncoders;
-                  int32_t EncoderPosTicks[4] = {0};
-                  int16_t EncoderSpeed[4] = {0};
-
-                  if (numOfEncoders > 0 && numOfEncoders < 5)
+                  //TODO handle multi encoder with multiple encode msg or different encoder msg definition now using only first encoder
+                  if (core_scan_.num_encoders > 0)
                   {
                     FireEncoder = true;
-                    for (int EncoderNum = 0; EncoderNum < numOfEncoders; EncoderNum++)
-                    {
-                      memcpy(&EncoderPosTicks[EncoderNum], receiveBuffer + 62 + EncoderNum * 6, 4);
-                      swap_endian((unsigned char *) &EncoderPosTicks[EncoderNum], 4);
-                      memcpy(&EncoderSpeed[EncoderNum], receiveBuffer + 66 + EncoderNum * 6, 2);
-                      swap_endian((unsigned char *) &EncoderSpeed[EncoderNum], 2);
-                    }
+                    EncoderMsg.enc_position = core_scan_.encoder_position[0];
+                    EncoderMsg.enc_speed = core_scan_.encoder_speed[0];
                   }
-                  //TODO handle multi encoder with multiple encode msg or different encoder msg definition now using only first encoder
-                  EncoderMsg.enc_position = EncoderPosTicks[0];
-                  EncoderMsg.enc_speed = EncoderSpeed[0];
-                  memcpy(&numberOf16BitChannels, receiveBuffer + 62 + encoderDataOffset, 2);
-                  swap_endian((unsigned char *) &numberOf16BitChannels, 2);
-
-                  int parseOff = 64 + encoderDataOffset;
-
 
-                  char szChannel[255] = {0};
-                  float scaleFactor = 1.0;
-                  float scaleFactorOffset = 0.0;
-                  int32_t startAngleDiv10000 = 1;
-                  int32_t sizeOfSingleAngularStepDiv10000 = 1;
-                  double startAngle = 0.0;
-                  double sizeOfSingleAngularStep = 0.0;
-                  short numberOfItems = 0;
-
-                  static int cnt = 0;
-                  cnt++;
-                  // get number of 8 bit channels
-                  // we must jump of the 16 bit data blocks including header ...
-                  for (int i = 0; i < numberOf16BitChannels; i++)
+                  numEchos = core_scan_.num_echos;
+                  echoMask = (1 << numEchos) - 1;
+                  if (numEchos > 0)
                   {
-                    int numberOfItems = 0x00;
-                    memcpy(&numberOfItems, receiveBuffer + parseOff + 19, 2);
-                    swap_endian((unsigned char *) &numberOfItems, 2);
-                    parseOff += 21; // 21 Byte header followed by data entries
-                    parseOff += numberOfItems * 2;
+                    msg.angle_min = core_scan_.angle_min;
+                    msg.angle_increment = core_scan_.angle_increment;
+                    msg.angle_max = msg.angle_min + ((int)core_scan_.num_beams - 1) * msg.angle_increment;
                   }
-
-                  // now we can read the number of 8-Bit-Channels
-                  memcpy(&numberOf8BitChannels, receiveBuffer + parseOff, 2);
-                  swap_endian((unsigned char *) &numberOf8BitChannels, 2);
-
-                  parseOff = 64 + encoderDataOffset;
-                  enum datagram_parse_task
-                  {
-                    process_dist,
-                    process_vang,
-                    process_rssi,
-                    process_idle
-                  };
-                  int rssiCnt = 0;
-                  int vangleCnt = 0;
-                  int distChannelCnt = 0;
-
-                  for (int processLoop = 0; processLoop < 2; processLoop++)
-                  {
-                    int totalChannelCnt = 0;
-
-
-                    bool bCont = true;
-
-                    datagram_parse_task task = process_idle;
-                    bool parsePacket = true;
-                    parseOff = 64 + encoderDataOffset;
-                    bool processData = false;
-
-                    if (processLoop == 0)
-                    {
-                      distChannelCnt = 0;
-                      rssiCnt = 0;
-                      vangleCnt = 0;
-                    }
-
-                    if (processLoop == 1)
-                    {
-                      processData = true;
-                      numEchos = distChannelCnt;
-                      msg.ranges.resize(numberOfItems * numEchos);
-                      if (rssiCnt > 0)
-                      {
-                        msg.intensities.resize(numberOfItems * rssiCnt);
-                      }
-                      else
-                      {
-                      }
-                      if (vangleCnt > 0) // should be 0 or 1
-                      {
-                        vang_vec.resize(numberOfItems * vangleCnt);
-                      }
-                      else
-                      {
-                        vang_vec.clear();
-                      }
-                      echoMask = (1 << numEchos) - 1;
-
-                      // reset count. We will use the counter for index calculation now.
-                      distChannelCnt = 0;
-                      rssiCnt = 0;
-                      vangleCnt = 0;
-
-                    }
-
-                    szChannel[6] = '\0';
-                    scaleFactor = 1.0;
-                    scaleFactorOffset = 0.0;
-                    startAngleDiv10000 = 1;
-                    sizeOfSingleAngularStepDiv10000 = 1;
-                    startAngle = 0.0;
-                    sizeOfSingleAngularStep = 0.0;
-                    numberOfItems = 0;
-
-
-#if 1 // prepared for multiecho parsing
-
-                    bCont = true;
-                    bool doVangVecProc = false;
-                    // try to get number of DIST and RSSI from binary data
-                    task = process_idle;
-                    do
-                    {
-                      task = process_idle;
-                      doVangVecProc = false;
-                      int processDataLenValuesInBytes = 2;
-
-                      if (totalChannelCnt == numberOf16BitChannels)
-                      {
-                        parseOff += 2; // jump of number of 8 bit channels- already parsed above
-                      }
-
-                      if (totalChannelCnt >= numberOf16BitChannels)
-                      {
-                        processDataLenValuesInBytes = 1; // then process 8 bit values ...
-                      }
-                      bCont = false;
-                      strcpy(szChannel, "");
-
-                      if (totalChannelCnt < (numberOf16BitChannels + numberOf8BitChannels))
-                      {
-                        szChannel[5] = '\0';
-                        strncpy(szChannel, (const char *) receiveBuffer + parseOff, 5);
-                      }
-                      else
-                      {
-                        // all channels processed (16 bit and 8 bit channels)
-                      }
-
-                      if (strstr(szChannel, "DIST") == szChannel)
-                      {
-                        task = process_dist;
-                        distChannelCnt++;
-                        bCont = true;
-                        numberOfItems = 0;
-                        memcpy(&numberOfItems, receiveBuffer + parseOff + 19, 2);
-                        swap_endian((unsigned char *) &numberOfItems, 2);
-
-                      }
-                      if (strstr(szChannel, "VANG") == szChannel)
-                      {
-                        vangleCnt++;
-                        task = process_vang;
-                        bCont = true;
-                        numberOfItems = 0;
-                        memcpy(&numberOfItems, receiveBuffer + parseOff + 19, 2);
-                        swap_endian((unsigned char *) &numberOfItems, 2);
-
-                        vang_vec.resize(numberOfItems);
-
-                      }
-                      if (strstr(szChannel, "RSSI") == szChannel)
-                      {
-                        task = process_rssi;
-                        rssiCnt++;
-                        bCont = true;
-                        numberOfItems = 0;
-                        // copy two byte value (unsigned short to  numberOfItems
-                        memcpy(&numberOfItems, receiveBuffer + parseOff + 19, 2);
-                        swap_endian((unsigned char *) &numberOfItems, 2); // swap
-
-                      }
-                      if (bCont)
-                      {
-                        scaleFactor = 0.0;
-                        scaleFactorOffset = 0.0;
-                        startAngleDiv10000 = 0;
-                        sizeOfSingleAngularStepDiv10000 = 0;
-                        numberOfItems = 0;
-
-                        memcpy(&scaleFactor, receiveBuffer + parseOff + 5, 4);
-                        memcpy(&scaleFactorOffset, receiveBuffer + parseOff + 9, 4);
-                        memcpy(&startAngleDiv10000, receiveBuffer + parseOff + 13, 4);
-                        memcpy(&sizeOfSingleAngularStepDiv10000, receiveBuffer + parseOff + 17, 2);
-                        memcpy(&numberOfItems, receiveBuffer + parseOff + 19, 2);
-
-
-                        swap_endian((unsigned char *) &scaleFactor, 4);
-                        swap_endian((unsigned char *) &scaleFactorOffset, 4);
-                        swap_endian((unsigned char *) &startAngleDiv10000, 4);
-                        swap_endian((unsigned char *) &sizeOfSingleAngularStepDiv10000, 2);
-                        swap_endian((unsigned char *) &numberOfItems, 2);
-
-                        if (processData)
-                        {
-                          unsigned short *data = (unsigned short *) (receiveBuffer + parseOff + 21);
-
-                          unsigned char *swapPtr = (unsigned char *) data;
-                          // copy RSSI-Values +2 for 16-bit values +1 for 8-bit value
-                          for (int i = 0;
-                               i < numberOfItems * processDataLenValuesInBytes; i += processDataLenValuesInBytes)
-                          {
-                            if (processDataLenValuesInBytes == 1)
-                            {
-                            }
-                            else
-                            {
-                              unsigned char tmp;
-                              tmp = swapPtr[i + 1];
-                              swapPtr[i + 1] = swapPtr[i];
-                              swapPtr[i] = tmp;
-                            }
-                          }
-                          int idx = 0;
-
-                          switch (task)
-                          {
-
-                            case process_dist:
-                            {
-                              startAngle = startAngleDiv10000 / 10000.00;
-                              sizeOfSingleAngularStep = sizeOfSingleAngularStepDiv10000 / 10000.0;
-                              sizeOfSingleAngularStep *= (M_PI / 180.0);
-
-                              msg.angle_min = startAngle / 180.0 * M_PI - M_PI / 2;
-                              msg.angle_increment = sizeOfSingleAngularStep;
-                              msg.angle_max = msg.angle_min + (numberOfItems - 1) * msg.angle_increment;
-
-                              if (this->parser_->getCurrentParamPtr()->getScanMirroredAndShifted())
-                              {
-                                msg.angle_min -= M_PI/2;
-                                msg.angle_max -= M_PI/2;
-
-                                msg.angle_min *= -1.0;
-                                msg.angle_increment *= -1.0;
-                                msg.angle_max *= -1.0;
-
-                              }
-                              float *rangePtr = NULL;
-
-                              if (numberOfItems > 0)
-                              {
-                                rangePtr = &msg.ranges[0];
-                              }
-                              float scaleFactor_001 = 0.001F * scaleFactor;// to avoid repeated multiplication
-                              for (int i = 0; i < numberOfItems; i++)
-                              {
-                                idx = i + numberOfItems * (distChannelCnt - 1);
-                                rangePtr[idx] = (float) data[i] * scaleFactor_001 + scaleFactorOffset;
-#ifdef DEBUG_DUMP_ENABLED
-                                if (distChannelCnt == 1)
-                                {
-                                  if (i == floor(numberOfItems / 2))
-                                  {
-                                    double curTimeStamp = SystemCountScan + i * msg.time_increment * 1E6;
-                                    //DataDumper::instance().pushData(curTimeStamp, "DIST", rangePtr[idx]);
-                                  }
-                                }
-#endif
-                                //XXX
-                              }
-
-                            }
-                              break;
-                            case process_rssi:
-                            {
-                              // Das muss vom Protokoll abgeleitet werden. !!!
-
-                              float *intensityPtr = NULL;
-
-                              if (numberOfItems > 0)
-                              {
-                                intensityPtr = &msg.intensities[0];
-
-                              }
-                              for (int i = 0; i < numberOfItems; i++)
-                              {
-                                idx = i + numberOfItems * (rssiCnt - 1);
-                                // we must select between 16 bit and 8 bit values
-                                float rssiVal = 0.0;
-                                if (processDataLenValuesInBytes == 2)
-                                {
-                                  rssiVal = (float) data[i];
-                                }
-                                else
-                                {
-                                  unsigned char *data8Ptr = (unsigned char *) data;
-                                  rssiVal = (float) data8Ptr[i];
-                                }
-                                intensityPtr[idx] = rssiVal * scaleFactor + scaleFactorOffset;
-                              }
-                            }
-                              break;
-
-                            case process_vang:
-                              float *vangPtr = NULL;
-                              if (numberOfItems > 0)
-                              {
-                                vangPtr = &vang_vec[0]; // much faster, with vang_vec[i] each time the size will be checked
-                              }
-                              for (int i = 0; i < numberOfItems; i++)
-                              {
-                                vangPtr[i] = (float) data[i] * scaleFactor + scaleFactorOffset;
-                              }
-                              break;
-                          }
-                        }
-                        parseOff += 21 + processDataLenValuesInBytes * numberOfItems;
-
-
-                      }
-                      totalChannelCnt++;
-                    } while (bCont);
-                  }
-#endif
-
-                  elevAngle = elevAngleX200 / 200.0;
-                  scanFrequency = scanFrequencyX100 / 100.0;
-
-
+                  msg.ranges.swap(core_scan_.ranges);
+                  msg.intensities.swap(core_scan_.intensities);
+                  vang_vec.swap(core_scan_.vertical_angles);
                 }
               }
             }
@@ -3570,18 +3579,49 @@ namespace sick_scan
 
           if (success == ExitSuccess)
           {
+            // The decoded scan takes over ranges and intensities of all echos (no copy). Laserscan messages, pointcloud,
+            // range images and field evaluation are generated from the decoded scan.
+            decoded_scan_.assign(numEchos, msg.ranges, msg.intensities, recvTimeStamp + ros::Duration(config_.time_offset), msg.time_increment);
+
+            // Select the echos by echo_policy before the scan is converted into laserscan messages and pointcloud. Echos are selected
+            // from the configured output channels. The selected echo is the only echo of the scan afterwards.
+            if (echo_policy_.getPolicy() != SickScanEchoPolicy::ECHO_ALL && numEchos > 1)
+            {
+              if (echo_policy_.getPolicy() == SickScanEchoPolicy::ECHO_FIRST && (echoFilterMask & 1) == 0)
+              {
+                ROS_WARN_THROTTLE(60.0, "echo_policy first: first echo used, although it is not a configured output channel (output channel mask 0x%x)", echoFilterMask);
+              }
+              numEchos = echo_policy_.apply(decoded_scan_.allRanges(), decoded_scan_.allIntensities(), numEchos, echoMask & echoFilterMask);
+              decoded_scan_.setNumEchos(numEchos);
+              echoMask = 1;
+              echoFilterMask = 1;
+            }
+
             bool elevationPreCalculated = false;
             double elevationAngleDegree = 0.0;
 
+            if (parseStartNanoSec > 0)
+            {
+              profiling.addLatency(SickScanProfiling::STAGE_PARSE, SickScanProfiling::nowNanoSec() - parseStartNanoSec);
+              parseStartNanoSec = 0;
+            }
+            if (dataDumpActive)
+            {
+              DataDumper::instance().pushData(dumpChannelParsed, recvTimeStamp.toSec(), (ros::Time::now() - recvTimeStamp).toSec());
+            }
 
-            std::vector<float> rangeTmp = msg.ranges;  // copy all range value
-            std::vector<float> intensityTmp = msg.intensities; // copy all intensity value
-
-            int intensityTmpNum = intensityTmp.size();
-            float *intensityTmpPtr = NULL;
-            if (intensityTmpNum > 0)
+            // Host-side evaluation of the monitoring fields using the first echo
+            if (field_evaluator_ != NULL && numOfLayers == 1 && numEchos > 0 && decoded_scan_.numBeams() > 0)
             {
-              intensityTmpPtr = &intensityTmp[0];
+              SickScanFieldMonSingleton *fieldMon = SickScanFieldMonSingleton::getInstance();
+              sick_scan::FieldEvalMsg field_eval_msg;
+              if (field_evaluator_->evaluate(decoded_scan_.ranges(0), decoded_scan_.numBeams(), msg.angle_min, msg.angle_increment,
+                                             msg.range_min, fieldMon->getActiveFieldset(), field_eval_msg))
+              {
+                field_eval_msg.header.stamp = msg.header.stamp;
+                field_eval_msg.header.frame_id = config_.frame_id;
+                field_eval_pub_.publish(field_eval_msg);
+              }
             }
 
             // Helpful: https://answers.ros.org/question/191265/pointcloud2-access-data/
@@ -3590,6 +3630,7 @@ namespace sick_scan
             int layer = 0;
             int baseLayer = 0;
             bool useGivenElevationAngle = false;
+            int frameLayer = SickScanFrameAssembler::layerIndex(numOfLayers, (int)msg.header.seq); // layer index by elevation angle, row of this layer in the pointcloud frame
             switch (numOfLayers)
             {
               case 1: // TIM571 etc.
@@ -3598,22 +3639,14 @@ namespace sick_scan
               case 4:
 
                 baseLayer = -1;
-                if (msg.header.seq == 250)
-                { layer = -1; }
-                else if (msg.header.seq == 0)
-                { layer = 0; }
-                else if (msg.header.seq == -250)
-                { layer = 1; }
-                else if (msg.header.seq == -500)
-                { layer = 2; }
+                layer = frameLayer + baseLayer;
                 elevationAngleDegree = this->parser_->getCurrentParamPtr()->getElevationDegreeResolution();
                 elevationAngleDegree = elevationAngleDegree / 180.0 * M_PI;
                 // 0.0436332 /*2.5 degrees*/;
                 break;
               case 24: // Preparation for MRS6000
                 baseLayer = -1;
-                layer = (msg.header.seq - (-2638)) / 125;
-                layer = (23 - layer) - 1;
+                layer = frameLayer + baseLayer;
 #if 0
               elevationAngleDegree = this->parser_->getCurrentParamPtr()->getElevationDegreeResolution();
               elevationAngleDegree = elevationAngleDegree / 180.0 * M_PI;
@@ -3630,6 +3663,21 @@ namespace sick_scan
                 break; // unsupported
 
             }
+            // MRS1xxx and MRS6xxx: the layers are collected into frames by their elevation angle.
+            // LMS1xxx transmits all layers at elevation 0, i.e. the layers can't be identified. LMS1xxx and scanners
+            // with other layer counts publish every scan as a cloud of its own.
+            int frameLayers = numOfLayers;
+            if ((numOfLayers != 4 && numOfLayers != 24)
+                || this->parser_->getCurrentParamPtr()->getScannerName().compare(SICK_SCANNER_LMS_1XXX_NAME) == 0)
+            {
+              frameLayers = 1;
+              frameLayer = 0;
+            }
+            else if (frameLayer < 0)
+            {
+              ROS_WARN_THROTTLE(1.0, "Unexpected elevation angle %d/200 deg for %d layers, scan not converted to pointcloud", (int)msg.header.seq, numOfLayers);
+              publishPointCloud = false;
+            }
 
 
 
@@ -3643,38 +3691,17 @@ namespace sick_scan
             else
             {
 
-              size_t startOffset = 0;
-              size_t endOffset = 0;
-              int echoPartNum = msg.ranges.size() / numEchos;
               for (int i = 0; i < numEchos; i++)
               {
 
                 bool sendMsg = false;
-                if ((echoMask & (1 << i)) & outputChannelFlagId)
+                float rangeScale = 1.0f; // scale of the laserscan ranges
+                if ((echoMask & (1 << i)) & echoFilterMask)
                 {
                   aiValidEchoIdx[numValidEchos] = i; // save index
                   numValidEchos++;
                   sendMsg = true;
                 }
-                startOffset = i * echoPartNum;
-                endOffset = (i + 1) * echoPartNum;
-
-                msg.ranges.clear();
-                msg.intensities.clear();
-                msg.ranges = std::vector<float>(
-                    rangeTmp.begin() + startOffset,
-                    rangeTmp.begin() + endOffset);
-                // check also for MRS1104
-                if (endOffset <= intensityTmp.size() && (intensityTmp.size() > 0))
-                {
-                  msg.intensities = std::vector<float>(
-                      intensityTmp.begin() + startOffset,
-                      intensityTmp.begin() + endOffset);
-                }
-                else
-                {
-                  msg.intensities.resize(echoPartNum); // fill with zeros
-                }
                 {
                   // numEchos
                   char szTmp[255] = {0};
@@ -3717,12 +3744,7 @@ namespace sick_scan
                         strcpy(szTmp, echoForSlam.c_str());  //
                         if (elevationAngleInRad != 0.0)
                         {
-                          float cosVal = cos(elevationAngleInRad);
-                          int rangeNum = msg.ranges.size();
-                          for (int j = 0; j < rangeNum; j++)
-                          {
-                            msg.ranges[j] *= cosVal;
-                          }
+                          rangeScale = cos(elevationAngleInRad); // project the ranges of the tilted layer into the horizontal plane
                         }
                       }
                     }
@@ -3748,11 +3770,12 @@ namespace sick_scan
                   sendMsg = false; // too many layers for publish as scan message. Only pointcloud messages will be pub.
                 }
                 if (sendMsg &
-                    outputChannelFlagId)  // publish only configured channels - workaround for cfg-bug MRS1104
+                    echoFilterMask)  // publish only configured channels - workaround for cfg-bug MRS1104
                 {
-
+                  decoded_scan_.toLaserScan(i, msg, rangeScale); // ranges and intensities of echo i, zero intensities if not transmitted
+                  SickScanProfiling::ScopedTimer publishTimer(SickScanProfiling::STAGE_PUBLISH);
                   pub_.publish(msg);
-
+                  profiling.incrementCounter(SickScanProfiling::COUNTER_SCANS_PUBLISHED);
                 }
 #else
                 printf("MSG received...");
@@ -3763,280 +3786,134 @@ namespace sick_scan
 
             if (publishPointCloud == true)
             {
+              SickScanProfiling::ScopedTimer cloudBuildTimer(SickScanProfiling::STAGE_CLOUD_BUILD);
 
+              const int numChannels = cloud_point_time_ ? 5 : 4; // x y z i (for intensity) and optional time
 
-              const int numChannels = 4; // x y z i (for intensity)
-
-              int numTmpLayer = numOfLayers;
-
-
-              cloud_.header.stamp = recvTimeStamp + ros::Duration(config_.time_offset);
-
-
-              cloud_.header.frame_id = config_.frame_id;
-              cloud_.header.seq = 0;
-              cloud_.height = numTmpLayer * numValidEchos; // due to multi echo multiplied by num. of layers
-              cloud_.width = msg.ranges.size();
-              cloud_.is_bigendian = false;
-              cloud_.is_dense = true;
-              cloud_.point_step = numChannels * sizeof(float);
-              cloud_.row_step = cloud_.point_step * cloud_.width;
-              cloud_.fields.resize(numChannels);
-              for (int i = 0; i < numChannels; i++)
+              static std::vector<sensor_msgs::PointField> cloudFields;
+              if (cloudFields.size() != numChannels)
               {
-                std::string channelId[] = {"x", "y", "z", "intensity"};
-                cloud_.fields[i].name = channelId[i];
-                cloud_.fields[i].offset = i * sizeof(float);
-                cloud_.fields[i].count = 1;
-                cloud_.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+                cloudFields.resize(numChannels);
+                for (int i = 0; i < numChannels; i++)
+                {
+                  std::string channelId[] = {"x", "y", "z", "intensity", "time"};
+                  cloudFields[i].name = channelId[i];
+                  cloudFields[i].offset = i * sizeof(float);
+                  cloudFields[i].count = 1;
+                  cloudFields[i].datatype = sensor_msgs::PointField::FLOAT32;
+                }
               }
 
-              cloud_.data.resize(cloud_.row_step * cloud_.height);
-
-              unsigned char *cloudDataPtr = &(cloud_.data[0]);
-
+              // Collect the layers in the frame assembler, the frame is finished after its last layer
+              frame_assembler_.setOutputMode(config_.cloud_output_mode, cloud_sector_angle_);
+              unsigned char *cloudDataPtr = frame_assembler_.beginLayer(frameLayers, numValidEchos, decoded_scan_.numBeams(), cloudFields,
+                                                                        numChannels * sizeof(float), frameLayer,
+                                                                        recvTimeStamp + ros::Duration(config_.time_offset), config_.frame_id);
+              size_t echoStride = frame_assembler_.getEchoStride();
+              // time of the first point of this layer relative to the frame timestamp
+              float layerTimeOffset = (float)(recvTimeStamp + ros::Duration(config_.time_offset) - frame_assembler_.getFrameStamp()).toSec();
 
-              // prepare lookup for elevation angle table
 
-              std::vector<float> cosAlphaTable; // Lookup table for cos
-              std::vector<float> sinAlphaTable; // Lookup table for sin
-              size_t rangeNum = rangeTmp.size() / numValidEchos;
-              cosAlphaTable.resize(rangeNum);
-              sinAlphaTable.resize(rangeNum);
-              float mirror_factor = 1.0;
-              float angleShift=0;
-              if (this->parser_->getCurrentParamPtr()->getScanMirroredAndShifted())
+              // azimuth and elevation of the beams, the azimuth tables are cached by the decoded scan
+              decoded_scan_.setAzimuth(config_.min_ang, msg.angle_increment, angleCompensator);
+              if (useGivenElevationAngle) // FOR MRS6124
               {
-//                mirror_factor = -1.0;
-//                angleShift = +M_PI/2.0; // add 90 deg for NAV3xx-series
+                decoded_scan_.setElevation(vang_vec);
               }
-
-              for (size_t iEcho = 0; iEcho < numValidEchos; iEcho++)
+              else if (elevationPreCalculated) // FOR MRS6124 without VANGL
               {
-
-                float angle = config_.min_ang;
-
-
-                float *cosAlphaTablePtr = &cosAlphaTable[0];
-                float *sinAlphaTablePtr = &sinAlphaTable[0];
-
-				float *vangPtr = NULL;
-				float *rangeTmpPtr = &rangeTmp[0];
-				if (vang_vec.size() > 0)
-				{
-					vangPtr = &vang_vec[0];
-				}
-                for (size_t i = 0; i < rangeNum; i++)
-                {
-                  enum enum_index_descr
-                  {
-                    idx_x,
-                    idx_y,
-                    idx_z,
-                    idx_intensity,
-                    idx_num
-                  };
-                  long adroff = i * (numChannels * (int) sizeof(float));
-
-                  adroff += (layer - baseLayer) * cloud_.row_step;
-
-                  adroff += iEcho * cloud_.row_step * numTmpLayer;
-
-                  unsigned char *ptr = cloudDataPtr + adroff;
-                  float *fptr = (float *) (cloudDataPtr + adroff);
-
-                  geometry_msgs::Point32 point;
-                  float range_meter = rangeTmpPtr[iEcho * rangeNum + i];
-                  float phi = angle; // azimuth angle
-                  float alpha = 0.0;  // elevation angle
-
-                  if (useGivenElevationAngle) // FOR MRS6124
-                  {
-                    alpha = -vangPtr[i] * deg2rad_const;
-                  }
-                  else
-                  {
-                    if (elevationPreCalculated) // FOR MRS6124 without VANGL
-                    {
-                      alpha = elevationAngleInRad;
-                    }
-                    else
-                    {
-                      alpha = layer * elevationAngleDegree; // for MRS1104
-                    }
-                  }
-
-                  if (iEcho == 0)
-                  {
-                    cosAlphaTablePtr[i] = cos(alpha); // for z-value (elevation)
-                    sinAlphaTablePtr[i] = sin(alpha);
-                  }
-                  else
-                  {
-                    // Just for Debugging: printf("%3d %8.3lf %8.3lf\n", (int)i, cosAlphaTablePtr[i], sinAlphaTablePtr[i]);
-                  }
-                  // Thanks to Sebastian Pütz <spuetz@uos.de> for his hint
-                  float rangeCos = range_meter * cosAlphaTablePtr[i];
-
-                  double phi_used = phi  + angleShift;
-                  if (this->angleCompensator != NULL)
-                  {
-                    phi_used = angleCompensator->compensateAngleInRadFromRos(phi_used);
-                  }
-                  fptr[idx_x] = rangeCos * cos(phi_used);  // copy x value in pointcloud
-                  fptr[idx_y] = rangeCos * sin(phi_used);  // copy y value in pointcloud
-                  fptr[idx_z] = range_meter * sinAlphaTablePtr[i] * mirror_factor;// copy z value in pointcloud
-
-                  fptr[idx_intensity] = 0.0;
-                  if (config_.intensity)
-                  {
-                    int intensityIndex = aiValidEchoIdx[iEcho] * rangeNum + i;
-                    // intensity values available??
-                    if (intensityIndex < intensityTmpNum)
-                    {
-                      fptr[idx_intensity] = intensityTmpPtr[intensityIndex]; // copy intensity value in pointcloud
-                    }
-                  }
-                  angle += msg.angle_increment;
-                }
-                // Publish
-                static int cnt = 0;
-                int layerOff = (layer - baseLayer);
-
+                decoded_scan_.setElevation(elevationAngleInRad);
               }
-              // if ( (msg.header.seq == 0) || (layerOff == 0)) // FIXEN!!!!
-              bool shallIFire = false;
-              if ((msg.header.seq == 0) || (msg.header.seq == 237))
+              else
               {
-                shallIFire = true;
+                decoded_scan_.setElevation(layer * elevationAngleDegree); // for MRS1104
               }
+              // Thanks to Sebastian Pütz <spuetz@uos.de> for his hint
+              decoded_scan_.toCloudParallel(cloud_build_pool_, 128, numValidEchos, aiValidEchoIdx, cloudDataPtr, numChannels * sizeof(float), echoStride,
+                                            config_.intensity, cloud_point_time_, layerTimeOffset);
+              frame_assembler_.endLayer(frameLayer);
+              cloudBuildTimer.stop();
 
-
-              static int layerCnt = 0;
-              static int layerSeq[4];
-
-              if (config_.cloud_output_mode > 0)
+              if (frame_assembler_.isFrameReady())
               {
-
-                layerSeq[layerCnt % 4] = layer;
-                if (layerCnt >= 4)  // mind. erst einmal vier Layer zusammensuchen
+#ifndef _MSC_VER
+                sensor_msgs::PointCloud2 &cloudFrameFloat = frame_assembler_.popFrame();
+                if (cloud_deskew_ != NULL && !cloud_deskew_->deskew(cloudFrameFloat))
                 {
-                  shallIFire = true; // here are at least 4 layers available
+                  ROS_WARN_THROTTLE(1.0, "Pointcloud deskew: no odometry or imu data available, pointcloud not motion compensated");
                 }
-                else
+                SickScanProfiling::ScopedTimer cloudEncodeTimer(SickScanProfiling::STAGE_CLOUD_ENCODE);
+                const sensor_msgs::PointCloud2 &cloudFrame = cloud_publish_full_ ? cloud_encoder_.encode(cloudFrameFloat) : cloudFrameFloat;
+                cloudEncodeTimer.stop();
+                if (!cloudFrame.is_dense)
                 {
-                  shallIFire = false;
+                  ROS_DEBUG_STREAM("Incomplete pointcloud frame published, " << frame_assembler_.getNumDroppedLayers() << " layers dropped in total");
                 }
-
-                layerCnt++;
-              }
-
-              if (shallIFire) // shall i fire the signal???
-              {
-                if (config_.cloud_output_mode == 0)
+                if (!cloud_publish_full_)
                 {
-                  // standard handling of scans
-                  cloud_pub_.publish(cloud_);
-
+                  // only the reduced pointcloud is published
                 }
-                else if (config_.cloud_output_mode == 2)
+                else if (frame_assembler_.getOutputMode() == SickScanFrameAssembler::OUTPUT_SECTOR)
                 {
-                  // Following cases are interesting:
-                  // LMS5xx: seq is always 0 -> publish every scan
-                  // MRS1104: Every 4th-Layer is 0 -> publish pointcloud every 4th layer message
-                  // LMS1104: Publish every layer. The timing for the LMS1104 seems to be:
-                  //          Every 67 ms receiving of a new scan message
-                  //          Scan message contains 367 measurements
-                  //          angle increment is 0.75° (yields 274,5° covery -> OK)
-                  // MRS6124: Publish very 24th layer at the layer = 237 , MRS6124 contains no sequence with seq 0
-                  //BBB
-#ifndef _MSC_VER
-                  int numTotalShots = 360; //TODO where is this from ?
-                  int numPartialShots = 40; //
-
-                  for (int i = 0; i < numTotalShots; i += numPartialShots)
+                  // publish the frame in fixed-angle sectors, each sector stamped by the time of its center
+                  int numSectors = frame_assembler_.numSectors(cloudFrame, msg.angle_increment);
+                  for (int sectorIdx = 0; sectorIdx < numSectors; sectorIdx++)
                   {
-                    sensor_msgs::PointCloud2 partialCloud;
-                    partialCloud = cloud_;
-                    ros::Time partialTimeStamp = cloud_.header.stamp;
-
-                    partialTimeStamp += ros::Duration((i + 0.5 * (numPartialShots - 1)) * timeIncrement);
-                    partialTimeStamp += ros::Duration((3 * numTotalShots) * timeIncrement);
-                    partialCloud.header.stamp = partialTimeStamp;
-                    partialCloud.width = numPartialShots * 3;  // die sind sicher in diesem Bereich
-
-                    int diffTo1100 = cloud_.width - 3 * (numTotalShots + i);
-                    if (diffTo1100 > numPartialShots)
+                    const sensor_msgs::PointCloud2 &sectorCloud = frame_assembler_.getSector(cloudFrame, sectorIdx, msg.angle_increment, msg.time_increment);
+                    SickScanProfiling::ScopedTimer publishTimer(SickScanProfiling::STAGE_PUBLISH);
+                    uint64_t publishTimeNanoSec = SickScanShmRingReader::systemTimeNanoSec(); // common reference time of ros and shm transport
+                    cloud_pub_.publish(sectorCloud);
+                    writeCloudToShm(sectorCloud, publishTimeNanoSec);
+                    if (dataDumpActive)
                     {
-                      diffTo1100 = numPartialShots;
+                      DataDumper::instance().pushData(dumpChannelPublished, recvTimeStamp.toSec(), (ros::Time::now() - recvTimeStamp).toSec());
                     }
-                    if (diffTo1100 < 0)
-                    {
-                      diffTo1100 = 0;
-                    }
-                    partialCloud.width += diffTo1100;
-                    // printf("Offset: %4d Breite: %4d\n", i, partialCloud.width);
-                    partialCloud.height = 1;
-
-
-                    partialCloud.is_bigendian = false;
-                    partialCloud.is_dense = true;
-                    partialCloud.point_step = numChannels * sizeof(float);
-                    partialCloud.row_step = partialCloud.point_step * partialCloud.width;
-                    partialCloud.fields.resize(numChannels);
-                    for (int ii = 0; ii < numChannels; ii++)
-                    {
-                      std::string channelId[] = {"x", "y", "z", "intensity"};
-                      partialCloud.fields[ii].name = channelId[ii];
-                      partialCloud.fields[ii].offset = ii * sizeof(float);
-                      partialCloud.fields[ii].count = 1;
-                      partialCloud.fields[ii].datatype = sensor_msgs::PointField::FLOAT32;
-                    }
-
-                    partialCloud.data.resize(partialCloud.row_step);
-
-                    int partOff = 0;
-                    for (int j = 0; j < 4; j++)
-                    {
-                      int layerIdx = (j + (layerCnt)) % 4;  // j = 0 -> oldest
-                      int rowIdx = 1 + layerSeq[layerIdx % 4]; // +1, da es bei -1 beginnt
-                      int colIdx = j * numTotalShots + i;
-                      int maxAvail = cloud_.width - colIdx; //
-                      if (maxAvail < 0)
-                      {
-                        maxAvail = 0;
-                      }
-
-                      if (maxAvail > numPartialShots)
-                      {
-                        maxAvail = numPartialShots;
-                      }
-
-                      // printf("Most recent LayerIdx: %2d RowIdx: %4d ColIdx: %4d\n", layer, rowIdx, colIdx);
-                      if (maxAvail > 0)
-                      {
-                        memcpy(&(partialCloud.data[partOff]),
-                               &(cloud_.data[(rowIdx * cloud_.width + colIdx + i) * cloud_.point_step]),
-                               cloud_.point_step * maxAvail);
-
-                      }
-
-                      partOff += maxAvail * partialCloud.point_step;
-                    }
-                    assert(partialCloud.data.size() == partialCloud.width * partialCloud.point_step);
-
-
-                    cloud_pub_.publish(partialCloud);
-#if 0
-                    memcpy(&(partialCloud.data[0]), &(cloud_.data[0]) + i * cloud_.point_step, cloud_.point_step * numPartialShots);
-                    cloud_pub_.publish(partialCloud);
-#endif
+                    profiling.incrementCounter(SickScanProfiling::COUNTER_CLOUDS_PUBLISHED);
+                    profiling.incrementCounter(SickScanProfiling::COUNTER_BYTES_PUBLISHED, sectorCloud.data.size());
                   }
                 }
-                //                cloud_pub_.publish(cloud_);
-
+                else
+                {
+                  // publish complete frames (cloud_output_mode 0) or single layers (cloud_output_mode 1)
+                  SickScanProfiling::ScopedTimer publishTimer(SickScanProfiling::STAGE_PUBLISH);
+                  uint64_t publishTimeNanoSec = SickScanShmRingReader::systemTimeNanoSec(); // common reference time of ros and shm transport
+                  cloud_pub_.publish(cloudFrame);
+                  writeCloudToShm(cloudFrame, publishTimeNanoSec);
+                  if (dataDumpActive)
+                  {
+                    DataDumper::instance().pushData(dumpChannelPublished, recvTimeStamp.toSec(), (ros::Time::now() - recvTimeStamp).toSec());
+                  }
+                  profiling.incrementCounter(SickScanProfiling::COUNTER_CLOUDS_PUBLISHED);
+                  profiling.incrementCounter(SickScanProfiling::COUNTER_BYTES_PUBLISHED, cloudFrame.data.size());
+                }
+                if (cloud_reducer_.getReduction() != SickScanCloudReducer::REDUCTION_NONE)
+                {
+                  // publish the reduced pointcloud
+                  SickScanProfiling::ScopedTimer cloudReduceTimer(SickScanProfiling::STAGE_CLOUD_REDUCE);
+                  const sensor_msgs::PointCloud2 &cloudReduced = cloud_reducer_.reduce(cloudFrameFloat);
+                  cloudReduceTimer.stop();
+                  SickScanProfiling::ScopedTimer publishTimer(SickScanProfiling::STAGE_PUBLISH);
+                  cloud_reduced_pub_.publish(cloudReduced);
+                  profiling.incrementCounter(SickScanProfiling::COUNTER_REDUCED_CLOUDS_PUBLISHED);
+                  profiling.incrementCounter(SickScanProfiling::COUNTER_REDUCED_BYTES_PUBLISHED, cloudReduced.data.size());
+                }
 #else
                 printf("PUBLISH:\n");
+#endif
+              }
+            }
+
+            // range and intensity images from the decoded ranges (no cartesian conversion)
+            if (range_image_ != NULL && frameLayer >= 0 && numValidEchos > 0 && numEchos > 0 && decoded_scan_.numBeams() > 0)
+            {
+              const std::vector<float> &intensities = decoded_scan_.allIntensities();
+              if (range_image_->addLayer(frameLayers, frameLayer, numValidEchos, aiValidEchoIdx, decoded_scan_.numBeams(), decoded_scan_.ranges(0),
+                                         intensities.empty() ? NULL : &intensities[0], intensities.size(), decoded_scan_.stamp(), config_.frame_id))
+              {
+#ifndef _MSC_VER
+                SickScanProfiling::ScopedTimer publishTimer(SickScanProfiling::STAGE_PUBLISH);
+                range_image_pub_.publish(range_image_->getRangeImage());
+                intensity_image_pub_.publish(range_image_->getIntensityImage());
 #endif
               }
             }
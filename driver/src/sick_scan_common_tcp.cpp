@@ -63,9 +63,12 @@
 #include <boost/lambda/lambda.hpp>
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <boost/lexical_cast.hpp>
 #include <vector>
 #include <sick_scan/sick_generic_radar.h>
+#include <sick_scan/sick_scan_profiling.h>
+#include <sick_scan/sick_scan_realtime.h>
 
 #ifdef _MSC_VER
 #include "sick_scan/rosconsole_simu.hpp"
@@ -180,6 +183,7 @@ namespace sick_scan
   {
 
     setEmulSensor(false);
+    m_beVerbose = false;
     if ((cola_dialect_id == 'a') || (cola_dialect_id == 'A'))
     {
       this->setProtocolType(CoLa_A);
@@ -195,6 +199,89 @@ namespace sick_scan
     m_numberOfBytesInReceiveBuffer = 0;
     m_alreadyReceivedBytes = 0;
     this->setReplyMode(0);
+
+    // Streaming of sectors of partially received scans
+    m_sectorStream = 0;
+    bool scan_sector_stream = false;
+    ros::NodeHandle pnSector("~");
+    pnSector.param<bool>("scan_sector_stream", scan_sector_stream, false);
+    if (scan_sector_stream)
+    {
+      int scan_sector_beams = 90;
+      std::string scan_sector_topic = "scan_sector", cloud_sector_topic = "cloud_sector", frame_id = "cloud";
+      pnSector.param<int>("scan_sector_beams", scan_sector_beams, 90);
+      pnSector.param<std::string>("scan_sector_topic", scan_sector_topic, "scan_sector");
+      pnSector.param<std::string>("cloud_sector_topic", cloud_sector_topic, "cloud_sector");
+      pnSector.param<std::string>("frame_id", frame_id, "cloud");
+      if (this->getProtocolType() != CoLa_B || parser->getCurrentParamPtr()->getNumberOfLayers() != 1)
+      {
+        ROS_WARN("scan_sector_stream requires a single-layer device and CoLa-B, sector streaming deactivated");
+      }
+      else
+      {
+        ros::NodeHandle nh;
+        m_sectorStream = new SickScanSectorStream(nh, scan_sector_topic, cloud_sector_topic, scan_sector_beams, frame_id,
+                                                  parser->get_range_min(), parser->get_range_max(),
+                                                  parser->getCurrentParamPtr()->getScanMirroredAndShifted());
+        ROS_INFO("Streaming scan sectors of %d beams to %s and %s", scan_sector_beams, scan_sector_topic.c_str(), cloud_sector_topic.c_str());
+      }
+    }
+
+    // Recording and replay of datagrams
+    m_datagramRecorder = 0;
+    m_datagramReplay = 0;
+    m_pcapngReplay = 0;
+    m_datagramReplayThread = 0;
+    m_datagramReplayThreadRunning = false;
+    ros::NodeHandle pn("~");
+    std::string datagram_record_file, datagram_replay_file;
+    pn.param<std::string>("datagram_record_file", datagram_record_file, "");
+    pn.param<std::string>("datagram_replay_file", datagram_replay_file, "");
+    pn.param<double>("datagram_replay_rate", m_datagramReplayRate, 1.0);
+    bool datagram_replay_pcapng = (datagram_replay_file.size() >= 7 && datagram_replay_file.compare(datagram_replay_file.size() - 7, 7, ".pcapng") == 0)
+      || (datagram_replay_file.size() >= 5 && datagram_replay_file.compare(datagram_replay_file.size() - 5, 5, ".pcap") == 0);
+    if (datagram_replay_pcapng)
+    {
+      m_pcapngReplay = new SickScanPcapngReader();
+      if (m_pcapngReplay->open(datagram_replay_file))
+      {
+        ROS_INFO("Replaying datagrams from network capture \"%s\" (replay rate %.2f)", datagram_replay_file.c_str(), m_datagramReplayRate);
+      }
+      else
+      {
+        ROS_ERROR("## ERROR: could not read network capture \"%s\"", datagram_replay_file.c_str());
+        delete m_pcapngReplay;
+        m_pcapngReplay = 0;
+      }
+    }
+    else if (!datagram_replay_file.empty())
+    {
+      m_datagramReplay = new SickScanDatagramLogReader();
+      if (m_datagramReplay->open(datagram_replay_file))
+      {
+        ROS_INFO("Replaying %zu datagrams from file \"%s\" (replay rate %.2f)", m_datagramReplay->numDatagrams(), datagram_replay_file.c_str(), m_datagramReplayRate);
+      }
+      else
+      {
+        ROS_ERROR("## ERROR: could not read datagram log file \"%s\"", datagram_replay_file.c_str());
+        delete m_datagramReplay;
+        m_datagramReplay = 0;
+      }
+    }
+    else if (!datagram_record_file.empty())
+    {
+      m_datagramRecorder = new SickScanDatagramLogWriter();
+      if (m_datagramRecorder->open(datagram_record_file))
+      {
+        ROS_INFO("Recording datagrams to file \"%s\"", datagram_record_file.c_str());
+      }
+      else
+      {
+        ROS_ERROR("## ERROR: could not create datagram log file \"%s\"", datagram_record_file.c_str());
+        delete m_datagramRecorder;
+        m_datagramRecorder = 0;
+      }
+    }
     // io_service_.setReadCallbackFunction(boost::bind(&SopasDevice::readCallbackFunction, this, _1, _2));
 
     // Set up the deadline actor to implement timeouts.
@@ -209,6 +296,98 @@ namespace sick_scan
   {
     // stop_scanner();
     close_device();
+    if (m_datagramReplayThread)
+    {
+      m_datagramReplayThreadRunning = false;
+      m_datagramReplayThread->interrupt(); // wakes up the replay thread, if it is blocked in a sleep
+      m_datagramReplayThread->join();
+      delete m_datagramReplayThread;
+      m_datagramReplayThread = 0;
+    }
+    delete m_datagramReplay;
+    m_datagramReplay = 0;
+    delete m_pcapngReplay;
+    m_pcapngReplay = 0;
+    delete m_datagramRecorder; // writes the index and closes the datagram log
+    m_datagramRecorder = 0;
+    delete m_sectorStream;
+    m_sectorStream = 0;
+  }
+
+  bool SickScanCommonTcp::isDatagramReplayActive()
+  {
+    return m_datagramReplay != 0 || m_pcapngReplay != 0;
+  }
+
+  /*!
+  \brief Thread function to replay datagrams from file. Datagrams are pushed into the receive queue with their
+  recorded timestamps, either in real time (scaled by datagram_replay_rate) or as fast as possible.
+  Network captures are read sequentially, i.e. captures of any size are replayed with bounded memory.
+  The node is shut down after the last datagram.
+  */
+  void SickScanCommonTcp::datagramReplayThreadFunction()
+  {
+    const int maxQueueSize = 16; // avoid flooding the receive queue if replaying as fast as possible
+    std::vector<uint8_t> datagram;
+    uint32_t sec = 0, nsec = 0;
+    size_t numDatagrams = m_datagramReplay ? m_datagramReplay->numDatagrams() : std::numeric_limits<size_t>::max();
+    double firstTimestamp = 0;
+    boost::chrono::steady_clock::time_point startTime = boost::chrono::steady_clock::now();
+    size_t idx = 0;
+    for (; m_datagramReplayThreadRunning && idx < numDatagrams; idx++)
+    {
+      if (m_pcapngReplay)
+      {
+        if (!m_pcapngReplay->read(sec, nsec, datagram))
+          break; // end of capture
+      }
+      else if (!m_datagramReplay->read(idx, sec, nsec, datagram))
+      {
+        ROS_ERROR("## ERROR: could not read datagram %zu from datagram log file", idx);
+        break;
+      }
+      if (idx == 0)
+      {
+        firstTimestamp = sec + 1.0e-9 * nsec;
+      }
+      if (m_datagramReplayRate > 0)
+      {
+        double delay = (sec + 1.0e-9 * nsec - firstTimestamp) / m_datagramReplayRate;
+        boost::chrono::steady_clock::time_point sendTime = startTime + boost::chrono::microseconds((int64_t)(1.0e6 * delay));
+        while (m_datagramReplayThreadRunning && boost::chrono::steady_clock::now() < sendTime)
+        {
+          // sleep in short slices, so that the destructor does not wait for gaps in the recording
+          boost::this_thread::sleep_until(std::min(sendTime, boost::chrono::steady_clock::now() + boost::chrono::milliseconds(10)));
+        }
+        if (!m_datagramReplayThreadRunning)
+        {
+          break;
+        }
+      }
+      else
+      {
+        while (m_datagramReplayThreadRunning && recvQueue.getNumberOfEntriesInQueue() >= maxQueueSize)
+        {
+          boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+        }
+      }
+      recvQueue.push(DatagramWithTimeStamp(ros::Time(sec, nsec), datagram));
+    }
+    double replayTime = 1.0e-6 * boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now() - startTime).count();
+    ROS_INFO("Datagram replay finished: %zu datagrams replayed in %.3f seconds", idx, replayTime);
+    if (m_pcapngReplay)
+    {
+      ROS_INFO("Network capture: %zu tcp segments processed, %zu bytes skipped (lost segments or no CoLa datagram)", m_pcapngReplay->numPackets(), m_pcapngReplay->numSkippedBytes());
+    }
+    if (m_datagramReplayThreadRunning)
+    {
+      // Wait until all datagrams are processed, then shutdown
+      while (m_datagramReplayThreadRunning && !recvQueue.isQueueEmpty())
+      {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+      }
+      ros::shutdown();
+    }
   }
 
   using boost::asio::ip::tcp;
@@ -409,6 +588,7 @@ namespace sick_scan
             "SickScanCommonNw::findFrameInReceiveBuffer: Frame too big for receive buffer. Frame discarded with length:"
             + ::toString(payloadlength) + ".");
         m_numberOfBytesInReceiveBuffer = 0;
+        SickScanProfiling::instance().incrementCounter(SickScanProfiling::COUNTER_FRAMES_DROPPED);
         return SopasEventMessage();
       }
       if ((payloadlength + 9) > m_numberOfBytesInReceiveBuffer)
@@ -447,6 +627,7 @@ namespace sick_scan
       {
         printWarning("SickScanCommonNw::findFrameInReceiveBuffer: Wrong checksum, Frame discarded.");
         m_numberOfBytesInReceiveBuffer = 0;
+        SickScanProfiling::instance().incrementCounter(SickScanProfiling::COUNTER_FRAMES_DROPPED);
         return SopasEventMessage();
       }
 
@@ -488,6 +669,13 @@ namespace sick_scan
                                                                                        frame.size()));
     // recvQueue.push(std::vector<unsigned char>(frame.getRawData(), frame.getRawData() + frame.size()));
     recvQueue.push(dataGramWidthTimeStamp);
+    if (m_datagramRecorder)
+    {
+      m_datagramRecorder->write(timeStamp.sec, timeStamp.nsec, frame.getRawData(), frame.size());
+    }
+    SickScanProfiling &profiling = SickScanProfiling::instance();
+    profiling.incrementCounter(SickScanProfiling::COUNTER_FRAMES_RECEIVED);
+    profiling.setGauge(SickScanProfiling::GAUGE_QUEUE_DEPTH, recvQueue.getNumberOfEntriesInQueue());
   }
 
   void SickScanCommonTcp::readCallbackFunction(UINT8 *buffer, UINT32 &numOfBytes)
@@ -498,6 +686,10 @@ namespace sick_scan
         "SickScanCommonNw::readCallbackFunction(): Called with " + toString(numOfBytes) + " available bytes.",
         beVerboseHere);
 
+    SickScanProfiling &profiling = SickScanProfiling::instance();
+    profiling.incrementCounter(SickScanProfiling::COUNTER_BYTES_RECEIVED, numOfBytes);
+    SickScanProfiling::ScopedTimer frameExtractionTimer(SickScanProfiling::STAGE_FRAME_EXTRACTION);
+
     ScopedLock lock(&m_receiveDataMutex); // Mutex for access to the input buffer
     UINT32 remainingSpace = sizeof(m_receiveBuffer) - m_numberOfBytesInReceiveBuffer;
     UINT32 bytesToBeTransferred = numOfBytes;
@@ -534,6 +726,11 @@ namespace sick_scan
           printInfoMessage("SickScanCommonNw::readCallbackFunction(): No complete frame in input buffer, we are done.",
                            beVerboseHere);
 
+          // Publish the sectors completely received so far
+          if (m_sectorStream && m_numberOfBytesInReceiveBuffer > 0)
+          {
+            m_sectorStream->update(m_receiveBuffer, m_numberOfBytesInReceiveBuffer, false, rcvTimeStamp);
+          }
           // Leave the loop
           break;
         }
@@ -543,6 +740,10 @@ namespace sick_scan
           printInfoMessage(
               "SickScanCommonNw::readCallbackFunction(): Processing a frame of length " + ::toString(frame.size()) +
               " bytes.", beVerboseHere);
+          if (m_sectorStream)
+          {
+            m_sectorStream->update(frame.getRawData(), size, true, rcvTimeStamp); // publish the remaining beams of this scan
+          }
           processFrame(rcvTimeStamp, frame);
           UINT32 bytesToMove = m_numberOfBytesInReceiveBuffer - size;
           memmove(&(m_receiveBuffer[0]), &(m_receiveBuffer[size]), bytesToMove); // payload+magic+length+s+checksum
@@ -557,12 +758,24 @@ namespace sick_scan
       // Either we have not read data from our buffer for a long time, or something has gone wrong. To re-sync,
       // we clear the input buffer here.
       m_numberOfBytesInReceiveBuffer = 0;
+      profiling.incrementCounter(SickScanProfiling::COUNTER_FRAMES_DROPPED);
     }
+    profiling.setGauge(SickScanProfiling::GAUGE_RECEIVE_BUFFER_BYTES, m_numberOfBytesInReceiveBuffer);
   }
 
 
   int SickScanCommonTcp::init_device()
   {
+    if (isDatagramReplayActive())
+    {
+      if (!m_datagramReplayThread)
+      {
+        ROS_INFO("Datagram replay activated - network traffic is switched off.");
+        m_datagramReplayThreadRunning = true;
+        m_datagramReplayThread = new boost::thread(&SickScanCommonTcp::datagramReplayThreadFunction, this);
+      }
+      return ExitSuccess;
+    }
     int portInt;
     sscanf(port_.c_str(), "%d", &portInt);
     m_nw.init(hostname_, portInt, disconnectFunctionS, (void *) this);
@@ -670,6 +883,15 @@ namespace sick_scan
       return ExitError;
     }
 #endif
+    if (isDatagramReplayActive())
+    {
+      // no device connected in replay mode
+      if (reply)
+      {
+        reply->clear();
+      }
+      return ExitSuccess;
+    }
     int sLen = 0;
     int preambelCnt = 0;
     bool cmdIsBinary = false;
@@ -789,6 +1011,10 @@ namespace sick_scan
       *numberOfRemainingFifoEntries = 0;
     }
     this->setReplyMode(1);
+    if (m_sectorStream)
+    {
+      m_sectorStream->setLimits(config_.min_ang, config_.max_ang, config_.time_offset); // same limits as the full scan
+    }
 
     if (this->getEmulSensor())
     {
@@ -813,7 +1039,9 @@ namespace sick_scan
       const int maxWaitInMs = getReadTimeOutInMs();
       std::vector<unsigned char> dataBuffer;
 #if 1 // prepared for reconnect
-      bool retVal = this->recvQueue.waitForIncomingObject(maxWaitInMs);
+      // realtime mode: spin before blocking to avoid the wakeup latency of the condition variable
+      int spinTimeInUs = SickScanRealtime::instance().getSpinUsec();
+      bool retVal = (spinTimeInUs > 0 && this->recvQueue.spinForIncomingObject(spinTimeInUs)) || this->recvQueue.waitForIncomingObject(maxWaitInMs);
       if (retVal == false)
       {
         ROS_WARN("Timeout during waiting for new datagram");
@@ -831,6 +1059,12 @@ namespace sick_scan
         }
         recvTimeStamp = datagramWithTimeStamp.timeStamp;
         dataBuffer = datagramWithTimeStamp.datagram;
+        SickScanProfiling &profiling = SickScanProfiling::instance();
+        if (profiling.isEnabled() && !isDatagramReplayActive()) // replayed datagrams have recorded timestamps
+        {
+          profiling.addLatency(SickScanProfiling::STAGE_QUEUE_WAIT, (uint64_t)std::max<int64_t>(0, (ros::Time::now() - recvTimeStamp).toNSec()));
+          profiling.setGauge(SickScanProfiling::GAUGE_QUEUE_DEPTH, this->recvQueue.getNumberOfEntriesInQueue());
+        }
 
       }
 #endif
@@ -0,0 +1,533 @@
+/*
+ * @brief ROS independent driver core with callback outputs
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "sick_scan/sick_scan_core.h"
+
+namespace sick_scan
+{
+  static uint16_t readU16(const uint8_t* p)
+  {
+    return (uint16_t)((p[0] << 8) | p[1]);
+  }
+
+  static uint32_t readU32(const uint8_t* p)
+  {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+  }
+
+  static float readFloat(const uint8_t* p)
+  {
+    uint32_t u = readU32(p);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+  }
+
+  /*!
+  \brief Returns true, if the payload of a cola binary telegram starts with a given command, f.e. "sSN LMDscandata "
+  */
+  static bool isCommand(const uint8_t* telegram, size_t size, const char* command)
+  {
+    size_t len = strlen(command);
+    return size >= 8 + len && memcmp(telegram + 8, command, len) == 0;
+  }
+
+  SickScanCore::SickScanCore() : m_scan_mirrored_and_shifted(false), m_socket(m_io_service), m_receive_thread_running(false),
+    m_receive_buffer_start(0), m_azimuth_min(0), m_azimuth_increment(0), m_response_received(false),
+    m_num_telegrams(0), m_num_bytes(0), m_num_errors(0)
+  {
+    m_scan.num_beams = 0;
+    m_scan.num_echos = 0;
+    m_scan.num_rssi = 0;
+    m_scan.num_encoders = 0;
+    m_cloud.num_beams = 0;
+    m_cloud.num_echos = 0;
+  }
+
+  SickScanCore::~SickScanCore()
+  {
+    disconnect();
+  }
+
+  uint64_t SickScanCore::systemTimeNanoSec(void)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  }
+
+  bool SickScanCore::connect(const std::string& hostname, int port, int timeout_msec)
+  {
+    disconnect();
+    try
+    {
+      boost::asio::ip::tcp::resolver resolver(m_io_service);
+      boost::asio::ip::tcp::resolver::query query(hostname, std::to_string(port));
+      boost::system::error_code errorcode;
+      boost::asio::ip::tcp::resolver::iterator endpoint = resolver.resolve(query, errorcode);
+      if (errorcode)
+        return false;
+      errorcode = boost::asio::error::host_not_found;
+      for (boost::asio::ip::tcp::resolver::iterator end; errorcode && endpoint != end; endpoint++)
+      {
+        m_socket.close();
+        m_socket.connect(*endpoint, errorcode);
+      }
+      if (errorcode)
+        return false;
+      m_socket.set_option(boost::asio::ip::tcp::no_delay(true));
+      struct timeval tv;
+      tv.tv_sec = timeout_msec / 1000;
+      tv.tv_usec = 1000 * (timeout_msec % 1000);
+      setsockopt(m_socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)); // blocking read returns after timeout to check the stop flag
+    }
+    catch (const std::exception&)
+    {
+      m_socket.close();
+      return false;
+    }
+    m_receive_buffer.clear();
+    m_receive_buffer_start = 0;
+    m_receive_thread_running = true;
+    m_receive_thread = std::thread(&SickScanCore::receiveThreadFunction, this);
+    return true;
+  }
+
+  void SickScanCore::disconnect(void)
+  {
+    m_receive_thread_running = false;
+    if (m_socket.is_open())
+    {
+      boost::system::error_code errorcode;
+      m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, errorcode);
+    }
+    if (m_receive_thread.joinable())
+      m_receive_thread.join();
+    if (m_socket.is_open())
+    {
+      boost::system::error_code errorcode;
+      m_socket.close(errorcode);
+    }
+  }
+
+  void SickScanCore::receiveThreadFunction(void)
+  {
+    std::vector<uint8_t> chunk(64 * 1024);
+    while (m_receive_thread_running)
+    {
+      ssize_t bytes_read = ::recv(m_socket.native_handle(), chunk.data(), chunk.size(), 0);
+      if (bytes_read > 0)
+        processReceivedBytes(chunk.data(), (size_t)bytes_read, systemTimeNanoSec());
+      else if (bytes_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        break; // connection closed or socket error
+    }
+    m_receive_thread_running = false;
+    m_response_cond.notify_all();
+  }
+
+  void SickScanCore::encodeTelegram(const std::vector<uint8_t>& payload, std::vector<uint8_t>& telegram)
+  {
+    uint32_t length = (uint32_t)payload.size();
+    uint8_t checksum = 0;
+    for (size_t n = 0; n < payload.size(); n++)
+      checksum ^= payload[n];
+    telegram.resize(payload.size() + 9);
+    memset(telegram.data(), 0x02, 4);
+    telegram[4] = (uint8_t)((length >> 24) & 0xFF);
+    telegram[5] = (uint8_t)((length >> 16) & 0xFF);
+    telegram[6] = (uint8_t)((length >> 8) & 0xFF);
+    telegram[7] = (uint8_t)(length & 0xFF);
+    if (!payload.empty())
+      memcpy(telegram.data() + 8, payload.data(), payload.size());
+    telegram[8 + payload.size()] = checksum;
+  }
+
+  bool SickScanCore::sendCommand(const std::vector<uint8_t>& command, std::vector<uint8_t>& response, int timeout_msec)
+  {
+    if (!m_receive_thread_running)
+      return false;
+    std::vector<uint8_t> telegram;
+    encodeTelegram(command, telegram);
+    std::unique_lock<std::mutex> lock(m_response_mutex);
+    m_response_received = false;
+    boost::system::error_code errorcode;
+    boost::asio::write(m_socket, boost::asio::buffer(telegram), errorcode);
+    if (errorcode)
+      return false;
+    if (!m_response_cond.wait_for(lock, std::chrono::milliseconds(timeout_msec), [this] { return m_response_received || !m_receive_thread_running; })
+      || !m_response_received)
+      return false;
+    response = m_response;
+    return true;
+  }
+
+  /*!
+  \brief Converts a sopas command string into a cola binary payload. Hex arguments like "03 F4724744" are given as bytes.
+  */
+  static std::vector<uint8_t> binaryCommand(const char* command, const std::vector<uint8_t>& arguments = std::vector<uint8_t>())
+  {
+    std::vector<uint8_t> payload(command, command + strlen(command));
+    payload.insert(payload.end(), arguments.begin(), arguments.end());
+    return payload;
+  }
+
+  bool SickScanCore::startScandata(int timeout_msec)
+  {
+    std::vector<uint8_t> response;
+    uint8_t access_mode[] = { 0x03, 0xF4, 0x72, 0x47, 0x44 }; // authorized client
+    uint8_t enable[] = { 0x01 };
+    return sendCommand(binaryCommand("sMN SetAccessMode ", std::vector<uint8_t>(access_mode, access_mode + sizeof(access_mode))), response, timeout_msec)
+      && sendCommand(binaryCommand("sMN LMCstartmeas"), response, timeout_msec)
+      && sendCommand(binaryCommand("sMN Run"), response, timeout_msec)
+      && sendCommand(binaryCommand("sEN LMDscandata ", std::vector<uint8_t>(enable, enable + sizeof(enable))), response, timeout_msec);
+  }
+
+  bool SickScanCore::stopScandata(int timeout_msec)
+  {
+    std::vector<uint8_t> response;
+    uint8_t disable[] = { 0x00 };
+    return sendCommand(binaryCommand("sEN LMDscandata ", std::vector<uint8_t>(disable, disable + sizeof(disable))), response, timeout_msec)
+      && sendCommand(binaryCommand("sMN LMCstopmeas"), response, timeout_msec);
+  }
+
+  void SickScanCore::processReceivedBytes(const uint8_t* data, size_t size, uint64_t recv_time_nsec)
+  {
+    m_num_bytes += size;
+    m_receive_buffer.insert(m_receive_buffer.end(), data, data + size);
+    while (m_receive_buffer.size() - m_receive_buffer_start >= 8)
+    {
+      const uint8_t* start = m_receive_buffer.data() + m_receive_buffer_start;
+      size_t available = m_receive_buffer.size() - m_receive_buffer_start;
+      if (readU32(start) != 0x02020202)
+      {
+        // resynchronize: skip bytes until the next stx
+        const uint8_t* stx = (const uint8_t*)memchr(start + 1, 0x02, available - 1);
+        m_receive_buffer_start = (stx ? (size_t)(stx - m_receive_buffer.data()) : m_receive_buffer.size());
+        continue;
+      }
+      size_t telegram_size = (size_t)readU32(start + 4) + 9;
+      if (available < telegram_size)
+        break;
+      processTelegram(start, telegram_size, recv_time_nsec);
+      m_receive_buffer_start += telegram_size;
+    }
+    // drop processed bytes, keep an incomplete telegram at the start of the buffer
+    if (m_receive_buffer_start > 0)
+    {
+      m_receive_buffer.erase(m_receive_buffer.begin(), m_receive_buffer.begin() + m_receive_buffer_start);
+      m_receive_buffer_start = 0;
+    }
+  }
+
+  bool SickScanCore::processTelegram(const uint8_t* telegram, size_t size, uint64_t recv_time_nsec)
+  {
+    if (size < 9 || readU32(telegram) != 0x02020202 || (size_t)readU32(telegram + 4) + 9 != size)
+    {
+      m_num_errors++;
+      return false;
+    }
+    uint8_t checksum = 0;
+    for (size_t n = 8; n < size - 1; n++)
+      checksum ^= telegram[n];
+    if (checksum != telegram[size - 1])
+    {
+      m_num_errors++;
+      return false;
+    }
+    m_num_telegrams++;
+    if (isCommand(telegram, size, "sSN LMDscandata "))
+    {
+      if (!m_scan_callback && !m_cloud_callback)
+        return true;
+      if (!decodeScandata(telegram, size, m_scan_mirrored_and_shifted, m_scan))
+      {
+        m_num_errors++;
+        return false;
+      }
+      m_scan.recv_time_nsec = recv_time_nsec;
+      if (m_scan_callback)
+        m_scan_callback(m_scan);
+      if (m_cloud_callback)
+      {
+        buildCloud(m_scan, m_cloud);
+        m_cloud_callback(m_cloud);
+      }
+    }
+    else if (isCommand(telegram, size, "sSN InertialMeasurementUnit "))
+    {
+      if (!m_imu_callback)
+        return true;
+      if (!decodeImu(telegram, size, m_imu))
+      {
+        m_num_errors++;
+        return false;
+      }
+      m_imu.recv_time_nsec = recv_time_nsec;
+      m_imu_callback(m_imu);
+    }
+    else if (isCommand(telegram, size, "sSN LFErec "))
+    {
+      if (!m_field_event_callback)
+        return true;
+      if (!decodeFieldEvents(telegram, size, m_field_events))
+      {
+        m_num_errors++;
+        return false;
+      }
+      m_field_event_callback(recv_time_nsec, m_field_events);
+    }
+    else if (isCommand(telegram, size, "sSN "))
+    {
+      if (m_telegram_callback)
+        m_telegram_callback(recv_time_nsec, telegram, size);
+    }
+    else
+    {
+      // response to a command sent by sendCommand()
+      std::lock_guard<std::mutex> lock(m_response_mutex);
+      m_response.assign(telegram + 8, telegram + size - 1);
+      m_response_received = true;
+      m_response_cond.notify_all();
+    }
+    return true;
+  }
+
+  bool SickScanCore::decodeScandata(const uint8_t* telegram, size_t size, bool scan_mirrored_and_shifted, SickScanCoreScan& scan,
+                                    uint32_t decode_echo_mask)
+  {
+    // Offsets see SickScanCommon::loopOnce(): 8 byte header, 16 byte "sSN LMDscandata ", device and scan status
+    if (size < 64)
+      return false;
+    scan.serial_number = readU32(telegram + 28);
+    scan.telegram_counter = readU16(telegram + 34);
+    scan.scan_counter = readU16(telegram + 36);
+    scan.time_since_startup_usec = readU32(telegram + 38);
+    scan.time_of_transmission_usec = readU32(telegram + 42);
+    scan.layer_angle_x200 = (int16_t)readU16(telegram + 50);
+    scan.elevation = (float)(-scan.layer_angle_x200 / 200.0 * M_PI / 180.0);
+    scan.scan_frequency = readU32(telegram + 52) / 100.0f;
+    uint32_t measurement_frequency_div100 = readU32(telegram + 56);
+    if (measurement_frequency_div100 > 10000) // see SickScanCommon::loopOnce()
+      measurement_frequency_div100 /= 100;
+    scan.time_increment = (measurement_frequency_div100 > 0) ? (float)(1.0 / (measurement_frequency_div100 * 100.0)) : 0.0f;
+    uint32_t num_encoders = readU16(telegram + 60);
+    size_t offset = 62 + 6 * num_encoders;
+    if (offset + 2 > size)
+      return false;
+    scan.num_encoders = std::min<uint32_t>(num_encoders, SickScanCoreScan::MAX_ENCODERS);
+    for (uint32_t n = 0; n < scan.num_encoders; n++)
+    {
+      scan.encoder_position[n] = (int32_t)readU32(telegram + 62 + 6 * n);
+      scan.encoder_speed[n] = (int16_t)readU16(telegram + 66 + 6 * n);
+    }
+    scan.num_beams = 0;
+    scan.num_echos = 0;
+    scan.num_rssi = 0;
+    scan.vertical_angles.clear();
+    // 16 bit channels followed by 8 bit channels, each channel with a 21 byte header
+    for (int bytes_per_value = 2; bytes_per_value >= 1; bytes_per_value--)
+    {
+      if (offset + 2 > size)
+        return false;
+      uint32_t num_channels = readU16(telegram + offset);
+      offset += 2;
+      for (uint32_t channel = 0; channel < num_channels; channel++)
+      {
+        if (offset + 21 > size)
+          return false;
+        const uint8_t* header = telegram + offset;
+        float scale_factor = readFloat(header + 5);
+        float scale_offset = readFloat(header + 9);
+        int32_t start_angle_div10000 = (int32_t)readU32(header + 13);
+        uint16_t angular_step_div10000 = readU16(header + 17);
+        uint32_t num_items = readU16(header + 19);
+        const uint8_t* data = header + 21;
+        offset += 21 + bytes_per_value * num_items;
+        if (offset > size)
+          return false;
+        bool is_dist = (memcmp(header, "DIST", 4) == 0);
+        bool is_rssi = (memcmp(header, "RSSI", 4) == 0);
+        if (memcmp(header, "VANG", 4) == 0) // vertical angles of MRS-1xxx
+        {
+          scan.vertical_angles.resize(num_items);
+          for (uint32_t i = 0; i < num_items; i++)
+            scan.vertical_angles[i] = (bytes_per_value == 2 ? readU16(data + 2 * i) : data[i]) * scale_factor + scale_offset;
+          continue;
+        }
+        if (!is_dist && !is_rssi)
+          continue;
+        if (scan.num_beams == 0)
+          scan.num_beams = num_items;
+        if (num_items != scan.num_beams)
+          return false;
+        if (is_dist)
+        {
+          if (scan.num_echos == 0)
+          {
+            scan.angle_increment = (float)(angular_step_div10000 / 10000.0 * M_PI / 180.0);
+            scan.angle_min = (float)(start_angle_div10000 / 10000.0 * M_PI / 180.0 - M_PI / 2);
+            if (scan_mirrored_and_shifted)
+            {
+              scan.angle_min = (float)(-(scan.angle_min - M_PI / 2));
+              scan.angle_increment = -scan.angle_increment;
+            }
+          }
+          scan.num_echos++;
+          scan.ranges.resize(scan.num_echos * num_items);
+          if (scan.num_echos <= 32 && (decode_echo_mask & (1u << (scan.num_echos - 1))) == 0)
+            continue; // echo not used, e.g. by echo_policy "first"
+          float* ranges = scan.ranges.data() + (scan.num_echos - 1) * num_items;
+          float scale_factor_001 = 0.001f * scale_factor; // mm to m
+          for (uint32_t i = 0; i < num_items; i++)
+            ranges[i] = (bytes_per_value == 2 ? readU16(data + 2 * i) : data[i]) * scale_factor_001 + scale_offset;
+        }
+        else
+        {
+          scan.num_rssi++;
+          scan.intensities.resize(scan.num_rssi * num_items);
+          if (scan.num_rssi <= 32 && (decode_echo_mask & (1u << (scan.num_rssi - 1))) == 0)
+            continue;
+          float* intensities = scan.intensities.data() + (scan.num_rssi - 1) * num_items;
+          for (uint32_t i = 0; i < num_items; i++)
+            intensities[i] = (bytes_per_value == 2 ? readU16(data + 2 * i) : data[i]) * scale_factor + scale_offset;
+        }
+      }
+    }
+    scan.ranges.resize(scan.num_echos * scan.num_beams);
+    scan.intensities.resize(scan.num_rssi * scan.num_beams);
+    return true;
+  }
+
+  bool SickScanCore::decodeImu(const uint8_t* telegram, size_t size, SickScanCoreImu& imu)
+  {
+    // 8 byte header, 28 byte "sSN InertialMeasurementUnit ", 13 floats and 4 byte timestamp, see SickScanImu::parseBinaryDatagram()
+    if (size < 36 + 13 * 4 + 4)
+      return false;
+    const uint8_t* values = telegram + 36;
+    for (int n = 0; n < 3; n++)
+    {
+      imu.linear_acceleration[n] = readFloat(values + 4 * n);
+      imu.angular_velocity[n] = readFloat(values + 4 * (3 + n));
+    }
+    for (int n = 0; n < 4; n++)
+      imu.orientation[n] = readFloat(values + 4 * (9 + n));
+    imu.timestamp_usec = readU32(values + 13 * 4);
+    return true;
+  }
+
+  bool SickScanCore::decodeFieldEvents(const uint8_t* telegram, size_t size, std::vector<SickScanCoreFieldEvent>& fields)
+  {
+    // 8 byte header, 11 byte "sSN LFErec ", number of fields and 43 byte per field, see SickScanMessages::parseLFErecMsg()
+    const size_t field_size = 43;
+    if (size < 19 + 2 + 1)
+      return false;
+    uint32_t num_fields = readU16(telegram + 19);
+    if (num_fields == 0 || 19 + 2 + num_fields * field_size + 1 != size)
+      return false;
+    fields.resize(num_fields);
+    const uint8_t* p = telegram + 21;
+    for (uint32_t n = 0; n < num_fields; n++, p += field_size)
+    {
+      SickScanCoreFieldEvent& field = fields[n];
+      field.version_number = readU16(p);
+      field.field_index = p[2];
+      field.sys_count = readU32(p + 3);
+      field.dist_scale_factor = readFloat(p + 7);
+      field.dist_scale_offset = readFloat(p + 11);
+      field.angle_scale_factor = readU32(p + 15);
+      field.angle_scale_offset = (int32_t)readU32(p + 19);
+      field.field_result_mrs = p[23];
+      // 3 reserved uint16 at p + 24
+      field.time_state = readU16(p + 30);
+      field.year = readU16(p + 32);
+      field.month = p[34];
+      field.day = p[35];
+      field.hour = p[36];
+      field.minute = p[37];
+      field.second = p[38];
+      field.microsecond = readU32(p + 39);
+    }
+    return true;
+  }
+
+  void SickScanCore::buildCloud(const SickScanCoreScan& scan, SickScanCoreCloud& cloud)
+  {
+    // azimuth tables are recomputed only if the scan geometry changes
+    if (m_cos_azimuth.size() != scan.num_beams || m_azimuth_min != scan.angle_min || m_azimuth_increment != scan.angle_increment)
+    {
+      m_cos_azimuth.resize(scan.num_beams);
+      m_sin_azimuth.resize(scan.num_beams);
+      for (uint32_t i = 0; i < scan.num_beams; i++)
+      {
+        double azimuth = scan.angle_min + i * (double)scan.angle_increment;
+        m_cos_azimuth[i] = (float)cos(azimuth);
+        m_sin_azimuth[i] = (float)sin(azimuth);
+      }
+      m_azimuth_min = scan.angle_min;
+      m_azimuth_increment = scan.angle_increment;
+    }
+    cloud.recv_time_nsec = scan.recv_time_nsec;
+    cloud.time_since_startup_usec = scan.time_since_startup_usec;
+    cloud.scan_counter = scan.scan_counter;
+    cloud.elevation = scan.elevation;
+    cloud.num_beams = scan.num_beams;
+    cloud.num_echos = scan.num_echos;
+    cloud.points.resize(4 * scan.num_echos * scan.num_beams);
+    float cos_elevation = cosf(scan.elevation);
+    float sin_elevation = sinf(scan.elevation);
+    float* point = cloud.points.data();
+    for (uint32_t echo = 0; echo < scan.num_echos; echo++)
+    {
+      const float* ranges = scan.ranges.data() + echo * scan.num_beams;
+      const float* intensities = (echo < scan.num_rssi) ? (scan.intensities.data() + echo * scan.num_beams) : 0;
+      for (uint32_t i = 0; i < scan.num_beams; i++, point += 4)
+      {
+        float range_xy = ranges[i] * cos_elevation;
+        point[0] = range_xy * m_cos_azimuth[i];
+        point[1] = range_xy * m_sin_azimuth[i];
+        point[2] = ranges[i] * sin_elevation;
+        point[3] = intensities ? intensities[i] : 0.0f;
+      }
+    }
+  }
+
+} /* namespace sick_scan */
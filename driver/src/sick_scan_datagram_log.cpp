@@ -0,0 +1,347 @@
+/*
+ * @brief Recording and replay of raw CoLa datagrams
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 04.02.2021
+ *
+ */
+
+#include <string.h>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "sick_scan/sick_scan_datagram_log.h"
+
+namespace sick_scan
+{
+  static const char datagramLogMagic[8] = { 'S', 'I', 'C', 'K', 'D', 'G', 'L', 'G' };
+  static const char datagramLogIndexMagic[8] = { 'S', 'I', 'C', 'K', 'D', 'G', 'I', 'X' };
+  static const uint32_t datagramLogVersion = 1;
+  static const size_t datagramLogHeaderSize = sizeof(datagramLogMagic) + 2 * sizeof(uint32_t);
+  static const size_t datagramLogFooterSize = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(datagramLogIndexMagic);
+
+  SickScanDatagramLogWriter::SickScanDatagramLogWriter() : m_file(NULL), m_offset(0)
+  {
+  }
+
+  SickScanDatagramLogWriter::~SickScanDatagramLogWriter()
+  {
+    close();
+  }
+
+  bool SickScanDatagramLogWriter::open(const std::string& filename)
+  {
+    close();
+    m_file = fopen(filename.c_str(), "wb");
+    if (m_file == NULL)
+      return false;
+    m_file_buffer.resize(1024 * 1024);
+    setvbuf(m_file, &m_file_buffer[0], _IOFBF, m_file_buffer.size());
+    m_index.clear();
+    m_index.reserve(64 * 1024);
+    uint32_t header[2] = { datagramLogVersion, 0 };
+    fwrite(datagramLogMagic, sizeof(datagramLogMagic), 1, m_file);
+    fwrite(header, sizeof(header), 1, m_file);
+    m_offset = datagramLogHeaderSize;
+    return true;
+  }
+
+  bool SickScanDatagramLogWriter::write(uint32_t sec, uint32_t nsec, const uint8_t* datagram, uint32_t length)
+  {
+    if (m_file == NULL)
+      return false;
+    uint32_t header[3] = { length, sec, nsec };
+    if (fwrite(header, sizeof(header), 1, m_file) != 1 || fwrite(datagram, 1, length, m_file) != length)
+      return false;
+    IndexEntry entry = { m_offset, sec, nsec };
+    m_index.push_back(entry);
+    m_offset += sizeof(header) + length;
+    return true;
+  }
+
+  void SickScanDatagramLogWriter::close(void)
+  {
+    if (m_file == NULL)
+      return;
+    for (size_t n = 0; n < m_index.size(); n++)
+    {
+      fwrite(&m_index[n].offset, sizeof(uint64_t), 1, m_file);
+      fwrite(&m_index[n].sec, sizeof(uint32_t), 1, m_file);
+      fwrite(&m_index[n].nsec, sizeof(uint32_t), 1, m_file);
+    }
+    uint32_t numDatagrams = (uint32_t)m_index.size();
+    fwrite(&m_offset, sizeof(uint64_t), 1, m_file);
+    fwrite(&numDatagrams, sizeof(uint32_t), 1, m_file);
+    fwrite(datagramLogIndexMagic, sizeof(datagramLogIndexMagic), 1, m_file);
+    fclose(m_file);
+    m_file = NULL;
+  }
+
+  SickScanDatagramLogReader::SickScanDatagramLogReader() : m_file(NULL)
+  {
+  }
+
+  SickScanDatagramLogReader::~SickScanDatagramLogReader()
+  {
+    close();
+  }
+
+  bool SickScanDatagramLogReader::open(const std::string& filename)
+  {
+    close();
+    m_file = fopen(filename.c_str(), "rb");
+    if (m_file == NULL)
+      return false;
+    char magic[sizeof(datagramLogMagic)];
+    uint32_t header[2];
+    if (fread(magic, sizeof(magic), 1, m_file) != 1 || memcmp(magic, datagramLogMagic, sizeof(magic)) != 0
+      || fread(header, sizeof(header), 1, m_file) != 1 || header[0] != datagramLogVersion)
+    {
+      close();
+      return false;
+    }
+    if (!readIndex() && !scanDatagrams())
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void SickScanDatagramLogReader::close(void)
+  {
+    if (m_file != NULL)
+      fclose(m_file);
+    m_file = NULL;
+    m_index.clear();
+  }
+
+  /*!
+  \brief Reads the index from the end of the file
+  */
+  bool SickScanDatagramLogReader::readIndex(void)
+  {
+    uint64_t indexOffset = 0;
+    uint32_t numDatagrams = 0;
+    char magic[sizeof(datagramLogIndexMagic)];
+    if (fseek(m_file, -(long)datagramLogFooterSize, SEEK_END) != 0
+      || fread(&indexOffset, sizeof(indexOffset), 1, m_file) != 1
+      || fread(&numDatagrams, sizeof(numDatagrams), 1, m_file) != 1
+      || fread(magic, sizeof(magic), 1, m_file) != 1
+      || memcmp(magic, datagramLogIndexMagic, sizeof(magic)) != 0
+      || fseek(m_file, (long)indexOffset, SEEK_SET) != 0)
+    {
+      return false;
+    }
+    m_index.resize(numDatagrams);
+    for (size_t n = 0; n < m_index.size(); n++)
+    {
+      if (fread(&m_index[n].offset, sizeof(uint64_t), 1, m_file) != 1
+        || fread(&m_index[n].sec, sizeof(uint32_t), 1, m_file) != 1
+        || fread(&m_index[n].nsec, sizeof(uint32_t), 1, m_file) != 1)
+      {
+        m_index.clear();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*!
+  \brief Rebuilds the index by scanning all datagrams (fallback for incomplete files without index)
+  */
+  bool SickScanDatagramLogReader::scanDatagrams(void)
+  {
+    m_index.clear();
+    uint64_t offset = datagramLogHeaderSize;
+    uint32_t header[3];
+    while (fseek(m_file, (long)offset, SEEK_SET) == 0 && fread(header, sizeof(header), 1, m_file) == 1)
+    {
+      if (fseek(m_file, (long)header[0], SEEK_CUR) != 0)
+        break;
+      IndexEntry entry = { offset, header[1], header[2] };
+      m_index.push_back(entry);
+      offset += sizeof(header) + header[0];
+    }
+    // The last datagram may be truncated
+    if (!m_index.empty())
+    {
+      uint32_t length = 0;
+      fseek(m_file, 0, SEEK_END);
+      long fileSize = ftell(m_file);
+      fseek(m_file, (long)m_index.back().offset, SEEK_SET);
+      if (fread(&length, sizeof(length), 1, m_file) != 1 || m_index.back().offset + 3 * sizeof(uint32_t) + length > (uint64_t)fileSize)
+        m_index.pop_back();
+    }
+    return !m_index.empty();
+  }
+
+  bool SickScanDatagramLogReader::read(size_t idx, uint32_t& sec, uint32_t& nsec, std::vector<uint8_t>& datagram)
+  {
+    if (m_file == NULL || idx >= m_index.size() || fseek(m_file, (long)m_index[idx].offset, SEEK_SET) != 0)
+      return false;
+    uint32_t header[3];
+    if (fread(header, sizeof(header), 1, m_file) != 1)
+      return false;
+    datagram.resize(header[0]);
+    if (header[0] > 0 && fread(&datagram[0], 1, header[0], m_file) != header[0])
+      return false;
+    sec = header[1];
+    nsec = header[2];
+    return true;
+  }
+
+  SickScanDatagramLogMapping::SickScanDatagramLogMapping() : m_data(NULL), m_size(0)
+  {
+  }
+
+  SickScanDatagramLogMapping::~SickScanDatagramLogMapping()
+  {
+    close();
+  }
+
+  bool SickScanDatagramLogMapping::open(const std::string& filename)
+  {
+    close();
+#ifndef _MSC_VER
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+      void* mapping = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED)
+      {
+        m_data = (const uint8_t*)mapping;
+        m_size = (size_t)file_stat.st_size;
+      }
+    }
+    ::close(fd);
+#else
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file != NULL)
+    {
+      fseek(file, 0, SEEK_END);
+      m_buffer.resize(ftell(file));
+      fseek(file, 0, SEEK_SET);
+      if (!m_buffer.empty() && fread(&m_buffer[0], 1, m_buffer.size(), file) == m_buffer.size())
+      {
+        m_data = &m_buffer[0];
+        m_size = m_buffer.size();
+      }
+      fclose(file);
+    }
+#endif
+    if (m_data == NULL || m_size < datagramLogHeaderSize || memcmp(m_data, datagramLogMagic, sizeof(datagramLogMagic)) != 0)
+    {
+      close();
+      return false;
+    }
+    uint32_t version = 0;
+    memcpy(&version, m_data + sizeof(datagramLogMagic), sizeof(version));
+    if (version != datagramLogVersion)
+    {
+      close();
+      return false;
+    }
+    // Read the index from the footer
+    uint64_t index_offset = 0;
+    uint32_t num_datagrams = 0;
+    const uint8_t* footer = m_data + m_size - datagramLogFooterSize;
+    if (m_size >= datagramLogHeaderSize + datagramLogFooterSize)
+    {
+      memcpy(&index_offset, footer, sizeof(index_offset));
+      memcpy(&num_datagrams, footer + sizeof(index_offset), sizeof(num_datagrams));
+    }
+    const size_t index_entry_size = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    bool index_valid = (m_size >= datagramLogHeaderSize + datagramLogFooterSize
+      && memcmp(footer + sizeof(index_offset) + sizeof(num_datagrams), datagramLogIndexMagic, sizeof(datagramLogIndexMagic)) == 0
+      && index_offset + (uint64_t)num_datagrams * index_entry_size <= m_size - datagramLogFooterSize);
+    if (index_valid)
+    {
+      m_index.reserve(num_datagrams);
+      for (uint32_t n = 0; n < num_datagrams; n++)
+      {
+        uint64_t offset = 0;
+        memcpy(&offset, m_data + index_offset + n * index_entry_size, sizeof(offset));
+        if (!addDatagram(offset))
+          break;
+      }
+    }
+    // Fallback for incomplete files without index: scan the datagrams. A valid index with 0 datagrams is an empty log.
+    if (!index_valid || m_index.size() != num_datagrams)
+    {
+      m_index.clear();
+      for (uint64_t offset = datagramLogHeaderSize; addDatagram(offset); offset += 3 * sizeof(uint32_t) + m_index.back().length)
+      {
+      }
+    }
+    if (m_index.empty() && !(index_valid && num_datagrams == 0))
+    {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  /*!
+  \brief Appends the datagram at a given file offset to the index, returns false if the datagram exceeds the mapping
+  */
+  bool SickScanDatagramLogMapping::addDatagram(uint64_t offset)
+  {
+    uint32_t header[3];
+    if (offset + sizeof(header) > m_size)
+      return false;
+    memcpy(header, m_data + offset, sizeof(header));
+    if (offset + sizeof(header) + header[0] > m_size)
+      return false;
+    IndexEntry entry = { m_data + offset + sizeof(header), header[0], header[1], header[2] };
+    m_index.push_back(entry);
+    return true;
+  }
+
+  void SickScanDatagramLogMapping::close(void)
+  {
+#ifndef _MSC_VER
+    if (m_data != NULL)
+      munmap((void*)m_data, m_size);
+#endif
+    m_data = NULL;
+    m_size = 0;
+    m_buffer.clear();
+    m_index.clear();
+  }
+
+} /* namespace sick_scan */
@@ -0,0 +1,179 @@
+/*
+ * @brief Structure-of-arrays representation of a decoded scan
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 15.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "sick_scan/sick_scan_decoded_scan.h"
+
+namespace sick_scan
+{
+  SickScanDecodedScan::SickScanDecodedScan()
+  : m_num_echos(0), m_num_beams(0), m_time_increment(0), m_azimuth_min(0), m_azimuth_increment(0), m_azimuth_compensator(0)
+  {
+  }
+
+  void SickScanDecodedScan::assign(int num_echos, std::vector<float>& ranges, std::vector<float>& intensities, const ros::Time& stamp, float time_increment)
+  {
+    m_ranges.swap(ranges);
+    m_intensities.swap(intensities);
+    m_num_echos = (num_echos > 0) ? num_echos : 0;
+    m_num_beams = (m_num_echos > 0) ? (m_ranges.size() / m_num_echos) : 0;
+    m_stamp = stamp;
+    m_time_increment = time_increment;
+    m_cos_elevation.clear();
+    m_sin_elevation.clear();
+  }
+
+  void SickScanDecodedScan::setNumEchos(int num_echos)
+  {
+    m_num_echos = (num_echos > 0) ? num_echos : 0;
+    m_ranges.resize(m_num_echos * m_num_beams);
+    if (m_intensities.size() > m_num_echos * m_num_beams)
+      m_intensities.resize(m_num_echos * m_num_beams);
+  }
+
+  void SickScanDecodedScan::setAzimuth(float angle_min, float angle_increment, AngleCompensator* compensator)
+  {
+    if (m_cos_azimuth.size() == m_num_beams && m_azimuth_min == angle_min && m_azimuth_increment == angle_increment && m_azimuth_compensator == compensator)
+      return; // unchanged, cached tables are valid
+    m_cos_azimuth.resize(m_num_beams);
+    m_sin_azimuth.resize(m_num_beams);
+    float angle = angle_min;
+    for (size_t beam = 0; beam < m_num_beams; beam++)
+    {
+      double phi = angle;
+      if (compensator != NULL)
+        phi = compensator->compensateAngleInRadFromRos(phi);
+      m_cos_azimuth[beam] = (float)cos(phi);
+      m_sin_azimuth[beam] = (float)sin(phi);
+      angle += angle_increment;
+    }
+    m_azimuth_min = angle_min;
+    m_azimuth_increment = angle_increment;
+    m_azimuth_compensator = compensator;
+  }
+
+  void SickScanDecodedScan::setElevation(float elevation)
+  {
+    m_cos_elevation.assign(m_num_beams, (float)cos(elevation));
+    m_sin_elevation.assign(m_num_beams, (float)sin(elevation));
+  }
+
+  void SickScanDecodedScan::setElevation(const std::vector<float>& vertical_angles_deg)
+  {
+    m_cos_elevation.resize(m_num_beams);
+    m_sin_elevation.resize(m_num_beams);
+    for (size_t beam = 0; beam < m_num_beams; beam++)
+    {
+      float alpha = (beam < vertical_angles_deg.size()) ? (float)(-vertical_angles_deg[beam] * M_PI / 180.0) : 0.0f;
+      m_cos_elevation[beam] = cosf(alpha);
+      m_sin_elevation[beam] = sinf(alpha);
+    }
+  }
+
+  void SickScanDecodedScan::toLaserScan(int echo, sensor_msgs::LaserScan& msg, float range_scale) const
+  {
+    const float* src_ranges = ranges(echo);
+    const float* src_intensities = intensities(echo);
+    msg.ranges.resize(m_num_beams);
+    msg.intensities.resize(m_num_beams);
+    if (src_ranges == NULL)
+      return;
+    if (range_scale == 1.0f)
+    {
+      memcpy(&msg.ranges[0], src_ranges, m_num_beams * sizeof(float));
+    }
+    else
+    {
+      for (size_t beam = 0; beam < m_num_beams; beam++)
+        msg.ranges[beam] = range_scale * src_ranges[beam];
+    }
+    if (src_intensities != NULL)
+      memcpy(&msg.intensities[0], src_intensities, m_num_beams * sizeof(float));
+    else
+      memset(&msg.intensities[0], 0, m_num_beams * sizeof(float)); // no intensities transmitted
+  }
+
+  void SickScanDecodedScan::toCloud(int num_echos, const int* echo_idx, uint8_t* cloud_data, size_t point_step, size_t echo_stride, bool with_intensity,
+                                    bool with_time, float time_offset, size_t beam_begin, size_t beam_end) const
+  {
+    beam_end = std::min(beam_end, m_num_beams);
+    if (cloud_data == NULL || m_cos_azimuth.size() != m_num_beams || m_cos_elevation.size() != m_num_beams)
+      return;
+    for (int n = 0; n < num_echos; n++)
+    {
+      const float* src_ranges = ranges(echo_idx[n]);
+      const float* src_intensities = with_intensity ? intensities(echo_idx[n]) : NULL;
+      if (src_ranges == NULL)
+        continue;
+      uint8_t* dst = cloud_data + n * echo_stride + beam_begin * point_step;
+      for (size_t beam = beam_begin; beam < beam_end; beam++, dst += point_step)
+      {
+        float* fptr = (float*)dst;
+        float range = src_ranges[beam];
+        float range_cos = range * m_cos_elevation[beam];
+        fptr[0] = range_cos * m_cos_azimuth[beam];
+        fptr[1] = range_cos * m_sin_azimuth[beam];
+        fptr[2] = range * m_sin_elevation[beam];
+        fptr[3] = (src_intensities != NULL) ? src_intensities[beam] : 0.0f;
+        if (with_time)
+          fptr[4] = time_offset + beam * m_time_increment;
+      }
+    }
+  }
+
+  void SickScanDecodedScan::toCloudParallel(SickScanThreadPool* pool, size_t min_beams_per_task, int num_echos, const int* echo_idx, uint8_t* cloud_data,
+                                            size_t point_step, size_t echo_stride, bool with_intensity, bool with_time, float time_offset) const
+  {
+    size_t num_threads = (pool != NULL) ? pool->numThreads() : 1;
+    // Number of beam intervals per echo: enough tasks for load balancing (4 per thread), but not less than min_beams_per_task beams each
+    size_t num_chunks = std::min(m_num_beams / std::max(min_beams_per_task, (size_t)1), (4 * num_threads + num_echos - 1) / std::max(num_echos, 1));
+    if (num_threads <= 1 || num_echos <= 0 || num_echos * std::max(num_chunks, (size_t)1) <= 1)
+    {
+      toCloud(num_echos, echo_idx, cloud_data, point_step, echo_stride, with_intensity, with_time, time_offset, 0, m_num_beams);
+      return;
+    }
+    num_chunks = std::max(num_chunks, (size_t)1);
+    pool->parallelFor(num_echos * num_chunks, [&](size_t task)
+    {
+      size_t echo = task / num_chunks, chunk = task % num_chunks;
+      toCloud(1, echo_idx + echo, cloud_data + echo * echo_stride, point_step, echo_stride, with_intensity, with_time, time_offset,
+              (chunk * m_num_beams) / num_chunks, ((chunk + 1) * m_num_beams) / num_chunks);
+    });
+  }
+
+} /* namespace sick_scan */
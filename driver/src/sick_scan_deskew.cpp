@@ -0,0 +1,192 @@
+/*
+ * @brief Motion compensation (deskew) of pointclouds
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 08.02.2021
+ *
+ */
+
+#include <string.h>
+
+#include "sick_scan/sick_scan_deskew.h"
+
+namespace sick_scan
+{
+  SickScanDeskew::SickScanDeskew(double max_sample_age) : m_max_sample_age(max_sample_age)
+  {
+  }
+
+  void SickScanDeskew::addSample(std::deque<VelocitySample>& samples, const ros::Time& stamp, double x, double y, double z)
+  {
+    VelocitySample sample;
+    sample.stamp = stamp.toSec();
+    sample.vel[0] = x;
+    sample.vel[1] = y;
+    sample.vel[2] = z;
+    std::lock_guard<std::mutex> lock(m_sample_mutex);
+    samples.push_back(sample);
+    while (samples.size() > 1 && samples.front().stamp < sample.stamp - 2 * m_max_sample_age)
+      samples.pop_front(); // keep the samples of the last 2 * max_sample_age seconds
+  }
+
+  void SickScanDeskew::addAngularVelocity(const ros::Time& stamp, double wx, double wy, double wz)
+  {
+    addSample(m_angular_velocity, stamp, wx, wy, wz);
+  }
+
+  void SickScanDeskew::addLinearVelocity(const ros::Time& stamp, double vx, double vy, double vz)
+  {
+    addSample(m_linear_velocity, stamp, vx, vy, vz);
+  }
+
+  void SickScanDeskew::addImu(const sensor_msgs::Imu& imu)
+  {
+    addAngularVelocity(imu.header.stamp, imu.angular_velocity.x, imu.angular_velocity.y, imu.angular_velocity.z);
+  }
+
+  void SickScanDeskew::imuCallback(const sensor_msgs::Imu::ConstPtr& msg)
+  {
+    addImu(*msg);
+  }
+
+  void SickScanDeskew::odometryCallback(const nav_msgs::Odometry::ConstPtr& msg)
+  {
+    const geometry_msgs::Twist& twist = msg->twist.twist;
+    addAngularVelocity(msg->header.stamp, twist.angular.x, twist.angular.y, twist.angular.z);
+    addLinearVelocity(msg->header.stamp, twist.linear.x, twist.linear.y, twist.linear.z);
+  }
+
+  /*!
+  \brief Returns the mean velocity of all samples between start_time and end_time, or the velocity of the
+  sample next to this interval, if no sample is within the interval.
+  \return false, if no sample is available within max_age
+  */
+  bool SickScanDeskew::meanVelocity(const std::deque<VelocitySample>& samples, double start_time, double end_time, double max_age, double* vel)
+  {
+    vel[0] = vel[1] = vel[2] = 0;
+    int num_samples = 0;
+    double min_dist = max_age;
+    const VelocitySample* next_sample = 0;
+    for (std::deque<VelocitySample>::const_iterator iter = samples.begin(); iter != samples.end(); iter++)
+    {
+      if (iter->stamp >= start_time && iter->stamp <= end_time)
+      {
+        for (int n = 0; n < 3; n++)
+          vel[n] += iter->vel[n];
+        num_samples++;
+      }
+      else
+      {
+        double dist = (iter->stamp < start_time) ? (start_time - iter->stamp) : (iter->stamp - end_time);
+        if (dist <= min_dist)
+        {
+          min_dist = dist;
+          next_sample = &(*iter);
+        }
+      }
+    }
+    if (num_samples > 0)
+    {
+      for (int n = 0; n < 3; n++)
+        vel[n] /= num_samples;
+      return true;
+    }
+    if (next_sample)
+    {
+      for (int n = 0; n < 3; n++)
+        vel[n] = next_sample->vel[n];
+      return true;
+    }
+    return false;
+  }
+
+  bool SickScanDeskew::deskew(sensor_msgs::PointCloud2& cloud)
+  {
+    int offset_x = -1, offset_y = -1, offset_z = -1, offset_time = -1;
+    for (size_t n = 0; n < cloud.fields.size(); n++)
+    {
+      if (cloud.fields[n].datatype != sensor_msgs::PointField::FLOAT32)
+        continue;
+      if (cloud.fields[n].name == "x")
+        offset_x = cloud.fields[n].offset;
+      else if (cloud.fields[n].name == "y")
+        offset_y = cloud.fields[n].offset;
+      else if (cloud.fields[n].name == "z")
+        offset_z = cloud.fields[n].offset;
+      else if (cloud.fields[n].name == "time")
+        offset_time = cloud.fields[n].offset;
+    }
+    size_t num_points = (size_t)cloud.width * cloud.height;
+    if (offset_x < 0 || offset_y < 0 || offset_z < 0 || offset_time < 0 || num_points == 0)
+      return false;
+
+    // Time range of the pointcloud
+    const uint8_t* point_ptr = &cloud.data[0];
+    float max_time = 0;
+    for (size_t n = 0; n < num_points; n++, point_ptr += cloud.point_step)
+    {
+      float point_time;
+      memcpy(&point_time, point_ptr + offset_time, sizeof(float));
+      if (point_time > max_time)
+        max_time = point_time;
+    }
+    double start_time = cloud.header.stamp.toSec();
+    double end_time = start_time + max_time;
+
+    // Mean velocities during the scan
+    double w[3], v[3];
+    bool angular_valid, linear_valid;
+    {
+      std::lock_guard<std::mutex> lock(m_sample_mutex);
+      angular_valid = meanVelocity(m_angular_velocity, start_time, end_time, m_max_sample_age, w);
+      linear_valid = meanVelocity(m_linear_velocity, start_time, end_time, m_max_sample_age, v);
+    }
+    if (!angular_valid && !linear_valid)
+      return false;
+    const float wx = (float)w[0], wy = (float)w[1], wz = (float)w[2];
+    const float vx = (float)v[0], vy = (float)v[1], vz = (float)v[2];
+
+    // Transform all points into the sensor pose at the pointcloud timestamp
+    uint8_t* data_ptr = &cloud.data[0];
+    for (size_t n = 0; n < num_points; n++, data_ptr += cloud.point_step)
+    {
+      float* px = (float*)(data_ptr + offset_x);
+      float* py = (float*)(data_ptr + offset_y);
+      float* pz = (float*)(data_ptr + offset_z);
+      float dt = *(const float*)(data_ptr + offset_time);
+      float x = *px, y = *py, z = *pz;
+      *px = x + dt * (wy * z - wz * y + vx);
+      *py = y + dt * (wz * x - wx * z + vy);
+      *pz = z + dt * (wx * y - wy * x + vz);
+    }
+    return true;
+  }
+
+} /* namespace sick_scan */
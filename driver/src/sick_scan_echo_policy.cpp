@@ -0,0 +1,130 @@
+/*
+ * @brief Host-side selection of echos of multi-echo scanners
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 12.02.2021
+ *
+ */
+
+#include "sick_scan/sick_scan_echo_policy.h"
+
+namespace sick_scan
+{
+  bool SickScanEchoPolicy::setPolicy(const std::string& policy_name, float intensity_threshold)
+  {
+    for (int n = 0; n < ECHO_POLICY_NUM; n++)
+    {
+      if (policy_name == policyName((POLICY)n))
+      {
+        m_policy = (POLICY)n;
+        m_intensity_threshold = intensity_threshold;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const char* SickScanEchoPolicy::policyName(POLICY policy)
+  {
+    static const char* names[ECHO_POLICY_NUM] = { "all", "first", "last", "strongest", "last_above_threshold" };
+    return (policy >= 0 && policy < ECHO_POLICY_NUM) ? names[policy] : "unknown";
+  }
+
+  int SickScanEchoPolicy::apply(std::vector<float>& ranges, std::vector<float>& intensities, int num_echos, int echo_mask) const
+  {
+    if (m_policy == ECHO_ALL || num_echos <= 1 || ranges.size() < (size_t)num_echos)
+      return num_echos;
+    size_t num_beams = ranges.size() / num_echos;
+    int num_intensity_echos = (int)(intensities.size() / num_beams);
+    if (num_intensity_echos > num_echos)
+      num_intensity_echos = num_echos;
+    float* range_ptr = &ranges[0];
+    float* intensity_ptr = (num_intensity_echos > 0) ? &intensities[0] : 0;
+    // Candidate echos are the echos enabled in echo_mask (echo 0, if none is enabled). Policy "first" decodes echo 0 only.
+    int candidates[32];
+    int num_candidates = 0;
+    for (int echo = 0; m_policy != ECHO_FIRST && echo < num_echos && echo < 32; echo++)
+    {
+      if (echo_mask & (1 << echo))
+        candidates[num_candidates++] = echo;
+    }
+    if (num_candidates == 0)
+      candidates[num_candidates++] = 0;
+    // The selected echo of a beam is written to index beam, i.e. to echo 0. Index beam is not read after the beam has been processed.
+    for (size_t beam = 0; beam < num_beams; beam++)
+    {
+      int selected = candidates[0]; // first candidate, if no echo matches the policy
+      switch (m_policy)
+      {
+        case ECHO_LAST:
+          for (int n = num_candidates - 1; n > 0; n--)
+          {
+            if (range_ptr[candidates[n] * num_beams + beam] > 0)
+            {
+              selected = candidates[n];
+              break;
+            }
+          }
+          break;
+        case ECHO_STRONGEST:
+          for (int n = 1; n < num_candidates && candidates[n] < num_intensity_echos; n++)
+          {
+            int echo = candidates[n];
+            if (range_ptr[echo * num_beams + beam] > 0
+                && (!(range_ptr[selected * num_beams + beam] > 0) || intensity_ptr[echo * num_beams + beam] > intensity_ptr[selected * num_beams + beam]))
+              selected = echo;
+          }
+          break;
+        case ECHO_LAST_ABOVE_THRESHOLD:
+          for (int n = num_candidates - 1; n > 0; n--)
+          {
+            int echo = candidates[n];
+            if (range_ptr[echo * num_beams + beam] > 0
+                && (echo >= num_intensity_echos || intensity_ptr[echo * num_beams + beam] >= m_intensity_threshold))
+            {
+              selected = echo;
+              break;
+            }
+          }
+          break;
+        default:
+          break;
+      }
+      range_ptr[beam] = range_ptr[selected * num_beams + beam];
+      if (intensity_ptr != 0) // range and intensity from the same echo, intensity 0 if the selected echo has no intensity
+        intensity_ptr[beam] = (selected < num_intensity_echos) ? intensity_ptr[selected * num_beams + beam] : 0;
+    }
+    ranges.resize(num_beams);
+    if (num_intensity_echos > 0)
+      intensities.resize(num_beams);
+    return 1;
+  }
+
+} /* namespace sick_scan */
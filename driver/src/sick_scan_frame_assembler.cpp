@@ -0,0 +1,246 @@
+/*
+ * @brief Assembles pointcloud frames from multi-layer scans
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 05.02.2021
+ *
+ */
+
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+#include "sick_scan/sick_scan_frame_assembler.h"
+
+namespace sick_scan
+{
+  SickScanFrameAssembler::SickScanFrameAssembler()
+  : m_output_mode(OUTPUT_FRAME), m_sector_angle(10.0 * M_PI / 180.0), m_active_buffer(0), m_num_layers(0), m_num_echos(0),
+    m_echo_stride(0), m_num_layers_received(0), m_frame_ready(false), m_num_complete_frames(0), m_num_incomplete_frames(0), m_num_dropped_layers(0)
+  {
+  }
+
+  void SickScanFrameAssembler::setOutputMode(int output_mode, double sector_angle_rad)
+  {
+    if (output_mode != m_output_mode)
+    {
+      m_output_mode = output_mode;
+      resetFrame();
+    }
+    m_sector_angle = sector_angle_rad;
+  }
+
+  int SickScanFrameAssembler::layerIndex(int num_layers, int elev_angle_x200)
+  {
+    int layer = -1;
+    switch (num_layers)
+    {
+      case 1: // TiM, LMS, NAV etc.
+        layer = 0;
+        break;
+      case 4: // MRS1xxx: elevation angles +1.25, 0, -1.25, -2.5 degree
+        if (elev_angle_x200 % 250 == 0 && elev_angle_x200 <= 250 && elev_angle_x200 >= -500)
+          layer = (250 - elev_angle_x200) / 250;
+        break;
+      case 24: // MRS6xxx: elevation angles from -13.19 degree in steps of 0.625 degree
+      {
+        const int min_elevation_x200 = -2638;
+        const int elevation_step_x200 = 125;
+        // range check before the division, integer division truncates towards zero
+        if (elev_angle_x200 >= min_elevation_x200 && elev_angle_x200 <= min_elevation_x200 + (num_layers - 1) * elevation_step_x200)
+          layer = (num_layers - 1) - (elev_angle_x200 - min_elevation_x200) / elevation_step_x200;
+        break;
+      }
+      default:
+        break;
+    }
+    if (layer < 0 || layer >= num_layers)
+      return -1;
+    return layer;
+  }
+
+  void SickScanFrameAssembler::resetFrame(void)
+  {
+    m_num_layers_received = 0;
+    m_layer_received.assign(m_layer_received.size(), 0);
+    m_num_layers = 0; // force reinitialization of the frame buffer
+  }
+
+  uint8_t* SickScanFrameAssembler::beginLayer(int num_layers, int num_echos, int width, const std::vector<sensor_msgs::PointField>& fields, int point_step,
+                                              int layer, const ros::Time& stamp, const std::string& frame_id)
+  {
+    if (layer < 0 || layer >= num_layers || num_echos <= 0 || width <= 0)
+      return NULL;
+    int buffer_layers = (m_output_mode == OUTPUT_LAYER) ? 1 : num_layers;
+    int buffer_layer = (m_output_mode == OUTPUT_LAYER) ? 0 : layer;
+    sensor_msgs::PointCloud2& frame = m_frame_buffer[m_active_buffer];
+    bool geometry_changed = (buffer_layers != m_num_layers || num_echos != m_num_echos || (uint32_t)width != frame.width
+      || (uint32_t)point_step != frame.point_step || fields.size() != frame.fields.size());
+    if (geometry_changed && m_num_layers_received > 0)
+    {
+      finishFrame(); // geometry changed, e.g. by reconfiguration of the echos
+    }
+    else if (!geometry_changed && m_layer_received[buffer_layer])
+    {
+      finishFrame(); // layer received twice, i.e. the frame is incomplete
+    }
+    sensor_msgs::PointCloud2& next_frame = m_frame_buffer[m_active_buffer];
+    if (m_num_layers_received == 0)
+    {
+      // Start a new frame
+      m_num_layers = buffer_layers;
+      m_num_echos = num_echos;
+      m_layer_received.assign(buffer_layers, 0);
+      next_frame.header.stamp = stamp;
+      next_frame.header.frame_id = frame_id;
+      next_frame.header.seq = 0;
+      next_frame.height = buffer_layers * num_echos;
+      next_frame.width = width;
+      next_frame.is_bigendian = false;
+      next_frame.is_dense = true;
+      next_frame.point_step = point_step;
+      next_frame.row_step = point_step * width;
+      next_frame.fields = fields;
+      next_frame.data.resize(next_frame.row_step * next_frame.height); // no reallocation after the first frame
+      m_echo_stride = (size_t)next_frame.row_step * buffer_layers;
+    }
+    return &next_frame.data[0] + (size_t)buffer_layer * next_frame.row_step;
+  }
+
+  void SickScanFrameAssembler::endLayer(int layer)
+  {
+    int buffer_layer = (m_output_mode == OUTPUT_LAYER) ? 0 : layer;
+    if (buffer_layer < 0 || buffer_layer >= (int)m_layer_received.size() || m_layer_received[buffer_layer])
+      return;
+    m_layer_received[buffer_layer] = 1;
+    m_num_layers_received++;
+    if (m_num_layers_received >= m_num_layers)
+      finishFrame();
+  }
+
+  /*!
+  \brief Finishes the frame under construction. Rows of missing layers are set to NaN (float fields) resp. 0.
+  The finished frame becomes ready and the other frame buffer is used for the next frame.
+  */
+  void SickScanFrameAssembler::finishFrame(void)
+  {
+    sensor_msgs::PointCloud2& frame = m_frame_buffer[m_active_buffer];
+    if (m_num_layers_received < m_num_layers)
+    {
+      const float nan_value = std::numeric_limits<float>::quiet_NaN();
+      for (int layer = 0; layer < m_num_layers; layer++)
+      {
+        if (m_layer_received[layer])
+          continue;
+        for (int echo = 0; echo < m_num_echos; echo++)
+        {
+          uint8_t* row = &frame.data[0] + echo * m_echo_stride + (size_t)layer * frame.row_step;
+          memset(row, 0, frame.row_step);
+          for (size_t field_idx = 0; field_idx < frame.fields.size(); field_idx++)
+          {
+            if (frame.fields[field_idx].datatype != sensor_msgs::PointField::FLOAT32)
+              continue;
+            for (uint32_t col = 0; col < frame.width; col++)
+              memcpy(row + col * frame.point_step + frame.fields[field_idx].offset, &nan_value, sizeof(float));
+          }
+        }
+      }
+      frame.is_dense = false;
+      m_num_dropped_layers += (m_num_layers - m_num_layers_received);
+      m_num_incomplete_frames++;
+    }
+    else
+    {
+      m_num_complete_frames++;
+    }
+    m_frame_ready = true;
+    m_active_buffer = 1 - m_active_buffer;
+    m_num_layers_received = 0;
+    m_layer_received.assign(m_layer_received.size(), 0);
+  }
+
+  sensor_msgs::PointCloud2& SickScanFrameAssembler::popFrame(void)
+  {
+    m_frame_ready = false;
+    return m_frame_buffer[1 - m_active_buffer];
+  }
+
+  int SickScanFrameAssembler::numSectors(const sensor_msgs::PointCloud2& frame, double angle_increment) const
+  {
+    int sector_width = (fabs(angle_increment) > 0) ? (int)(m_sector_angle / fabs(angle_increment) + 0.5) : (int)frame.width;
+    if (sector_width < 1)
+      sector_width = 1;
+    return ((int)frame.width + sector_width - 1) / sector_width;
+  }
+
+  const sensor_msgs::PointCloud2& SickScanFrameAssembler::getSector(const sensor_msgs::PointCloud2& frame, int sector_idx, double angle_increment, double time_increment)
+  {
+    int num_sectors = numSectors(frame, angle_increment);
+    int sector_width = ((int)frame.width + num_sectors - 1) / num_sectors;
+    int col_start = sector_idx * sector_width;
+    int col_end = std::min<int>(col_start + sector_width, (int)frame.width);
+    if (col_start >= col_end)
+    {
+      m_sector.width = 0;
+      m_sector.data.clear();
+      return m_sector;
+    }
+    double sector_time_offset = 0.5 * (col_start + col_end - 1) * time_increment;
+    m_sector.header = frame.header;
+    m_sector.header.stamp += ros::Duration(sector_time_offset);
+    m_sector.height = frame.height;
+    m_sector.width = col_end - col_start;
+    m_sector.is_bigendian = frame.is_bigendian;
+    m_sector.is_dense = frame.is_dense;
+    m_sector.point_step = frame.point_step;
+    m_sector.row_step = m_sector.point_step * m_sector.width;
+    m_sector.fields = frame.fields;
+    m_sector.data.resize((size_t)m_sector.row_step * m_sector.height);
+    for (uint32_t row = 0; row < frame.height; row++)
+    {
+      memcpy(&m_sector.data[(size_t)row * m_sector.row_step], &frame.data[(size_t)row * frame.row_step + (size_t)col_start * frame.point_step], m_sector.row_step);
+    }
+    for (size_t field_idx = 0; field_idx < m_sector.fields.size(); field_idx++)
+    {
+      if (m_sector.fields[field_idx].name != "time" || m_sector.fields[field_idx].datatype != sensor_msgs::PointField::FLOAT32)
+        continue;
+      uint8_t* point_ptr = &m_sector.data[0] + m_sector.fields[field_idx].offset;
+      for (size_t n = 0; n < (size_t)m_sector.width * m_sector.height; n++, point_ptr += m_sector.point_step)
+      {
+        float point_time;
+        memcpy(&point_time, point_ptr, sizeof(float));
+        point_time -= (float)sector_time_offset;
+        memcpy(point_ptr, &point_time, sizeof(float));
+      }
+    }
+    return m_sector;
+  }
+
+} /* namespace sick_scan */
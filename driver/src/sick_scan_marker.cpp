@@ -80,7 +80,7 @@ static std_msgs::ColorRGBA gray(void) // invalid fields (default)
 }
 
 sick_scan::SickScanMarker::SickScanMarker(ros::NodeHandle* nh, const std::string & marker_topic, const std::string & marker_frame_id)
-: m_scan_mon_fieldset(0)
+: m_scan_mon_fieldset(0), m_num_subscribers(0)
 {
     if(nh)
     {
@@ -96,9 +96,12 @@ sick_scan::SickScanMarker::~SickScanMarker()
 void sick_scan::SickScanMarker::updateMarker(const std::vector<SickScanMonField>& fields, int fieldset)
 {
     m_scan_mon_fields = fields;
+    m_scan_mon_field_geometry.clear(); // field configuration changed, triangles will be recomputed on demand
+    m_published_marker.clear(); // republish all markers
+    m_published_marker_geometry.clear();
     m_scan_mon_fieldset = fieldset; // todo: query selected field set - maybe "sRN uiSelectedFieldNum" ??? "sRA uiSelectedFieldNum" returns 0 in 001_sopas_et_binary_startup.pcapng.json
     std::vector<FieldInfo> default_fields = {FieldInfo(0,0,"-","3",gray()), FieldInfo(1,0,"-","2",gray()), FieldInfo(2,0,"-","1",gray())};
-    m_scan_mon_field_marker = createMonFieldMarker(default_fields);
+    m_scan_mon_field_marker = createMonFieldMarker(default_fields, m_scan_mon_field_marker_geometry);
     m_scan_mon_field_legend = createMonFieldLegend(default_fields);
     // m_scan_fieldset_legend = createMonFieldsetLegend(0);
     // m_scan_outputstate_legend = createOutputStateLegend({"0", "0", "0"}, {"-", "-", "-"}, {gray(), gray(), gray()}); // only if outputstates active, i.e. after updateMarker(LIDoutputstateMsg)
@@ -186,92 +189,145 @@ void sick_scan::SickScanMarker::updateMarker(sick_scan::LFErecMsg& msg)
         dbg_info << ((field_idx > 0) ? "," : "") << m_scan_mon_fields[field_idx].getPointCount();
     dbg_info << "}, mon_field_set = " << m_scan_mon_fieldset;
     ROS_DEBUG_STREAM(dbg_info.str());
-    m_scan_mon_field_marker = createMonFieldMarker(field_info);
+    m_scan_mon_field_marker = createMonFieldMarker(field_info, m_scan_mon_field_marker_geometry);
     m_scan_mon_field_legend = createMonFieldLegend(field_info);
     m_scan_fieldset_legend = createMonFieldsetLegend(m_scan_mon_fieldset);
     publishMarker();
 }
 
+/*
+ * Publishes all markers which have changed since their last publishing. The field geometry changes only if the fieldset changes,
+ * so LFErec and LIDoutputstate messages at scan rate typically result in a few color and text updates or no message at all.
+ * Field markers are compared by their field index instead of their triangles, and the cached triangles are copied into
+ * the message only if the field marker is published.
+ * All markers are republished once per second and if the number of subscribers changes, so that new subscribers receive the
+ * complete state.
+ */
 void sick_scan::SickScanMarker::publishMarker(void)
 {
+    ros::Time now = ros::Time::now();
+    uint32_t num_subscribers = m_marker_publisher.getNumSubscribers();
+    bool publish_all = (num_subscribers != m_num_subscribers || (now - m_last_full_publish).toSec() >= 1.0 || now < m_last_full_publish);
+    if(publish_all)
+    {
+        m_last_full_publish = now;
+        m_num_subscribers = num_subscribers;
+    }
+    const std::vector<visualization_msgs::Marker>* marker_lists[4] = { &m_scan_mon_field_marker, &m_scan_mon_field_legend, &m_scan_outputstate_legend, &m_scan_fieldset_legend };
     visualization_msgs::MarkerArray marker_array;
-    marker_array.markers.reserve(m_scan_mon_field_marker.size() + m_scan_mon_field_legend.size() + m_scan_outputstate_legend.size());
-    for(int n = 0; n < m_scan_mon_field_marker.size(); n++)
-        marker_array.markers.push_back(m_scan_mon_field_marker[n]);
-    for(int n = 0; n < m_scan_mon_field_legend.size(); n++)
-        marker_array.markers.push_back(m_scan_mon_field_legend[n]);
-    for(int n = 0; n < m_scan_outputstate_legend.size(); n++)
-        marker_array.markers.push_back(m_scan_outputstate_legend[n]);
-    for(int n = 0; n < m_scan_fieldset_legend.size(); n++)
-        marker_array.markers.push_back(m_scan_fieldset_legend[n]);
-    m_marker_publisher.publish(marker_array);
-}
-
-std::vector<visualization_msgs::Marker> sick_scan::SickScanMarker::createMonFieldMarker(const std::vector<FieldInfo>& field_info)
-{
-    int nr_triangles = 0;
-    for(int field_info_idx = 0; field_info_idx < field_info.size(); field_info_idx++)
+    marker_array.markers.reserve(m_scan_mon_field_marker.size() + m_scan_mon_field_legend.size() + m_scan_outputstate_legend.size() + m_scan_fieldset_legend.size());
+    for(int list_idx = 0; list_idx < 4; list_idx++)
     {
-        int field_idx = field_info[field_info_idx].field_index_scan_mon;
-        nr_triangles += std::max(0, m_scan_mon_fields[field_idx].getPointCount() - 1); // 2 points: 1 triangle, 3 points: 2 triangles, and so on
+        const std::vector<visualization_msgs::Marker>& markers = *marker_lists[list_idx];
+        for(int n = 0; n < markers.size(); n++)
+        {
+            int marker_id = markers[n].id;
+            std::map<int, int>::const_iterator geometry = m_scan_mon_field_marker_geometry.find(marker_id);
+            int field_idx = (list_idx == 0 && geometry != m_scan_mon_field_marker_geometry.end()) ? geometry->second : -1;
+            std::map<int, visualization_msgs::Marker>::iterator published_marker = m_published_marker.find(marker_id);
+            std::map<int, int>::iterator published_geometry = m_published_marker_geometry.find(marker_id);
+            if(publish_all || published_marker == m_published_marker.end() || markerChanged(published_marker->second, markers[n])
+            || published_geometry == m_published_marker_geometry.end() || published_geometry->second != field_idx)
+            {
+                marker_array.markers.push_back(markers[n]);
+                if(field_idx >= 0)
+                    marker_array.markers.back().points = getFieldGeometry(field_idx).triangles;
+                m_published_marker[marker_id] = markers[n];
+                m_published_marker_geometry[marker_id] = field_idx;
+            }
+        }
     }
+    if(!marker_array.markers.empty())
+        m_marker_publisher.publish(marker_array);
+}
 
-    // Draw fields using marker triangles
-    visualization_msgs::Marker marker_point;
-    marker_point.header.stamp = ros::Time::now();
-    marker_point.header.frame_id = m_frame_id;
-    marker_point.ns = "sick_scan";
-    marker_point.id = 1;
-    marker_point.type = visualization_msgs::Marker::TRIANGLE_LIST;
-    marker_point.scale.x = 1;
-    marker_point.scale.y = 1;
-    marker_point.scale.z = 1;
-    marker_point.pose.position.x = 0.0;
-    marker_point.pose.position.y = 0.0;
-    marker_point.pose.position.z = 0.0;
-    marker_point.pose.orientation.x = 0.0;
-    marker_point.pose.orientation.y = 0.0;
-    marker_point.pose.orientation.z = 0.0;
-    marker_point.pose.orientation.w = 1.0;
-    marker_point.action = visualization_msgs::Marker::ADD; // note: ADD == MODIFY
-    marker_point.color = gray();
-    marker_point.lifetime = ros::Duration(0); // lifetime 0 indicates forever
+/*
+ * Returns true, if the marker differs in its content, i.e. in any other property than the timestamp. Markers do not contain
+ * points (field triangles are compared by their field index in publishMarker()), so only the properties are compared.
+ */
+bool sick_scan::SickScanMarker::markerChanged(const visualization_msgs::Marker& marker1, const visualization_msgs::Marker& marker2)
+{
+    if(marker1.id != marker2.id || marker1.type != marker2.type || marker1.action != marker2.action || marker1.text != marker2.text
+    || marker1.color != marker2.color || marker1.header.frame_id != marker2.header.frame_id
+    || marker1.pose.position.x != marker2.pose.position.x || marker1.pose.position.y != marker2.pose.position.y || marker1.pose.position.z != marker2.pose.position.z
+    || marker1.points.size() != marker2.points.size() || marker1.colors.size() != marker2.colors.size())
+        return true;
+    return false;
+}
 
-    marker_point.points.resize(3 * nr_triangles);
-    marker_point.colors.resize(3 * nr_triangles);
-    std::vector<geometry_msgs::Point> triangle_centroids;
-    triangle_centroids.reserve(field_info.size());
-    for(int field_info_idx = 0, triangle_idx = 0; field_info_idx < field_info.size() && triangle_idx < nr_triangles; field_info_idx++)
+/*
+ * Returns the triangles and the centroid of a monitoring field. The geometry is computed once and cached until the field configuration changes.
+ */
+const sick_scan::SickScanMarker::FieldGeometry& sick_scan::SickScanMarker::getFieldGeometry(int field_idx)
+{
+    if(m_scan_mon_field_geometry.size() != m_scan_mon_fields.size())
+        m_scan_mon_field_geometry.resize(m_scan_mon_fields.size());
+    FieldGeometry& geometry = m_scan_mon_field_geometry[field_idx];
+    if(!geometry.valid)
     {
-        int field_idx = field_info[field_info_idx].field_index_scan_mon;
-        std_msgs::ColorRGBA field_color = field_info[field_info_idx].field_color;
-        for(int point_idx = 1; point_idx < m_scan_mon_fields[field_idx].getPointCount() && triangle_idx < nr_triangles; point_idx++, triangle_idx++)
+        const SickScanMonField& field = m_scan_mon_fields[field_idx];
+        int nr_triangles = std::max(0, field.getPointCount() - 1); // 2 points: 1 triangle, 3 points: 2 triangles, and so on
+        geometry.triangles.resize(3 * nr_triangles); // p1 = (0,0,0) is the sensor origin
+        geometry.centroid.x = 0;
+        geometry.centroid.y = 0;
+        geometry.centroid.z = 0;
+        for(int point_idx = 0; point_idx < field.getPointCount(); point_idx++)
         {
-            float p1_x = 0, p1_y = 0, p1_z = 0, p2_x = 0, p2_y = 0, p2_z = 0, p3_x = 0, p3_y = 0, p3_z = 0;
-            monFieldToCarthesian(m_scan_mon_fields[field_idx].getRanges()[point_idx - 1], m_scan_mon_fields[field_idx].getAnglesRad()[point_idx - 1], p2_x, p2_y);
-            monFieldToCarthesian(m_scan_mon_fields[field_idx].getRanges()[point_idx - 0], m_scan_mon_fields[field_idx].getAnglesRad()[point_idx - 0], p3_x, p3_y);
-
-            marker_point.points[3 * triangle_idx + 0].x = p1_x;
-            marker_point.points[3 * triangle_idx + 0].y = p1_y;
-            marker_point.points[3 * triangle_idx + 0].z = p1_z;
-
-            marker_point.points[3 * triangle_idx + 1].x = p2_x;
-            marker_point.points[3 * triangle_idx + 1].y = p2_y;
-            marker_point.points[3 * triangle_idx + 1].z = p2_z;
-
-            marker_point.points[3 * triangle_idx + 2].x = p3_x;
-            marker_point.points[3 * triangle_idx + 2].y = p3_y;
-            marker_point.points[3 * triangle_idx + 2].z = p3_z;
-
-            marker_point.colors[3 * triangle_idx + 0] = field_color;
-            marker_point.colors[3 * triangle_idx + 1] = field_color;
-            marker_point.colors[3 * triangle_idx + 2] = field_color;
+            float x = 0, y = 0;
+            monFieldToCarthesian(field.getRanges()[point_idx], field.getAnglesRad()[point_idx], x, y);
+            if(point_idx > 0)
+            {
+                geometry.triangles[3 * (point_idx - 1) + 2].x = x; // p3 of triangle point_idx - 1
+                geometry.triangles[3 * (point_idx - 1) + 2].y = y;
+            }
+            if(point_idx < nr_triangles)
+            {
+                geometry.triangles[3 * point_idx + 1].x = x; // p2 of triangle point_idx
+                geometry.triangles[3 * point_idx + 1].y = y;
+            }
+            geometry.centroid.x += x;
+            geometry.centroid.y += y;
         }
+        geometry.centroid.x /= (float)(field.getPointCount() + 1);
+        geometry.centroid.y /= (float)(field.getPointCount() + 1);
+        geometry.valid = true;
     }
+    return geometry;
+}
 
+std::vector<visualization_msgs::Marker> sick_scan::SickScanMarker::createMonFieldMarker(const std::vector<FieldInfo>& field_info, std::map<int, int>& marker_geometry)
+{
     std::vector<visualization_msgs::Marker> marker_array;
-    marker_array.reserve(1 + field_info.size());
-    marker_array.push_back(marker_point);
+    marker_array.reserve(2 * field_info.size());
+    marker_geometry.clear();
+
+    // Draw fields using marker triangles, one marker per field. Field geometry is cached, i.e. a status change updates the marker color only.
+    // The triangles are not copied into the marker, they are inserted by publishMarker() if the marker is published.
+    for(int field_info_idx = 0; field_info_idx < field_info.size(); field_info_idx++)
+    {
+        const FieldGeometry& geometry = getFieldGeometry(field_info[field_info_idx].field_index_scan_mon);
+        visualization_msgs::Marker marker_point;
+        marker_point.header.stamp = ros::Time::now();
+        marker_point.header.frame_id = m_frame_id;
+        marker_point.ns = "sick_scan";
+        marker_point.id = 300 + field_info_idx;
+        marker_point.type = visualization_msgs::Marker::TRIANGLE_LIST;
+        marker_point.scale.x = 1;
+        marker_point.scale.y = 1;
+        marker_point.scale.z = 1;
+        marker_point.pose.position.x = 0.0;
+        marker_point.pose.position.y = 0.0;
+        marker_point.pose.position.z = 0.0;
+        marker_point.pose.orientation.x = 0.0;
+        marker_point.pose.orientation.y = 0.0;
+        marker_point.pose.orientation.z = 0.0;
+        marker_point.pose.orientation.w = 1.0;
+        marker_point.action = (geometry.triangles.empty() ? visualization_msgs::Marker::DELETE : visualization_msgs::Marker::ADD); // note: ADD == MODIFY
+        marker_point.color = field_info[field_info_idx].field_color;
+        marker_point.lifetime = ros::Duration(0); // lifetime 0 indicates forever
+        marker_array.push_back(marker_point);
+        marker_geometry[marker_point.id] = field_info[field_info_idx].field_index_scan_mon;
+    }
 
     // Draw field names
     for(int field_info_idx = 0; field_info_idx < field_info.size(); field_info_idx++)
@@ -279,19 +335,7 @@ std::vector<visualization_msgs::Marker> sick_scan::SickScanMarker::createMonFiel
         int field_idx = field_info[field_info_idx].field_index_scan_mon;
         if(m_scan_mon_fields[field_idx].getPointCount() >= 2)
         {
-            geometry_msgs::Point triangle_centroid;
-            triangle_centroid.x = 0;
-            triangle_centroid.y = 0;
-            triangle_centroid.z = 0;
-            for(int point_idx = 0; point_idx < m_scan_mon_fields[field_idx].getPointCount(); point_idx++)
-            {
-                float x = 0, y = 0, z = 0;
-                monFieldToCarthesian(m_scan_mon_fields[field_idx].getRanges()[point_idx], m_scan_mon_fields[field_idx].getAnglesRad()[point_idx], x, y);
-                triangle_centroid.x += x;
-                triangle_centroid.y += y;
-            }
-            triangle_centroid.x /= (float)(m_scan_mon_fields[field_idx].getPointCount() + 1);
-            triangle_centroid.y /= (float)(m_scan_mon_fields[field_idx].getPointCount() + 1);
+            const geometry_msgs::Point& triangle_centroid = getFieldGeometry(field_idx).centroid;
             visualization_msgs::Marker marker_field_name;
             marker_field_name.header.stamp = ros::Time::now();
             marker_field_name.header.frame_id = m_frame_id;
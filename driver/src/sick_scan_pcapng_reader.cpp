@@ -0,0 +1,526 @@
+/*
+ * @brief Streaming pcapng reader, extracts CoLa datagrams from tcp captures
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 17.02.2021
+ *
+ */
+
+#include <string.h>
+
+#include "sick_scan/sick_scan_pcapng_reader.h"
+
+namespace sick_scan
+{
+  static const size_t maxBlockSize = 256 * 1024 * 1024;     // sanity check for corrupted files
+  static const size_t maxPendingSegments = 256;             // max. number of out-of-order segments per tcp stream
+  static const uint32_t maxBinaryDatagramSize = 16 * 1024 * 1024; // max. CoLa-B payload length, otherwise resync
+  static const size_t maxAsciiDatagramSize = 1024 * 1024;   // max. CoLa-A datagram size, otherwise resync
+
+  static uint16_t getBigEndian16(const uint8_t* p)
+  {
+    return (uint16_t)((p[0] << 8) | p[1]);
+  }
+
+  static uint32_t getBigEndian32(const uint8_t* p)
+  {
+    return ((uint32_t)getBigEndian16(p) << 16) | getBigEndian16(p + 2);
+  }
+
+  SickScanPcapngReader::SickScanPcapngReader()
+  : m_file(NULL), m_pcapng(true), m_bigEndian(false), m_sec(0), m_nsec(0), m_numPackets(0), m_numDatagrams(0), m_numSkippedBytes(0)
+  {
+  }
+
+  SickScanPcapngReader::~SickScanPcapngReader()
+  {
+    close();
+  }
+
+  bool SickScanPcapngReader::open(const std::string& filename, const std::vector<uint16_t>& ports)
+  {
+    close();
+    m_ports = ports;
+    if (m_ports.empty())
+    {
+      m_ports.push_back(2111);
+      m_ports.push_back(2112);
+    }
+    m_file = fopen(filename.c_str(), "rb");
+    if (m_file == NULL)
+      return false;
+    m_fileBuffer.resize(1024 * 1024);
+    setvbuf(m_file, &m_fileBuffer[0], _IOFBF, m_fileBuffer.size());
+    uint8_t header[24];
+    if (fread(header, 4, 1, m_file) != 1)
+    {
+      close();
+      return false;
+    }
+    if (header[0] == 0x0A && header[1] == 0x0D && header[2] == 0x0D && header[3] == 0x0A)
+    {
+      // pcapng: section header block, parsed by readPcapngBlock()
+      m_pcapng = true;
+      fseek(m_file, 0, SEEK_SET);
+      return true;
+    }
+    // classic pcap: magic number 0xa1b2c3d4 (microsecond timestamps) or 0xa1b23c4d (nanosecond timestamps)
+    m_pcapng = false;
+    m_bigEndian = (header[0] == 0xA1);
+    uint32_t magic = get32(header);
+    if ((magic != 0xA1B2C3D4 && magic != 0xA1B23C4D) || fread(header + 4, sizeof(header) - 4, 1, m_file) != 1)
+    {
+      close();
+      return false;
+    }
+    Interface interface;
+    interface.linktype = (int)(get32(header + 20) & 0xFFFF);
+    interface.tsresolPow2 = false;
+    interface.tsresol = (magic == 0xA1B23C4D) ? 9 : 6;
+    m_interfaces.push_back(interface);
+    return true;
+  }
+
+  void SickScanPcapngReader::close(void)
+  {
+    if (m_file)
+      fclose(m_file);
+    m_file = NULL;
+    m_interfaces.clear();
+    m_streams.clear();
+    m_datagrams.clear();
+    m_sec = m_nsec = 0;
+    m_numPackets = m_numDatagrams = m_numSkippedBytes = 0;
+  }
+
+  bool SickScanPcapngReader::read(uint32_t& sec, uint32_t& nsec, std::vector<uint8_t>& datagram)
+  {
+    while (m_datagrams.empty() && m_file != NULL)
+    {
+      if (!(m_pcapng ? readPcapngBlock() : readPcapRecord()))
+      {
+        fclose(m_file); // end of file, datagrams already extracted can still be read
+        m_file = NULL;
+      }
+    }
+    if (m_datagrams.empty())
+      return false;
+    sec = m_datagrams.front().sec;
+    nsec = m_datagrams.front().nsec;
+    datagram.swap(m_datagrams.front().data);
+    m_datagrams.pop_front();
+    return true;
+  }
+
+  /*!
+  \brief Converts a pcapng timestamp to seconds and nanoseconds
+  */
+  static void convertTimestamp(bool tsresolPow2, uint8_t tsresol, uint64_t timestamp, uint32_t& sec, uint32_t& nsec)
+  {
+    if (tsresolPow2)
+    {
+      tsresol = (tsresol < 63) ? tsresol : 63;
+      uint64_t fraction = timestamp & ((((uint64_t)1) << tsresol) - 1);
+      sec = (uint32_t)(timestamp >> tsresol);
+      nsec = (uint32_t)(1.0e9 * fraction / (double)(((uint64_t)1) << tsresol));
+      return;
+    }
+    tsresol = (tsresol < 19) ? tsresol : 19;
+    uint64_t units_per_sec = 1;
+    for (int n = 0; n < tsresol; n++)
+      units_per_sec *= 10;
+    uint64_t fraction = timestamp % units_per_sec;
+    sec = (uint32_t)(timestamp / units_per_sec);
+    for (int n = tsresol; n < 9; n++)
+      fraction *= 10;
+    for (int n = 9; n < tsresol; n++)
+      fraction /= 10;
+    nsec = (uint32_t)fraction;
+  }
+
+  /*!
+  \brief Reads and processes the next pcapng block (section header, interface description or packet block)
+  \return false at the end of file or on error
+  */
+  bool SickScanPcapngReader::readPcapngBlock(void)
+  {
+    uint8_t header[12];
+    if (fread(header, 8, 1, m_file) != 1)
+      return false;
+    if (header[0] == 0x0A && header[1] == 0x0D && header[2] == 0x0D && header[3] == 0x0A)
+    {
+      // section header block: byte order magic 0x1A2B3C4D determines the byte order of the section
+      if (fread(header + 8, 4, 1, m_file) != 1)
+        return false;
+      m_bigEndian = (header[8] == 0x1A);
+      m_interfaces.clear();
+      uint32_t blockSize = get32(header + 4);
+      if (blockSize < 28 || blockSize > maxBlockSize)
+        return false;
+      m_block.resize(blockSize - 12);
+      return fread(m_block.data(), m_block.size(), 1, m_file) == 1;
+    }
+    uint32_t blockType = get32(header);
+    uint32_t blockSize = get32(header + 4);
+    if (blockSize < 12 || blockSize > maxBlockSize || (blockSize % 4) != 0)
+      return false;
+    m_block.resize(blockSize - 8); // block body and trailing block size
+    if (fread(m_block.data(), m_block.size(), 1, m_file) != 1)
+      return false;
+    const uint8_t* body = m_block.data();
+    size_t bodySize = m_block.size() - 4;
+    if (blockType == 1 && bodySize >= 8) // interface description block
+    {
+      Interface interface;
+      interface.linktype = get16(body);
+      interface.tsresolPow2 = false;
+      interface.tsresol = 6;
+      for (size_t offset = 8; offset + 4 <= bodySize; )
+      {
+        uint16_t optionCode = get16(body + offset);
+        uint16_t optionLength = get16(body + offset + 2);
+        if (optionCode == 0 || offset + 4 + optionLength > bodySize)
+          break;
+        if (optionCode == 9 && optionLength >= 1) // if_tsresol
+        {
+          interface.tsresolPow2 = ((body[offset + 4] & 0x80) != 0);
+          interface.tsresol = (body[offset + 4] & 0x7F);
+        }
+        offset += 4 + ((optionLength + 3) & ~3);
+      }
+      m_interfaces.push_back(interface);
+    }
+    else if ((blockType == 6 || blockType == 2) && bodySize >= 20) // enhanced packet block or (obsolete) packet block
+    {
+      uint32_t interfaceId = (blockType == 6) ? get32(body) : get16(body);
+      uint64_t timestamp = ((uint64_t)get32(body + 4) << 32) | get32(body + 8);
+      uint32_t capturedLength = get32(body + 12);
+      if (interfaceId < m_interfaces.size() && 20 + (size_t)capturedLength <= bodySize)
+      {
+        const Interface& interface = m_interfaces[interfaceId];
+        convertTimestamp(interface.tsresolPow2, interface.tsresol, timestamp, m_sec, m_nsec);
+        processPacket(interface.linktype, body + 20, capturedLength);
+      }
+    }
+    else if (blockType == 3 && bodySize >= 4 && !m_interfaces.empty()) // simple packet block without timestamp
+    {
+      size_t capturedLength = get32(body);
+      capturedLength = (capturedLength < bodySize - 4) ? capturedLength : (bodySize - 4);
+      processPacket(m_interfaces[0].linktype, body + 4, capturedLength);
+    }
+    return true;
+  }
+
+  /*!
+  \brief Reads and processes the next record of a classic pcap file
+  \return false at the end of file or on error
+  */
+  bool SickScanPcapngReader::readPcapRecord(void)
+  {
+    uint8_t header[16];
+    if (fread(header, sizeof(header), 1, m_file) != 1)
+      return false;
+    uint32_t capturedLength = get32(header + 8);
+    if (capturedLength > maxBlockSize)
+      return false;
+    m_block.resize(capturedLength);
+    if (capturedLength > 0 && fread(m_block.data(), capturedLength, 1, m_file) != 1)
+      return false;
+    m_sec = get32(header);
+    m_nsec = (m_interfaces[0].tsresol == 9) ? get32(header + 4) : (1000 * get32(header + 4));
+    processPacket(m_interfaces[0].linktype, m_block.data(), m_block.size());
+    return true;
+  }
+
+  /*!
+  \brief Decodes the link, ip and tcp header of a packet and processes the tcp payload sent by the scanner
+  */
+  void SickScanPcapngReader::processPacket(int linktype, const uint8_t* data, size_t size)
+  {
+    // Link layer
+    size_t offset = 0;
+    int ipVersion = 0;
+    uint32_t family = 0;
+    switch (linktype)
+    {
+      case 1: // ethernet
+        if (size < 14)
+          return;
+        offset = 14;
+        family = getBigEndian16(data + 12);
+        while ((family == 0x8100 || family == 0x88A8) && offset + 4 <= size) // vlan tags
+        {
+          family = getBigEndian16(data + offset + 2);
+          offset += 4;
+        }
+        ipVersion = (family == 0x0800) ? 4 : ((family == 0x86DD) ? 6 : 0);
+        break;
+      case 0:   // null (loopback), address family in byte order of the capturing host
+      case 108: // loop (loopback), address family in network byte order
+        if (size < 4)
+          return;
+        offset = 4;
+        family = getBigEndian32(data);
+        if (linktype == 0 && (family & 0xFFFF) == 0)
+          family = (data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
+        ipVersion = (family == 2) ? 4 : ((family == 24 || family == 28 || family == 30) ? 6 : 0);
+        break;
+      case 12:  // raw ip
+      case 14:
+      case 101:
+      case 228: // raw ipv4
+      case 229: // raw ipv6
+        ipVersion = (size > 0) ? (data[0] >> 4) : 0;
+        break;
+      case 113: // linux cooked capture
+        if (size < 16)
+          return;
+        offset = 16;
+        family = getBigEndian16(data + 14);
+        ipVersion = (family == 0x0800) ? 4 : ((family == 0x86DD) ? 6 : 0);
+        break;
+      case 276: // linux cooked capture v2
+        if (size < 20)
+          return;
+        offset = 20;
+        family = getBigEndian16(data);
+        ipVersion = (family == 0x0800) ? 4 : ((family == 0x86DD) ? 6 : 0);
+        break;
+      default:
+        return;
+    }
+    data += offset;
+    size -= offset;
+
+    // Network layer
+    std::string streamId;
+    if (ipVersion == 4)
+    {
+      if (size < 20 || (data[0] >> 4) != 4 || data[9] != 6) // ipv4 and tcp
+        return;
+      size_t headerLength = 4 * (data[0] & 0x0F);
+      size_t totalLength = getBigEndian16(data + 2);
+      if ((getBigEndian16(data + 6) & 0x3FFF) != 0) // fragment
+        return;
+      if (headerLength < 20 || totalLength < headerLength || totalLength > size) // truncated packet (snaplen)
+        return;
+      streamId.assign((const char*)data + 12, 8); // source and destination address
+      data += headerLength;
+      size = totalLength - headerLength;
+    }
+    else if (ipVersion == 6)
+    {
+      if (size < 40 || (data[0] >> 4) != 6 || data[6] != 6) // ipv6 and tcp, extension headers not supported
+        return;
+      size_t payloadLength = getBigEndian16(data + 4);
+      if (40 + payloadLength > size)
+        return;
+      streamId.assign((const char*)data + 8, 32); // source and destination address
+      data += 40;
+      size = payloadLength;
+    }
+    else
+    {
+      return;
+    }
+
+    // Transport layer: tcp segments sent by the scanner
+    if (size < 20)
+      return;
+    uint16_t sourcePort = getBigEndian16(data);
+    bool scannerPort = false;
+    for (size_t n = 0; n < m_ports.size(); n++)
+      scannerPort = scannerPort || (m_ports[n] == sourcePort);
+    size_t headerLength = 4 * (data[12] >> 4);
+    if (!scannerPort || headerLength < 20 || headerLength > size)
+      return;
+    streamId.append((const char*)data, 4); // source and destination port
+    uint8_t flags = data[13];
+    m_numPackets++;
+    processTcpSegment(streamId, getBigEndian32(data + 4), (flags & 0x02) != 0, (flags & 0x05) != 0, data + headerLength, size - headerLength);
+  }
+
+  /*!
+  \brief Reassembles a tcp stream: segments are appended in sequence order, retransmitted bytes are dropped and
+  out-of-order segments are buffered until the missing segments have been received. If too many segments are
+  pending (i.e. segments have been lost in the capture), the stream is resynchronized.
+  */
+  void SickScanPcapngReader::processTcpSegment(const std::string& streamId, uint32_t seq, bool syn, bool fin, const uint8_t* payload, size_t size)
+  {
+    TcpStream& stream = m_streams[streamId];
+    if (syn)
+    {
+      m_numSkippedBytes += stream.buffer.size() - stream.bufferStart;
+      stream = TcpStream();
+      stream.synchronized = true;
+      stream.nextSeq = ++seq;
+    }
+    else if (!stream.synchronized) // capture started after connection setup
+    {
+      stream.synchronized = true;
+      stream.nextSeq = seq;
+    }
+    if (size > 0)
+    {
+      int32_t seqDiff = (int32_t)(seq - stream.nextSeq);
+      if (seqDiff > 0 && stream.pending.size() < maxPendingSegments)
+      {
+        stream.pending[seq].assign(payload, payload + size);
+      }
+      else if (seqDiff > 0)
+      {
+        // segments lost, continue with the current segment
+        m_numSkippedBytes += stream.buffer.size() - stream.bufferStart;
+        for (std::map<uint32_t, std::vector<uint8_t> >::iterator iter = stream.pending.begin(); iter != stream.pending.end(); iter++)
+          m_numSkippedBytes += iter->second.size();
+        stream.buffer.clear();
+        stream.bufferStart = 0;
+        stream.pending.clear();
+        stream.nextSeq = seq;
+        appendToStream(stream, payload, size);
+      }
+      else if ((size_t)(-(int64_t)seqDiff) < size)
+      {
+        appendToStream(stream, payload - seqDiff, size + seqDiff); // skip retransmitted bytes
+      }
+      for (bool appended = true; appended && !stream.pending.empty(); )
+      {
+        appended = false;
+        for (std::map<uint32_t, std::vector<uint8_t> >::iterator iter = stream.pending.begin(); iter != stream.pending.end(); iter++)
+        {
+          int32_t pendingDiff = (int32_t)(iter->first - stream.nextSeq);
+          if (pendingDiff <= 0)
+          {
+            if ((size_t)(-(int64_t)pendingDiff) < iter->second.size())
+              appendToStream(stream, iter->second.data() - pendingDiff, iter->second.size() + pendingDiff);
+            stream.pending.erase(iter);
+            appended = true;
+            break;
+          }
+        }
+      }
+      extractDatagrams(stream);
+    }
+    if (fin)
+    {
+      m_numSkippedBytes += stream.buffer.size() - stream.bufferStart;
+      m_streams.erase(streamId);
+    }
+  }
+
+  void SickScanPcapngReader::appendToStream(TcpStream& stream, const uint8_t* payload, size_t size)
+  {
+    if (stream.bufferStart > 0 && 2 * stream.bufferStart >= stream.buffer.size())
+    {
+      stream.buffer.erase(stream.buffer.begin(), stream.buffer.begin() + stream.bufferStart);
+      stream.bufferStart = 0;
+    }
+    stream.buffer.insert(stream.buffer.end(), payload, payload + size);
+    stream.nextSeq += (uint32_t)size;
+  }
+
+  /*!
+  \brief Extracts all complete CoLa-A and CoLa-B datagrams from the reassembled stream
+  */
+  void SickScanPcapngReader::extractDatagrams(TcpStream& stream)
+  {
+    while (stream.bufferStart < stream.buffer.size())
+    {
+      const uint8_t* data = stream.buffer.data() + stream.bufferStart;
+      size_t size = stream.buffer.size() - stream.bufferStart;
+      size_t datagramSize = 0;
+      if (data[0] != 0x02)
+      {
+        // not a datagram start, skip bytes until next <STX>
+        const uint8_t* stx = (const uint8_t*)memchr(data, 0x02, size);
+        size_t skip = stx ? (size_t)(stx - data) : size;
+        m_numSkippedBytes += skip;
+        stream.bufferStart += skip;
+        continue;
+      }
+      size_t numStx = 1;
+      while (numStx < 4 && numStx < size && data[numStx] == 0x02)
+        numStx++;
+      if (numStx == size && numStx < 4)
+        break; // wait for more bytes
+      if (numStx == 4)
+      {
+        // CoLa-B: 0x02020202 + 4 byte payload length + payload + 1 byte CRC
+        if (size < 8)
+          break;
+        uint32_t payloadLength = getBigEndian32(data + 4);
+        if (payloadLength > maxBinaryDatagramSize)
+        {
+          m_numSkippedBytes++;
+          stream.bufferStart++;
+          continue;
+        }
+        if (size < 9 + (size_t)payloadLength)
+          break;
+        datagramSize = 9 + payloadLength;
+      }
+      else
+      {
+        // CoLa-A: <STX> + payload + <ETX>
+        const uint8_t* etx = (const uint8_t*)memchr(data + 1, 0x03, size - 1);
+        if (etx == NULL && size <= maxAsciiDatagramSize)
+          break;
+        if (etx == NULL)
+        {
+          m_numSkippedBytes++;
+          stream.bufferStart++;
+          continue;
+        }
+        datagramSize = (size_t)(etx - data) + 1;
+        bool printable = true; // CoLa-A payload is ascii text, otherwise <STX> was part of binary data
+        for (size_t n = 1; printable && n + 1 < datagramSize; n++)
+          printable = (data[n] >= 0x20 && data[n] < 0x7F);
+        if (!printable)
+        {
+          m_numSkippedBytes++;
+          stream.bufferStart++;
+          continue;
+        }
+      }
+      m_datagrams.push_back(Datagram());
+      m_datagrams.back().sec = m_sec;
+      m_datagrams.back().nsec = m_nsec;
+      m_datagrams.back().data.assign(data, data + datagramSize);
+      m_numDatagrams++;
+      stream.bufferStart += datagramSize;
+    }
+    if (stream.bufferStart == stream.buffer.size())
+    {
+      stream.buffer.clear();
+      stream.bufferStart = 0;
+    }
+  }
+
+} /* namespace sick_scan */
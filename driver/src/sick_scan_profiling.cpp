@@ -0,0 +1,180 @@
+/*
+ * @brief Lightweight profiling counters and latency histograms for sick_scan
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 01.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "sick_scan/sick_scan_profiling.h"
+
+namespace sick_scan
+{
+  SickScanProfiling::SickScanProfiling() : m_enabled(false)
+  {
+    reset();
+  }
+
+  /*!
+  \brief Returns the histogram bucket of a value. Values below SUB_BUCKETS are mapped 1:1, larger values
+  are mapped to the power of two (exponent) and the next SUB_BUCKET_BITS bits (mantissa).
+  */
+  int SickScanProfiling::bucketIndex(uint64_t value)
+  {
+    if (value < SUB_BUCKETS)
+      return (int)value;
+    int msb = 63;
+    while ((value & (1ULL << msb)) == 0)
+      msb--;
+    int exponent = msb - SUB_BUCKET_BITS + 1;
+    int mantissa = (int)((value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return exponent * SUB_BUCKETS + mantissa;
+  }
+
+  /*!
+  \brief Returns the largest value mapped to a bucket
+  */
+  uint64_t SickScanProfiling::bucketUpperBound(int bucket)
+  {
+    if (bucket < SUB_BUCKETS)
+      return (uint64_t)bucket;
+    int exponent = bucket / SUB_BUCKETS;
+    uint64_t mantissa = (uint64_t)(bucket % SUB_BUCKETS);
+    int shift = exponent - 1;
+    uint64_t lower = ((uint64_t)SUB_BUCKETS + mantissa) << shift;
+    return lower + ((1ULL << shift) - 1);
+  }
+
+  uint64_t SickScanProfiling::getLatencyCount(STAGE stage) const
+  {
+    uint64_t count = 0;
+    for (int bucket = 0; bucket < NUM_BUCKETS; bucket++)
+      count += m_histogram[stage][bucket].load(std::memory_order_relaxed);
+    return count;
+  }
+
+  double SickScanProfiling::getLatencyMeanMicroSec(STAGE stage) const
+  {
+    uint64_t count = getLatencyCount(stage);
+    if (count == 0)
+      return 0;
+    return 1.0e-3 * (double)m_latency_sum[stage].load(std::memory_order_relaxed) / (double)count;
+  }
+
+  double SickScanProfiling::getLatencyPercentileMicroSec(STAGE stage, double percentile) const
+  {
+    uint64_t count = getLatencyCount(stage);
+    if (count == 0)
+      return 0;
+    uint64_t threshold = (uint64_t)(0.01 * percentile * count + 0.5);
+    if (threshold < 1)
+      threshold = 1;
+    uint64_t sum = 0;
+    for (int bucket = 0; bucket < NUM_BUCKETS; bucket++)
+    {
+      sum += m_histogram[stage][bucket].load(std::memory_order_relaxed);
+      if (sum >= threshold)
+        return 1.0e-3 * (double)std::min(bucketUpperBound(bucket), m_latency_max[stage].load(std::memory_order_relaxed));
+    }
+    return getLatencyMaxMicroSec(stage);
+  }
+
+  double SickScanProfiling::getCounterRate(COUNTER counter) const
+  {
+    uint64_t elapsed = nowNanoSec() - m_reset_time.load(std::memory_order_relaxed);
+    return (elapsed > 0) ? (1.0e9 * getCounter(counter) / elapsed) : 0.0;
+  }
+
+  const char* SickScanProfiling::stageName(STAGE stage)
+  {
+    static const char* names[STAGE_NUM] = { "socket_read", "frame_extraction", "queue_wait", "parse", "cloud_build", "cloud_encode", "cloud_reduce", "publish" };
+    return (stage >= 0 && stage < STAGE_NUM) ? names[stage] : "unknown";
+  }
+
+  const char* SickScanProfiling::counterName(COUNTER counter)
+  {
+    static const char* names[COUNTER_NUM] = { "bytes_received", "frames_received", "frames_dropped", "frames_skipped", "scans_published", "clouds_published", "bytes_published",
+      "reduced_clouds_published", "reduced_bytes_published" };
+    return (counter >= 0 && counter < COUNTER_NUM) ? names[counter] : "unknown";
+  }
+
+  const char* SickScanProfiling::gaugeName(GAUGE gauge)
+  {
+    static const char* names[GAUGE_NUM] = { "queue_depth", "receive_buffer_bytes" };
+    return (gauge >= 0 && gauge < GAUGE_NUM) ? names[gauge] : "unknown";
+  }
+
+  std::string SickScanProfiling::toString(void) const
+  {
+    std::stringstream s;
+    s << std::fixed << std::setprecision(1);
+    s << "SickScanProfiling:";
+    for (int n = 0; n < COUNTER_NUM; n++)
+      s << " " << counterName((COUNTER)n) << "=" << getCounter((COUNTER)n) << " (" << getCounterRate((COUNTER)n) << "/s)";
+    for (int n = 0; n < GAUGE_NUM; n++)
+      s << " " << gaugeName((GAUGE)n) << "=" << getGauge((GAUGE)n) << " (max " << getGaugeMax((GAUGE)n) << ")";
+    for (int n = 0; n < STAGE_NUM; n++)
+    {
+      STAGE stage = (STAGE)n;
+      s << "\n  " << std::setw(16) << std::left << stageName(stage) << std::right
+        << " n=" << getLatencyCount(stage)
+        << " mean=" << getLatencyMeanMicroSec(stage)
+        << " p50=" << getLatencyPercentileMicroSec(stage, 50)
+        << " p99=" << getLatencyPercentileMicroSec(stage, 99)
+        << " p99.9=" << getLatencyPercentileMicroSec(stage, 99.9)
+        << " max=" << getLatencyMaxMicroSec(stage) << " [usec]";
+    }
+    return s.str();
+  }
+
+  void SickScanProfiling::reset(void)
+  {
+    for (int n = 0; n < COUNTER_NUM; n++)
+      m_counter[n].store(0, std::memory_order_relaxed);
+    for (int n = 0; n < GAUGE_NUM; n++)
+    {
+      m_gauge[n].store(0, std::memory_order_relaxed);
+      m_gauge_max[n].store(0, std::memory_order_relaxed);
+    }
+    for (int n = 0; n < STAGE_NUM; n++)
+    {
+      m_latency_sum[n].store(0, std::memory_order_relaxed);
+      m_latency_max[n].store(0, std::memory_order_relaxed);
+      for (int bucket = 0; bucket < NUM_BUCKETS; bucket++)
+        m_histogram[n][bucket].store(0, std::memory_order_relaxed);
+    }
+    m_reset_time.store(nowNanoSec(), std::memory_order_relaxed);
+  }
+
+} /* namespace sick_scan */
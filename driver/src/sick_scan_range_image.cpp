@@ -0,0 +1,134 @@
+/*
+ * @brief Organized range and intensity images of multi-layer scans
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 10.02.2021
+ *
+ */
+
+#include <limits>
+#include <string.h>
+
+#include <sensor_msgs/image_encodings.h>
+
+#include "sick_scan/sick_scan_range_image.h"
+
+namespace sick_scan
+{
+  SickScanRangeImage::SickScanRangeImage()
+  : m_active_buffer(0), m_num_layers(0), m_num_echos(0), m_width(0), m_num_layers_received(0)
+  {
+  }
+
+  bool SickScanRangeImage::addLayer(int num_layers, int layer, int num_echos, const int* echo_idx, int width, const float* ranges,
+                                    const float* intensities, int num_intensities, const ros::Time& stamp, const std::string& frame_id)
+  {
+    if (layer < 0 || layer >= num_layers || num_echos <= 0 || width <= 0)
+      return false;
+    bool images_ready = false;
+    bool geometry_changed = (num_layers != m_num_layers || num_echos != m_num_echos || width != m_width);
+    if ((geometry_changed && m_num_layers_received > 0) || (!geometry_changed && m_layer_received[layer]))
+    {
+      finishImages(); // geometry changed or layer received twice, i.e. the images are incomplete
+      images_ready = true;
+    }
+    sensor_msgs::Image* images[2] = { &m_range_image[m_active_buffer], &m_intensity_image[m_active_buffer] };
+    if (m_num_layers_received == 0)
+    {
+      // Start new images
+      m_num_layers = num_layers;
+      m_num_echos = num_echos;
+      m_width = width;
+      m_layer_received.assign(num_layers, 0);
+      for (int n = 0; n < 2; n++)
+      {
+        images[n]->header.stamp = stamp;
+        images[n]->header.frame_id = frame_id;
+        images[n]->height = num_layers * num_echos;
+        images[n]->width = width;
+        images[n]->encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+        images[n]->is_bigendian = false;
+        images[n]->step = width * sizeof(float);
+        images[n]->data.resize((size_t)images[n]->step * images[n]->height); // no reallocation after the first image
+      }
+    }
+
+    // Copy ranges and intensities of all echos into the image rows of this layer
+    for (int echo = 0; echo < num_echos; echo++)
+    {
+      size_t row_offset = (size_t)(echo * num_layers + layer) * m_range_image[m_active_buffer].step;
+      int src_offset = echo_idx[echo] * width;
+      memcpy(&m_range_image[m_active_buffer].data[row_offset], ranges + src_offset, width * sizeof(float));
+      if (intensities != NULL && src_offset + width <= num_intensities)
+        memcpy(&m_intensity_image[m_active_buffer].data[row_offset], intensities + src_offset, width * sizeof(float));
+      else
+        memset(&m_intensity_image[m_active_buffer].data[row_offset], 0, width * sizeof(float));
+    }
+    m_layer_received[layer] = 1;
+    m_num_layers_received++;
+    if (m_num_layers_received >= m_num_layers)
+    {
+      finishImages();
+      images_ready = true;
+    }
+    return images_ready;
+  }
+
+  /*!
+  \brief Finishes the images under construction. Rows of missing layers are set to NaN.
+  The finished images become ready and the other image buffers are used for the next images.
+  */
+  void SickScanRangeImage::finishImages(void)
+  {
+    if (m_num_layers_received < m_num_layers)
+    {
+      const float nan_value = std::numeric_limits<float>::quiet_NaN();
+      sensor_msgs::Image* images[2] = { &m_range_image[m_active_buffer], &m_intensity_image[m_active_buffer] };
+      for (int layer = 0; layer < m_num_layers; layer++)
+      {
+        if (m_layer_received[layer])
+          continue;
+        for (int echo = 0; echo < m_num_echos; echo++)
+        {
+          for (int n = 0; n < 2; n++)
+          {
+            float* row = (float*)&images[n]->data[(size_t)(echo * m_num_layers + layer) * images[n]->step];
+            for (int beam = 0; beam < m_width; beam++)
+              row[beam] = nan_value;
+          }
+        }
+      }
+    }
+    m_active_buffer = 1 - m_active_buffer;
+    m_num_layers_received = 0;
+    m_layer_received.assign(m_layer_received.size(), 0);
+  }
+
+} /* namespace sick_scan */
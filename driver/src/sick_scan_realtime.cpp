@@ -0,0 +1,111 @@
+/*
+ * @brief Optional realtime configuration of the driver threads
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "sick_scan/sick_scan_realtime.h"
+
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46 // linux >= 3.11
+#endif
+
+namespace sick_scan
+{
+  const char* SickScanRealtime::threadName(THREAD thread)
+  {
+    static const char* names[THREAD_NUM] = { "receive", "main" };
+    return (thread >= 0 && thread < THREAD_NUM) ? names[thread] : "unknown";
+  }
+
+  bool SickScanRealtime::applyThreadConfig(THREAD thread, pthread_t thread_id, std::string& error) const
+  {
+    bool success = true;
+    int cpu = getThreadCpu(thread);
+    int priority = getThreadPriority(thread);
+    if (cpu >= 0)
+    {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(cpu, &cpuset);
+      int result = pthread_setaffinity_np(thread_id, sizeof(cpuset), &cpuset);
+      if (result != 0)
+      {
+        error += std::string("cpu affinity ") + std::to_string(cpu) + " of " + threadName(thread) + " thread failed: " + strerror(result) + ". ";
+        success = false;
+      }
+    }
+    if (priority > 0)
+    {
+      struct sched_param param;
+      memset(&param, 0, sizeof(param));
+      param.sched_priority = priority;
+      int result = pthread_setschedparam(thread_id, SCHED_FIFO, &param);
+      if (result != 0)
+      {
+        error += std::string("SCHED_FIFO priority ") + std::to_string(priority) + " of " + threadName(thread) + " thread failed: " + strerror(result) + ". ";
+        success = false;
+      }
+    }
+    return success;
+  }
+
+  bool SickScanRealtime::applyBusyPoll(int socket_fd, std::string& error) const
+  {
+    int busy_poll_usec = getBusyPollUsec();
+    if (busy_poll_usec <= 0)
+      return true;
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_usec, sizeof(busy_poll_usec)) != 0)
+    {
+      error += std::string("SO_BUSY_POLL ") + std::to_string(busy_poll_usec) + " usec failed: " + strerror(errno) + ". ";
+      return false;
+    }
+    return true;
+  }
+
+  bool SickScanRealtime::lockMemory(std::string& error)
+  {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+      error += std::string("mlockall failed: ") + strerror(errno) + ". ";
+      return false;
+    }
+    return true;
+  }
+
+} /* namespace sick_scan */
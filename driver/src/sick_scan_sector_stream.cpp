@@ -0,0 +1,237 @@
+/*
+ * @brief Streaming of scan sectors from partially received datagrams
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 13.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "sick_scan/sick_scan_sector_stream.h"
+
+namespace sick_scan
+{
+  /*!
+  \brief Reads a big endian value from a buffer
+  */
+  template<typename T> static T readBigEndian(const uint8_t* buffer)
+  {
+    uint8_t bytes[sizeof(T)];
+    for (size_t n = 0; n < sizeof(T); n++)
+      bytes[n] = buffer[sizeof(T) - 1 - n];
+    T value;
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+  }
+
+  SickScanSectorStream::SickScanSectorStream(ros::NodeHandle& nh, const std::string& scan_topic, const std::string& cloud_topic, int sector_beams,
+                                             const std::string& frame_id, double range_min, double range_max, bool mirrored)
+  : m_sector_beams(std::max(1, sector_beams)), m_frame_id(frame_id), m_range_min(range_min), m_range_max(range_max), m_mirrored(mirrored),
+    m_limit_angle_min(-2 * M_PI), m_limit_angle_max(2 * M_PI), m_limit_time_offset(0),
+    m_active(false), m_ignore(false), m_header_valid(false), m_system_count_scan(0), m_data_offset(0), m_num_beams(0), m_beams_published(0),
+    m_scale(1), m_scale_offset(0), m_angle_min(0), m_angle_increment(0), m_time_increment(0), m_scan_time(0),
+    m_angle_limit_min(-2 * M_PI), m_angle_limit_max(2 * M_PI), m_time_offset(0), m_num_sectors_published(0)
+  {
+    m_scan_pub = nh.advertise<sensor_msgs::LaserScan>(scan_topic, 100);
+    m_cloud_pub = nh.advertise<sensor_msgs::PointCloud2>(cloud_topic, 100);
+    const char* field_names[4] = { "x", "y", "z", "intensity" };
+    m_cloud.fields.resize(4);
+    for (int n = 0; n < 4; n++)
+    {
+      m_cloud.fields[n].name = field_names[n];
+      m_cloud.fields[n].offset = n * sizeof(float);
+      m_cloud.fields[n].datatype = sensor_msgs::PointField::FLOAT32;
+      m_cloud.fields[n].count = 1;
+    }
+    m_cloud.height = 1;
+    m_cloud.point_step = 4 * sizeof(float);
+    m_cloud.is_bigendian = false;
+    m_cloud.is_dense = true;
+  }
+
+  void SickScanSectorStream::setLimits(double angle_min, double angle_max, double time_offset)
+  {
+    std::lock_guard<std::mutex> lock(m_limits_mutex);
+    m_limit_angle_min = angle_min;
+    m_limit_angle_max = angle_max;
+    m_limit_time_offset = time_offset;
+  }
+
+  void SickScanSectorStream::update(const uint8_t* buffer, size_t length, bool complete, const ros::Time& receive_time)
+  {
+    if (length < 0x2A + 4 || readBigEndian<uint32_t>(buffer) != 0x02020202)
+      return;
+    // A new datagram starts, if the previous one has been completed or its scan counter differs (previous datagram dropped)
+    uint32_t system_count_scan = readBigEndian<uint32_t>(buffer + 0x26);
+    if (!m_active || system_count_scan != m_system_count_scan)
+    {
+      m_active = true;
+      m_ignore = false;
+      m_header_valid = false;
+      m_beams_published = 0;
+      m_system_count_scan = system_count_scan;
+      std::lock_guard<std::mutex> lock(m_limits_mutex);
+      m_angle_limit_min = m_limit_angle_min;
+      m_angle_limit_max = m_limit_angle_max;
+      m_time_offset = m_limit_time_offset;
+    }
+    if (!m_ignore && (m_header_valid || parseHeader(buffer, length, receive_time)))
+    {
+      int beams_received = (length > m_data_offset) ? (int)((length - m_data_offset) / 2) : 0;
+      if (beams_received > m_num_beams)
+        beams_received = m_num_beams;
+      while (beams_received - m_beams_published >= m_sector_beams || (complete && beams_received > m_beams_published))
+      {
+        int beam_end = std::min(m_beams_published + m_sector_beams, beams_received);
+        publishSector(buffer, m_beams_published, beam_end);
+        m_beams_published = beam_end;
+      }
+    }
+    if (complete)
+      m_active = false;
+  }
+
+  bool SickScanSectorStream::parseHeader(const uint8_t* buffer, size_t length, const ros::Time& receive_time)
+  {
+    static const char scan_cmd[] = "sSN LMDscandata ";
+    if (memcmp(buffer + 8, scan_cmd, sizeof(scan_cmd) - 1) != 0)
+    {
+      m_ignore = true; // not a scan datagram
+      return false;
+    }
+    if (length < 62)
+      return false;
+    int num_encoders = readBigEndian<uint16_t>(buffer + 60);
+    size_t channel_offset = 64 + 6 * num_encoders;
+    if (length < channel_offset + 21)
+      return false;
+    if (memcmp(buffer + channel_offset, "DIST1", 5) != 0)
+    {
+      m_ignore = true; // no 16 bit DIST1 channel
+      return false;
+    }
+    // Scan start = arrival of the first bytes - device time between scan start and transmission
+    uint32_t system_count_transmit = readBigEndian<uint32_t>(buffer + 0x2A);
+    m_scan_start = receive_time - ros::Duration(1.0e-6 * (uint32_t)(system_count_transmit - m_system_count_scan)) + ros::Duration(m_time_offset);
+
+    int scan_frequency_x100 = readBigEndian<int32_t>(buffer + 52);
+    int measurement_frequency_div100 = readBigEndian<int32_t>(buffer + 56);
+    if (measurement_frequency_div100 > 10000) // firmware inconsistency, see SickScanCommon::loopOnce
+      measurement_frequency_div100 /= 100;
+    m_scan_time = (scan_frequency_x100 > 0) ? (100.0 / scan_frequency_x100) : 0;
+    m_time_increment = (measurement_frequency_div100 > 0) ? (1.0 / (measurement_frequency_div100 * 100.0)) : 0;
+
+    m_scale = readBigEndian<float>(buffer + channel_offset + 5);
+    m_scale_offset = readBigEndian<float>(buffer + channel_offset + 9);
+    int32_t start_angle_div10000 = readBigEndian<int32_t>(buffer + channel_offset + 13);
+    uint16_t angular_step_div10000 = readBigEndian<uint16_t>(buffer + channel_offset + 17);
+    m_num_beams = readBigEndian<uint16_t>(buffer + channel_offset + 19);
+    m_data_offset = channel_offset + 21;
+
+    m_angle_min = start_angle_div10000 / 10000.0 / 180.0 * M_PI - M_PI / 2;
+    m_angle_increment = angular_step_div10000 / 10000.0 / 180.0 * M_PI;
+    if (m_mirrored) // see SickScanCommon::loopOnce
+    {
+      m_angle_min = -(m_angle_min - M_PI / 2);
+      m_angle_increment = -m_angle_increment;
+    }
+    m_header_valid = true;
+    return true;
+  }
+
+  void SickScanSectorStream::publishSector(const uint8_t* buffer, int beam_start, int beam_end)
+  {
+    // Crop the sector to the angle limits. The beams within the limits are contiguous, since the angle is monotonic.
+    const double angle_eps = 1.0e-6;
+    while (beam_start < beam_end)
+    {
+      double angle = m_angle_min + beam_start * m_angle_increment;
+      if (angle >= m_angle_limit_min - angle_eps && angle <= m_angle_limit_max + angle_eps)
+        break;
+      beam_start++;
+    }
+    while (beam_end > beam_start)
+    {
+      double angle = m_angle_min + (beam_end - 1) * m_angle_increment;
+      if (angle >= m_angle_limit_min - angle_eps && angle <= m_angle_limit_max + angle_eps)
+        break;
+      beam_end--;
+    }
+    int num_beams = beam_end - beam_start;
+    if (num_beams <= 0)
+      return; // sector completely outside the angle limits
+    ros::Time stamp = m_scan_start + ros::Duration(beam_start * m_time_increment);
+    float scale = 0.001f * m_scale;
+
+    m_scan.header.stamp = stamp;
+    m_scan.header.frame_id = m_frame_id;
+    m_scan.angle_min = m_angle_min + beam_start * m_angle_increment;
+    m_scan.angle_increment = m_angle_increment;
+    m_scan.angle_max = m_scan.angle_min + (num_beams - 1) * m_angle_increment;
+    m_scan.time_increment = m_time_increment;
+    m_scan.scan_time = m_scan_time;
+    m_scan.range_min = m_range_min;
+    m_scan.range_max = m_range_max;
+    m_scan.ranges.resize(num_beams);
+    m_scan.intensities.clear();
+
+    // Beams outside the range limits are kept in the laserscan (like in the full scan) and are not converted into points
+    m_cloud.header = m_scan.header;
+    m_cloud.data.resize((size_t)m_cloud.point_step * num_beams);
+    float* point = (float*)&m_cloud.data[0];
+    int num_points = 0;
+
+    const uint8_t* data = buffer + m_data_offset + 2 * beam_start;
+    for (int n = 0; n < num_beams; n++, data += 2)
+    {
+      float range = readBigEndian<uint16_t>(data) * scale + m_scale_offset;
+      m_scan.ranges[n] = range;
+      if (!(range >= m_range_min && range <= m_range_max))
+        continue;
+      double angle = m_scan.angle_min + n * m_angle_increment;
+      point[0] = range * cos(angle);
+      point[1] = range * sin(angle);
+      point[2] = 0;
+      point[3] = 0;
+      point += 4;
+      num_points++;
+    }
+    m_cloud.width = num_points;
+    m_cloud.row_step = m_cloud.point_step * m_cloud.width;
+    m_cloud.data.resize(m_cloud.row_step);
+    m_scan_pub.publish(m_scan);
+    m_cloud_pub.publish(m_cloud);
+    m_num_sectors_published++;
+  }
+
+} /* namespace sick_scan */
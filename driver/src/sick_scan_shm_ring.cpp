@@ -0,0 +1,250 @@
+/*
+ * @brief Shared memory ring buffer for pointclouds
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 14.02.2021
+ *
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "sick_scan/sick_scan_shm_ring.h"
+
+namespace sick_scan
+{
+  /*!
+  \brief Slots are aligned to 64 byte (cache lines)
+  */
+  static size_t slotStride(uint32_t slot_size)
+  {
+    return ((sizeof(SickScanShmSlotHeader) + slot_size + 63) / 64) * 64;
+  }
+
+  static size_t ringHeaderSize(void)
+  {
+    return ((sizeof(SickScanShmRingHeader) + 63) / 64) * 64;
+  }
+
+  static SickScanShmSlotHeader* slotPtr(SickScanShmRingHeader* ring, uint64_t index)
+  {
+    uint8_t* base = (uint8_t*)ring + ringHeaderSize();
+    return (SickScanShmSlotHeader*)(base + (index % ring->num_slots) * slotStride(ring->slot_size));
+  }
+
+  uint64_t SickScanShmRingReader::systemTimeNanoSec(void)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  }
+
+  SickScanShmRingWriter::SickScanShmRingWriter() : m_size(0), m_ring(0)
+  {
+  }
+
+  SickScanShmRingWriter::~SickScanShmRingWriter()
+  {
+    close();
+  }
+
+  bool SickScanShmRingWriter::open(const std::string& name, uint32_t num_slots, uint32_t slot_size)
+  {
+    close();
+    if (num_slots < 2 || slot_size == 0)
+      return false;
+    m_size = ringHeaderSize() + num_slots * slotStride(slot_size);
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0666);
+    if (fd < 0)
+      return false;
+    if (ftruncate(fd, m_size) != 0)
+    {
+      ::close(fd);
+      shm_unlink(name.c_str());
+      return false;
+    }
+    void* ptr = mmap(0, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED)
+    {
+      shm_unlink(name.c_str());
+      return false;
+    }
+    m_name = name;
+    m_ring = (SickScanShmRingHeader*)ptr;
+    m_ring->magic = 0; // invalid until initialized
+    m_ring->version = SickScanShmRingHeader::VERSION;
+    m_ring->num_slots = num_slots;
+    m_ring->slot_size = slot_size;
+    m_ring->num_written.store(0, std::memory_order_relaxed);
+    for (uint32_t n = 0; n < num_slots; n++)
+      slotPtr(m_ring, n)->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_ring->magic = SickScanShmRingHeader::MAGIC;
+    return true;
+  }
+
+  void SickScanShmRingWriter::close(void)
+  {
+    if (m_ring)
+    {
+      munmap(m_ring, m_size);
+      shm_unlink(m_name.c_str());
+      m_ring = 0;
+    }
+  }
+
+  bool SickScanShmRingWriter::write(SickScanShmCloudHeader& header, const uint8_t* data, uint32_t data_size)
+  {
+    if (!m_ring || data_size > m_ring->slot_size)
+      return false;
+    uint64_t index = m_ring->num_written.load(std::memory_order_relaxed);
+    SickScanShmSlotHeader* slot = slotPtr(m_ring, index);
+    header.message_index = index;
+    if (header.write_time_nsec == 0)
+      header.write_time_nsec = SickScanShmRingReader::systemTimeNanoSec();
+    header.data_size = data_size;
+
+    // seqlock write: odd sequence while the slot is modified
+    uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot->cloud, &header, sizeof(header));
+    if (data_size > 0)
+      memcpy((uint8_t*)slot + sizeof(SickScanShmSlotHeader), data, data_size);
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+    m_ring->num_written.store(index + 1, std::memory_order_release);
+    return true;
+  }
+
+  SickScanShmRingReader::SickScanShmRingReader() : m_size(0), m_ring(0), m_next_index(0), m_num_skipped(0)
+  {
+  }
+
+  SickScanShmRingReader::~SickScanShmRingReader()
+  {
+    close();
+  }
+
+  bool SickScanShmRingReader::open(const std::string& name)
+  {
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+      return false;
+    struct stat shm_stat;
+    if (fstat(fd, &shm_stat) != 0 || (size_t)shm_stat.st_size < ringHeaderSize())
+    {
+      ::close(fd);
+      return false;
+    }
+    m_size = shm_stat.st_size;
+    void* ptr = mmap(0, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED)
+      return false;
+    m_ring = (SickScanShmRingHeader*)ptr;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m_ring->magic != SickScanShmRingHeader::MAGIC || m_ring->version != SickScanShmRingHeader::VERSION
+        || m_size < ringHeaderSize() + m_ring->num_slots * slotStride(m_ring->slot_size))
+    {
+      close();
+      return false;
+    }
+    m_next_index = m_ring->num_written.load(std::memory_order_acquire);
+    m_num_skipped = 0;
+    return true;
+  }
+
+  void SickScanShmRingReader::close(void)
+  {
+    if (m_ring)
+    {
+      munmap(m_ring, m_size);
+      m_ring = 0;
+    }
+  }
+
+  bool SickScanShmRingReader::read(SickScanShmCloudHeader& header, std::vector<uint8_t>& data, int timeout_msec)
+  {
+    if (!m_ring)
+      return false;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point deadline = start + std::chrono::milliseconds(timeout_msec);
+    std::chrono::steady_clock::time_point spin_until = start + std::chrono::microseconds(200);
+    while (true)
+    {
+      uint64_t num_written = m_ring->num_written.load(std::memory_order_acquire);
+      if (m_next_index < num_written)
+      {
+        // The writer may already overwrite the oldest slot, so skip to the second oldest if the reader is too slow
+        if (num_written - m_next_index >= m_ring->num_slots)
+        {
+          uint64_t next_index = num_written - m_ring->num_slots + 1;
+          m_num_skipped += next_index - m_next_index;
+          m_next_index = next_index;
+        }
+        const SickScanShmSlotHeader* slot = slotPtr(m_ring, m_next_index);
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if ((sequence & 1) == 0)
+        {
+          memcpy(&header, (const void*)&slot->cloud, sizeof(header));
+          uint32_t data_size = std::min(header.data_size, m_ring->slot_size);
+          data.resize(data_size);
+          if (data_size > 0)
+            memcpy(&data[0], (const uint8_t*)slot + sizeof(SickScanShmSlotHeader), data_size);
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if (slot->sequence.load(std::memory_order_relaxed) == sequence && header.message_index == m_next_index)
+          {
+            m_next_index++;
+            return true;
+          }
+        }
+        continue; // slot overwritten during copy, retry with the current write index
+      }
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+        return false;
+      if (now < spin_until)
+        std::this_thread::yield(); // low latency for pointclouds arriving shortly after the last one
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+} /* namespace sick_scan */
@@ -0,0 +1,138 @@
+/*
+ * @brief Thread pool with work stealing for data parallel loops
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 16.02.2021
+ *
+ */
+
+#include <algorithm>
+
+#include "sick_scan/sick_scan_thread_pool.h"
+
+namespace sick_scan
+{
+  SickScanThreadPool::SickScanThreadPool(int num_threads)
+  : m_ranges(std::max(num_threads, 1)), m_task(0), m_generation(0), m_num_running(0), m_shutdown(false), m_num_stolen(0)
+  {
+    for (size_t n = 0; n < m_ranges.size(); n++)
+    {
+      m_ranges[n].next = 0;
+      m_ranges[n].end = 0;
+    }
+    for (int n = 1; n < numThreads(); n++)
+    {
+      m_workers.push_back(std::thread(&SickScanThreadPool::runWorker, this, n));
+    }
+  }
+
+  SickScanThreadPool::~SickScanThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_shutdown = true;
+    }
+    m_start_cond.notify_all();
+    for (size_t n = 0; n < m_workers.size(); n++)
+    {
+      m_workers[n].join();
+    }
+  }
+
+  void SickScanThreadPool::parallelFor(size_t num_tasks, const std::function<void(size_t)>& task)
+  {
+    if (m_workers.empty() || num_tasks <= 1)
+    {
+      for (size_t n = 0; n < num_tasks; n++)
+        task(n);
+      return;
+    }
+    // Split the tasks into one contiguous range per thread
+    size_t num_threads = m_ranges.size();
+    for (size_t n = 0; n < num_threads; n++)
+    {
+      m_ranges[n].next = (n * num_tasks) / num_threads;
+      m_ranges[n].end = ((n + 1) * num_tasks) / num_threads;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_task = &task;
+      m_num_running = (int)m_workers.size();
+      m_generation++;
+    }
+    m_start_cond.notify_all();
+    runTasks(0);
+    // Wait until all workers have finished, i.e. no worker accesses task or the task ranges anymore
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finish_cond.wait(lock, [this] { return m_num_running == 0; });
+    m_task = 0;
+  }
+
+  void SickScanThreadPool::runWorker(int thread_idx)
+  {
+    uint64_t generation = 0;
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_start_cond.wait(lock, [this, generation] { return m_shutdown || m_generation != generation; });
+        if (m_shutdown)
+          return;
+        generation = m_generation;
+      }
+      runTasks(thread_idx);
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_num_running--;
+      }
+      m_finish_cond.notify_one();
+    }
+  }
+
+  void SickScanThreadPool::runTasks(int thread_idx)
+  {
+    const std::function<void(size_t)>& task = *m_task;
+    size_t num_threads = m_ranges.size();
+    // Run the own task range first, then steal the remaining tasks of the other threads
+    for (size_t k = 0; k < num_threads; k++)
+    {
+      TaskRange& range = m_ranges[(thread_idx + k) % num_threads];
+      size_t num_run = 0;
+      for (size_t n = range.next.fetch_add(1); n < range.end; n = range.next.fetch_add(1))
+      {
+        task(n);
+        num_run++;
+      }
+      if (k > 0 && num_run > 0)
+        m_num_stolen += num_run;
+    }
+  }
+
+} /* namespace sick_scan */
@@ -7,6 +7,8 @@
 #include "sick_scan/tcp/tcp.hpp"
 #include "sick_scan/tcp/errorhandler.hpp"
 #include "sick_scan/tcp/toolbox.hpp"
+#include "sick_scan/sick_scan_profiling.h"
+#include "sick_scan/sick_scan_realtime.h"
 #include <stdio.h>      // for sprintf()
 
 #include <sys/socket.h> // for socket(), bind(), and connect()
@@ -180,8 +182,22 @@ bool Tcp::open(std::string ipAddress, UINT16 port, bool enableVerboseDebugOutput
 
 	printInfoMessage("Tcp::open: Connection established. Now starting read thread.", m_beVerbose);
 
+	// Optional realtime mode: busy polling of the socket
+	std::string realtimeError;
+	if (sick_scan::SickScanRealtime::instance().applyBusyPoll(m_connectionSocket, realtimeError) == false)
+	{
+		printWarning("Tcp::open: Realtime mode: " + realtimeError);
+	}
+
 	// Empfangsthread starten
 	m_readThread.run(this);
+
+	// Optional realtime mode: cpu affinity and priority of the read thread
+	realtimeError.clear();
+	if (sick_scan::SickScanRealtime::instance().applyThreadConfig(sick_scan::SickScanRealtime::THREAD_RECEIVE, *m_readThread.get_thread_id(), realtimeError) == false)
+	{
+		printWarning("Tcp::open: Realtime mode: " + realtimeError);
+	}
 	
 	printInfoMessage("Tcp::open: Done, leaving now.", m_beVerbose);
 
@@ -246,12 +262,22 @@ INT32 Tcp::readInputData()
 #else
 	{
 		int ret = -1;
+		// Optional realtime mode: spin (poll without timeout) before blocking
+		int spinTimeUs = sick_scan::SickScanRealtime::instance().getSpinUsec();
+		uint64_t spinEndTime = (spinTimeUs > 0) ? (sick_scan::SickScanProfiling::nowNanoSec() + 1000 * (uint64_t)spinTimeUs) : 0;
 		do {
 			struct pollfd fd;
 
 			fd.fd = m_connectionSocket; // your socket handler
 			fd.events = POLLIN;
-			ret = poll(&fd, 1, 1000); // 1 second for timeout
+			if (spinEndTime > 0 && sick_scan::SickScanProfiling::nowNanoSec() < spinEndTime)
+			{
+				ret = poll(&fd, 1, 0);
+			}
+			else
+			{
+				ret = poll(&fd, 1, 1000); // 1 second for timeout
+			}
 			switch (ret) {
 				case -1:
 					// Error
@@ -260,8 +286,11 @@ INT32 Tcp::readInputData()
 					// Timeout
 					break;
 				default:
+				{
+					sick_scan::SickScanProfiling::ScopedTimer timer(sick_scan::SickScanProfiling::STAGE_SOCKET_READ);
 					recvMsgSize = recv(m_connectionSocket, inBuffer, max_length, 0);
 					break;
+				}
 			}
 			if (m_readThread.m_threadShouldRun == false)
 			{
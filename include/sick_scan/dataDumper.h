@@ -1,7 +1,13 @@
 #ifndef DATA_DUMPER_H
 #define DATA_DUMPER_H
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
 #include <string>
+#include <thread>
 #include <vector>
 
 #define DEBUG_DUMP_ENABLED 0
@@ -17,10 +23,64 @@ public:
   }
 
   ~DataDumper()
-  {}
+  {
+    stopBinaryDump();
+    delete[] ringBuffer;
+  }
 
+  /*!
+   * Pushes a value by channel name. In binary dump mode, the value is passed to pushData(int, double, double) after
+   * looking up the channel id, which takes channelMutex and a map lookup (i.e. not lock-free). Otherwise the value is
+   * collected in memory and written to csv when the buffer is full. Use channelId() and pushData(int, double, double)
+   * in time critical code.
+   */
   int pushData(double timeStamp, std::string info, double val);
 
+  /*!
+   * Returns the channel id of a channel name. Channel ids should be requested once (e.g. stored in a static variable)
+   * and passed to pushData(int, double, double) in time critical code.
+   * @param[in] info channel name
+   * @return channel id
+   */
+  int channelId(const std::string& info);
+
+  /*!
+   * Pushes a record to the lock-free ring buffer of the binary dump. Does not allocate memory and does not block.
+   * If the ring buffer is full, the record is dropped and counted (see getDroppedRecords()).
+   * If the binary dump is not active, the record is passed to pushData(double, std::string, double).
+   * @param[in] channel channel id returned by channelId()
+   * @param[in] timeStamp timestamp
+   * @param[in] val value
+   * @return 0 on success, 2 if the record was dropped
+   */
+  int pushData(int channel, double timeStamp, double val);
+
+  /*!
+   * Starts the binary dump mode: records are pushed into a preallocated ring buffer and written to file
+   * by a background thread. Use convertBinaryDumpToCsv() or sick_scan_dump_converter to convert the file to csv.
+   * @param[in] filename binary output file
+   * @param[in] ringBufferSize number of records in the ring buffer (rounded up to a power of 2)
+   * @return true on success
+   */
+  bool startBinaryDump(const std::string& filename, size_t ringBufferSize = 65536);
+
+  /*!
+   * Stops the binary dump mode, waits for producers still writing a record, writes all pending records and closes the file
+   */
+  void stopBinaryDump(void);
+
+  bool isBinaryDumpActive(void) const { return binaryDumpActive.load(std::memory_order_acquire); }
+
+  uint64_t getDroppedRecords(void) const { return droppedRecords.load(std::memory_order_relaxed); }
+
+  /*!
+   * Converts a binary dump file to csv with the same format as writeDataToCsv()
+   * @param[in] binFilename binary dump file written in binary dump mode
+   * @param[in] csvFilename csv output file
+   * @return number of converted records or -1 in case of errors
+   */
+  static int convertBinaryDumpToCsv(const std::string& binFilename, const std::string& csvFilename);
+
   int writeDataToCsv(std::string fileName);
 
   int writeToFileNameWhenBufferIsFull(std::string filename);
@@ -37,6 +97,30 @@ public:
   int testbed();
 
 private:
+  /*!
+   * POD record of the binary dump ring buffer
+   */
+  struct BinaryDumpRecord
+  {
+    double timeStamp;
+    double value;
+    uint32_t channel;
+    uint32_t reserved;
+  };
+
+  /*!
+   * Slot of the ring buffer. The sequence number synchronizes producers and the writer thread (bounded MPSC queue).
+   */
+  struct BinaryDumpSlot
+  {
+    std::atomic<uint64_t> sequence;
+    BinaryDumpRecord record;
+  };
+
+  void binaryDumpThread(void);
+
+  int writeChannelNames(FILE *fout, size_t& numWrittenChannels);
+
   const int maxFifoSize = 10000;
   std::vector<double> timeStampVec;
   std::vector<std::string> infoVec;
@@ -49,12 +133,32 @@ private:
     infoVec.resize(maxFifoSize);
     dataVec.resize(maxFifoSize);
     pushCounter = 0;
+    binaryDumpActive = false;
+    activeProducers = 0;
+    droppedRecords = 0;
+    ringBuffer = 0;
+    ringBufferMask = 0;
+    ringWriteIndex = 0;
+    ringReadIndex = 0;
   }           // verhindert, dass ein Objekt von au�erhalb von N erzeugt wird.
   // protected, wenn man von der Klasse noch erben m�chte
   DataDumper(const DataDumper &); /* verhindert, dass eine weitere Instanz via
 								   Kopier-Konstruktor erstellt werden kann */
   DataDumper &operator=(const DataDumper &); //Verhindert weitere Instanz durch Kopie
   std::string dumpFileName;
+
+  std::mutex channelMutex;                   // protects channelNames and channelIds
+  std::vector<std::string> channelNames;     // channel names indexed by channel id
+  std::map<std::string, int> channelIds;     // channel ids by channel name
+  std::atomic<bool> binaryDumpActive;
+  std::atomic<int> activeProducers;          // number of producers currently writing into the ring buffer
+  std::atomic<uint64_t> droppedRecords;
+  BinaryDumpSlot* ringBuffer;                // preallocated ring buffer with ringBufferMask + 1 slots
+  uint64_t ringBufferMask;
+  std::atomic<uint64_t> ringWriteIndex;      // next slot to write, incremented by producers
+  uint64_t ringReadIndex;                    // next slot to read, used by the writer thread only
+  std::thread binaryDumpWriter;
+  std::string binaryDumpFileName;
 };
 
 /* Verwendung:
@@ -51,6 +51,8 @@
 
 #include <diagnostic_updater/diagnostic_updater.h>
 #include <diagnostic_updater/publisher.h>
+
+#include "sick_scan/FieldEvalMsg.h"
 /*
 #include <sick_scan/sick_scan_common_nw.h>
 #include <sick_scan/RadarScan.h> // generated by msg-generator
@@ -121,6 +123,49 @@ namespace sick_scan
   };
 
 
+  /*!
+  \brief Host-side evaluation of the monitoring fields.
+  The field polygons (R, Phi) of all fields are converted into a table of range thresholds per beam,
+  which is recomputed only if the scan geometry or the field configuration changes. Each scan is then
+  evaluated against the fields of the active fieldset by a single pass over the ranges.
+  */
+  class SickScanFieldMonEvaluator
+  {
+  public:
+    SickScanFieldMonEvaluator(int fields_per_fieldset = 3);
+
+    /*!
+    \brief Evaluates the fields of a fieldset for a scan
+    \param ranges: scan ranges in meter (first echo)
+    \param num_ranges: number of ranges
+    \param angle_min: angle of the first beam in ros coordinates [rad]
+    \param angle_increment: angle between two beams [rad]
+    \param range_min: ranges below range_min are invalid and never counted as intrusion
+    \param fieldset: active fieldset (0, 1, ...)
+    \param msg: evaluation result (header is not modified)
+    \return true on success, false if no fields are configured
+    */
+    bool evaluate(const float* ranges, int num_ranges, float angle_min, float angle_increment, float range_min, int fieldset, sick_scan::FieldEvalMsg& msg);
+
+    /*!
+    \brief Forces an update of the threshold table, f.e. after the field configuration has been queried again
+    */
+    void invalidate(void) { m_table_num_beams = 0; }
+
+  protected:
+
+    void updateThresholdTable(const std::vector<SickScanMonField>& fields, int num_ranges, float angle_min, float angle_increment);
+
+    static float fieldRangeAtAngle(const SickScanMonField& field, float angle_rad);
+
+    int m_fields_per_fieldset;
+    int m_table_num_beams;      // number of beams in m_threshold_table, 0 if invalid
+    float m_table_angle_min;    // angle_min of m_threshold_table
+    float m_table_angle_inc;    // angle_increment of m_threshold_table
+    std::vector<std::vector<float> > m_threshold_table; // m_threshold_table[field_idx][beam_idx]: field range at beam beam_idx, 0 if the beam is not covered by the field
+  };
+
+
 #if 0
   class SickScanRadar
   {
@@ -0,0 +1,165 @@
+/*
+ * @brief C API of the ROS independent driver core
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_API_H_
+#define SICK_SCAN_API_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+** C API of the ROS independent driver core (see sick_scan_core.h). Decoded scans and their pointclouds are written
+** by the receive thread into a ring buffer of preallocated slots. The application polls the ring buffer from one
+** thread and reads the scan data in place; a slot is returned to the driver by SickScanApiReleaseScan().
+** The ring buffer is lock-free (single producer, single consumer). If all slots are in use, new scans are dropped.
+** Scans are decoded by the same cola binary decoder as in the ROS driver. Unlike the ROS driver, the API supports
+** cola binary only, stamps scans by their receive time (no software pll) and does not filter angles or ranges.
+*/
+
+enum SickScanApiResult
+{
+  SICK_SCAN_API_SUCCESS = 0,
+  SICK_SCAN_API_ERROR = 1,
+  SICK_SCAN_API_TIMEOUT = 2,
+  SICK_SCAN_API_NOT_CONNECTED = 3
+};
+
+#define SICK_SCAN_API_MAX_ENCODERS 4
+
+typedef struct SickScanApiContext* SickScanApiHandle;
+
+/*!
+\brief Scan and pointcloud in a ring buffer slot. Pointers point into the slot and are valid until
+SickScanApiReleaseScan(). Ranges and intensities of echo e and beam b are at index e * num_beams + b, the point of
+echo e and beam b starts at points[4 * (e * num_beams + b)] with float fields x, y, z, intensity.
+*/
+typedef struct SickScanApiScan
+{
+  uint64_t sequence;                  /* running index of the scan (0, 1, 2, ...) */
+  uint64_t recv_time_nsec;            /* system time (CLOCK_REALTIME) when the scan telegram was received */
+  uint64_t publish_time_nsec;         /* system time when the scan was written to the ring buffer */
+  uint32_t time_since_startup_usec;   /* device time of the scan */
+  uint32_t time_of_transmission_usec; /* device time of the transmission */
+  uint32_t serial_number;
+  uint16_t telegram_counter;
+  uint16_t scan_counter;
+  int16_t layer_angle_x200;           /* layer angle in 1/200 degree, 0 for single layer devices */
+  float elevation;                    /* elevation of the layer in radians */
+  float scan_frequency;
+  float time_increment;
+  float angle_min;
+  float angle_increment;
+  uint32_t num_beams;
+  uint32_t num_echos;
+  uint32_t num_rssi;
+  uint32_t num_encoders;
+  int32_t encoder_position[SICK_SCAN_API_MAX_ENCODERS];
+  int16_t encoder_speed[SICK_SCAN_API_MAX_ENCODERS];
+  const float* ranges;                /* num_echos * num_beams ranges in meter */
+  const float* intensities;           /* num_rssi * num_beams intensities */
+  const float* points;                /* num_points points with x, y, z, intensity */
+  uint32_t num_points;
+  uint32_t point_step;                /* bytes per point (16) */
+} SickScanApiScan;
+
+/*!
+\brief Creates a driver instance with a ring buffer of num_slots slots, each for up to max_points points
+(beams times echos). Returns NULL on error.
+*/
+SickScanApiHandle SickScanApiCreate(uint32_t num_slots, uint32_t max_points);
+
+/*!
+\brief Disconnects and releases the driver instance
+*/
+void SickScanApiRelease(SickScanApiHandle handle);
+
+/*!
+\brief Devices with mirrored and shifted scan data (f.e. NAV-3xx), must be set before connect or replay
+*/
+int SickScanApiSetScanMirroredAndShifted(SickScanApiHandle handle, int mirrored_and_shifted);
+
+/*!
+\brief Connects to a device and starts the measurement
+*/
+int SickScanApiConnect(SickScanApiHandle handle, const char* hostname, int port, int timeout_msec);
+
+/*!
+\brief Stops the measurement and disconnects
+*/
+int SickScanApiDisconnect(SickScanApiHandle handle);
+
+/*!
+\brief Starts a thread replaying a datagram log (*.sdl) or network capture (*.pcapng, *.pcap). speed 1 replays in
+realtime, speed 0 as fast as possible. repeat is the number of replays of the file. The file is read datagram by
+datagram while it is replayed, i.e. files of any size can be replayed.
+*/
+int SickScanApiReplay(SickScanApiHandle handle, const char* filename, double speed, int repeat);
+
+/*!
+\brief Returns 1 while connected or replaying, otherwise 0
+*/
+int SickScanApiIsRunning(SickScanApiHandle handle);
+
+/*!
+\brief Returns the oldest scan not yet released. Waits up to timeout_msec milliseconds (0: no wait) for a new
+scan. The scan must be returned by SickScanApiReleaseScan() before the next call of SickScanApiPollScan().
+\return SICK_SCAN_API_SUCCESS or SICK_SCAN_API_TIMEOUT
+*/
+int SickScanApiPollScan(SickScanApiHandle handle, SickScanApiScan* scan, int timeout_msec);
+
+/*!
+\brief Returns the slot of a scan to the driver
+*/
+int SickScanApiReleaseScan(SickScanApiHandle handle, SickScanApiScan* scan);
+
+/*!
+\brief Returns the number of scans written to the ring buffer, dropped (ring buffer full or scan too large) and
+the number of telegrams with errors
+*/
+int SickScanApiGetStatistics(SickScanApiHandle handle, uint64_t* num_scans, uint64_t* num_dropped, uint64_t* num_errors);
+
+/*!
+\brief Returns the current system time in nanoseconds (clock of recv_time_nsec and publish_time_nsec)
+*/
+uint64_t SickScanApiSystemTimeNanoSec(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* SICK_SCAN_API_H_ */
@@ -0,0 +1,122 @@
+/*
+ * @brief Compact encodings of pointcloud messages
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 09.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_CLOUD_ENCODER_H_
+#define SICK_SCAN_CLOUD_ENCODER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <sensor_msgs/PointCloud2.h>
+
+namespace sick_scan
+{
+  /*!
+  \brief Converts the float32 pointcloud of the driver (fields x, y, z, intensity and optional time) into a compact point layout.
+  Supported layouts (parameter cloud_encoding):
+  - "float32": x, y, z, intensity FLOAT32 (16 byte per point, no conversion)
+  - "int16":   x, y, z INT16 in units of cloud_encoding_resolution, intensity UINT16 (8 byte per point)
+  - "int32":   x, y, z INT32 in units of cloud_encoding_resolution, intensity UINT16 (14 byte per point)
+  - "float16": x, y, z IEEE 754 half precision stored as UINT16, intensity UINT16 (8 byte per point)
+  - "polar":   range UINT16 in units of cloud_encoding_resolution, beam (column index) UINT16, intensity UINT16 (6 byte per point)
+  A field "time" (FLOAT32) is passed unchanged. Invalid points (NaN or out of range) are encoded as INT16_MIN resp. INT32_MIN
+  for int16 and int32, as NaN for float16 and as range 0 for polar. Out of range are coordinates beyond 32767 units (int16)
+  and ranges beyond 65535 units (polar), i.e. 32.7 m resp. 65.5 m at millimeter resolution. The organized layout (height, width) is kept.
+  The resolution of the int16, int32 and polar encodings is published with the cloud as an additional field
+  "resolution=<meter>" with count 0, i.e. the field occupies no bytes in the points (see getResolution()).
+  */
+  class SickScanCloudEncoder
+  {
+  public:
+
+    enum ENCODING
+    {
+      ENCODING_FLOAT32 = 0,
+      ENCODING_INT16,
+      ENCODING_INT32,
+      ENCODING_FLOAT16,
+      ENCODING_POLAR,
+      ENCODING_NUM
+    };
+
+    SickScanCloudEncoder(ENCODING encoding = ENCODING_FLOAT32, double resolution = 0.001);
+
+    /*!
+    \brief Sets the encoding by its name ("float32", "int16", "int32", "float16" or "polar")
+    \return false, if the name is unknown (encoding not changed)
+    */
+    bool setEncoding(const std::string& encoding_name, double resolution);
+
+    void setEncoding(ENCODING encoding, double resolution);
+
+    ENCODING getEncoding(void) const { return m_encoding; }
+
+    static const char* encodingName(ENCODING encoding);
+
+    /*!
+    \brief Returns the size of an encoded point in bytes
+    */
+    static int pointStep(ENCODING encoding, bool with_time);
+
+    /*!
+    \brief Encodes a float32 pointcloud. Returns the input cloud for encoding float32, otherwise a reference to
+    the preallocated encoded cloud, which stays valid until the next call.
+    */
+    const sensor_msgs::PointCloud2& encode(const sensor_msgs::PointCloud2& cloud);
+
+    /*!
+    \brief Conversion between float32 and IEEE 754 half precision (round to nearest even)
+    */
+    static uint16_t floatToHalf(float value);
+
+    static float halfToFloat(uint16_t value);
+
+    /*!
+    \brief Returns the resolution in meter of an encoded cloud, i.e. the scale of its integer fields,
+    or 0 if the cloud has no field "resolution=<meter>" (float32 and float16 encoding)
+    */
+    static double getResolution(const sensor_msgs::PointCloud2& cloud);
+
+  protected:
+
+    ENCODING m_encoding;
+    float m_scale; // 1 / resolution
+    std::string m_resolution_field_name; // name of the metadata field with the resolution
+    sensor_msgs::PointCloud2 m_cloud; // preallocated encoded cloud
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_CLOUD_ENCODER_H_ */
@@ -0,0 +1,119 @@
+/*
+ * @brief Reduction of pointclouds by decimation, range bins or voxel grid
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 11.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_CLOUD_REDUCER_H_
+#define SICK_SCAN_CLOUD_REDUCER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <sensor_msgs/PointCloud2.h>
+
+namespace sick_scan
+{
+  /*!
+  \brief Reduces the float32 pointcloud of the driver before publishing. Supported reductions (parameter cloud_reduction):
+  - "decimation": keeps every n-th column (beam) of the organized cloud
+  - "range_bin":  splits each row into bins of n beams and keeps the points with minimum and maximum range of each bin
+  - "voxel":      voxel grid filter, i.e. all points within a voxel are replaced by their centroid (like pcl::VoxelGrid)
+  Decimation keeps the organized layout, range_bin and voxel output unorganized clouds with valid points only. All
+  buffers (output cloud, voxel hash table and accumulators) are preallocated and reused, i.e. there are no per-point
+  heap allocations after the first cloud.
+  */
+  class SickScanCloudReducer
+  {
+  public:
+
+    enum REDUCTION
+    {
+      REDUCTION_NONE = 0,
+      REDUCTION_DECIMATION,
+      REDUCTION_RANGE_BIN,
+      REDUCTION_VOXEL,
+      REDUCTION_NUM
+    };
+
+    SickScanCloudReducer();
+
+    /*!
+    \brief Sets the reduction by its name ("none", "decimation", "range_bin" or "voxel")
+    \param reduction_name reduction
+    \param decimation keep every n-th column (reduction decimation)
+    \param bin_size number of beams per bin (reduction range_bin)
+    \param voxel_size voxel size in meter (reduction voxel)
+    \return false, if the name is unknown (reduction not changed)
+    */
+    bool setReduction(const std::string& reduction_name, int decimation, int bin_size, double voxel_size);
+
+    REDUCTION getReduction(void) const { return m_reduction; }
+
+    static const char* reductionName(REDUCTION reduction);
+
+    /*!
+    \brief Reduces a pointcloud with FLOAT32 fields x, y, z and optional further FLOAT32 fields (e.g. intensity, time),
+    which are passed (decimation, range_bin) resp. averaged (voxel). Returns a reference to the preallocated reduced
+    cloud, which stays valid until the next call.
+    */
+    const sensor_msgs::PointCloud2& reduce(const sensor_msgs::PointCloud2& cloud);
+
+  protected:
+
+    void decimate(const sensor_msgs::PointCloud2& cloud);
+
+    void reduceRangeBins(const sensor_msgs::PointCloud2& cloud, int offset_x, int offset_y, int offset_z);
+
+    void reduceVoxelGrid(const sensor_msgs::PointCloud2& cloud, int offset_x, int offset_y, int offset_z);
+
+    void initOutput(const sensor_msgs::PointCloud2& cloud, uint32_t height, uint32_t width);
+
+    REDUCTION m_reduction;
+    int m_decimation;
+    int m_bin_size;
+    float m_inv_voxel_size;
+    sensor_msgs::PointCloud2 m_cloud;        // preallocated reduced cloud
+
+    // voxel grid: open addressing hash table (linear probing) from voxel key to voxel index
+    std::vector<uint64_t> m_voxel_keys;      // voxel key of each slot
+    std::vector<int32_t> m_voxel_slot_index; // voxel index of each slot
+    std::vector<uint32_t> m_voxel_slot_gen;  // slot is used, if its generation equals m_voxel_gen (avoids clearing the table)
+    uint32_t m_voxel_gen;
+    std::vector<float> m_voxel_sum;          // sum of all float fields per voxel
+    std::vector<uint32_t> m_voxel_count;     // number of points per voxel
+    std::vector<int> m_float_offsets;        // offsets of all FLOAT32 fields
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_CLOUD_REDUCER_H_ */
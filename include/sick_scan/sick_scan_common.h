@@ -77,6 +77,16 @@
 #include "sick_scan/Encoder.h"
 #include "sick_scan/sick_generic_field_mon.h"
 #include "sick_scan/sick_scan_marker.h"
+#include "sick_scan/sick_scan_profiling.h"
+#include "sick_scan/sick_scan_frame_assembler.h"
+#include "sick_scan/sick_scan_deskew.h"
+#include "sick_scan/sick_scan_cloud_encoder.h"
+#include "sick_scan/sick_scan_range_image.h"
+#include "sick_scan/sick_scan_cloud_reducer.h"
+#include "sick_scan/sick_scan_echo_policy.h"
+#include "sick_scan/sick_scan_decoded_scan.h"
+#include "sick_scan/sick_scan_core.h"
+#include "sick_scan/sick_scan_shm_ring.h"
 
 void swap_endian(unsigned char *ptr, int numBytes);
 
@@ -224,6 +234,11 @@ namespace sick_scan
 
     virtual int init();
 
+    /*!
+    \brief Returns true, if datagrams are replayed from file instead of received from a device
+    */
+    virtual bool isDatagramReplayActive() { return false; }
+
     int loopOnce();
 
     void check_angle_range(SickScanConfig &conf);
@@ -276,7 +291,19 @@ namespace sick_scan
     ros::Publisher imuScan_pub_;
     ros::Publisher Encoder_pub;
     // sensor_msgs::PointCloud cloud_;
-    sensor_msgs::PointCloud2 cloud_;
+    SickScanFrameAssembler frame_assembler_; // collects the layers of a scan into pointcloud frames
+    double cloud_sector_angle_; // sector angle in radians for cloud_output_mode 2
+    bool cloud_point_time_; // add field "time" (point time relative to the cloud timestamp) to the pointcloud
+    SickScanDeskew* cloud_deskew_; // motion compensation of the pointcloud, if cloud_deskew is set
+    SickScanCloudEncoder cloud_encoder_; // compact point layout by parameter cloud_encoding
+    SickScanEchoPolicy echo_policy_; // host-side echo selection by parameter echo_policy
+    SickScanDecodedScan decoded_scan_; // decoded scan, source of laserscan messages, pointcloud and range images
+    sensor_msgs::LaserScan scan_msg_; // laserscan message of loopOnce, its ranges and intensities are swapped with decoded_scan_
+    SickScanCoreScan core_scan_; // binary scandata decoded by SickScanCore::decodeScandata
+    SickScanThreadPool* cloud_build_pool_; // parallel pointcloud build, if cloud_build_threads > 1
+    SickScanCloudReducer cloud_reducer_; // reduced pointcloud by parameter cloud_reduction
+    ros::Publisher cloud_reduced_pub_;
+    bool cloud_publish_full_; // publish the full pointcloud (true by default, optionally false if a reduced pointcloud is published)
     //////
     // Dynamic Reconfigure
     SickScanConfig config_;
@@ -285,6 +312,8 @@ namespace sick_scan
 
     virtual int init_scanner();
 
+    std::vector<bool> initOutputChannelFlags(void);
+
     virtual int stop_scanner();
 
     virtual int close_device() = 0;
@@ -337,6 +366,16 @@ namespace sick_scan
 
     bool dumpDatagramForDebugging(unsigned char *buffer, int bufLen);
 
+    /*!
+    \brief writes a pointcloud into the shared memory ring buffer (active if cloud_shm_name is set)
+    */
+    void writeCloudToShm(const sensor_msgs::PointCloud2 &cloud, uint64_t publish_time_nsec);
+
+    /*!
+    \brief diagnostic task reporting the profiling counters and latencies (active if profiling_enable is set)
+    */
+    void profilingDiagnostics(diagnostic_updater::DiagnosticStatusWrapper &stat);
+
     diagnostic_updater::Updater diagnostics_;
 
 
@@ -353,10 +392,20 @@ namespace sick_scan
     ros::Publisher lidoutputstate_pub_;
     bool publish_lidoutputstate_;
     SickScanMarker* cloud_marker_;
+    ros::Publisher field_eval_pub_;
+    ros::Subscriber deskew_odom_sub_;
+    ros::Subscriber deskew_imu_sub_;
+    SickScanRangeImage* range_image_; // range and intensity images, if range_image_enable is set
+    ros::Publisher range_image_pub_;
+    ros::Publisher intensity_image_pub_;
+    SickScanShmRingWriter* cloud_shm_; // shared memory transport of the pointcloud, if cloud_shm_name is set
+    SickScanFieldMonEvaluator* field_evaluator_; // host-side field evaluation, if field_eval_enable is set
 
     // Diagnostics
     diagnostic_updater::DiagnosedPublisher<sensor_msgs::LaserScan> *diagnosticPub_;
     double expectedFrequency_;
+    double profiling_dump_interval_; // interval of profiling summaries in seconds (0: no periodic summary)
+    ros::Time profiling_last_dump_;
 
 
 #ifndef _MSC_VER
@@ -38,6 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
 #include <boost/asio.hpp>
 
 #undef NOMINMAX // to get rid off warning C4005: "NOMINMAX": Makro-Neudefinition
@@ -45,6 +46,9 @@
 #include "sick_scan_common.h"
 #include "sick_generic_parser.h"
 #include "template_queue.h"
+#include "sick_scan_datagram_log.h"
+#include "sick_scan_pcapng_reader.h"
+#include "sick_scan_sector_stream.h"
 
 namespace sick_scan
 {
@@ -83,6 +87,11 @@ namespace sick_scan
 
     int getReplyMode();
 
+    /*!
+    \brief Returns true, if datagrams are replayed from a datagram log file (parameter datagram_replay_file)
+    */
+    virtual bool isDatagramReplayActive();
+
     void setEmulSensor(bool _emulFlag);
 
     bool getEmulSensor();
@@ -137,6 +146,8 @@ namespace sick_scan
 
     void checkDeadline();
 
+    void datagramReplayThreadFunction();
+
   private:
 
 
@@ -163,6 +174,14 @@ namespace sick_scan
     std::string port_;
     int timelimit_;
     int m_replyMode;
+
+    SickScanDatagramLogWriter* m_datagramRecorder; // records all received datagrams, if datagram_record_file is set
+    SickScanDatagramLogReader* m_datagramReplay;   // replays datagrams instead of connecting to a device, if datagram_replay_file is set
+    SickScanPcapngReader* m_pcapngReplay;          // replays datagrams from a network capture, if datagram_replay_file is a pcapng or pcap file
+    double m_datagramReplayRate;                   // replay speed: 1.0 = real time, 0 = as fast as possible
+    boost::thread* m_datagramReplayThread;
+    std::atomic<bool> m_datagramReplayThreadRunning; // shared between the replay thread and init/destructor
+    SickScanSectorStream* m_sectorStream;         // publishes sectors of partially received scans, if scan_sector_stream is set
   };
 
 
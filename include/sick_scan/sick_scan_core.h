@@ -0,0 +1,298 @@
+/*
+ * @brief ROS independent driver core with callback outputs
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_CORE_H_
+#define SICK_SCAN_CORE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace sick_scan
+{
+  /*!
+  \brief Decoded scan of one layer in structure of arrays layout, corresponds to sensor_msgs::LaserScan without ROS
+  types. Ranges and intensities of all echos are stored consecutively, i.e. ranges[echo * num_beams + beam].
+  */
+  struct SickScanCoreScan
+  {
+    enum { MAX_ENCODERS = 4 };
+    uint64_t recv_time_nsec;           // system time when the telegram was received
+    uint32_t serial_number;
+    uint16_t telegram_counter;
+    uint16_t scan_counter;
+    uint32_t time_since_startup_usec;  // device time of the scan
+    uint32_t time_of_transmission_usec; // device time of the transmission
+    int16_t layer_angle_x200;          // layer angle in 1/200 degree, 0 for single layer devices
+    float elevation;                   // elevation of the layer in radians
+    float scan_frequency;              // scans per second
+    float time_increment;              // time between two beams in seconds
+    float angle_min;                   // azimuth of the first beam in radians (ROS convention, 0 in x direction)
+    float angle_increment;             // angle between two beams in radians
+    uint32_t num_beams;
+    uint32_t num_echos;                // number of range channels (DIST1, DIST2, ...)
+    uint32_t num_rssi;                 // number of intensity channels (RSSI1, RSSI2, ...)
+    std::vector<float> ranges;         // ranges in meter, num_echos * num_beams
+    std::vector<float> intensities;    // intensities, num_rssi * num_beams
+    std::vector<float> vertical_angles; // vertical angle of each beam in degree (VANG channel of MRS1xxx), empty if not transmitted
+    uint32_t num_encoders;
+    int32_t encoder_position[MAX_ENCODERS];
+    int16_t encoder_speed[MAX_ENCODERS];
+  };
+
+  /*!
+  \brief Pointcloud of a scan with float32 fields x, y, z and intensity. The point of echo e and beam b is
+  stored at points[4 * (e * num_beams + b)].
+  */
+  struct SickScanCoreCloud
+  {
+    uint64_t recv_time_nsec;           // system time when the scan telegram was received
+    uint32_t time_since_startup_usec;  // device time of the scan
+    uint16_t scan_counter;
+    float elevation;
+    uint32_t num_beams;
+    uint32_t num_echos;
+    std::vector<float> points;         // x, y, z, intensity
+  };
+
+  /*!
+  \brief Decoded "sSN InertialMeasurementUnit" telegram
+  */
+  struct SickScanCoreImu
+  {
+    uint64_t recv_time_nsec;
+    uint32_t timestamp_usec;           // device time
+    float linear_acceleration[3];      // x, y, z in m/s^2
+    float angular_velocity[3];         // x, y, z in rad/s
+    float orientation[4];              // quaternion w, x, y, z
+  };
+
+  /*!
+  \brief Field evaluation result of one field of a "sSN LFErec" telegram, corresponds to sick_scan::LFErecFieldMsg
+  */
+  struct SickScanCoreFieldEvent
+  {
+    uint16_t version_number;
+    uint8_t field_index;
+    uint32_t sys_count;
+    float dist_scale_factor;
+    float dist_scale_offset;
+    uint32_t angle_scale_factor;
+    int32_t angle_scale_offset;
+    uint8_t field_result_mrs;          // 0: invalid, 1: free, 2: infringed
+    uint16_t time_state;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint32_t microsecond;
+  };
+
+  /*!
+  \brief ROS independent driver core: connects to a device, configures scandata output, receives and frames cola
+  binary telegrams and decodes scandata, imu and field evaluation telegrams into plain C++ structures, which are passed
+  to callbacks. Telegrams without decoder (f.e. radar or LIDoutputstate telegrams) are passed raw to the telegram
+  callback. All callbacks are called in the receive thread (or in the thread calling processReceivedBytes() or
+  processTelegram(), if telegrams are replayed). Output structures are reused, i.e. decoding does not allocate
+  memory once the buffers have grown to the size of the largest telegram.
+  */
+  class SickScanCore
+  {
+  public:
+
+    typedef std::function<void(const SickScanCoreScan&)> ScanCallback;
+    typedef std::function<void(const SickScanCoreCloud&)> CloudCallback;
+    typedef std::function<void(const SickScanCoreImu&)> ImuCallback;
+    typedef std::function<void(uint64_t recv_time_nsec, const std::vector<SickScanCoreFieldEvent>&)> FieldEventCallback;
+    typedef std::function<void(uint64_t recv_time_nsec, const uint8_t* telegram, size_t size)> TelegramCallback;
+
+    SickScanCore();
+
+    ~SickScanCore();
+
+    /*
+    ** Outputs. Callbacks must be set before connect() or the first call of processReceivedBytes().
+    */
+
+    void setScanCallback(const ScanCallback& callback) { m_scan_callback = callback; }
+
+    /*!
+    \brief Sets the pointcloud callback. Pointclouds are built only if a cloud callback is set.
+    */
+    void setCloudCallback(const CloudCallback& callback) { m_cloud_callback = callback; }
+
+    void setImuCallback(const ImuCallback& callback) { m_imu_callback = callback; }
+
+    void setFieldEventCallback(const FieldEventCallback& callback) { m_field_event_callback = callback; }
+
+    /*!
+    \brief Sets the callback for all event telegrams ("sSN ...") without decoder, f.e. radar telegrams
+    */
+    void setTelegramCallback(const TelegramCallback& callback) { m_telegram_callback = callback; }
+
+    /*!
+    \brief Devices with mirrored and shifted scan data (see ScannerBasicParam::getScanMirroredAndShifted)
+    */
+    void setScanMirroredAndShifted(bool mirrored_and_shifted) { m_scan_mirrored_and_shifted = mirrored_and_shifted; }
+
+    /*
+    ** Connection and configuration
+    */
+
+    /*!
+    \brief Connects to a device and starts the receive thread
+    */
+    bool connect(const std::string& hostname, int port, int timeout_msec = 5000);
+
+    void disconnect(void);
+
+    bool isConnected(void) const { return m_receive_thread_running; }
+
+    /*!
+    \brief Sends a sopas command and waits for its response
+    \param command cola binary payload of the command without header, length and checksum, f.e. "sRN DeviceIdent"
+    \param response payload of the response without header, length and checksum
+    \param timeout_msec max. time to wait for the response
+    \return true, if a response has been received
+    */
+    bool sendCommand(const std::vector<uint8_t>& command, std::vector<uint8_t>& response, int timeout_msec = 5000);
+
+    /*!
+    \brief Logs in as authorized client, starts the measurement and activates scandata telegrams. Device specific
+    configuration (scan range, echos, field evaluation etc.) can be sent by sendCommand() before.
+    */
+    bool startScandata(int timeout_msec = 5000);
+
+    bool stopScandata(int timeout_msec = 5000);
+
+    /*
+    ** Receive and decode
+    */
+
+    /*!
+    \brief Appends received bytes of the tcp stream and processes all complete telegrams
+    */
+    void processReceivedBytes(const uint8_t* data, size_t size, uint64_t recv_time_nsec);
+
+    /*!
+    \brief Decodes a complete cola binary telegram incl. header, length and checksum and calls the callbacks
+    \return false, if the telegram is not a valid cola binary telegram
+    */
+    bool processTelegram(const uint8_t* telegram, size_t size, uint64_t recv_time_nsec);
+
+    /*!
+    \brief Decodes a cola binary "sSN LMDscandata" telegram. Buffers of scan are reused. This is the scandata decoder of
+    both the driver core and the ROS driver (SickScanCommon::loopOnce).
+    \param decode_echo_mask channels DISTn and RSSIn are decoded only if bit n-1 is set, the values of other echos are not set
+    */
+    static bool decodeScandata(const uint8_t* telegram, size_t size, bool scan_mirrored_and_shifted, SickScanCoreScan& scan,
+                               uint32_t decode_echo_mask = 0xFFFFFFFF);
+
+    static bool decodeImu(const uint8_t* telegram, size_t size, SickScanCoreImu& imu);
+
+    static bool decodeFieldEvents(const uint8_t* telegram, size_t size, std::vector<SickScanCoreFieldEvent>& fields);
+
+    /*!
+    \brief Converts a scan into a pointcloud. Buffers of cloud are reused.
+    */
+    void buildCloud(const SickScanCoreScan& scan, SickScanCoreCloud& cloud);
+
+    /*!
+    \brief Encodes a cola binary telegram: header, payload length, payload and checksum
+    */
+    static void encodeTelegram(const std::vector<uint8_t>& payload, std::vector<uint8_t>& telegram);
+
+    uint64_t getNumTelegrams(void) const { return m_num_telegrams; }
+
+    uint64_t getNumBytes(void) const { return m_num_bytes; }
+
+    /*!
+    \brief Returns the number of telegrams discarded due to invalid checksum or failed decoding
+    */
+    uint64_t getNumErrors(void) const { return m_num_errors; }
+
+    /*!
+    \brief Returns the current system time in nanoseconds (clock of recv_time_nsec)
+    */
+    static uint64_t systemTimeNanoSec(void);
+
+  protected:
+
+    void receiveThreadFunction(void);
+
+    ScanCallback m_scan_callback;
+    CloudCallback m_cloud_callback;
+    ImuCallback m_imu_callback;
+    FieldEventCallback m_field_event_callback;
+    TelegramCallback m_telegram_callback;
+    bool m_scan_mirrored_and_shifted;
+
+    boost::asio::io_service m_io_service;
+    boost::asio::ip::tcp::socket m_socket;
+    std::thread m_receive_thread;
+    std::atomic<bool> m_receive_thread_running;
+
+    std::vector<uint8_t> m_receive_buffer;  // received bytes not yet framed
+    size_t m_receive_buffer_start;          // start of the unprocessed bytes in m_receive_buffer
+    SickScanCoreScan m_scan;
+    SickScanCoreCloud m_cloud;
+    SickScanCoreImu m_imu;
+    std::vector<SickScanCoreFieldEvent> m_field_events;
+    std::vector<float> m_cos_azimuth;       // cached azimuth tables of the pointcloud build
+    std::vector<float> m_sin_azimuth;
+    float m_azimuth_min;
+    float m_azimuth_increment;
+
+    std::mutex m_response_mutex;
+    std::condition_variable m_response_cond;
+    std::vector<uint8_t> m_response;        // payload of the last response
+    bool m_response_received;
+
+    uint64_t m_num_telegrams;
+    uint64_t m_num_bytes;
+    uint64_t m_num_errors;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_CORE_H_ */
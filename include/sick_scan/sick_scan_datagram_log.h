@@ -0,0 +1,200 @@
+/*
+ * @brief Recording and replay of raw CoLa datagrams
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 04.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_DATAGRAM_LOG_H_
+#define SICK_SCAN_DATAGRAM_LOG_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace sick_scan
+{
+  /*!
+  \brief Datagram log file format (little endian):
+  Header: "SICKDGLG" (8 byte), version (uint32), reserved (uint32)
+  Datagrams: length (uint32), timestamp sec (uint32), timestamp nsec (uint32), raw datagram (length bytes)
+  Index (written on close): for each datagram file offset (uint64), timestamp sec (uint32), timestamp nsec (uint32)
+  Footer: index offset (uint64), number of datagrams (uint32), "SICKDGIX" (8 byte)
+  If the footer is missing (e.g. recording has been aborted), the reader rebuilds the index by scanning the datagrams.
+  */
+  class SickScanDatagramLogWriter
+  {
+  public:
+    SickScanDatagramLogWriter();
+
+    ~SickScanDatagramLogWriter();
+
+    /*!
+    \brief Creates a new datagram log file
+    \return true on success
+    */
+    bool open(const std::string& filename);
+
+    /*!
+    \brief Appends a raw datagram with its receive timestamp. Not thread-safe, call from the receive thread only.
+    */
+    bool write(uint32_t sec, uint32_t nsec, const uint8_t* datagram, uint32_t length);
+
+    /*!
+    \brief Writes the index and closes the file
+    */
+    void close(void);
+
+    bool isOpen(void) const { return m_file != NULL; }
+
+    size_t numDatagrams(void) const { return m_index.size(); }
+
+  protected:
+
+    struct IndexEntry
+    {
+      uint64_t offset;
+      uint32_t sec;
+      uint32_t nsec;
+    };
+
+    FILE* m_file;
+    uint64_t m_offset;
+    std::vector<IndexEntry> m_index;
+    std::vector<char> m_file_buffer; // large stdio buffer to minimize write syscalls in the receive thread
+  };
+
+  class SickScanDatagramLogReader
+  {
+  public:
+    SickScanDatagramLogReader();
+
+    ~SickScanDatagramLogReader();
+
+    /*!
+    \brief Opens a datagram log file and reads the index
+    \return true on success
+    */
+    bool open(const std::string& filename);
+
+    void close(void);
+
+    size_t numDatagrams(void) const { return m_index.size(); }
+
+    /*!
+    \brief Returns the timestamp of a datagram in seconds without reading the datagram
+    */
+    double timestamp(size_t idx) const { return m_index[idx].sec + 1.0e-9 * m_index[idx].nsec; }
+
+    /*!
+    \brief Reads a datagram
+    \param idx index of the datagram, 0 <= idx < numDatagrams()
+    \param sec, nsec receive timestamp
+    \param datagram raw datagram
+    \return true on success
+    */
+    bool read(size_t idx, uint32_t& sec, uint32_t& nsec, std::vector<uint8_t>& datagram);
+
+  protected:
+
+    struct IndexEntry
+    {
+      uint64_t offset;
+      uint32_t sec;
+      uint32_t nsec;
+    };
+
+    bool readIndex(void);
+
+    bool scanDatagrams(void);
+
+    FILE* m_file;
+    std::vector<IndexEntry> m_index;
+  };
+
+  /*!
+  \brief Read-only memory mapping of a datagram log file. Datagrams are returned as pointers into the mapping,
+  i.e. without copy and without reading the whole file at startup. Pages are loaded on demand by the OS.
+  */
+  class SickScanDatagramLogMapping
+  {
+  public:
+    SickScanDatagramLogMapping();
+
+    ~SickScanDatagramLogMapping();
+
+    /*!
+    \brief Maps a datagram log file and reads the index (or rebuilds the index, if the file has no index)
+    \return true on success, a complete log without datagrams is opened with numDatagrams() == 0
+    */
+    bool open(const std::string& filename);
+
+    void close(void);
+
+    size_t numDatagrams(void) const { return m_index.size(); }
+
+    /*!
+    \brief Returns the timestamp of a datagram in seconds
+    */
+    double timestamp(size_t idx) const { return m_index[idx].sec + 1.0e-9 * m_index[idx].nsec; }
+
+    /*!
+    \brief Returns a pointer to a datagram in the mapping, valid until close()
+    \param idx index of the datagram, 0 <= idx < numDatagrams()
+    \param length length of the datagram in byte
+    */
+    const uint8_t* datagram(size_t idx, uint32_t& length) const
+    {
+      length = m_index[idx].length;
+      return m_index[idx].data;
+    }
+
+  protected:
+
+    struct IndexEntry
+    {
+      const uint8_t* data;
+      uint32_t length;
+      uint32_t sec;
+      uint32_t nsec;
+    };
+
+    bool addDatagram(uint64_t offset);
+
+    const uint8_t* m_data;           // start of the mapping
+    size_t m_size;                   // size of the mapping
+    std::vector<uint8_t> m_buffer;   // file content on systems without mmap
+    std::vector<IndexEntry> m_index;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_DATAGRAM_LOG_H_ */
@@ -0,0 +1,174 @@
+/*
+ * @brief Structure-of-arrays representation of a decoded scan
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 15.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_DECODED_SCAN_H_
+#define SICK_SCAN_DECODED_SCAN_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <sick_scan/helper/angle_compensator.h>
+#include "sick_scan/sick_scan_thread_pool.h"
+
+namespace sick_scan
+{
+  /*!
+  \brief Structure-of-arrays representation of a decoded scan (one layer of a multi-layer scanner): ranges and
+  intensities of all echos, azimuth and elevation of all beams and the beam time offsets. A scan is decoded once;
+  LaserScan messages, pointclouds, range images and field evaluation are generated as read-only views of the decoded
+  scan. The views are const and independent of each other, i.e. they can run in parallel.
+  */
+  class SickScanDecodedScan
+  {
+  public:
+
+    SickScanDecodedScan();
+
+    /*!
+    \brief Takes over the ranges and intensities of a decoded scan. The vectors are swapped, i.e. the buffers of the
+    previous scan are returned in ranges and intensities for reuse. The caller keeps ranges and intensities between
+    two scans (e.g. as members), so that the buffers alternate without reallocation. Beam angles and elevations are invalidated.
+    \param num_echos number of echos
+    \param ranges ranges in meter, ranges[echo * num_beams + beam]
+    \param intensities intensities, intensities[echo * num_beams + beam], or empty
+    \param stamp timestamp of the first beam
+    \param time_increment time between two beams in seconds
+    */
+    void assign(int num_echos, std::vector<float>& ranges, std::vector<float>& intensities, const ros::Time& stamp, float time_increment);
+
+    /*!
+    \brief Sets the azimuth of all beams (angle_min + beam * angle_increment, optionally compensated).
+    Sine and cosine are cached and only recalculated if the angles change. The compensation
+    formula of the compensator must not change while it is in use.
+    */
+    void setAzimuth(float angle_min, float angle_increment, AngleCompensator* compensator);
+
+    /*!
+    \brief Sets the same elevation angle (in radians) for all beams
+    */
+    void setElevation(float elevation);
+
+    /*!
+    \brief Sets the elevation angle of each beam
+    \param vertical_angles_deg vertical angle of each beam in degree (MRS6xxx), elevation = -vertical_angle
+    */
+    void setElevation(const std::vector<float>& vertical_angles_deg);
+
+    /*!
+    \brief Copies the ranges and intensities of an echo into a LaserScan message (the other fields of msg are unchanged)
+    \param echo echo index
+    \param msg laserscan message
+    \param range_scale ranges are multiplied by range_scale (e.g. projection of a tilted layer into the horizontal plane)
+    */
+    void toLaserScan(int echo, sensor_msgs::LaserScan& msg, float range_scale = 1.0f) const;
+
+    /*!
+    \brief Writes the points of beams [beam_begin, beam_end) of the given echos into a pointcloud buffer with
+    float32 fields x, y, z, intensity and optional time. Disjoint beam intervals can be converted in parallel.
+    \param num_echos number of echos to convert
+    \param echo_idx indices of the echos to convert
+    \param cloud_data start of the pointcloud data of this scan, point (echo, beam) at echo * echo_stride + beam * point_step
+    \param point_step size of a point in byte
+    \param echo_stride offset between the points of two echos in byte
+    \param with_intensity copy intensities (otherwise intensity is 0)
+    \param with_time write the point time (time_offset + beam * time_increment) as 5. field
+    \param time_offset time of the first beam relative to the pointcloud timestamp
+    */
+    void toCloud(int num_echos, const int* echo_idx, uint8_t* cloud_data, size_t point_step, size_t echo_stride, bool with_intensity,
+                 bool with_time, float time_offset, size_t beam_begin, size_t beam_end) const;
+
+    /*!
+    \brief Converts all beams of the given echos into a pointcloud buffer like toCloud(). The points are partitioned into
+    tasks of an echo and a beam interval of at least min_beams_per_task beams, which are run by the thread pool.
+    Each task writes a disjoint slice of the pointcloud buffer. Runs in the calling thread if pool is NULL.
+    */
+    void toCloudParallel(SickScanThreadPool* pool, size_t min_beams_per_task, int num_echos, const int* echo_idx, uint8_t* cloud_data,
+                         size_t point_step, size_t echo_stride, bool with_intensity, bool with_time, float time_offset) const;
+
+    int numEchos(void) const { return m_num_echos; }
+
+    size_t numBeams(void) const { return m_num_beams; }
+
+    const ros::Time& stamp(void) const { return m_stamp; }
+
+    float timeIncrement(void) const { return m_time_increment; }
+
+    /*!
+    \brief Returns the ranges of an echo (numBeams() values) or NULL, if not available
+    */
+    const float* ranges(int echo = 0) const { return (echo < m_num_echos && m_num_beams > 0) ? &m_ranges[echo * m_num_beams] : NULL; }
+
+    /*!
+    \brief Returns the intensities of an echo (numBeams() values) or NULL, if not available
+    */
+    const float* intensities(int echo = 0) const { return ((echo + 1) * m_num_beams <= m_intensities.size() && m_num_beams > 0) ? &m_intensities[echo * m_num_beams] : NULL; }
+
+    /*!
+    \brief Returns all ranges, ranges[echo * numBeams() + beam]. Modifiable for host-side echo selection.
+    */
+    std::vector<float>& allRanges(void) { return m_ranges; }
+
+    /*!
+    \brief Returns all intensities, intensities[echo * numBeams() + beam]. Modifiable for host-side echo selection.
+    */
+    std::vector<float>& allIntensities(void) { return m_intensities; }
+
+    /*!
+    \brief Sets the number of echos after host-side echo selection (ranges and intensities have been reordered)
+    */
+    void setNumEchos(int num_echos);
+
+  protected:
+
+    int m_num_echos;
+    size_t m_num_beams;
+    ros::Time m_stamp;
+    float m_time_increment;
+    std::vector<float> m_ranges;         // ranges of all echos in meter, echo-major
+    std::vector<float> m_intensities;    // intensities of all echos, echo-major (empty if not transmitted)
+    std::vector<float> m_cos_azimuth;    // cos and sin of the azimuth of each beam
+    std::vector<float> m_sin_azimuth;
+    std::vector<float> m_cos_elevation;  // cos and sin of the elevation of each beam
+    std::vector<float> m_sin_elevation;
+    float m_azimuth_min;                 // parameters of the cached azimuth tables
+    float m_azimuth_increment;
+    AngleCompensator* m_azimuth_compensator;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_DECODED_SCAN_H_ */
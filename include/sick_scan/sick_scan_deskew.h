@@ -0,0 +1,108 @@
+/*
+ * @brief Motion compensation (deskew) of pointclouds
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 08.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_DESKEW_H_
+#define SICK_SCAN_DESKEW_H_
+
+#include <deque>
+#include <mutex>
+
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <nav_msgs/Odometry.h>
+
+namespace sick_scan
+{
+  /*!
+  \brief Compensates the sensor motion during a scan. Angular and linear velocities are collected from odometry
+  and imu messages (including the imu of the scanner). The points of a pointcloud are transformed into the sensor
+  pose at the pointcloud timestamp, assuming constant velocities during the scan:
+  p' = p + dt * (w x p + v) with dt = time of the point relative to the pointcloud timestamp (field "time").
+  Velocities are expected in the sensor frame, i.e. odometry and imu must be aligned with the sensor.
+  */
+  class SickScanDeskew
+  {
+  public:
+    SickScanDeskew(double max_sample_age = 0.5);
+
+    /*!
+    \brief Adds an angular velocity sample in rad/s
+    */
+    void addAngularVelocity(const ros::Time& stamp, double wx, double wy, double wz);
+
+    /*!
+    \brief Adds a linear velocity sample in m/s
+    */
+    void addLinearVelocity(const ros::Time& stamp, double vx, double vy, double vz);
+
+    /*!
+    \brief Adds the angular velocity of an imu message
+    */
+    void addImu(const sensor_msgs::Imu& imu);
+
+    void imuCallback(const sensor_msgs::Imu::ConstPtr& msg);
+
+    /*!
+    \brief Adds the angular and linear velocity of an odometry message
+    */
+    void odometryCallback(const nav_msgs::Odometry::ConstPtr& msg);
+
+    /*!
+    \brief Motion compensation of a pointcloud with FLOAT32 fields x, y, z and time
+    \return true if the pointcloud has been compensated, false if no velocities are available for the time of the pointcloud
+    */
+    bool deskew(sensor_msgs::PointCloud2& cloud);
+
+  protected:
+
+    struct VelocitySample
+    {
+      double stamp;
+      double vel[3];
+    };
+
+    void addSample(std::deque<VelocitySample>& samples, const ros::Time& stamp, double x, double y, double z);
+
+    static bool meanVelocity(const std::deque<VelocitySample>& samples, double start_time, double end_time, double max_age, double* vel);
+
+    std::mutex m_sample_mutex;
+    std::deque<VelocitySample> m_angular_velocity;
+    std::deque<VelocitySample> m_linear_velocity;
+    double m_max_sample_age;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_DESKEW_H_ */
@@ -0,0 +1,111 @@
+/*
+ * @brief Host-side selection of echos of multi-echo scanners
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 12.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_ECHO_POLICY_H_
+#define SICK_SCAN_ECHO_POLICY_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace sick_scan
+{
+  /*!
+  \brief Selects one echo per beam directly after decoding the DIST and RSSI channels, i.e. before the scan is
+  split into laserscan messages and converted into a pointcloud. Only policy "first" reduces the decoding (see
+  decodeEchoMask()); all other policies select from the decoded ranges and intensities of all echos, since the
+  datagram transmits the echos in separate DIST and RSSI channels. Supported policies (parameter echo_policy):
+  - "all":         all echos are kept (default, configured output channels apply)
+  - "first":       first echo (DIST1 and RSSI1 only, further channels are not decoded)
+  - "last":        last valid echo (range > 0)
+  - "strongest":   valid echo with the highest intensity (first echo, if no intensities are available)
+  - "last_above_threshold": last valid echo with an intensity of at least echo_policy_intensity_threshold,
+                   first echo if no echo reaches the threshold
+  */
+  class SickScanEchoPolicy
+  {
+  public:
+
+    enum POLICY
+    {
+      ECHO_ALL = 0,
+      ECHO_FIRST,
+      ECHO_LAST,
+      ECHO_STRONGEST,
+      ECHO_LAST_ABOVE_THRESHOLD,
+      ECHO_POLICY_NUM
+    };
+
+    SickScanEchoPolicy() : m_policy(ECHO_ALL), m_intensity_threshold(0) {}
+
+    /*!
+    \brief Sets the policy by its name
+    \return false, if the name is unknown (policy not changed)
+    */
+    bool setPolicy(const std::string& policy_name, float intensity_threshold);
+
+    POLICY getPolicy(void) const { return m_policy; }
+
+    static const char* policyName(POLICY policy);
+
+    /*!
+    \brief Returns false, if channel DISTn resp. RSSIn (echo_idx = n - 1) is not used by the policy and does not need to be decoded
+    */
+    bool decodeEcho(int echo_idx) const { return m_policy != ECHO_FIRST || echo_idx == 0; }
+
+    /*!
+    \brief Returns the echos to decode as bit mask (bit n: channels DISTn+1 and RSSIn+1), see decodeEcho()
+    */
+    uint32_t decodeEchoMask(void) const { return (m_policy == ECHO_FIRST) ? 0x1 : 0xFFFFFFFF; }
+
+    /*!
+    \brief Reduces ranges and intensities of all echos (ranges[echo * num_beams + beam]) in place to the selected echo per beam
+    \param ranges ranges of all echos
+    \param intensities intensities of all or some echos (missing intensities are treated as not available,
+    i.e. the intensity of a selected echo without intensity is 0)
+    \param num_echos number of echos in ranges
+    \param echo_mask echos to select from (bit n: echo n), e.g. the configured output channels
+    \return number of echos after selection, i.e. 1 or num_echos for policy "all"
+    */
+    int apply(std::vector<float>& ranges, std::vector<float>& intensities, int num_echos, int echo_mask = -1) const;
+
+  protected:
+
+    POLICY m_policy;
+    float m_intensity_threshold;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_ECHO_POLICY_H_ */
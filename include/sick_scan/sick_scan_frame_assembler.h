@@ -0,0 +1,172 @@
+/*
+ * @brief Assembles pointcloud frames from multi-layer scans
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 05.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_FRAME_ASSEMBLER_H_
+#define SICK_SCAN_FRAME_ASSEMBLER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+
+namespace sick_scan
+{
+  /*!
+  \brief Collects the scans of multi-layer scanners (MRS1xxx, MRS6xxx) into a preallocated full-revolution
+  pointcloud buffer. Scanners without layers identified by elevation angle (e.g. LMS1xxx, which transmits all
+  layers at elevation 0) are passed with num_layers = 1, i.e. each scan is finished as a frame of its own. Rows are ordered by echo and layer (row = echo * numLayers + layer), columns by azimuth.
+  A frame is finished when all layers have been received. If a layer is received a second time before the frame
+  is complete, layers have been dropped: the frame is finished as incomplete (missing rows are set to NaN and
+  is_dense is false) and a new frame is started. Two frame buffers are used alternately, i.e. the finished frame
+  stays valid while the next frame is assembled.
+  Depending on the output mode, complete frames, single layers or fixed-angle sectors of a frame are emitted.
+  */
+  class SickScanFrameAssembler
+  {
+  public:
+
+    enum OUTPUT_MODE
+    {
+      OUTPUT_FRAME = 0,  // all layers in one cloud (cloud_output_mode 0)
+      OUTPUT_LAYER = 1,  // each layer in its own cloud (cloud_output_mode 1)
+      OUTPUT_SECTOR = 2  // frames are split into fixed-angle sectors (cloud_output_mode 2)
+    };
+
+    SickScanFrameAssembler();
+
+    /*!
+    \brief Sets the output mode and the sector angle (used in mode OUTPUT_SECTOR only). A running frame is discarded if the mode changes.
+    */
+    void setOutputMode(int output_mode, double sector_angle_rad);
+
+    int getOutputMode(void) const { return m_output_mode; }
+
+    /*!
+    \brief Returns the layer index 0 <= layer < num_layers of a scan by its elevation angle (in 1/200 degree),
+    or -1 if the elevation angle does not match a layer or the number of layers is not supported (1, 4 or 24).
+    Layer 0 is the uppermost layer.
+    */
+    static int layerIndex(int num_layers, int elev_angle_x200);
+
+    /*!
+    \brief Starts a new layer of the current frame. Finishes the current frame if the layer has been received
+    before (incomplete frame) or if the frame geometry changed.
+    \param num_layers number of layers of the scanner
+    \param num_echos number of echos per layer
+    \param width number of points per layer and echo
+    \param fields point fields
+    \param point_step size of a point in bytes
+    \param layer layer index by layerIndex()
+    \param stamp timestamp of the layer
+    \param frame_id frame id
+    \return pointer to the first point of the layer (echo 0). The rows of the following echos start at
+    getEchoStride() bytes offset. Returns NULL for invalid layers.
+    */
+    uint8_t* beginLayer(int num_layers, int num_echos, int width, const std::vector<sensor_msgs::PointField>& fields, int point_step,
+                        int layer, const ros::Time& stamp, const std::string& frame_id);
+
+    /*!
+    \brief Finishes a layer started by beginLayer(). Finishes the frame after its last layer.
+    */
+    void endLayer(int layer);
+
+    /*!
+    \brief Returns the byte offset between the echos of a layer
+    */
+    size_t getEchoStride(void) const { return m_echo_stride; }
+
+    /*!
+    \brief Returns true, if a finished frame (or layer in mode OUTPUT_LAYER) is ready for publishing
+    */
+    bool isFrameReady(void) const { return m_frame_ready; }
+
+    /*!
+    \brief Returns the finished frame and clears the ready flag. The frame stays valid until the next frame is finished.
+    */
+    sensor_msgs::PointCloud2& popFrame(void);
+
+    /*!
+    \brief Returns the timestamp of the frame under construction, i.e. the timestamp of its first layer
+    */
+    const ros::Time& getFrameStamp(void) const { return m_frame_buffer[m_active_buffer].header.stamp; }
+
+    /*!
+    \brief Returns the number of sectors of a frame in mode OUTPUT_SECTOR
+    */
+    int numSectors(const sensor_msgs::PointCloud2& frame, double angle_increment) const;
+
+    /*!
+    \brief Copies a sector of a frame into a preallocated sector cloud. All rows of the frame are copied,
+    i.e. the sector is an organized cloud with the same height as the frame. If the frame has a FLOAT32
+    field "time" (point time relative to the frame timestamp), it is converted relative to the sector timestamp.
+    \param frame finished frame
+    \param sector_idx sector index, 0 <= sector_idx < numSectors()
+    \param angle_increment angle increment between two columns
+    \param time_increment time between two columns, used to stamp the sector by the time of its center column
+    \return sector cloud
+    */
+    const sensor_msgs::PointCloud2& getSector(const sensor_msgs::PointCloud2& frame, int sector_idx, double angle_increment, double time_increment);
+
+    uint64_t getNumCompleteFrames(void) const { return m_num_complete_frames; }
+
+    uint64_t getNumIncompleteFrames(void) const { return m_num_incomplete_frames; }
+
+    uint64_t getNumDroppedLayers(void) const { return m_num_dropped_layers; }
+
+  protected:
+
+    void finishFrame(void);
+
+    void resetFrame(void);
+
+    int m_output_mode;
+    double m_sector_angle;
+    sensor_msgs::PointCloud2 m_frame_buffer[2]; // frame under construction and finished frame
+    int m_active_buffer;                        // index of the frame under construction
+    int m_num_layers;                           // number of layers in the frame buffer (1 in mode OUTPUT_LAYER)
+    int m_num_echos;
+    size_t m_echo_stride;
+    std::vector<uint8_t> m_layer_received;      // layers received in the frame under construction
+    int m_num_layers_received;
+    bool m_frame_ready;
+    sensor_msgs::PointCloud2 m_sector;          // preallocated sector cloud
+    uint64_t m_num_complete_frames;
+    uint64_t m_num_incomplete_frames;
+    uint64_t m_num_dropped_layers;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_FRAME_ASSEMBLER_H_ */
@@ -39,6 +39,7 @@
 #ifndef SICK_SCAN_MARKER_H_
 #define SICK_SCAN_MARKER_H_
 
+#include <map>
 #include <ros/ros.h>
 #include <std_msgs/ColorRGBA.h>
 #include <visualization_msgs/MarkerArray.h>
@@ -77,8 +78,19 @@ namespace sick_scan
       std_msgs::ColorRGBA field_color; // field_result as color
     };
 
+    class FieldGeometry // cached triangles of a monitoring field, computed once per field configuration
+    {
+    public:
+      FieldGeometry() : valid(false) {}
+      bool valid;
+      std::vector<geometry_msgs::Point> triangles; // 3 points per triangle
+      geometry_msgs::Point centroid;
+    };
+
     void publishMarker(void);
-    std::vector<visualization_msgs::Marker> createMonFieldMarker(const std::vector<FieldInfo>& field_info);
+    const FieldGeometry& getFieldGeometry(int field_idx);
+    static bool markerChanged(const visualization_msgs::Marker& marker1, const visualization_msgs::Marker& marker2);
+    std::vector<visualization_msgs::Marker> createMonFieldMarker(const std::vector<FieldInfo>& field_info, std::map<int, int>& marker_geometry);
     std::vector<visualization_msgs::Marker> createMonFieldLegend(const std::vector<FieldInfo>& field_info);
     std::vector<visualization_msgs::Marker> createMonFieldsetLegend(int fieldset);
     std::vector<visualization_msgs::Marker> createOutputStateLegend(const std::vector<std::string>& output_state, const std::vector<std::string>& output_count, const std::vector<std_msgs::ColorRGBA>& output_colors);
@@ -87,10 +99,16 @@ namespace sick_scan
     ros::Publisher m_marker_publisher;
     int m_scan_mon_fieldset;
     std::vector<sick_scan::SickScanMonField> m_scan_mon_fields;
-    std::vector<visualization_msgs::Marker> m_scan_mon_field_marker;
+    std::vector<FieldGeometry> m_scan_mon_field_geometry; // m_scan_mon_field_geometry[field_idx]: cached triangles of m_scan_mon_fields[field_idx]
+    std::vector<visualization_msgs::Marker> m_scan_mon_field_marker; // field markers without points, see m_scan_mon_field_marker_geometry
+    std::map<int, int> m_scan_mon_field_marker_geometry; // field index of the triangles by marker id of m_scan_mon_field_marker
     std::vector<visualization_msgs::Marker> m_scan_mon_field_legend;
     std::vector<visualization_msgs::Marker> m_scan_fieldset_legend;
     std::vector<visualization_msgs::Marker> m_scan_outputstate_legend;
+    std::map<int, visualization_msgs::Marker> m_published_marker; // last published marker by marker id
+    std::map<int, int> m_published_marker_geometry; // field index of the last published triangles by marker id (-1: no triangles)
+    ros::Time m_last_full_publish; // time of last publishing of all markers
+    uint32_t m_num_subscribers; // number of subscribers at last publishing
 
   }; /* class SickScanMarker */
 
@@ -0,0 +1,147 @@
+/*
+ * @brief Streaming pcapng reader, extracts CoLa datagrams from tcp captures
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 17.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_PCAPNG_READER_H_
+#define SICK_SCAN_PCAPNG_READER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace sick_scan
+{
+  /*!
+  \brief Streaming reader for network captures (pcapng and classic pcap files, e.g. recorded by wireshark or tcpdump).
+  The tcp streams sent by the scanner (i.e. tcp source port 2111 or 2112 by default) are reassembled, and CoLa-A
+  (<STX>...<ETX>) and CoLa-B (0x02020202 + length + payload + CRC) datagrams are extracted with the capture timestamp
+  of the packet completing the datagram. The file is read sequentially block by block, memory is bounded by the
+  number of out-of-order segments and the size of incomplete datagrams per tcp stream.
+  Supported link types: ethernet (incl. vlan), loopback (null and loop), raw ip and linux cooked capture (sll, sll2).
+  IPv4 and IPv6 (without extension headers) are supported, ip fragments are ignored.
+  */
+  class SickScanPcapngReader
+  {
+  public:
+    SickScanPcapngReader();
+
+    ~SickScanPcapngReader();
+
+    /*!
+    \brief Opens a pcapng or pcap file
+    \param filename capture file
+    \param ports tcp source ports of the scanner, default (empty): 2111 and 2112
+    \return true on success
+    */
+    bool open(const std::string& filename, const std::vector<uint16_t>& ports = std::vector<uint16_t>());
+
+    void close(void);
+
+    /*!
+    \brief Reads the next CoLa datagram
+    \param sec, nsec capture timestamp
+    \param datagram raw datagram
+    \return true on success, false at the end of file or on error
+    */
+    bool read(uint32_t& sec, uint32_t& nsec, std::vector<uint8_t>& datagram);
+
+    size_t numPackets(void) const { return m_numPackets; }           // number of tcp segments processed
+
+    size_t numDatagrams(void) const { return m_numDatagrams; }       // number of datagrams extracted
+
+    size_t numSkippedBytes(void) const { return m_numSkippedBytes; } // number of bytes skipped due to lost segments or unknown data
+
+  protected:
+
+    struct Interface
+    {
+      int linktype;
+      bool tsresolPow2; // timestamp resolution is 2^-tsresol (true) or 10^-tsresol (false)
+      uint8_t tsresol;
+    };
+
+    struct Datagram
+    {
+      uint32_t sec;
+      uint32_t nsec;
+      std::vector<uint8_t> data;
+    };
+
+    struct TcpStream
+    {
+      TcpStream() : synchronized(false), nextSeq(0), bufferStart(0) {}
+      bool synchronized;                                 // true after the first segment
+      uint32_t nextSeq;                                  // next expected sequence number
+      std::vector<uint8_t> buffer;                       // received bytes
+      size_t bufferStart;                                // start of the bytes not yet assigned to a datagram
+      std::map<uint32_t, std::vector<uint8_t> > pending; // out-of-order segments by sequence number
+    };
+
+    bool readPcapngBlock(void);
+
+    bool readPcapRecord(void);
+
+    void processPacket(int linktype, const uint8_t* data, size_t size);
+
+    void processTcpSegment(const std::string& streamId, uint32_t seq, bool syn, bool fin, const uint8_t* payload, size_t size);
+
+    void appendToStream(TcpStream& stream, const uint8_t* payload, size_t size);
+
+    void extractDatagrams(TcpStream& stream);
+
+    uint16_t get16(const uint8_t* p) const { return m_bigEndian ? ((p[0] << 8) | p[1]) : ((p[1] << 8) | p[0]); }
+
+    uint32_t get32(const uint8_t* p) const { return m_bigEndian ? ((uint32_t)get16(p) << 16) | get16(p + 2) : ((uint32_t)get16(p + 2) << 16) | get16(p); }
+
+    FILE* m_file;
+    std::vector<char> m_fileBuffer;
+    bool m_pcapng;                     // pcapng (true) or classic pcap (false)
+    bool m_bigEndian;                  // byte order of the current section
+    std::vector<Interface> m_interfaces;
+    std::vector<uint8_t> m_block;
+    std::vector<uint16_t> m_ports;
+    std::map<std::string, TcpStream> m_streams;
+    std::deque<Datagram> m_datagrams; // extracted datagrams, not yet read
+    uint32_t m_sec;                    // timestamp of the current packet
+    uint32_t m_nsec;
+    size_t m_numPackets;
+    size_t m_numDatagrams;
+    size_t m_numSkippedBytes;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_PCAPNG_READER_H_ */
@@ -0,0 +1,219 @@
+/*
+ * @brief Lightweight profiling counters and latency histograms for sick_scan
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 01.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_PROFILING_H_
+#define SICK_SCAN_PROFILING_H_
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
+namespace sick_scan
+{
+  /*!
+  \brief Always-on-capable instrumentation of the driver hot path.
+  All counters, gauges and histogram buckets are lock-free atomics updated with relaxed memory order,
+  so they can be updated from the receive thread and the main loop without synchronization. Latency
+  histograms use log-linear buckets (8 sub-buckets per power of two, i.e. max. 12.5% relative error)
+  like HDR histograms. If profiling is disabled, all update functions return immediately.
+  */
+  class SickScanProfiling
+  {
+  public:
+    enum STAGE // pipeline stages with latency histograms
+    {
+      STAGE_SOCKET_READ,      // copy received bytes into the receive buffer
+      STAGE_FRAME_EXTRACTION, // find and extract CoLa frames in the receive buffer
+      STAGE_QUEUE_WAIT,       // time between frame extraction and pop from the receive queue
+      STAGE_PARSE,            // decode a datagram
+      STAGE_CLOUD_BUILD,      // build the pointcloud
+      STAGE_CLOUD_ENCODE,     // convert the pointcloud into the point layout by parameter cloud_encoding
+      STAGE_CLOUD_REDUCE,     // reduce the pointcloud by parameter cloud_reduction
+      STAGE_PUBLISH,          // publish scan and pointcloud messages
+      STAGE_NUM
+    };
+
+    enum COUNTER // event counters
+    {
+      COUNTER_BYTES_RECEIVED,   // bytes received from the socket
+      COUNTER_FRAMES_RECEIVED,  // frames extracted from the receive buffer
+      COUNTER_FRAMES_DROPPED,   // frames discarded due to checksum errors or receive buffer overflow
+      COUNTER_FRAMES_SKIPPED,   // frames skipped by configuration (parameter skip)
+      COUNTER_SCANS_PUBLISHED,  // laserscan messages published
+      COUNTER_CLOUDS_PUBLISHED, // pointcloud messages published
+      COUNTER_BYTES_PUBLISHED,  // pointcloud bytes published
+      COUNTER_REDUCED_CLOUDS_PUBLISHED, // reduced pointcloud messages published (parameter cloud_reduction)
+      COUNTER_REDUCED_BYTES_PUBLISHED,  // reduced pointcloud bytes published
+      COUNTER_NUM
+    };
+
+    enum GAUGE // current values with maximum
+    {
+      GAUGE_QUEUE_DEPTH,          // number of datagrams in the receive queue
+      GAUGE_RECEIVE_BUFFER_BYTES, // number of bytes in the receive buffer
+      GAUGE_NUM
+    };
+
+    static SickScanProfiling &instance()
+    {
+      static SickScanProfiling _instance;
+      return _instance;
+    }
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+
+    bool isEnabled(void) const { return m_enabled.load(std::memory_order_relaxed); }
+
+    /*!
+    \brief Returns a monotonic timestamp in nanoseconds
+    */
+    static uint64_t nowNanoSec(void)
+    {
+      return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void addLatency(STAGE stage, uint64_t nanosec)
+    {
+      if (!isEnabled())
+        return;
+      m_histogram[stage][bucketIndex(nanosec)].fetch_add(1, std::memory_order_relaxed);
+      m_latency_sum[stage].fetch_add(nanosec, std::memory_order_relaxed);
+      uint64_t max_val = m_latency_max[stage].load(std::memory_order_relaxed);
+      while (nanosec > max_val && !m_latency_max[stage].compare_exchange_weak(max_val, nanosec, std::memory_order_relaxed))
+      {
+      }
+    }
+
+    void incrementCounter(COUNTER counter, uint64_t increment = 1)
+    {
+      if (isEnabled())
+        m_counter[counter].fetch_add(increment, std::memory_order_relaxed);
+    }
+
+    void setGauge(GAUGE gauge, int64_t value)
+    {
+      if (!isEnabled())
+        return;
+      m_gauge[gauge].store(value, std::memory_order_relaxed);
+      int64_t max_val = m_gauge_max[gauge].load(std::memory_order_relaxed);
+      while (value > max_val && !m_gauge_max[gauge].compare_exchange_weak(max_val, value, std::memory_order_relaxed))
+      {
+      }
+    }
+
+    uint64_t getCounter(COUNTER counter) const { return m_counter[counter].load(std::memory_order_relaxed); }
+
+    /*!
+    \brief Returns the average rate of a counter in 1/sec since the last reset, e.g. the published bytes per second
+    */
+    double getCounterRate(COUNTER counter) const;
+
+    int64_t getGauge(GAUGE gauge) const { return m_gauge[gauge].load(std::memory_order_relaxed); }
+
+    int64_t getGaugeMax(GAUGE gauge) const { return m_gauge_max[gauge].load(std::memory_order_relaxed); }
+
+    uint64_t getLatencyCount(STAGE stage) const;
+
+    double getLatencyMeanMicroSec(STAGE stage) const;
+
+    double getLatencyMaxMicroSec(STAGE stage) const { return 1.0e-3 * m_latency_max[stage].load(std::memory_order_relaxed); }
+
+    /*!
+    \brief Returns the latency percentile (0 < percentile <= 100) of a stage in microseconds
+    */
+    double getLatencyPercentileMicroSec(STAGE stage, double percentile) const;
+
+    static const char* stageName(STAGE stage);
+
+    static const char* counterName(COUNTER counter);
+
+    static const char* gaugeName(GAUGE gauge);
+
+    /*!
+    \brief Returns a human readable summary of all counters, gauges and latencies
+    */
+    std::string toString(void) const;
+
+    /*!
+    \brief Resets all counters, gauges and histograms
+    */
+    void reset(void);
+
+    /*!
+    \brief Measures the latency of a stage from construction until destruction resp. stop()
+    */
+    class ScopedTimer
+    {
+    public:
+      ScopedTimer(STAGE stage) : m_stage(stage), m_start(SickScanProfiling::instance().isEnabled() ? nowNanoSec() : 0) {}
+      ~ScopedTimer() { stop(); }
+      void stop(void)
+      {
+        if (m_start > 0)
+          SickScanProfiling::instance().addLatency(m_stage, nowNanoSec() - m_start);
+        m_start = 0;
+      }
+    protected:
+      STAGE m_stage;
+      uint64_t m_start;
+    };
+
+  protected:
+
+    enum { SUB_BUCKET_BITS = 3, SUB_BUCKETS = (1 << SUB_BUCKET_BITS), NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS };
+
+    SickScanProfiling();
+
+    SickScanProfiling(const SickScanProfiling &);
+
+    SickScanProfiling &operator=(const SickScanProfiling &);
+
+    static int bucketIndex(uint64_t value);
+
+    static uint64_t bucketUpperBound(int bucket);
+
+    std::atomic<bool> m_enabled;
+    std::atomic<uint64_t> m_counter[COUNTER_NUM];
+    std::atomic<int64_t> m_gauge[GAUGE_NUM];
+    std::atomic<int64_t> m_gauge_max[GAUGE_NUM];
+    std::atomic<uint64_t> m_latency_sum[STAGE_NUM];
+    std::atomic<uint64_t> m_latency_max[STAGE_NUM];
+    std::atomic<uint64_t> m_histogram[STAGE_NUM][NUM_BUCKETS];
+    std::atomic<uint64_t> m_reset_time; // nowNanoSec() at the last reset
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_PROFILING_H_ */
@@ -0,0 +1,103 @@
+/*
+ * @brief Organized range and intensity images of multi-layer scans
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 10.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_RANGE_IMAGE_H_
+#define SICK_SCAN_RANGE_IMAGE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+
+namespace sick_scan
+{
+  /*!
+  \brief Builds range and intensity images (encoding 32FC1) directly from the decoded scan data, i.e. without
+  conversion into cartesian coordinates. Image rows are ordered by echo and layer (row = echo * numLayers + layer,
+  layer 0 is the uppermost layer), columns by beam (azimuth). The ranges and intensities of a layer are copied
+  directly into the rows of the preallocated images. Images are finished like the frames of SickScanFrameAssembler:
+  after their last layer, or as incomplete images with NaN rows for missing layers if a layer is received twice.
+  Two image buffers are used alternately, i.e. the finished images stay valid while the next images are assembled.
+  */
+  class SickScanRangeImage
+  {
+  public:
+
+    SickScanRangeImage();
+
+    /*!
+    \brief Adds the ranges and intensities of a layer
+    \param num_layers number of layers of the scanner
+    \param layer layer index by SickScanFrameAssembler::layerIndex()
+    \param num_echos number of echos to copy
+    \param echo_idx indices of the echos to copy
+    \param width number of beams per echo
+    \param ranges ranges in meter, ranges[echo * width + beam]
+    \param intensities intensities, intensities[echo * width + beam], or NULL
+    \param num_intensities number of values in intensities
+    \param stamp timestamp of the layer
+    \param frame_id frame id
+    \return true, if the images are complete and ready for publishing
+    */
+    bool addLayer(int num_layers, int layer, int num_echos, const int* echo_idx, int width, const float* ranges,
+                  const float* intensities, int num_intensities, const ros::Time& stamp, const std::string& frame_id);
+
+    /*!
+    \brief Returns the last finished range image
+    */
+    const sensor_msgs::Image& getRangeImage(void) const { return m_range_image[1 - m_active_buffer]; }
+
+    /*!
+    \brief Returns the last finished intensity image
+    */
+    const sensor_msgs::Image& getIntensityImage(void) const { return m_intensity_image[1 - m_active_buffer]; }
+
+  protected:
+
+    void finishImages(void);
+
+    sensor_msgs::Image m_range_image[2];         // preallocated range images under construction and finished
+    sensor_msgs::Image m_intensity_image[2];     // preallocated intensity images under construction and finished
+    int m_active_buffer;                         // index of the images under construction
+    int m_num_layers;                            // number of layers of the images under construction
+    int m_num_echos;
+    int m_width;
+    std::vector<uint8_t> m_layer_received;       // layers received in the images under construction
+    int m_num_layers_received;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_RANGE_IMAGE_H_ */
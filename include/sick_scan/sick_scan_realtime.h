@@ -0,0 +1,139 @@
+/*
+ * @brief Optional realtime configuration of the driver threads
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_REALTIME_H_
+#define SICK_SCAN_REALTIME_H_
+
+#include <atomic>
+#include <pthread.h>
+#include <string>
+
+namespace sick_scan
+{
+  /*!
+  \brief Optional realtime configuration of the driver threads: cpu affinity and SCHED_FIFO priority per thread,
+  busy polling of the scan socket (SO_BUSY_POLL), spin-then-block waiting for received datagrams and locking of
+  the process memory. All options are disabled by default. The configuration is set once from the node parameters
+  before the scanner is connected and read by the receive thread and the main loop.
+  */
+  class SickScanRealtime
+  {
+  public:
+    enum THREAD // driver threads with their own cpu affinity and priority
+    {
+      THREAD_RECEIVE, // tcp read thread, receives and frames the datagrams
+      THREAD_MAIN,    // main loop (loopOnce), decodes and publishes, runs the ros callbacks
+      THREAD_NUM
+    };
+
+    static SickScanRealtime &instance()
+    {
+      static SickScanRealtime _instance;
+      return _instance;
+    }
+
+    /*!
+    \param cpu cpu core of the thread, -1: no affinity
+    \param priority SCHED_FIFO priority 1 to 99, 0: default scheduling
+    */
+    void setThreadConfig(THREAD thread, int cpu, int priority)
+    {
+      m_cpu[thread].store(cpu, std::memory_order_relaxed);
+      m_priority[thread].store(priority, std::memory_order_relaxed);
+    }
+
+    int getThreadCpu(THREAD thread) const { return m_cpu[thread].load(std::memory_order_relaxed); }
+
+    int getThreadPriority(THREAD thread) const { return m_priority[thread].load(std::memory_order_relaxed); }
+
+    /*!
+    \brief Sets SO_BUSY_POLL of the scan socket in microseconds, 0: disabled
+    */
+    void setBusyPollUsec(int usec) { m_busy_poll_usec.store(usec, std::memory_order_relaxed); }
+
+    int getBusyPollUsec(void) const { return m_busy_poll_usec.load(std::memory_order_relaxed); }
+
+    /*!
+    \brief Sets the time in microseconds the receive thread and the main loop spin (poll without sleeping) for new
+    data before they block, 0: block immediately
+    */
+    void setSpinUsec(int usec) { m_spin_usec.store(usec, std::memory_order_relaxed); }
+
+    int getSpinUsec(void) const { return m_spin_usec.load(std::memory_order_relaxed); }
+
+    /*!
+    \brief Applies cpu affinity and priority of a driver thread
+    \param error error message, if the thread configuration failed (f.e. missing CAP_SYS_NICE for SCHED_FIFO)
+    \return true on success or if nothing was configured for this thread
+    */
+    bool applyThreadConfig(THREAD thread, pthread_t thread_id, std::string& error) const;
+
+    bool applyThreadConfigToCurrentThread(THREAD thread, std::string& error) const
+    {
+      return applyThreadConfig(thread, pthread_self(), error);
+    }
+
+    /*!
+    \brief Sets SO_BUSY_POLL of a socket, if configured
+    \return true on success or if busy polling is disabled
+    */
+    bool applyBusyPoll(int socket_fd, std::string& error) const;
+
+    /*!
+    \brief Locks all current and future memory of the process (mlockall), i.e. no page faults in the hot path
+    */
+    static bool lockMemory(std::string& error);
+
+    static const char* threadName(THREAD thread);
+
+  protected:
+
+    SickScanRealtime() : m_busy_poll_usec(0), m_spin_usec(0)
+    {
+      for (int n = 0; n < THREAD_NUM; n++)
+      {
+        m_cpu[n].store(-1);
+        m_priority[n].store(0);
+      }
+    }
+
+    std::atomic<int> m_cpu[THREAD_NUM];
+    std::atomic<int> m_priority[THREAD_NUM];
+    std::atomic<int> m_busy_poll_usec;
+    std::atomic<int> m_spin_usec;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_REALTIME_H_ */
@@ -0,0 +1,135 @@
+/*
+ * @brief Streaming of scan sectors from partially received datagrams
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 13.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_SECTOR_STREAM_H_
+#define SICK_SCAN_SECTOR_STREAM_H_
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+#include <sensor_msgs/PointCloud2.h>
+
+namespace sick_scan
+{
+  /*!
+  \brief Publishes angular sectors of a CoLa-B LMDscandata datagram while the datagram is still being received.
+  The receive thread calls update() whenever new bytes have been appended to the receive buffer. As soon as the
+  header and the DIST1 channel header are complete, each block of sector_beams beams is published as soon as its
+  bytes have arrived, as LaserScan and PointCloud2 message. Sector messages contain the first echo only and no
+  intensities, since the RSSI channels follow the DIST channels in the datagram. The timestamp of a sector is the
+  time of its first beam: the scan start is estimated by the arrival time of the first bytes of the datagram minus
+  the device time between scan start and transmission (SystemCountTransmit - SystemCountScan), plus time_offset.
+  Note that this time base differs from the full scan, which is stamped by the software PLL: sector and scan stamps
+  of the same beam can differ by the jitter of the receive time. Beams outside the angle limits (min_ang, max_ang)
+  are not published, beams outside the range limits (range_min, range_max) are not converted into points, i.e. the
+  sectors contain the same beams as the full scan. Single-layer devices only.
+  */
+  class SickScanSectorStream
+  {
+  public:
+
+    SickScanSectorStream(ros::NodeHandle& nh, const std::string& scan_topic, const std::string& cloud_topic, int sector_beams,
+                         const std::string& frame_id, double range_min, double range_max, bool mirrored);
+
+    /*!
+    \brief Processes the receive buffer
+    \param buffer receive buffer starting with the magic word 0x02020202 of a (partial) CoLa-B datagram
+    \param length number of bytes in the receive buffer
+    \param complete true, if the buffer contains the complete datagram (remaining beams are published and the datagram is finished)
+    \param receive_time time of the last receive
+    */
+    void update(const uint8_t* buffer, size_t length, bool complete, const ros::Time& receive_time);
+
+    /*!
+    \brief Sets the angle limits and the time offset of the driver configuration, applied from the next datagram on
+    \param angle_min minimal angle in ros coordinates (config min_ang)
+    \param angle_max maximal angle in ros coordinates (config max_ang)
+    \param time_offset time offset added to the sector timestamps (config time_offset)
+    */
+    void setLimits(double angle_min, double angle_max, double time_offset);
+
+    uint64_t getNumSectorsPublished(void) const { return m_num_sectors_published; }
+
+  protected:
+
+    /*!
+    \brief Parses the header of a LMDscandata datagram up to the DIST1 channel header. Returns false, if not enough bytes
+    are available yet. m_ignore is set for other datagrams.
+    */
+    bool parseHeader(const uint8_t* buffer, size_t length, const ros::Time& receive_time);
+
+    void publishSector(const uint8_t* buffer, int beam_start, int beam_end);
+
+    ros::Publisher m_scan_pub;
+    ros::Publisher m_cloud_pub;
+    int m_sector_beams;
+    std::string m_frame_id;
+    double m_range_min;
+    double m_range_max;
+    bool m_mirrored;
+    std::mutex m_limits_mutex;   // protects m_limit_angle_min, m_limit_angle_max and m_limit_time_offset set by the main thread
+    double m_limit_angle_min;
+    double m_limit_angle_max;
+    double m_limit_time_offset;
+
+    // state of the datagram currently received
+    bool m_active;               // a datagram is being received
+    bool m_ignore;               // the current datagram is not a scan or not supported
+    bool m_header_valid;         // header and DIST1 channel header are parsed
+    uint32_t m_system_count_scan;
+    ros::Time m_scan_start;      // estimated time of the first beam
+    size_t m_data_offset;        // offset of the first DIST1 value
+    int m_num_beams;
+    int m_beams_published;
+    float m_scale;
+    float m_scale_offset;
+    double m_angle_min;
+    double m_angle_increment;
+    double m_time_increment;
+    double m_scan_time;
+    double m_angle_limit_min;    // angle limits and time offset of the current datagram
+    double m_angle_limit_max;
+    double m_time_offset;
+    uint64_t m_num_sectors_published;
+
+    sensor_msgs::LaserScan m_scan;    // preallocated sector messages
+    sensor_msgs::PointCloud2 m_cloud;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_SECTOR_STREAM_H_ */
@@ -0,0 +1,183 @@
+/*
+ * @brief Shared memory ring buffer for pointclouds
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 14.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_SHM_RING_H_
+#define SICK_SCAN_SHM_RING_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace sick_scan
+{
+  /*!
+  \brief Pointcloud header transmitted with each pointcloud in shared memory. Corresponds to the header and the
+  layout fields of sensor_msgs::PointCloud2, so that clients do not depend on ROS.
+  */
+  struct SickScanShmCloudHeader
+  {
+    enum { MAX_FIELDS = 8, MAX_NAME_LENGTH = 16, MAX_FRAME_ID_LENGTH = 64 };
+    struct Field
+    {
+      char name[MAX_NAME_LENGTH];
+      uint32_t offset;
+      uint8_t datatype; // sensor_msgs::PointField datatype
+      uint32_t count;
+    };
+    uint64_t message_index;        // running index of the pointcloud (0, 1, 2, ...)
+    uint64_t write_time_nsec;      // system time (CLOCK_REALTIME) when the pointcloud was published (before ros publish and shm write)
+    uint32_t stamp_sec;            // header.stamp
+    uint32_t stamp_nsec;
+    char frame_id[MAX_FRAME_ID_LENGTH];
+    uint32_t height;
+    uint32_t width;
+    uint32_t point_step;
+    uint32_t row_step;
+    uint8_t is_bigendian;
+    uint8_t is_dense;
+    uint32_t num_fields;
+    Field fields[MAX_FIELDS];      // point fields; metadata fields (count 0) are carried as members, f.e. resolution
+    double resolution;             // scale of the integer fields in meter (int16, int32 and polar encoding), 0 for float fields
+    uint32_t data_size;            // number of data bytes following the header
+  };
+
+  /*!
+  \brief Layout of the shared memory: ring header followed by num_slots slots. Each slot consists of a seqlock
+  sequence counter, the cloud header and slot_size data bytes. The sequence counter of a slot is odd while the
+  writer updates the slot; a reader copies a slot and accepts the copy only if the counter was even and unchanged.
+  */
+  struct SickScanShmRingHeader
+  {
+    enum { MAGIC = 0x53434D52, VERSION = 2 }; // "SCMR"
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_slots;
+    uint32_t slot_size;              // max. data bytes per slot
+    std::atomic<uint64_t> num_written; // number of pointclouds written, i.e. index of the next pointcloud
+  };
+
+  struct SickScanShmSlotHeader
+  {
+    std::atomic<uint64_t> sequence;  // seqlock counter, odd while writing
+    SickScanShmCloudHeader cloud;
+  };
+
+  /*!
+  \brief Writes pointclouds into a POSIX shared memory ring buffer (single writer). The shared memory is created
+  by open() and removed by close() or the destructor.
+  */
+  class SickScanShmRingWriter
+  {
+  public:
+
+    SickScanShmRingWriter();
+
+    ~SickScanShmRingWriter();
+
+    /*!
+    \brief Creates the shared memory, e.g. name "/sick_scan_cloud"
+    */
+    bool open(const std::string& name, uint32_t num_slots, uint32_t slot_size);
+
+    void close(void);
+
+    bool isOpen(void) const { return m_ring != 0; }
+
+    /*!
+    \brief Writes a pointcloud into the next slot. message_index of the header is set by write(), write_time_nsec is
+    set to the current time, if the caller did not set it.
+    \return false, if the data do not fit into a slot
+    */
+    bool write(SickScanShmCloudHeader& header, const uint8_t* data, uint32_t data_size);
+
+  protected:
+
+    std::string m_name;
+    size_t m_size;
+    SickScanShmRingHeader* m_ring;
+  };
+
+  /*!
+  \brief Reads pointclouds from a shared memory ring buffer created by SickScanShmRingWriter. Any number of readers
+  can read concurrently. Readers never block the writer; a reader which falls behind by more than num_slots pointclouds
+  continues with the oldest pointcloud still available and counts the skipped pointclouds.
+  */
+  class SickScanShmRingReader
+  {
+  public:
+
+    SickScanShmRingReader();
+
+    ~SickScanShmRingReader();
+
+    /*!
+    \brief Opens an existing shared memory. By default, reading starts with the next pointcloud written.
+    */
+    bool open(const std::string& name);
+
+    void close(void);
+
+    bool isOpen(void) const { return m_ring != 0; }
+
+    /*!
+    \brief Reads the next pointcloud
+    \param header cloud header
+    \param data cloud data
+    \param timeout_msec max. time to wait for a new pointcloud in milliseconds (polling, 0: no wait)
+    \return true, if a pointcloud has been read
+    */
+    bool read(SickScanShmCloudHeader& header, std::vector<uint8_t>& data, int timeout_msec);
+
+    /*!
+    \brief Returns the number of pointclouds skipped, because the reader was too slow
+    */
+    uint64_t getNumSkipped(void) const { return m_num_skipped; }
+
+    /*!
+    \brief Returns the current system time in nanoseconds (same clock as SickScanShmCloudHeader::write_time_nsec)
+    */
+    static uint64_t systemTimeNanoSec(void);
+
+  protected:
+
+    size_t m_size;
+    SickScanShmRingHeader* m_ring;
+    uint64_t m_next_index;
+    uint64_t m_num_skipped;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_SHM_RING_H_ */
@@ -0,0 +1,105 @@
+/*
+ * @brief Thread pool with work stealing for data parallel loops
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 16.02.2021
+ *
+ */
+
+#ifndef SICK_SCAN_THREAD_POOL_H_
+#define SICK_SCAN_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sick_scan
+{
+  /*!
+  \brief Fixed size thread pool for data parallel loops. parallelFor() splits the tasks into one contiguous range per
+  thread. A thread which has finished its own range steals the remaining tasks of the other threads, i.e. the load is
+  balanced even if the tasks have different runtimes. The calling thread participates in the loop.
+  */
+  class SickScanThreadPool
+  {
+  public:
+
+    /*!
+    \param num_threads number of threads including the calling thread, i.e. num_threads - 1 workers are started
+    */
+    SickScanThreadPool(int num_threads);
+
+    ~SickScanThreadPool();
+
+    int numThreads(void) const { return (int)m_ranges.size(); }
+
+    /*!
+    \brief Runs task(0), task(1), ..., task(num_tasks - 1) in parallel and returns after all tasks have finished.
+    Tasks must write into disjoint memory. parallelFor() must not be called concurrently or recursively.
+    */
+    void parallelFor(size_t num_tasks, const std::function<void(size_t)>& task);
+
+    /*!
+    \brief Returns the number of tasks run by another than their initial thread
+    */
+    size_t getNumStolen(void) const { return m_num_stolen.load(); }
+
+  protected:
+
+    /*!
+    \brief Task range of a thread, padded to a cache line to avoid false sharing
+    */
+    struct alignas(64) TaskRange
+    {
+      std::atomic<size_t> next;
+      size_t end;
+    };
+
+    void runWorker(int thread_idx);
+
+    void runTasks(int thread_idx);
+
+    std::vector<TaskRange> m_ranges;           // task range of each thread
+    std::vector<std::thread> m_workers;
+    const std::function<void(size_t)>* m_task; // task of the current loop
+    std::mutex m_mutex;
+    std::condition_variable m_start_cond;      // signals a new loop to the workers
+    std::condition_variable m_finish_cond;     // signals the end of a loop to the caller
+    uint64_t m_generation;                     // incremented for each loop
+    int m_num_running;                         // number of workers running the current loop
+    bool m_shutdown;
+    std::atomic<size_t> m_num_stolen;
+  };
+
+} /* namespace sick_scan */
+#endif /* SICK_SCAN_THREAD_POOL_H_ */
@@ -1,6 +1,7 @@
 #ifndef TEMPLATE_QUEUE_H
 #define TEMPLATE_QUEUE_H
 
+#include <atomic>
 #include <queue>
 #include <boost/thread.hpp>
 #include <boost/chrono.hpp>
@@ -13,6 +14,10 @@ class Queue
 {
 public:
 
+  Queue() : numEntries_(0)
+  {
+  }
+
   /*!
   \brief get number of entries in queue
   \return Number of entries in queue
@@ -47,6 +52,24 @@ public:
     return (ret);
   }
 
+  /*!
+  \brief spins (polls without sleeping) for an incoming object, used before waitForIncomingObject() to avoid
+  the wakeup latency of the condition variable
+  \return true, if an object is available, false after spinTimeInUs microseconds
+  */
+  bool spinForIncomingObject(int spinTimeInUs)
+  {
+    boost::chrono::steady_clock::time_point endTime = boost::chrono::steady_clock::now() + boost::chrono::microseconds(spinTimeInUs);
+    do
+    {
+      if (numEntries_.load(std::memory_order_acquire) > 0)
+      {
+        return (true);
+      }
+    } while (boost::chrono::steady_clock::now() < endTime);
+    return (false);
+  }
+
   T pop()
   {
     boost::mutex::scoped_lock mlock(mutex_);
@@ -56,6 +79,7 @@ public:
     }
     T item = queue_.front();
     queue_.pop();
+    numEntries_.fetch_sub(1, std::memory_order_release);
     return item;
   }
 
@@ -68,12 +92,14 @@ public:
     }
     item = queue_.front();
     queue_.pop();
+    numEntries_.fetch_sub(1, std::memory_order_release);
   }
 
   void push(const T &item)
   {
     boost::mutex::scoped_lock mlock(mutex_);
     queue_.push(item);
+    numEntries_.fetch_add(1, std::memory_order_release);
     mlock.unlock();
     cond_.notify_one();
   }
@@ -82,6 +108,7 @@ public:
   {
     boost::mutex::scoped_lock mlock(mutex_);
     queue_.push(item);
+    numEntries_.fetch_add(1, std::memory_order_release);
     mlock.unlock();
     cond_.notify_one();
   }
@@ -90,6 +117,7 @@ private:
   std::queue<T> queue_;
   boost::mutex mutex_;
   boost::condition_variable cond_;
+  std::atomic<int> numEntries_; // number of entries, read without mutex by spinForIncomingObject()
 };
 
 #endif
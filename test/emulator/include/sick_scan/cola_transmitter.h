@@ -56,6 +56,8 @@
 #ifndef __SIM_LOC_COLA_TRANSMITTER_H_INCLUDED
 #define __SIM_LOC_COLA_TRANSMITTER_H_INCLUDED
 
+#include <functional>
+
 #include "sick_scan/client_socket.h"
 #include "sick_scan/fifo_buffer.h"
 
@@ -93,6 +95,13 @@ namespace sick_scan
      * @return always true
      */
     virtual bool close(void);
+
+    /*!
+     * Releases the send mutex of a socket. Call after closing a socket, so that a new socket at the same address
+     * gets a new mutex and the registry does not grow with each connection.
+     * @param[in] socket closed socket
+     */
+    static void releaseSocket(const boost::asio::ip::tcp::socket & socket);
   
     /*!
      * Send data to the localization server.
@@ -110,6 +119,30 @@ namespace sick_scan
      * @return true on success, false on failure
      */
     static bool send(boost::asio::ip::tcp::socket & socket, const std::vector<uint8_t> & data, ROS::Time & send_timestamp);
+
+    /*!
+     * Send data to the localization server.
+     * @param[in] socket socket to write to
+     * @param[in] data data to be send
+     * @param[in] size number of bytes to send
+     * @param[out] send_timestamp send timestamp in seconds (ros timestamp immediately before tcp send)
+     * @return true on success, false on failure
+     */
+    static bool send(boost::asio::ip::tcp::socket & socket, const uint8_t* data, size_t size, ROS::Time & send_timestamp);
+
+    /*!
+     * Send data to the localization server in fragments, i.e. with one tcp write per fragment. The fragments are
+     * written without interruption by other send calls to the same socket. Waiting before a fragment blocks other
+     * sends to the same socket only.
+     * @param[in] socket socket to write to
+     * @param[in] data data to be send
+     * @param[in] fragment_sizes number of bytes of each fragment, the sum of all fragment sizes is the size of data
+     * @param[in] wait_before_fragment called with index and size of each fragment before the fragment is written (f.e. to delay fragments)
+     * @param[out] send_timestamp send timestamp in seconds (ros timestamp immediately before the first tcp send)
+     * @return true on success, false on failure
+     */
+    static bool sendFragments(boost::asio::ip::tcp::socket & socket, const uint8_t* data, const std::vector<size_t> & fragment_sizes,
+      const std::function<void(size_t, size_t)> & wait_before_fragment, ROS::Time & send_timestamp);
     
     /*!
      * Receive a cola telegram from the localization server.
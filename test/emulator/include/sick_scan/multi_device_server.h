@@ -0,0 +1,246 @@
+/*
+ * @brief MultiDeviceServer emulates multiple devices and tcp clients in one event-driven process
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SICK_SCAN_MULTI_DEVICE_SERVER_H_INCLUDED
+#define __SICK_SCAN_MULTI_DEVICE_SERVER_H_INCLUDED
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/thread.hpp>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sick_scan/scandata_files.h"
+#include "sick_scan/scandata_generator.h"
+
+namespace sick_scan
+{
+  /*!
+   * class MultiDeviceServer emulates a fleet of devices in one process. Each virtual device listens on its own
+   * ip address and port, answers cola requests and sends scandata from its own source (synthetic device profile
+   * or scandata files) with its own device identity. All devices and tcp clients are served event-driven by
+   * a single thread running the boost::asio event loop, i.e. the number of devices is not limited by threads.
+   */
+  class MultiDeviceServer
+  {
+  public:
+
+    /*!
+     * class DeviceConfig: configuration of a virtual device
+     */
+    class DeviceConfig
+    {
+    public:
+      DeviceConfig() : ip_address("0.0.0.0"), port(2112), rate(-1), beams(-1), echos(-1), rssi(-1), encoders(-1), serial_number(0) {} ///< Constructor
+      std::string name;          ///< device name for log messages, default: "<ip_address>:<port>"
+      std::string ip_address;    ///< ip address to listen to, f.e. "127.0.0.2" (loopback), default: "0.0.0.0" (all interfaces)
+      int port;                  ///< tcp port for cola requests and scandata, default: 2112
+      std::string profile;       ///< device profile of synthetic scandata, f.e. "mrs6xxx", or empty to send scandata from files
+      std::string scandatafiles; ///< comma separated list of scandata files (jsonfiles, *.sdl, *.pcapng), if profile is empty
+      std::string scandatatypes; ///< comma separated list of scandata message types sent from scandata files
+      double rate;               ///< synthetic scandata: scans per second, -1: scan frequency of the profile, 0: as fast as possible
+      int beams;                 ///< synthetic scandata: number of beams per layer and echo, -1: profile
+      int echos;                 ///< synthetic scandata: number of echos, -1: profile
+      int rssi;                  ///< synthetic scandata: 1: with RSSI, 0: without RSSI, -1: profile
+      int encoders;              ///< synthetic scandata: number of encoder blocks, -1: profile
+      uint32_t serial_number;    ///< serial number in "sRA SerialNumber" responses and synthetic scandata, 0: default
+      std::string device_ident;  ///< device name in "sRA DeviceIdent" responses, default: profile name
+    };
+
+    /*!
+     * Parses a list of device configurations, f.e. "port=2112 profile=mrs6xxx serial=1001; port=2113 scandatafiles=tim781s.sdl".
+     * Devices are separated by ';', each device is a list of key=value pairs separated by spaces. Supported keys are
+     * name, ip, port, profile, scandatafiles, rate, beams, echos, rssi, encoders, serial and ident.
+     * @param[in] devices list of device configurations
+     * @param[in] defaults default configuration, used for all keys not given in devices
+     * @param[out] configs device configurations
+     * @return true on success, false on parse errors
+     */
+    static bool parseDeviceConfigs(const std::string & devices, const DeviceConfig & defaults, std::vector<DeviceConfig> & configs);
+
+    /*!
+     * Creates the configurations for a number of identical devices. The devices listen either to consecutive ports
+     * on the same ip address, or to the same port on consecutive ip addresses (f.e. 127.0.0.1, 127.0.0.2, ...).
+     * Serial numbers are numbered consecutively, starting with the serial number of the default configuration.
+     * @param[in] num_devices number of devices
+     * @param[in] consecutive_ip_addresses true: consecutive ip addresses, false: consecutive ports
+     * @param[in] defaults configuration of the first device
+     * @param[out] configs device configurations
+     */
+    static void createDeviceConfigs(int num_devices, bool consecutive_ip_addresses, const DeviceConfig & defaults, std::vector<DeviceConfig> & configs);
+
+    /*!
+     * Constructor. The server does not start automatically, call start() and stop() to start and stop the server.
+     * @param[in] configs device configurations
+     * @param[in] start_scandata_delay delay between scandata activation ("LMCstartmeas" request) and first scandata message in seconds
+     */
+    MultiDeviceServer(const std::vector<DeviceConfig> & configs, double start_scandata_delay = 1);
+
+    /*!
+     * Destructor. Stops the server and closes all tcp connections.
+     */
+    virtual ~MultiDeviceServer();
+
+    /*!
+     * Opens the listening sockets of all devices and starts the event loop thread.
+     * @return true on success, false on failure (f.e. ip address or port not available).
+     */
+    virtual bool start(void);
+
+    /*!
+     * Stops the event loop thread and closes all tcp connections.
+     * @return true on success, false on failure.
+     */
+    virtual bool stop(void);
+
+  protected:
+
+    class Session;
+    typedef std::shared_ptr<Session> SessionPtr; ///< shortcut for shared pointer to a tcp client session
+
+    /*!
+     * class VirtualDevice: listening socket, scandata source and statistics of a virtual device
+     */
+    class VirtualDevice
+    {
+    public:
+      VirtualDevice(boost::asio::io_service & ioservice, const DeviceConfig & _config) : config(_config), acceptor(ioservice), synthetic(false),
+        num_telegrams(0), num_bytes(0), num_dropped(0) {} ///< Constructor
+      DeviceConfig config;                                  ///< device configuration
+      boost::asio::ip::tcp::acceptor acceptor;              ///< listening socket
+      bool synthetic;                                       ///< true: synthetic scandata, false: scandata from files
+      sick_scan::ScandataGenerator::DeviceProfile profile;  ///< device profile of synthetic scandata
+      std::shared_ptr<sick_scan::ScandataFiles> scandata_files; ///< scandata from files (shared by all devices with the same files)
+      std::list<SessionPtr> sessions;                       ///< connected tcp clients
+      uint64_t num_telegrams;                               ///< number of scandata telegrams sent
+      uint64_t num_bytes;                                   ///< number of scandata bytes sent
+      uint64_t num_dropped;                                 ///< number of scandata telegrams dropped (previous telegram not yet sent)
+    };
+
+    /*!
+     * class Session: connection to a tcp client. Receives cola requests, sends responses and scandata.
+     * All callbacks run in the event loop thread.
+     */
+    class Session : public std::enable_shared_from_this<Session>
+    {
+    public:
+      Session(boost::asio::io_service & ioservice, VirtualDevice* device, double start_scandata_delay); ///< Constructor
+      void start(void);                  ///< starts to receive cola requests
+      void close(void);                  ///< closes the connection
+      boost::asio::ip::tcp::socket socket; ///< tcp socket
+    protected:
+      class SendBuffer
+      {
+      public:
+        SendBuffer(const uint8_t* _data = 0, size_t _size = 0, bool _scandata = false) : data(_data), size(_size), scandata(_scandata) {} ///< Constructor
+        std::vector<uint8_t> buffer; ///< owned data (cola responses)
+        const uint8_t* data;         ///< data to send, points to buffer or to scandata
+        size_t size;                 ///< number of bytes to send
+        bool scandata;               ///< true: scandata telegram, false: cola response
+      };
+      void receive(void);                                     ///< starts an asynchronous read
+      void handleRequest(const std::vector<uint8_t> & request); ///< decodes a cola request and sends the response
+      void send(const SendBuffer & send_buffer);              ///< queues data to send
+      void sendNext(void);                                    ///< starts an asynchronous write of the next queued data
+      void startScandata(void);                               ///< starts sending scandata after the start delay
+      void sendScandata(void);                                ///< sends the next scandata telegram and schedules the next one
+      VirtualDevice* m_device;                                ///< the emulated device
+      double m_start_scandata_delay;                          ///< delay between "LMCstartmeas" request and first scandata message in seconds
+      std::vector<uint8_t> m_receive_chunk;                   ///< buffer for asynchronous reads
+      std::vector<uint8_t> m_receive_buffer;                  ///< received bytes not yet decoded
+      std::deque<SendBuffer> m_send_queue;                    ///< data to send, front is currently written
+      bool m_scandata_enabled;                                ///< true after "LMCstartmeas", false after "LMCstopmeas"
+      bool m_scandata_in_flight;                              ///< true while a scandata telegram is written
+      boost::asio::steady_timer m_scandata_timer;             ///< timer for the next scandata telegram
+      boost::asio::steady_timer::time_point m_scandata_deadline; ///< deadline of the next scandata telegram
+      std::shared_ptr<sick_scan::ScandataGenerator> m_generator; ///< synthetic scandata generator
+      std::chrono::steady_clock::time_point m_start_time;    ///< start time of the session (device time for synthetic scandata)
+      int m_frame_idx;                                        ///< index of the next scandata frame from files
+      int m_frame_delta;                                      ///< +1 or -1 (frames are sent forth and back, as TestServerThread does)
+    };
+
+    /*!
+     * Accepts the next tcp client of a device
+     * @param[in] device virtual device
+     */
+    void accept(VirtualDevice* device);
+
+    /*!
+     * Logs the statistics (telegrams and bytes sent) once per second
+     */
+    void logStatistics(void);
+
+    /*
+     * member data
+     */
+
+    boost::asio::io_service m_ioservice;                   ///< event loop for all devices and sessions
+    std::shared_ptr<boost::asio::io_service::work> m_ioservice_work; ///< keeps the event loop running
+    boost::thread* m_ioservice_thread;                     ///< event loop thread
+    std::vector<std::shared_ptr<VirtualDevice> > m_devices; ///< all virtual devices
+    double m_start_scandata_delay;                         ///< delay between "LMCstartmeas" request and first scandata message in seconds
+    boost::asio::steady_timer m_statistics_timer;          ///< timer to log statistics
+    uint64_t m_statistics_num_telegrams;                   ///< number of telegrams sent at the last statistics log
+    uint64_t m_statistics_num_bytes;                       ///< number of bytes sent at the last statistics log
+
+  }; // class MultiDeviceServer
+
+} // namespace sick_scan
+#endif // __SICK_SCAN_MULTI_DEVICE_SERVER_H_INCLUDED
@@ -0,0 +1,123 @@
+/*
+ * @brief ScandataFiles reads scandata messages from jsonfiles, binary scandata files
+ * and network captures for the emulator.
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SICK_SCAN_SCANDATA_FILES_H_INCLUDED
+#define __SICK_SCAN_SCANDATA_FILES_H_INCLUDED
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "sick_scan/pcapng_json_parser.h"
+#include "sick_scan/sick_scan_datagram_log.h"
+
+namespace sick_scan
+{
+  /*!
+   * class ScandataFiles reads scandata messages from jsonfiles, binary scandata files (*.sdl, memory mapped)
+   * and network captures (*.pcapng, *.pcap). The messages are provided as frames pointing to the binary
+   * cola data, which is owned by the ScandataFiles instance, i.e. frames are valid until the instance is destroyed.
+   */
+  class ScandataFiles
+  {
+  public:
+
+    /*!
+     * class ScandataFrame: utility container for a scandata message to send (pointer to the binary cola data plus timestamp)
+     */
+    class ScandataFrame
+    {
+    public:
+      ScandataFrame(double _timestamp = 0, const uint8_t* _data = 0, size_t _size = 0) : timestamp(_timestamp), data(_data), size(_size) {} ///< Constructor
+      double timestamp;    ///< relative timestamp in seconds
+      const uint8_t* data; ///< binary cola data 0x02020202....
+      size_t size;         ///< number of bytes
+    };
+
+    /*!
+     * Reads scandata messages from a list of files. Timestamps of all files are concatenated.
+     * @param[in] scandatafiles comma separated list of jsonfiles, binary scandata files (*.sdl) or network captures (*.pcapng, *.pcap)
+     * @param[in] scandatatypes comma separated list of scandata message types, f.e. "sSN LMDscandata,sSN LMDscandatamon"
+     * @return true on success (at least one message read), false otherwise
+     */
+    bool read(const std::string & scandatafiles, const std::string & scandatatypes);
+
+    /*!
+     * Returns all scandata messages
+     */
+    const std::vector<ScandataFrame> & frames(void) const { return m_frames; }
+
+    /*!
+     * Returns true, if a cola message has one of the given types (f.e. "sSN LMDscandata"), or if scandatatypes is empty.
+     * @param[in] data binary cola message
+     * @param[in] size number of bytes
+     * @param[in] scandatatypes list of scandata message types
+     */
+    static bool isScandataType(const uint8_t* data, size_t size, const std::vector<std::string> & scandatatypes);
+
+  protected:
+
+    /*
+     * member data
+     */
+
+    std::list<std::vector<sick_scan::JsonScanData> > m_json_messages;   ///< scandata messages parsed from jsonfiles and network captures
+    std::list<sick_scan::SickScanDatagramLogMapping> m_scandata_mappings; ///< memory mapped binary scandata files
+    std::vector<ScandataFrame> m_frames;                                ///< all scandata messages
+
+  }; // class ScandataFiles
+
+} // namespace sick_scan
+#endif // __SICK_SCAN_SCANDATA_FILES_H_INCLUDED
@@ -0,0 +1,161 @@
+/*
+ * @brief scandata_generator synthesizes LMDscandata telegrams for device profiles.
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SICK_SCAN_SCANDATA_GENERATOR_H_INCLUDED
+#define __SICK_SCAN_SCANDATA_GENERATOR_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace sick_scan
+{
+  /*!
+   * class ScandataGenerator synthesizes Cola-Binary "sSN LMDscandata" telegrams for configurable device profiles
+   * (number of layers, beams, echos, RSSI and encoder blocks). The telegrams of all layers are encoded once;
+   * nextTelegram() only updates counters, timestamps, ranges and checksum, i.e. telegrams can be generated at
+   * rates up to the link saturation.
+   */
+  class ScandataGenerator
+  {
+  public:
+
+    /*!
+     * class DeviceProfile describes the scandata telegrams of a device
+     */
+    class DeviceProfile
+    {
+    public:
+      DeviceProfile() : num_layers(1), num_beams(811), num_echos(1), rssi(true), rssi_8bit(false), num_encoders(0),
+        start_angle_deg(-45), angular_step_deg(1.0/3.0), scan_frequency(15), serial_number(12345678) {}
+      std::string name;         ///< name of the profile, f.e. "tim7xx"
+      int num_layers;           ///< number of layers (1, 4 or 24)
+      int num_beams;            ///< number of beams per layer and echo
+      int num_echos;            ///< number of echos (1 up to 5)
+      bool rssi;                ///< true: RSSI channels transmitted (one per echo)
+      bool rssi_8bit;           ///< true: 8 bit RSSI channels, false: 16 bit RSSI channels
+      int num_encoders;         ///< number of encoder blocks (0 up to 4)
+      double start_angle_deg;   ///< angle of the first beam in degree (scanner coordinates)
+      double angular_step_deg;  ///< angular resolution in degree
+      double scan_frequency;    ///< number of complete scans (all layers) per second
+      uint32_t serial_number;   ///< serial number of the device
+    };
+
+    /*!
+     * Returns the predefined device profile of a given name
+     * @param[in] name profile name, see deviceProfileNames()
+     * @param[out] profile device profile
+     * @return true on success, false if name is unknown
+     */
+    static bool getDeviceProfile(const std::string & name, DeviceProfile & profile);
+
+    /*!
+     * Returns the names of all predefined device profiles (comma separated)
+     */
+    static std::string deviceProfileNames(void);
+
+    /*!
+     * ScandataGenerator constructor
+     * @param[in] profile device profile
+     */
+    ScandataGenerator(const DeviceProfile & profile);
+
+    /*!
+     * Returns the next scandata telegram. Layers are sent one after another, each scan starts with the uppermost layer.
+     * The returned telegram is valid until the next call of nextTelegram().
+     * @param[in] time_since_startup_usec device time in microseconds (TimeSinceStartup and TimeOfTransmission)
+     * @return Cola-Binary telegram (incl. 0x02020202 header, length and checksum)
+     */
+    const std::vector<uint8_t> & nextTelegram(uint32_t time_since_startup_usec);
+
+    /*!
+     * Returns the number of telegrams per second at the scan frequency of the profile
+     */
+    double telegramRate(void) const { return m_profile.scan_frequency * m_profile.num_layers; }
+
+    /*!
+     * Returns the device profile
+     */
+    const DeviceProfile & profile(void) const { return m_profile; }
+
+    /*!
+     * Returns the elevation angle of a layer in 1/200 degree as sent in the LayerAngle field
+     */
+    static int16_t layerAngleX200(int num_layers, int layer);
+
+  protected:
+
+    /*!
+     * Encodes the telegram template of a layer
+     */
+    void encodeTemplate(int layer, std::vector<uint8_t> & telegram);
+
+    /*
+     * member data
+     */
+
+    DeviceProfile m_profile;                          ///< device profile
+    std::vector<std::vector<uint8_t> > m_telegrams;   ///< telegram of each layer
+    std::vector<size_t> m_dist_offsets;               ///< offset of the data of each DIST channel in a telegram
+    std::vector<size_t> m_rssi_offsets;               ///< offset of the data of each RSSI channel in a telegram
+    size_t m_encoder_offset;                          ///< offset of the first encoder block in a telegram
+    std::vector<uint16_t> m_scene;                    ///< synthetic ranges in millimeter, 2 * num_beams values
+    uint32_t m_telegram_counter;                      ///< number of telegrams generated
+    uint32_t m_scan_counter;                          ///< number of scans generated
+    int m_layer;                                      ///< layer of the next telegram
+
+  }; // class ScandataGenerator
+
+} // namespace sick_scan
+#endif // __SICK_SCAN_SCANDATA_GENERATOR_H_INCLUDED
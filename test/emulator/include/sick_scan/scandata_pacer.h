@@ -0,0 +1,121 @@
+/*
+ * @brief scandata_pacer sends telegrams at precise rates.
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SICK_SCAN_SCANDATA_PACER_H_INCLUDED
+#define __SICK_SCAN_SCANDATA_PACER_H_INCLUDED
+
+#include <stdint.h>
+
+namespace sick_scan
+{
+  /*!
+   * class ScandataPacer paces telegrams at a given rate. It sleeps until shortly before the next deadline
+   * (timerfd on Linux, otherwise a thread sleep) and busy-waits for the remaining time, i.e. pacing is precise
+   * to a few microseconds at any rate up to the link saturation, without spinning the whole period.
+   */
+  class ScandataPacer
+  {
+  public:
+
+    /*!
+     * ScandataPacer constructor
+     * @param[in] rate number of telegrams per second, rate <= 0: no pacing (send as fast as possible)
+     * @param[in] spin_usec busy-wait time in microseconds before each deadline, default: 100 microseconds
+     */
+    ScandataPacer(double rate = 0, double spin_usec = 100);
+
+    /*!
+     * ScandataPacer destructor
+     */
+    ~ScandataPacer();
+
+    /*!
+     * Sets the rate and restarts the pacing
+     * @param[in] rate number of telegrams per second, rate <= 0: no pacing (send as fast as possible)
+     */
+    void setRate(double rate);
+
+    /*!
+     * Waits until the deadline of the next telegram. Deadlines are absolute, i.e. jitter does not accumulate.
+     * If the caller is more than 1 second behind the schedule, the schedule is restarted.
+     * @return delay of the current telegram against its deadline in nanoseconds (0: in time)
+     */
+    uint64_t wait(void);
+
+    /*!
+     * Returns the number of telegrams which missed their deadline by more than one period
+     */
+    uint64_t numLate(void) const { return m_num_late; }
+
+    /*!
+     * Returns the current time of the monotonic clock in nanoseconds
+     */
+    static uint64_t nowNanoSec(void);
+
+  protected:
+
+    /*
+     * member data
+     */
+
+    uint64_t m_period_nsec;    ///< time between two telegrams in nanoseconds, 0: no pacing
+    uint64_t m_spin_nsec;      ///< busy-wait time before each deadline in nanoseconds
+    uint64_t m_next_deadline;  ///< deadline of the next telegram (monotonic clock in nanoseconds)
+    uint64_t m_num_late;       ///< number of telegrams later than one period
+    int m_timer_fd;            ///< timerfd for sleeps until shortly before the deadline (Linux only), or -1
+
+  }; // class ScandataPacer
+
+} // namespace sick_scan
+#endif // __SICK_SCAN_SCANDATA_PACER_H_INCLUDED
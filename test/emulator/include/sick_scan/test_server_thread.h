@@ -69,6 +69,7 @@
 #include <list>
 
 #include "sick_scan/fifo_buffer.h"
+#include "sick_scan/transport_impairment.h"
 #include "sick_scan/utils.h"
 
 namespace sick_scan
@@ -193,6 +194,13 @@ namespace sick_scan
      * @param[in] p_socket socket to sends scandata and scandatamon messages the tcp client
      */
     virtual void runWorkerThreadScandataCb(boost::asio::ip::tcp::socket* p_socket);
+
+    /*!
+     * Sends synthetic scandata telegrams of device profile m_synthetic_scandata_profile to the tcp client
+     * while m_tcp_send_scandata_thread_running is true.
+     * @param[in] p_socket socket to send scandata telegrams to the tcp client
+     */
+    virtual void runSyntheticScandata(boost::asio::ip::tcp::socket* p_socket);
   
     /*!
      * Thread callback, runs an error simulation and switches m_error_simulation_flag through the error test cases.
@@ -236,8 +244,15 @@ namespace sick_scan
     sick_scan::SickLocResultPortTestcaseMsgPublisher m_result_testcases_publisher;  ///< ros publisher for testcases with result port telegrams (type SickLocResultPortTestcaseMsg)
     std::string m_result_testcases_frame_id;                 ///< ros frame id of testcase messages (type SickLocResultPortTestcaseMsg), default: "result_testcases"
     bool m_demo_move_in_circles;                             ///< true: simulate a sensor moving in circles, false (default): create random based result port telegrams
-    std::string m_scandatafiles;                             ///< comma separated list of jsonfiles to emulate scandata messages, f.e. "tim781s_scandata.pcapng.json,tim781s_sopas.pcapng.json"
+    std::string m_scandatafiles;                             ///< comma separated list of jsonfiles, binary scandata files (*.sdl) or network captures (*.pcapng, *.pcap) to emulate scandata messages, f.e. "tim781s_scandata.pcapng.json,tim781s_sopas.pcapng.json"
     std::string m_scandatatypes;                             ///< comma separated list of scandata message types, f.e. "sSN LMDscandata,sSN LMDscandatamon"
+    std::string m_synthetic_scandata_profile;                ///< device profile of synthetic scandata, f.e. "mrs6xxx", default: "" (send scandata from m_scandatafiles)
+    double m_synthetic_scandata_rate;                        ///< scans per second of synthetic scandata, 0: as fast as possible (link saturation), default: -1 (scan frequency of the profile)
+    int m_synthetic_scandata_beams;                          ///< number of beams per layer of synthetic scandata, default: -1 (profile)
+    int m_synthetic_scandata_echos;                          ///< number of echos of synthetic scandata, default: -1 (profile)
+    int m_synthetic_scandata_rssi;                           ///< synthetic scandata with (1) or without (0) RSSI channels, default: -1 (profile)
+    int m_synthetic_scandata_encoders;                       ///< number of encoder blocks of synthetic scandata, default: -1 (profile)
+    sick_scan::TransportImpairment::Profile m_impairment_profile; ///< transport impairments of the scandata stream, default: none
 
     /*
      * configuration and member data for error simulation
@@ -0,0 +1,174 @@
+/*
+ * @brief TransportImpairment emulates an impaired network link (fragmentation, bursts, jitter, bandwidth limit, garbage)
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SICK_SCAN_TRANSPORT_IMPAIRMENT_H_INCLUDED
+#define __SICK_SCAN_TRANSPORT_IMPAIRMENT_H_INCLUDED
+
+#include <boost/asio/ip/tcp.hpp>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "sick_scan/ros_wrapper.h"
+
+namespace sick_scan
+{
+  /*!
+   * class TransportImpairment emulates an impaired network link between device and driver. Scandata telegrams are
+   * written in fragments at random byte boundaries, held back and coalesced with the following telegrams, delayed
+   * by random jitter, throttled to a max. bandwidth and separated by garbage bytes. The impairments are random,
+   * but reproducible with a given seed, i.e. the framing, queueing and timestamping of the driver can be benchmarked
+   * and regression-tested under realistic Ethernet or WiFi conditions.
+   */
+  class TransportImpairment
+  {
+  public:
+
+    /*!
+     * class Profile configures the impairments
+     */
+    class Profile
+    {
+    public:
+      Profile() : fragment_probability(0), max_fragments(1), fragment_delay_usec(0), burst_size(1), delay_probability(0), max_delay_usec(0),
+        bandwidth(0), garbage_probability(0), max_garbage_bytes(0), seed(0) {} ///< Constructor, default: no impairments
+      std::string name;            ///< profile name
+      double fragment_probability; ///< probability of a telegram being written in fragments
+      int max_fragments;           ///< max. number of fragments per telegram
+      double fragment_delay_usec;  ///< delay between two fragments in microseconds
+      int burst_size;              ///< number of telegrams coalesced and written in one burst, 1: no bursts
+      double delay_probability;    ///< probability of a telegram being held back and written together with the next telegram
+      double max_delay_usec;       ///< max. random delay (jitter) before a write in microseconds
+      double bandwidth;            ///< max. bandwidth in MB per second, 0: unlimited
+      double garbage_probability;  ///< probability of garbage bytes in front of a telegram
+      int max_garbage_bytes;       ///< max. number of garbage bytes in front of a telegram
+      uint32_t seed;               ///< seed of the random generator, 0: random seed
+    };
+
+    /*!
+     * Returns the profile of a given name
+     * @param[in] name profile name: "none", "fragmented", "ethernet", "wifi", "congested" or "garbage"
+     * @param[out] profile impairment profile
+     * @return true on success, false if the profile name is unknown
+     */
+    static bool getProfile(const std::string & name, Profile & profile);
+
+    /*!
+     * Returns a comma separated list of all profile names
+     */
+    static std::string profileNames(void);
+
+    /*!
+     * TransportImpairment constructor
+     * @param[in] profile impairments
+     */
+    TransportImpairment(const Profile & profile = Profile());
+
+    /*!
+     * Returns true, if any impairment is configured, or false otherwise (telegrams are sent unchanged)
+     */
+    bool active(void) const;
+
+    /*!
+     * Sends a telegram with impairments. Telegrams held back for a burst or delayed telegrams are not sent
+     * immediately, but together with a following telegram.
+     * @param[in] socket socket to write to
+     * @param[in] data telegram
+     * @param[in] size number of bytes of the telegram
+     * @param[out] send_timestamp send timestamp (ros timestamp immediately before the first tcp write)
+     * @return true on success, false on failure
+     */
+    bool send(boost::asio::ip::tcp::socket & socket, const uint8_t* data, size_t size, ROS::Time & send_timestamp);
+
+  protected:
+
+    /*!
+     * Logs the number of impaired telegrams since the last log
+     */
+    void logStatistics(void);
+
+    /*!
+     * Returns true with the given probability
+     */
+    bool randomEvent(double probability);
+
+    /*!
+     * Waits until the throttled link can send the next bytes, or after a fragment delay
+     * @param[in] fragment_idx index of the next fragment (delay between fragments if fragment_idx > 0)
+     * @param[in] fragment_size size of the next fragment in byte
+     */
+    void waitBeforeFragment(size_t fragment_idx, size_t fragment_size);
+
+    /*
+     * member data
+     */
+
+    Profile m_profile;                   ///< configured impairments
+    std::mt19937 m_random_engine;        ///< random generator
+    std::vector<uint8_t> m_pending;      ///< telegrams held back for the next write
+    int m_num_pending;                   ///< number of telegrams in m_pending
+    uint64_t m_link_free_time;           ///< throttled link: time in nanoseconds when the link has sent all bytes
+    bool m_nodelay;                      ///< true after tcp_nodelay has been set, i.e. fragments are sent in separate tcp segments
+    uint64_t m_statistics_time;          ///< time of the last statistics log in nanoseconds
+    uint64_t m_num_telegrams;            ///< statistics: number of telegrams
+    uint64_t m_num_fragmented;           ///< statistics: number of telegrams sent in fragments
+    uint64_t m_num_coalesced;            ///< statistics: number of telegrams held back and coalesced with following telegrams
+    uint64_t m_num_garbage_bytes;        ///< statistics: number of garbage bytes
+    uint64_t m_max_throttle_usec;        ///< statistics: max. delay by bandwidth limit in microseconds
+
+  }; // class TransportImpairment
+
+} // namespace sick_scan
+#endif // __SICK_SCAN_TRANSPORT_IMPAIRMENT_H_INCLUDED
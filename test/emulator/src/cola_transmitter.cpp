@@ -54,6 +54,8 @@
  *
  */
 
+#include <map>
+#include <memory>
 #include <thread>
 #include <mutex>
 
@@ -63,7 +65,37 @@
 #include "sick_scan/cola_transmitter.h"
 #include "sick_scan/utils.h"
 
-static std::mutex s_ColaTransmitterSendMutex; // mutex to lock ColaTransmitter::send
+static std::mutex s_socket_mutex_map_lock; // protects s_socket_mutex_map
+static std::map<const boost::asio::ip::tcp::socket*, std::shared_ptr<std::mutex>> s_socket_mutex_map; // send mutex of all open sockets
+
+/*!
+ * Returns the mutex to lock ColaTransmitter::send and ColaTransmitter::sendFragments for a given socket. Sends to the
+ * same socket are serialized, sends to different sockets (f.e. delayed or throttled fragments) do not block each other.
+ * The mutex is registered until the socket is released by ColaTransmitter::releaseSocket(). Callers hold the returned
+ * shared pointer while sending, so releasing a socket never destroys a mutex in use. Closed sockets are not registered.
+ */
+static std::shared_ptr<std::mutex> socketSendMutex(const boost::asio::ip::tcp::socket & socket)
+{
+  std::lock_guard<std::mutex> map_lock_guard(s_socket_mutex_map_lock);
+  std::map<const boost::asio::ip::tcp::socket*, std::shared_ptr<std::mutex>>::iterator socket_mutex = s_socket_mutex_map.find(&socket);
+  if (socket_mutex != s_socket_mutex_map.end())
+    return socket_mutex->second;
+  std::shared_ptr<std::mutex> new_socket_mutex = std::make_shared<std::mutex>();
+  if (socket.is_open())
+    s_socket_mutex_map[&socket] = new_socket_mutex;
+  return new_socket_mutex;
+}
+
+/*!
+ * Releases the send mutex of a socket. Call after closing a socket, so that a new socket at the same address
+ * gets a new mutex and the registry does not grow with each connection.
+ * @param[in] socket closed socket
+ */
+void sick_scan::ColaTransmitter::releaseSocket(const boost::asio::ip::tcp::socket & socket)
+{
+  std::lock_guard<std::mutex> map_lock_guard(s_socket_mutex_map_lock);
+  s_socket_mutex_map.erase(&socket);
+}
 
 /*!
  * Constructor.
@@ -106,6 +138,7 @@ bool sick_scan::ColaTransmitter::close(void)
   try
   {
     m_tcp_socket.close();
+    releaseSocket(m_tcp_socket.socket());
     m_ioservice.stop();
     return true;
   }
@@ -136,17 +169,31 @@ bool sick_scan::ColaTransmitter::send(const std::vector<uint8_t> & data, ROS::Ti
  */
 bool sick_scan::ColaTransmitter::send(boost::asio::ip::tcp::socket & socket, const std::vector<uint8_t> & data, ROS::Time & send_timestamp)
 {
-  std::lock_guard<std::mutex> send_lock_guard(s_ColaTransmitterSendMutex);
+  return send(socket, data.data(), data.size(), send_timestamp);
+}
+
+/*!
+ * Send data to the localization server.
+ * @param[in] socket socket to write to
+ * @param[in] data data to be send
+ * @param[in] size number of bytes to send
+ * @param[out] send_timestamp send timestamp in seconds (ros timestamp immediately before tcp send)
+ * @return true on success, false on failure
+ */
+bool sick_scan::ColaTransmitter::send(boost::asio::ip::tcp::socket & socket, const uint8_t* data, size_t size, ROS::Time & send_timestamp)
+{
+  std::shared_ptr<std::mutex> send_mutex = socketSendMutex(socket);
+  std::lock_guard<std::mutex> send_lock_guard(*send_mutex);
   try
   {
     if (ROS::ok() && socket.is_open())
     {
       boost::system::error_code errorcode;
       send_timestamp = ROS::now();
-      size_t bytes_written = boost::asio::write(socket, boost::asio::buffer(data.data(), data.size()), boost::asio::transfer_exactly(data.size()), errorcode);
-      if (!errorcode && bytes_written == data.size())
+      size_t bytes_written = boost::asio::write(socket, boost::asio::buffer(data, size), boost::asio::transfer_exactly(size), errorcode);
+      if (!errorcode && bytes_written == size)
         return true;
-      ROS_WARN_STREAM("## ERROR ColaTransmitter::send: tcp socket write error, " << bytes_written << " of " << data.size() << " bytes written, errorcode " << errorcode.value() << " \"" << errorcode.message() << "\"");
+      ROS_WARN_STREAM("## ERROR ColaTransmitter::send: tcp socket write error, " << bytes_written << " of " << size << " bytes written, errorcode " << errorcode.value() << " \"" << errorcode.message() << "\"");
     }
   }
   catch(std::exception & exc)
@@ -156,6 +203,50 @@ bool sick_scan::ColaTransmitter::send(boost::asio::ip::tcp::socket & socket, con
   return false;
 }
 
+/*!
+ * Send data to the localization server in fragments, i.e. with one tcp write per fragment. The fragments are
+ * written without interruption by other send calls to the same socket. Waiting before a fragment blocks other
+ * sends to the same socket only.
+ * @param[in] socket socket to write to
+ * @param[in] data data to be send
+ * @param[in] fragment_sizes number of bytes of each fragment, the sum of all fragment sizes is the size of data
+ * @param[in] wait_before_fragment called with index and size of each fragment before the fragment is written (f.e. to delay fragments)
+ * @param[out] send_timestamp send timestamp in seconds (ros timestamp immediately before the first tcp send)
+ * @return true on success, false on failure
+ */
+bool sick_scan::ColaTransmitter::sendFragments(boost::asio::ip::tcp::socket & socket, const uint8_t* data, const std::vector<size_t> & fragment_sizes,
+  const std::function<void(size_t, size_t)> & wait_before_fragment, ROS::Time & send_timestamp)
+{
+  std::shared_ptr<std::mutex> send_mutex = socketSendMutex(socket);
+  std::lock_guard<std::mutex> send_lock_guard(*send_mutex);
+  try
+  {
+    for(size_t fragment_idx = 0, offset = 0; fragment_idx < fragment_sizes.size(); offset += fragment_sizes[fragment_idx], fragment_idx++)
+    {
+      if (!ROS::ok() || !socket.is_open())
+        return false;
+      size_t size = fragment_sizes[fragment_idx];
+      if (wait_before_fragment)
+        wait_before_fragment(fragment_idx, size);
+      boost::system::error_code errorcode;
+      if (fragment_idx == 0)
+        send_timestamp = ROS::now();
+      size_t bytes_written = boost::asio::write(socket, boost::asio::buffer(data + offset, size), boost::asio::transfer_exactly(size), errorcode);
+      if (errorcode || bytes_written != size)
+      {
+        ROS_WARN_STREAM("## ERROR ColaTransmitter::sendFragments: tcp socket write error, " << bytes_written << " of " << size << " bytes written, errorcode " << errorcode.value() << " \"" << errorcode.message() << "\"");
+        return false;
+      }
+    }
+    return true;
+  }
+  catch(std::exception & exc)
+  {
+    ROS_WARN_STREAM("## ERROR ColaTransmitter::sendFragments(): exception " << exc.what());
+  }
+  return false;
+}
+
 /*!
  * Receive a cola telegram from the localization server.
  * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
@@ -0,0 +1,604 @@
+/*
+ * @brief MultiDeviceServer emulates multiple devices and tcp clients in one event-driven process
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include "sick_scan/ros_wrapper.h"
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#include "sick_scan/cola_converter.h"
+#include "sick_scan/cola_parser.h"
+#include "sick_scan/multi_device_server.h"
+#include "sick_scan/pcapng_json_parser.h"
+#include "sick_scan/testcase_generator.h"
+
+/*!
+ * Mutex to protect the static response tables and controller settings of TestcaseGenerator::createColaResponse()
+ */
+static boost::mutex s_create_cola_response_mutex;
+
+/*!
+ * Parses a list of device configurations, f.e. "port=2112 profile=mrs6xxx serial=1001; port=2113 scandatafiles=tim781s.sdl".
+ * Devices are separated by ';', each device is a list of key=value pairs separated by spaces. Supported keys are
+ * name, ip, port, profile, scandatafiles, rate, beams, echos, rssi, encoders, serial and ident.
+ * @param[in] devices list of device configurations
+ * @param[in] defaults default configuration, used for all keys not given in devices
+ * @param[out] configs device configurations
+ * @return true on success, false on parse errors
+ */
+bool sick_scan::MultiDeviceServer::parseDeviceConfigs(const std::string & devices, const DeviceConfig & defaults, std::vector<DeviceConfig> & configs)
+{
+  std::vector<std::string> device_list = sick_scan::PcapngJsonParser::split(devices, ';');
+  for(size_t device_cnt = 0; device_cnt < device_list.size(); device_cnt++)
+  {
+    DeviceConfig config = defaults;
+    std::istringstream key_value_stream(device_list[device_cnt]);
+    std::string key_value;
+    int num_keys = 0;
+    while(key_value_stream >> key_value)
+    {
+      size_t sep = key_value.find('=');
+      if(sep == std::string::npos || sep == 0)
+      {
+        ROS_ERROR_STREAM("## ERROR MultiDeviceServer: invalid device configuration \"" << key_value << "\", expected key=value");
+        return false;
+      }
+      std::string key = key_value.substr(0, sep), value = key_value.substr(sep + 1);
+      if(key == "name")
+        config.name = value;
+      else if(key == "ip")
+        config.ip_address = value;
+      else if(key == "port")
+        config.port = std::atoi(value.c_str());
+      else if(key == "profile")
+        config.profile = value;
+      else if(key == "scandatafiles")
+        config.scandatafiles = value;
+      else if(key == "rate")
+        config.rate = std::atof(value.c_str());
+      else if(key == "beams")
+        config.beams = std::atoi(value.c_str());
+      else if(key == "echos")
+        config.echos = std::atoi(value.c_str());
+      else if(key == "rssi")
+        config.rssi = std::atoi(value.c_str());
+      else if(key == "encoders")
+        config.encoders = std::atoi(value.c_str());
+      else if(key == "serial")
+        config.serial_number = (uint32_t)std::strtoul(value.c_str(), 0, 10);
+      else if(key == "ident")
+        config.device_ident = value;
+      else
+      {
+        ROS_ERROR_STREAM("## ERROR MultiDeviceServer: unknown key \"" << key << "\" in device configuration");
+        return false;
+      }
+      num_keys++;
+    }
+    if(num_keys > 0)
+      configs.push_back(config);
+  }
+  return true;
+}
+
+/*!
+ * Creates the configurations for a number of identical devices. The devices listen either to consecutive ports
+ * on the same ip address, or to the same port on consecutive ip addresses (f.e. 127.0.0.1, 127.0.0.2, ...).
+ * Serial numbers are numbered consecutively, starting with the serial number of the default configuration.
+ * @param[in] num_devices number of devices
+ * @param[in] consecutive_ip_addresses true: consecutive ip addresses, false: consecutive ports
+ * @param[in] defaults configuration of the first device
+ * @param[out] configs device configurations
+ */
+void sick_scan::MultiDeviceServer::createDeviceConfigs(int num_devices, bool consecutive_ip_addresses, const DeviceConfig & defaults, std::vector<DeviceConfig> & configs)
+{
+  boost::system::error_code error_code;
+  boost::asio::ip::address_v4 ip_address = boost::asio::ip::address_v4::from_string(defaults.ip_address, error_code);
+  for(int device_cnt = 0; device_cnt < num_devices; device_cnt++)
+  {
+    DeviceConfig config = defaults;
+    if(consecutive_ip_addresses)
+      config.ip_address = boost::asio::ip::address_v4((uint32_t)ip_address.to_ulong() + device_cnt).to_string();
+    else
+      config.port = defaults.port + device_cnt;
+    if(defaults.serial_number > 0)
+      config.serial_number = defaults.serial_number + device_cnt;
+    configs.push_back(config);
+  }
+}
+
+/*!
+ * Constructor. The server does not start automatically, call start() and stop() to start and stop the server.
+ * @param[in] configs device configurations
+ * @param[in] start_scandata_delay delay between scandata activation ("LMCstartmeas" request) and first scandata message in seconds
+ */
+sick_scan::MultiDeviceServer::MultiDeviceServer(const std::vector<DeviceConfig> & configs, double start_scandata_delay)
+: m_ioservice(), m_ioservice_thread(0), m_start_scandata_delay(start_scandata_delay), m_statistics_timer(m_ioservice),
+  m_statistics_num_telegrams(0), m_statistics_num_bytes(0)
+{
+  for(size_t device_cnt = 0; device_cnt < configs.size(); device_cnt++)
+  {
+    m_devices.push_back(std::make_shared<VirtualDevice>(m_ioservice, configs[device_cnt]));
+    DeviceConfig & config = m_devices.back()->config;
+    if(config.name.empty())
+      config.name = config.ip_address + ":" + std::to_string(config.port);
+  }
+}
+
+/*!
+ * Destructor. Stops the server and closes all tcp connections.
+ */
+sick_scan::MultiDeviceServer::~MultiDeviceServer()
+{
+  stop();
+}
+
+/*!
+ * Opens the listening sockets of all devices and starts the event loop thread.
+ * @return true on success, false on failure (f.e. ip address or port not available).
+ */
+bool sick_scan::MultiDeviceServer::start(void)
+{
+  std::map<std::string, std::shared_ptr<sick_scan::ScandataFiles> > scandata_files; // devices with the same scandata files share their messages
+  for(size_t device_cnt = 0; device_cnt < m_devices.size(); device_cnt++)
+  {
+    VirtualDevice & device = *m_devices[device_cnt];
+    // Scandata source
+    if(!device.config.profile.empty())
+    {
+      if(!sick_scan::ScandataGenerator::getDeviceProfile(device.config.profile, device.profile))
+      {
+        ROS_ERROR_STREAM("## ERROR MultiDeviceServer: unknown profile \"" << device.config.profile << "\" of device " << device.config.name << ", supported profiles: " << sick_scan::ScandataGenerator::deviceProfileNames());
+        return false;
+      }
+      if(device.config.beams > 0)
+        device.profile.num_beams = device.config.beams;
+      if(device.config.echos > 0)
+        device.profile.num_echos = device.config.echos;
+      if(device.config.rssi >= 0)
+        device.profile.rssi = (device.config.rssi > 0);
+      if(device.config.encoders >= 0)
+        device.profile.num_encoders = device.config.encoders;
+      if(device.config.rate >= 0)
+        device.profile.scan_frequency = device.config.rate;
+      if(device.config.serial_number > 0)
+        device.profile.serial_number = device.config.serial_number;
+      device.synthetic = true;
+    }
+    else if(!device.config.scandatafiles.empty())
+    {
+      std::string key = device.config.scandatafiles + "|" + device.config.scandatatypes;
+      if(scandata_files.find(key) == scandata_files.end())
+      {
+        scandata_files[key] = std::make_shared<sick_scan::ScandataFiles>();
+        scandata_files[key]->read(device.config.scandatafiles, device.config.scandatatypes);
+      }
+      device.scandata_files = scandata_files[key];
+      if(device.scandata_files->frames().empty())
+        ROS_WARN_STREAM("## WARNING MultiDeviceServer: no scandata found in \"" << device.config.scandatafiles << "\", device " << device.config.name << " sends no scandata");
+    }
+    if(device.config.device_ident.empty())
+      device.config.device_ident = device.config.profile.empty() ? std::string("sick_scan_emulator") : device.config.profile;
+    // Listening socket
+    try
+    {
+      boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(device.config.ip_address), device.config.port);
+      device.acceptor.open(endpoint.protocol());
+      device.acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+      device.acceptor.bind(endpoint);
+      device.acceptor.listen();
+    }
+    catch(std::exception & exc)
+    {
+      ROS_ERROR_STREAM("## ERROR MultiDeviceServer: can't listen to " << device.config.ip_address << ":" << device.config.port << " (device " << device.config.name << "), exception " << exc.what());
+      return false;
+    }
+    ROS_INFO_STREAM("MultiDeviceServer: device " << device.config.name << " listening to " << device.config.ip_address << ":" << device.config.port << ", "
+      << (device.synthetic ? ("synthetic scandata profile " + device.profile.name) : ("scandata files \"" + device.config.scandatafiles + "\""))
+      << ", serial number " << (device.synthetic ? device.profile.serial_number : device.config.serial_number));
+    accept(&device);
+  }
+  m_statistics_timer.expires_from_now(std::chrono::seconds(1));
+  m_statistics_timer.async_wait([this](const boost::system::error_code & error_code) { if(!error_code) logStatistics(); });
+  m_ioservice_work = std::make_shared<boost::asio::io_service::work>(m_ioservice);
+  m_ioservice_thread = new boost::thread([this]() { m_ioservice.run(); });
+  ROS_INFO_STREAM("MultiDeviceServer: " << m_devices.size() << " devices started");
+  return true;
+}
+
+/*!
+ * Stops the event loop thread and closes all tcp connections.
+ * @return true on success, false on failure.
+ */
+bool sick_scan::MultiDeviceServer::stop(void)
+{
+  m_ioservice_work.reset();
+  m_ioservice.stop();
+  if(m_ioservice_thread)
+  {
+    m_ioservice_thread->join();
+    delete(m_ioservice_thread);
+    m_ioservice_thread = 0;
+  }
+  for(size_t device_cnt = 0; device_cnt < m_devices.size(); device_cnt++)
+  {
+    VirtualDevice & device = *m_devices[device_cnt];
+    boost::system::error_code error_code;
+    device.acceptor.close(error_code);
+    std::list<SessionPtr> sessions = device.sessions;
+    for(std::list<SessionPtr>::iterator session_iter = sessions.begin(); session_iter != sessions.end(); session_iter++)
+      (*session_iter)->close();
+    device.sessions.clear();
+  }
+  return true;
+}
+
+/*!
+ * Accepts the next tcp client of a device
+ * @param[in] device virtual device
+ */
+void sick_scan::MultiDeviceServer::accept(VirtualDevice* device)
+{
+  SessionPtr session = std::make_shared<Session>(m_ioservice, device, m_start_scandata_delay);
+  device->acceptor.async_accept(session->socket, [this, device, session](const boost::system::error_code & error_code)
+  {
+    if(error_code)
+    {
+      if(error_code != boost::asio::error::operation_aborted)
+        ROS_WARN_STREAM("## WARNING MultiDeviceServer: accept failed on device " << device->config.name << ": " << error_code.message());
+      return;
+    }
+    ROS_INFO_STREAM("MultiDeviceServer: device " << device->config.name << " established new tcp client connection");
+    boost::system::error_code option_error;
+    session->socket.set_option(boost::asio::ip::tcp::no_delay(true), option_error);
+    device->sessions.push_back(session);
+    session->start();
+    accept(device);
+  });
+}
+
+/*!
+ * Logs the statistics (telegrams and bytes sent) once per second
+ */
+void sick_scan::MultiDeviceServer::logStatistics(void)
+{
+  uint64_t num_telegrams = 0, num_bytes = 0, num_dropped = 0;
+  size_t num_sessions = 0;
+  for(size_t device_cnt = 0; device_cnt < m_devices.size(); device_cnt++)
+  {
+    num_telegrams += m_devices[device_cnt]->num_telegrams;
+    num_bytes += m_devices[device_cnt]->num_bytes;
+    num_dropped += m_devices[device_cnt]->num_dropped;
+    num_sessions += m_devices[device_cnt]->sessions.size();
+  }
+  if(num_telegrams > m_statistics_num_telegrams)
+  {
+    ROS_INFO_STREAM("MultiDeviceServer: " << m_devices.size() << " devices, " << num_sessions << " clients, " << (num_telegrams - m_statistics_num_telegrams) << " telegrams/s, "
+      << (1.0e-6 * (num_bytes - m_statistics_num_bytes)) << " MB/s, " << num_dropped << " telegrams dropped in total");
+  }
+  m_statistics_num_telegrams = num_telegrams;
+  m_statistics_num_bytes = num_bytes;
+  m_statistics_timer.expires_at(m_statistics_timer.expires_at() + std::chrono::seconds(1));
+  m_statistics_timer.async_wait([this](const boost::system::error_code & error_code) { if(!error_code) logStatistics(); });
+}
+
+/*!
+ * Session constructor
+ * @param[in] ioservice event loop
+ * @param[in] device the emulated device
+ * @param[in] start_scandata_delay delay between "LMCstartmeas" request and first scandata message in seconds
+ */
+sick_scan::MultiDeviceServer::Session::Session(boost::asio::io_service & ioservice, VirtualDevice* device, double start_scandata_delay)
+: socket(ioservice), m_device(device), m_start_scandata_delay(start_scandata_delay), m_receive_chunk(64 * 1024), m_scandata_enabled(false),
+  m_scandata_in_flight(false), m_scandata_timer(ioservice), m_start_time(std::chrono::steady_clock::now()), m_frame_idx(0), m_frame_delta(1)
+{
+}
+
+/*!
+ * Starts to receive cola requests
+ */
+void sick_scan::MultiDeviceServer::Session::start(void)
+{
+  receive();
+}
+
+/*!
+ * Closes the connection and removes the session from its device
+ */
+void sick_scan::MultiDeviceServer::Session::close(void)
+{
+  boost::system::error_code error_code;
+  m_scandata_enabled = false;
+  m_scandata_timer.cancel(error_code);
+  if(socket.is_open())
+  {
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error_code);
+    socket.close(error_code);
+  }
+  m_device->sessions.remove(shared_from_this());
+}
+
+/*!
+ * Starts an asynchronous read. Received bytes are split into cola telegrams (Cola-Binary: 0x02020202 + length + payload + CRC,
+ * Cola-ASCII: <STX> + payload + <ETX>), each request is answered in the order of reception.
+ */
+void sick_scan::MultiDeviceServer::Session::receive(void)
+{
+  SessionPtr self = shared_from_this();
+  socket.async_read_some(boost::asio::buffer(m_receive_chunk), [this, self](const boost::system::error_code & error_code, size_t bytes_received)
+  {
+    if(error_code)
+    {
+      if(error_code != boost::asio::error::operation_aborted)
+      {
+        ROS_INFO_STREAM("MultiDeviceServer: device " << m_device->config.name << " tcp client disconnected");
+        close();
+      }
+      return;
+    }
+    m_receive_buffer.insert(m_receive_buffer.end(), m_receive_chunk.begin(), m_receive_chunk.begin() + bytes_received);
+    size_t start = 0;
+    while(start < m_receive_buffer.size())
+    {
+      size_t size = m_receive_buffer.size() - start, length = 0;
+      const uint8_t* data = m_receive_buffer.data() + start;
+      if(data[0] != 0x02)
+      {
+        start++; // skip bytes until next <STX>
+        continue;
+      }
+      if(size >= 8 && data[1] == 0x02 && data[2] == 0x02 && data[3] == 0x02)
+      {
+        length = 9 + ((data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7]); // Cola-Binary
+        if(size < length)
+          break;
+      }
+      else if(size < 8 && std::count(data, data + size, 0x02) == (int)size)
+      {
+        break; // possibly an incomplete Cola-Binary header
+      }
+      else
+      {
+        const uint8_t* etx = std::find(data + 1, data + size, 0x03); // Cola-ASCII
+        if(etx == data + size)
+          break;
+        length = etx + 1 - data;
+      }
+      handleRequest(std::vector<uint8_t>(data, data + length));
+      start += length;
+    }
+    m_receive_buffer.erase(m_receive_buffer.begin(), m_receive_buffer.begin() + start);
+    receive();
+  });
+}
+
+/*!
+ * Decodes a cola request and sends the response. Scandata activation and device identity are handled per session
+ * resp. per device, all other requests are answered by TestcaseGenerator::createColaResponse().
+ * @param[in] request Cola-ASCII or Cola-Binary request
+ */
+void sick_scan::MultiDeviceServer::Session::handleRequest(const std::vector<uint8_t> & request)
+{
+  bool cola_binary = sick_scan::ColaAsciiBinaryConverter::IsColaBinary(request);
+  std::vector<uint8_t> request_ascii = cola_binary ? sick_scan::ColaAsciiBinaryConverter::ColaBinaryToColaAscii(request) : request;
+  sick_scan::SickLocColaTelegramMsg telegram_msg = sick_scan::ColaParser::decodeColaTelegram(sick_scan::ColaAsciiBinaryConverter::ConvertColaAscii(request_ascii));
+  ROS_DEBUG_STREAM("MultiDeviceServer: device " << m_device->config.name << " received cola request " << sick_scan::ColaAsciiBinaryConverter::ConvertColaAscii(request_ascii));
+  sick_scan::SickLocColaTelegramMsg telegram_answer;
+  if(telegram_msg.command_type == sick_scan::ColaParser::sMN && telegram_msg.command_name == "LMCstartmeas")
+  {
+    telegram_answer = sick_scan::ColaParser::createColaTelegram(sick_scan::ColaParser::sAN, telegram_msg.command_name, {"00"});
+    if(!m_scandata_enabled)
+    {
+      m_scandata_enabled = true;
+      startScandata();
+    }
+  }
+  else if(telegram_msg.command_type == sick_scan::ColaParser::sMN && telegram_msg.command_name == "LMCstopmeas")
+  {
+    telegram_answer = sick_scan::ColaParser::createColaTelegram(sick_scan::ColaParser::sAN, telegram_msg.command_name, {"00"});
+    m_scandata_enabled = false;
+    boost::system::error_code error_code;
+    m_scandata_timer.cancel(error_code);
+  }
+  else if(telegram_msg.command_type == sick_scan::ColaParser::sRN && (telegram_msg.command_name == "DeviceIdent" || telegram_msg.command_name == "SerialNumber"))
+  {
+    // Device identity: strings with 16 bit length, hex encoded as the other binary sRA responses
+    std::vector<std::string> identity;
+    if(telegram_msg.command_name == "DeviceIdent")
+      identity = { m_device->config.device_ident, "1.0.0.0" };
+    else
+      identity = { std::to_string(m_device->synthetic ? m_device->profile.serial_number : m_device->config.serial_number) };
+    std::string parameter;
+    char hex_buffer[8];
+    for(size_t n = 0; n < identity.size(); n++)
+    {
+      snprintf(hex_buffer, sizeof(hex_buffer), "%04x", (unsigned)identity[n].size());
+      parameter += hex_buffer;
+      for(size_t m = 0; m < identity[n].size(); m++)
+      {
+        snprintf(hex_buffer, sizeof(hex_buffer), "%02x", (unsigned)(uint8_t)identity[n][m]);
+        parameter += hex_buffer;
+      }
+    }
+    telegram_answer = sick_scan::ColaParser::createColaTelegram(sick_scan::ColaParser::sRA, telegram_msg.command_name, {parameter});
+  }
+  else
+  {
+    boost::lock_guard<boost::mutex> response_lockguard(s_create_cola_response_mutex);
+    telegram_answer = sick_scan::TestcaseGenerator::createColaResponse(telegram_msg);
+  }
+  SendBuffer response;
+  response.buffer = cola_binary ? sick_scan::ColaAsciiBinaryConverter::ColaTelegramToColaBinary(telegram_answer) : sick_scan::ColaParser::encodeColaTelegram(telegram_answer);
+  send(response);
+}
+
+/*!
+ * Queues data to send. Data is written in the order of send() calls.
+ * @param[in] send_buffer data to send, either owned (cola responses) or a pointer to scandata
+ */
+void sick_scan::MultiDeviceServer::Session::send(const SendBuffer & send_buffer)
+{
+  m_send_queue.push_back(send_buffer);
+  SendBuffer & queued = m_send_queue.back();
+  if(!queued.buffer.empty())
+  {
+    queued.data = queued.buffer.data();
+    queued.size = queued.buffer.size();
+  }
+  if(m_send_queue.size() == 1)
+    sendNext();
+}
+
+/*!
+ * Starts an asynchronous write of the next queued data
+ */
+void sick_scan::MultiDeviceServer::Session::sendNext(void)
+{
+  if(m_send_queue.empty() || !socket.is_open())
+    return;
+  SessionPtr self = shared_from_this();
+  boost::asio::async_write(socket, boost::asio::buffer(m_send_queue.front().data, m_send_queue.front().size), [this, self](const boost::system::error_code & error_code, size_t bytes_sent)
+  {
+    if(error_code)
+    {
+      if(error_code != boost::asio::error::operation_aborted)
+        close();
+      return;
+    }
+    bool scandata = m_send_queue.front().scandata;
+    m_send_queue.pop_front();
+    if(scandata)
+    {
+      m_scandata_in_flight = false;
+      m_device->num_telegrams++;
+      m_device->num_bytes += bytes_sent;
+      if(m_scandata_enabled && m_device->synthetic && m_device->profile.scan_frequency <= 0)
+        sendScandata(); // as fast as possible: next telegram after the previous one has been sent
+    }
+    sendNext();
+  });
+}
+
+/*!
+ * Starts sending scandata after the start delay
+ */
+void sick_scan::MultiDeviceServer::Session::startScandata(void)
+{
+  if(m_device->synthetic && !m_generator)
+    m_generator = std::make_shared<sick_scan::ScandataGenerator>(m_device->profile);
+  if(!m_device->synthetic && (!m_device->scandata_files || m_device->scandata_files->frames().empty()))
+    return;
+  m_scandata_deadline = boost::asio::steady_timer::clock_type::now() + std::chrono::microseconds((int64_t)(1.0e6 * m_start_scandata_delay));
+  SessionPtr self = shared_from_this();
+  m_scandata_timer.expires_at(m_scandata_deadline);
+  m_scandata_timer.async_wait([this, self](const boost::system::error_code & error_code) { if(!error_code) sendScandata(); });
+}
+
+/*!
+ * Sends the next scandata telegram and schedules the next one. If the previous telegram has not yet been sent
+ * (i.e. the client does not read fast enough), the telegram is dropped like a device with a full send buffer does.
+ */
+void sick_scan::MultiDeviceServer::Session::sendScandata(void)
+{
+  if(!m_scandata_enabled || !socket.is_open())
+    return;
+  double period = 0;
+  if(m_scandata_in_flight)
+  {
+    m_device->num_dropped++;
+  }
+  else if(m_device->synthetic)
+  {
+    uint32_t time_since_startup_usec = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start_time).count();
+    const std::vector<uint8_t> & telegram = m_generator->nextTelegram(time_since_startup_usec); // valid until the next call, i.e. until the telegram has been sent
+    m_scandata_in_flight = true;
+    send(SendBuffer(telegram.data(), telegram.size(), true));
+  }
+  else
+  {
+    const std::vector<sick_scan::ScandataFiles::ScandataFrame> & frames = m_device->scandata_files->frames();
+    const sick_scan::ScandataFiles::ScandataFrame & frame = frames[m_frame_idx];
+    m_scandata_in_flight = true;
+    send(SendBuffer(frame.data, frame.size, true));
+  }
+  // Schedule the next telegram
+  if(m_device->synthetic)
+  {
+    if(m_device->profile.scan_frequency <= 0)
+      return; // as fast as possible, next telegram is sent after completion
+    period = 1.0 / (m_device->profile.scan_frequency * m_device->profile.num_layers);
+  }
+  else
+  {
+    // Frames are sent forth and back with their recorded time difference, as TestServerThread does
+    const std::vector<sick_scan::ScandataFiles::ScandataFrame> & frames = m_device->scandata_files->frames();
+    int next_idx = m_frame_idx + m_frame_delta;
+    if(next_idx < 0 || next_idx >= (int)frames.size())
+    {
+      m_frame_delta = -m_frame_delta;
+      next_idx = std::max(0, std::min((int)frames.size() - 1, m_frame_idx + m_frame_delta));
+    }
+    period = std::max(0.001, std::abs(frames[next_idx].timestamp - frames[m_frame_idx].timestamp));
+    m_frame_idx = next_idx;
+  }
+  boost::asio::steady_timer::time_point now = boost::asio::steady_timer::clock_type::now();
+  m_scandata_deadline += std::chrono::nanoseconds((int64_t)(1.0e9 * period));
+  if(m_scandata_deadline + std::chrono::seconds(1) < now)
+    m_scandata_deadline = now; // more than 1 second behind the schedule: restart the schedule
+  SessionPtr self = shared_from_this();
+  m_scandata_timer.expires_at(m_scandata_deadline);
+  m_scandata_timer.async_wait([this, self](const boost::system::error_code & error_code) { if(!error_code) sendScandata(); });
+}
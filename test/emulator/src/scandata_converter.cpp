@@ -0,0 +1,131 @@
+/*
+ * @brief sick_scan_scandata_converter converts scandata messages from network captures or jsonfiles
+ * to binary scandata files, which can be memory mapped by the emulator.
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include "sick_scan/ros_wrapper.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "sick_scan/pcapng_json_parser.h"
+#include "sick_scan/scandata_files.h"
+#include "sick_scan/sick_scan_datagram_log.h"
+#include "sick_scan/sick_scan_pcapng_reader.h"
+
+/*!
+ * sick_scan_scandata_converter converts scandata messages from a network capture (*.pcapng or *.pcap) or from a jsonfile
+ * (pcapng file converted by pcap_json_converter.py) to a binary scandata file (datagram log, *.sdl). Binary scandata files
+ * are memory mapped by the emulator and sent without parsing or copying any hex strings, see doc/emulator.md.
+ * Network captures are processed as a stream, i.e. captures of any size are converted with bounded memory.
+ *
+ * Usage: sick_scan_scandata_converter <input.pcapng|input.pcap|input.pcapng.json> <output.sdl> [scandatatypes]
+ * Example: sick_scan_scandata_converter tim781s_scandata.pcapng tim781s_scandata.sdl "sSN LMDscandata ,sSN LFErec "
+ */
+int main(int argc, char** argv)
+{
+  if(argc < 3)
+  {
+    std::cerr << "Usage: sick_scan_scandata_converter <input.pcapng|input.pcap|input.pcapng.json> <output.sdl> [scandatatypes]" << std::endl;
+    std::cerr << "Example: sick_scan_scandata_converter tim781s_scandata.pcapng tim781s_scandata.sdl \"sSN LMDscandata ,sSN LFErec \"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string input_filename = argv[1];
+  std::string sdl_filename = argv[2];
+  std::vector<std::string> scandatatypes = sick_scan::PcapngJsonParser::split((argc > 3) ? argv[3] : "sSN LMDscandata ,sSN LIDinputstate ,sSN LIDoutputstate ,sSN LFErec ", ',');
+  bool input_is_json = (input_filename.size() > 5 && input_filename.compare(input_filename.size() - 5, 5, ".json") == 0);
+
+  sick_scan::SickScanPcapngReader pcapng_reader;
+  std::vector<sick_scan::JsonScanData> scandata;
+  if((input_is_json && (!sick_scan::PcapngJsonParser::parseJsonfile(input_filename, scandatatypes, 0, scandata) || scandata.empty()))
+    || (!input_is_json && !pcapng_reader.open(input_filename)))
+  {
+    std::cerr << "## ERROR sick_scan_scandata_converter: error reading file \"" << input_filename << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  sick_scan::SickScanDatagramLogWriter writer;
+  if(!writer.open(sdl_filename))
+  {
+    std::cerr << "## ERROR sick_scan_scandata_converter: error creating file \"" << sdl_filename << "\"" << std::endl;
+    return EXIT_FAILURE;
+  }
+  size_t msg_cnt = 0;
+  uint32_t sec = 0, nsec = 0;
+  std::vector<uint8_t> datagram;
+  for(size_t n = 0; input_is_json ? (n < scandata.size()) : pcapng_reader.read(sec, nsec, datagram); n++)
+  {
+    if(input_is_json)
+    {
+      double timestamp = std::max(0.0, scandata[n].timestamp);
+      sec = (uint32_t)std::floor(timestamp);
+      nsec = std::min<uint32_t>((uint32_t)std::round((timestamp - sec) * 1.0e9), 999999999);
+      datagram.swap(scandata[n].data);
+    }
+    if(!sick_scan::ScandataFiles::isScandataType(datagram.data(), datagram.size(), scandatatypes))
+      continue;
+    if(!writer.write(sec, nsec, datagram.data(), (uint32_t)datagram.size()))
+    {
+      std::cerr << "## ERROR sick_scan_scandata_converter: error writing file \"" << sdl_filename << "\"" << std::endl;
+      return EXIT_FAILURE;
+    }
+    msg_cnt++;
+  }
+  writer.close();
+  std::cout << "sick_scan_scandata_converter: " << msg_cnt << " messages converted from \"" << input_filename << "\" to \"" << sdl_filename << "\"" << std::endl;
+  if(!input_is_json)
+    std::cout << "sick_scan_scandata_converter: " << pcapng_reader.numPackets() << " tcp segments processed, " << pcapng_reader.numSkippedBytes() << " bytes skipped" << std::endl;
+  return EXIT_SUCCESS;
+}
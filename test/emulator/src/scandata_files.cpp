@@ -0,0 +1,156 @@
+/*
+ * @brief ScandataFiles reads scandata messages from jsonfiles, binary scandata files
+ * and network captures for the emulator.
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include "sick_scan/ros_wrapper.h"
+#include <algorithm>
+
+#include "sick_scan/scandata_files.h"
+#include "sick_scan/sick_scan_pcapng_reader.h"
+
+/*!
+ * Reads scandata messages from a list of files. Timestamps of all files are concatenated.
+ * @param[in] scandatafiles comma separated list of jsonfiles, binary scandata files (*.sdl) or network captures (*.pcapng, *.pcap)
+ * @param[in] scandatatypes comma separated list of scandata message types, f.e. "sSN LMDscandata,sSN LMDscandatamon"
+ * @return true on success (at least one message read), false otherwise
+ */
+bool sick_scan::ScandataFiles::read(const std::string & scandatafiles, const std::string & scandatatypes)
+{
+  std::vector<std::string> filenames = sick_scan::PcapngJsonParser::split(scandatafiles, ',');
+  std::vector<std::string> types = sick_scan::PcapngJsonParser::split(scandatatypes, ',');
+  double start_timestamp = 0;
+  for(int n = 0; n < filenames.size(); n++)
+  {
+    const std::string & scandatafile = filenames[n];
+    if(scandatafile.size() > 4 && scandatafile.compare(scandatafile.size() - 4, 4, ".sdl") == 0)
+    {
+      // Binary scandata file (datagram log), memory mapped, messages are sent without copy
+      m_scandata_mappings.push_back(sick_scan::SickScanDatagramLogMapping());
+      sick_scan::SickScanDatagramLogMapping & mapping = m_scandata_mappings.back();
+      if(!mapping.open(scandatafile))
+      {
+        ROS_WARN_STREAM("## WARNING ScandataFiles: error reading file \"" << scandatafile << "\".");
+        continue;
+      }
+      for(size_t msg_cnt = 0; msg_cnt < mapping.numDatagrams(); msg_cnt++)
+      {
+        uint32_t size = 0;
+        const uint8_t* data = mapping.datagram(msg_cnt, size);
+        if(isScandataType(data, size, types))
+          m_frames.push_back(ScandataFrame(mapping.timestamp(msg_cnt) - mapping.timestamp(0) + start_timestamp, data, size));
+      }
+    }
+    else if((scandatafile.size() > 7 && scandatafile.compare(scandatafile.size() - 7, 7, ".pcapng") == 0)
+      || (scandatafile.size() > 5 && scandatafile.compare(scandatafile.size() - 5, 5, ".pcap") == 0))
+    {
+      // Network capture, cola messages sent by the scanner are extracted from the reassembled tcp streams
+      sick_scan::SickScanPcapngReader pcapng_reader;
+      if(!pcapng_reader.open(scandatafile))
+      {
+        ROS_WARN_STREAM("## WARNING ScandataFiles: error reading file \"" << scandatafile << "\".");
+        continue;
+      }
+      m_json_messages.push_back(std::vector<sick_scan::JsonScanData>());
+      std::vector<sick_scan::JsonScanData> & pcapng_messages = m_json_messages.back();
+      std::vector<uint8_t> datagram;
+      uint32_t sec = 0, nsec = 0;
+      double first_timestamp = -1;
+      while(pcapng_reader.read(sec, nsec, datagram))
+      {
+        double timestamp = sec + 1.0e-9 * nsec;
+        if(first_timestamp < 0)
+          first_timestamp = timestamp;
+        if(isScandataType(datagram.data(), datagram.size(), types))
+          pcapng_messages.push_back(sick_scan::JsonScanData(timestamp - first_timestamp + start_timestamp, datagram));
+      }
+      for(size_t msg_cnt = 0; msg_cnt < pcapng_messages.size(); msg_cnt++)
+        m_frames.push_back(ScandataFrame(pcapng_messages[msg_cnt].timestamp, pcapng_messages[msg_cnt].data.data(), pcapng_messages[msg_cnt].data.size()));
+    }
+    else
+    {
+      m_json_messages.push_back(std::vector<sick_scan::JsonScanData>());
+      std::vector<sick_scan::JsonScanData> & json_file_messages = m_json_messages.back();
+      if(!sick_scan::PcapngJsonParser::parseJsonfile(scandatafile, types, start_timestamp, json_file_messages) || json_file_messages.empty())
+      {
+        ROS_WARN_STREAM("## WARNING ScandataFiles: error reading file \"" << scandatafile << "\".");
+        continue;
+      }
+      for(size_t msg_cnt = 0; msg_cnt < json_file_messages.size(); msg_cnt++)
+        m_frames.push_back(ScandataFrame(json_file_messages[msg_cnt].timestamp, json_file_messages[msg_cnt].data.data(), json_file_messages[msg_cnt].data.size()));
+    }
+    if(!m_frames.empty())
+    {
+      ROS_INFO_STREAM("ScandataFiles: file \"" << scandatafile << "\" successfully parsed, " << m_frames.size() << " messages of types \"" << scandatatypes << "\".");
+      start_timestamp = m_frames.back().timestamp + 0.01;
+    }
+  }
+  return !m_frames.empty();
+}
+
+/*!
+ * Returns true, if a cola message has one of the given types (f.e. "sSN LMDscandata"), or if scandatatypes is empty.
+ * @param[in] data binary cola message
+ * @param[in] size number of bytes
+ * @param[in] scandatatypes list of scandata message types
+ */
+bool sick_scan::ScandataFiles::isScandataType(const uint8_t* data, size_t size, const std::vector<std::string> & scandatatypes)
+{
+  const uint8_t* data_end = data + std::min<size_t>(size, 64); // message type within the first bytes after stx and length
+  for(int type_cnt = 0; type_cnt < scandatatypes.size(); type_cnt++)
+  {
+    if(std::search(data, data_end, scandatatypes[type_cnt].begin(), scandatatypes[type_cnt].end()) != data_end)
+      return true;
+  }
+  return scandatatypes.empty();
+}
@@ -0,0 +1,293 @@
+/*
+ * @brief scandata_generator synthesizes LMDscandata telegrams for device profiles.
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sick_scan/scandata_generator.h"
+
+/** Appends a value in big endian byte order */
+template <typename T> static void appendBigEndian(std::vector<uint8_t> & telegram, T value)
+{
+  uint8_t bytes[sizeof(T)];
+  memcpy(bytes, &value, sizeof(T));
+  for (int n = (int)sizeof(T) - 1; n >= 0; n--)
+    telegram.push_back(bytes[n]);
+}
+
+/** Writes a value in big endian byte order at a given offset */
+template <typename T> static void writeBigEndian(uint8_t* dst, T value)
+{
+  uint8_t bytes[sizeof(T)];
+  memcpy(bytes, &value, sizeof(T));
+  for (int n = 0; n < (int)sizeof(T); n++)
+    dst[n] = bytes[sizeof(T) - 1 - n];
+}
+
+/*!
+ * Returns the predefined device profile of a given name
+ * @param[in] name profile name, see deviceProfileNames()
+ * @param[out] profile device profile
+ * @return true on success, false if name is unknown
+ */
+bool sick_scan::ScandataGenerator::getDeviceProfile(const std::string & name, DeviceProfile & profile)
+{
+  profile = DeviceProfile();
+  profile.name = name;
+  if (name == "tim5xx" || name == "tim7xx")
+  {
+    profile.num_beams = 811; // 270 degree, 0.333 degree resolution
+    profile.start_angle_deg = -45;
+    profile.angular_step_deg = 1.0 / 3.0;
+    profile.scan_frequency = 15;
+  }
+  else if (name == "lms1xx")
+  {
+    profile.num_beams = 541; // 270 degree, 0.5 degree resolution
+    profile.start_angle_deg = -45;
+    profile.angular_step_deg = 0.5;
+    profile.scan_frequency = 50;
+  }
+  else if (name == "lms5xx")
+  {
+    profile.num_beams = 381; // 190 degree, 0.5 degree resolution
+    profile.num_echos = 5;
+    profile.start_angle_deg = -5;
+    profile.angular_step_deg = 0.5;
+    profile.scan_frequency = 25;
+  }
+  else if (name == "mrs1xxx")
+  {
+    profile.num_layers = 4;
+    profile.num_beams = 1101; // 275 degree, 0.25 degree resolution
+    profile.num_echos = 3;
+    profile.start_angle_deg = -47.5;
+    profile.angular_step_deg = 0.25;
+    profile.scan_frequency = 12.5; // 50 Hz layer frequency
+  }
+  else if (name == "mrs6xxx")
+  {
+    profile.num_layers = 24;
+    profile.num_beams = 924; // 120 degree, 0.13 degree resolution
+    profile.num_echos = 3;
+    profile.rssi_8bit = true;
+    profile.start_angle_deg = 30;
+    profile.angular_step_deg = 0.13;
+    profile.scan_frequency = 10;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * Returns the names of all predefined device profiles (comma separated)
+ */
+std::string sick_scan::ScandataGenerator::deviceProfileNames(void)
+{
+  return "tim5xx,tim7xx,lms1xx,lms5xx,mrs1xxx,mrs6xxx";
+}
+
+/*!
+ * Returns the elevation angle of a layer in 1/200 degree as sent in the LayerAngle field
+ */
+int16_t sick_scan::ScandataGenerator::layerAngleX200(int num_layers, int layer)
+{
+  if (num_layers == 4) // MRS1xxx: +1.25, 0, -1.25, -2.5 degree
+    return (int16_t)(250 - 250 * layer);
+  if (num_layers == 24) // MRS6xxx: from -13.19 degree in steps of 0.625 degree, layer 0 is the uppermost layer
+    return (int16_t)(-2638 + 125 * (num_layers - 1 - layer));
+  return 0;
+}
+
+/*!
+ * ScandataGenerator constructor
+ * @param[in] profile device profile
+ */
+sick_scan::ScandataGenerator::ScandataGenerator(const DeviceProfile & profile)
+: m_profile(profile), m_encoder_offset(0), m_telegram_counter(0), m_scan_counter(0), m_layer(0)
+{
+  m_profile.num_layers = std::max(1, m_profile.num_layers);
+  m_profile.num_beams = std::max(1, std::min(65535, m_profile.num_beams));
+  m_profile.num_echos = std::max(1, std::min(5, m_profile.num_echos));
+  m_profile.num_encoders = std::max(0, std::min(4, m_profile.num_encoders));
+  // Synthetic scene: ranges between 1 and 5 meter, the scene rotates by one beam per scan
+  m_scene.resize(2 * m_profile.num_beams);
+  for (size_t n = 0; n < m_scene.size(); n++)
+    m_scene[n] = (uint16_t)(3000 + 2000 * sin(2 * M_PI * 3 * n / m_profile.num_beams));
+  m_telegrams.resize(m_profile.num_layers);
+  for (int layer = 0; layer < m_profile.num_layers; layer++)
+    encodeTemplate(layer, m_telegrams[layer]);
+}
+
+/*!
+ * Encodes the telegram template of a layer
+ */
+void sick_scan::ScandataGenerator::encodeTemplate(int layer, std::vector<uint8_t> & telegram)
+{
+  int num_beams = m_profile.num_beams;
+  telegram.clear();
+  appendBigEndian<uint32_t>(telegram, 0x02020202);
+  appendBigEndian<uint32_t>(telegram, 0); // length, set below
+  const char* command = "sSN LMDscandata ";
+  telegram.insert(telegram.end(), command, command + strlen(command));
+  appendBigEndian<uint16_t>(telegram, 1);          // VersionNumber
+  appendBigEndian<uint16_t>(telegram, 1);          // DeviceNumber
+  appendBigEndian<uint32_t>(telegram, m_profile.serial_number); // SerialNumber
+  appendBigEndian<uint16_t>(telegram, 0);          // DeviceStatus
+  appendBigEndian<uint16_t>(telegram, 0);          // TelegramCounter (offset 34)
+  appendBigEndian<uint16_t>(telegram, 0);          // ScanCounter (offset 36)
+  appendBigEndian<uint32_t>(telegram, 0);          // TimeSinceStartup (offset 38)
+  appendBigEndian<uint32_t>(telegram, 0);          // TimeOfTransmission (offset 42)
+  appendBigEndian<uint16_t>(telegram, 0);          // InputStatus
+  appendBigEndian<uint16_t>(telegram, 0);          // OutputStatus
+  appendBigEndian<int16_t>(telegram, layerAngleX200(m_profile.num_layers, layer)); // LayerAngle (offset 50)
+  appendBigEndian<uint32_t>(telegram, (uint32_t)(100 * m_profile.scan_frequency * m_profile.num_layers)); // ScanFrequency in 1/100 Hz
+  appendBigEndian<uint32_t>(telegram, (uint32_t)((360.0 / m_profile.angular_step_deg) * m_profile.scan_frequency * m_profile.num_layers / 100)); // MeasurementFrequency in 100 Hz
+  appendBigEndian<uint16_t>(telegram, (uint16_t)m_profile.num_encoders);
+  m_encoder_offset = telegram.size();
+  for (int encoder = 0; encoder < m_profile.num_encoders; encoder++)
+  {
+    appendBigEndian<uint32_t>(telegram, 0);        // EncoderPosition
+    appendBigEndian<int16_t>(telegram, 100);       // EncoderSpeed
+  }
+  // 16 bit channels: DIST1 ... DISTn and 16 bit RSSI1 ... RSSIn
+  int num_rssi = m_profile.rssi ? m_profile.num_echos : 0;
+  int num_16bit_channels = m_profile.num_echos + (m_profile.rssi_8bit ? 0 : num_rssi);
+  int num_8bit_channels = m_profile.rssi_8bit ? num_rssi : 0;
+  m_dist_offsets.clear();
+  m_rssi_offsets.clear();
+  appendBigEndian<uint16_t>(telegram, (uint16_t)num_16bit_channels);
+  for (int channel = 0; channel < num_16bit_channels + num_8bit_channels; channel++)
+  {
+    if (channel == num_16bit_channels)
+      appendBigEndian<uint16_t>(telegram, (uint16_t)num_8bit_channels);
+    bool dist = (channel < m_profile.num_echos);
+    int echo = dist ? channel : (channel - m_profile.num_echos);
+    char name[16];
+    snprintf(name, sizeof(name), "%s%d", dist ? "DIST" : "RSSI", echo + 1);
+    telegram.insert(telegram.end(), name, name + 5);
+    appendBigEndian<float>(telegram, 1.0f);        // ScaleFactor
+    appendBigEndian<float>(telegram, 0.0f);        // ScaleFactorOffset
+    appendBigEndian<int32_t>(telegram, (int32_t)lround(10000 * m_profile.start_angle_deg));  // StartAngle in 1/10000 degree
+    appendBigEndian<uint16_t>(telegram, (uint16_t)lround(10000 * m_profile.angular_step_deg)); // SizeOfSingleAngularStep in 1/10000 degree
+    appendBigEndian<uint16_t>(telegram, (uint16_t)num_beams);
+    (dist ? m_dist_offsets : m_rssi_offsets).push_back(telegram.size());
+    telegram.resize(telegram.size() + num_beams * ((channel < num_16bit_channels) ? 2 : 1), 0);
+  }
+  if (num_8bit_channels == 0)
+    appendBigEndian<uint16_t>(telegram, 0);        // number of 8 bit channels
+  for (int n = 0; n < 5; n++)
+    appendBigEndian<uint16_t>(telegram, 0);        // position, name, comment, time and event info not transmitted
+  // RSSI values are constant
+  for (size_t rssi = 0; rssi < m_rssi_offsets.size(); rssi++)
+  {
+    for (int beam = 0; beam < num_beams; beam++)
+    {
+      if (m_profile.rssi_8bit)
+        telegram[m_rssi_offsets[rssi] + beam] = (uint8_t)(50 + (beam % 200));
+      else
+        writeBigEndian<uint16_t>(&telegram[m_rssi_offsets[rssi] + 2 * beam], (uint16_t)(1000 + 10 * (beam % 1000)));
+    }
+  }
+  writeBigEndian<uint32_t>(&telegram[4], (uint32_t)(telegram.size() - 8));
+  telegram.push_back(0); // checksum, set by nextTelegram()
+}
+
+/*!
+ * Returns the next scandata telegram. Layers are sent one after another, each scan starts with the uppermost layer.
+ * The returned telegram is valid until the next call of nextTelegram().
+ * @param[in] time_since_startup_usec device time in microseconds (TimeSinceStartup and TimeOfTransmission)
+ * @return Cola-Binary telegram (incl. 0x02020202 header, length and checksum)
+ */
+const std::vector<uint8_t> & sick_scan::ScandataGenerator::nextTelegram(uint32_t time_since_startup_usec)
+{
+  std::vector<uint8_t> & telegram = m_telegrams[m_layer];
+  int num_beams = m_profile.num_beams;
+  writeBigEndian<uint16_t>(&telegram[34], (uint16_t)m_telegram_counter);
+  writeBigEndian<uint16_t>(&telegram[36], (uint16_t)m_scan_counter);
+  writeBigEndian<uint32_t>(&telegram[38], time_since_startup_usec);
+  writeBigEndian<uint32_t>(&telegram[42], time_since_startup_usec);
+  for (int encoder = 0; encoder < m_profile.num_encoders; encoder++)
+    writeBigEndian<uint32_t>(&telegram[m_encoder_offset + 6 * encoder], m_scan_counter * 100);
+  // Ranges of the rotating scene, echo n is n meter behind the first echo
+  const uint16_t* scene = &m_scene[m_scan_counter % num_beams];
+  for (size_t echo = 0; echo < m_dist_offsets.size(); echo++)
+  {
+    uint8_t* dst = &telegram[m_dist_offsets[echo]];
+    uint16_t echo_offset = (uint16_t)(1000 * echo + 10 * m_layer);
+    for (int beam = 0; beam < num_beams; beam++, dst += 2)
+    {
+      uint16_t range = scene[beam] + echo_offset;
+      dst[0] = (uint8_t)(range >> 8);
+      dst[1] = (uint8_t)(range & 0xFF);
+    }
+  }
+  // Checksum: xor of all bytes after the length field
+  uint8_t checksum = 0;
+  for (size_t n = 8; n + 1 < telegram.size(); n++)
+    checksum ^= telegram[n];
+  telegram.back() = checksum;
+  m_telegram_counter++;
+  if (++m_layer >= m_profile.num_layers)
+  {
+    m_layer = 0;
+    m_scan_counter++;
+  }
+  return telegram;
+}
@@ -0,0 +1,154 @@
+/*
+ * @brief scandata_pacer sends telegrams at precise rates.
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <chrono>
+#include <thread>
+#include <time.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#include "sick_scan/scandata_pacer.h"
+
+/*!
+ * ScandataPacer constructor
+ * @param[in] rate number of telegrams per second, rate <= 0: no pacing (send as fast as possible)
+ * @param[in] spin_usec busy-wait time in microseconds before each deadline, default: 100 microseconds
+ */
+sick_scan::ScandataPacer::ScandataPacer(double rate, double spin_usec)
+: m_period_nsec(0), m_spin_nsec((uint64_t)(1000 * spin_usec)), m_next_deadline(0), m_num_late(0), m_timer_fd(-1)
+{
+#ifdef __linux__
+  m_timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+#endif
+  setRate(rate);
+}
+
+/*!
+ * ScandataPacer destructor
+ */
+sick_scan::ScandataPacer::~ScandataPacer()
+{
+#ifdef __linux__
+  if (m_timer_fd >= 0)
+    ::close(m_timer_fd);
+#endif
+}
+
+/*!
+ * Sets the rate and restarts the pacing
+ * @param[in] rate number of telegrams per second, rate <= 0: no pacing (send as fast as possible)
+ */
+void sick_scan::ScandataPacer::setRate(double rate)
+{
+  m_period_nsec = (rate > 0) ? (uint64_t)(1.0e9 / rate) : 0;
+  m_next_deadline = 0;
+}
+
+/*!
+ * Returns the current time of the monotonic clock in nanoseconds
+ */
+uint64_t sick_scan::ScandataPacer::nowNanoSec(void)
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*!
+ * Waits until the deadline of the next telegram. Deadlines are absolute, i.e. jitter does not accumulate.
+ * If the caller is more than 1 second behind the schedule, the schedule is restarted.
+ * @return delay of the current telegram against its deadline in nanoseconds (0: in time)
+ */
+uint64_t sick_scan::ScandataPacer::wait(void)
+{
+  if (m_period_nsec == 0)
+    return 0;
+  uint64_t now = nowNanoSec();
+  if (m_next_deadline == 0 || now > m_next_deadline + 1000000000ULL)
+    m_next_deadline = now; // first telegram or far behind the schedule: restart
+  uint64_t deadline = m_next_deadline;
+  m_next_deadline += m_period_nsec;
+  if (now >= deadline)
+  {
+    uint64_t delay = now - deadline;
+    if (delay > m_period_nsec)
+      m_num_late++;
+    return delay;
+  }
+  // Sleep until shortly before the deadline
+  if (deadline - now > m_spin_nsec)
+  {
+    uint64_t wakeup = deadline - m_spin_nsec;
+#ifdef __linux__
+    if (m_timer_fd >= 0)
+    {
+      // steady_clock is CLOCK_MONOTONIC on Linux
+      struct itimerspec timer_spec = {};
+      timer_spec.it_value.tv_sec = (time_t)(wakeup / 1000000000ULL);
+      timer_spec.it_value.tv_nsec = (long)(wakeup % 1000000000ULL);
+      uint64_t expirations = 0;
+      if (timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &timer_spec, 0) == 0 && ::read(m_timer_fd, &expirations, sizeof(expirations)) > 0)
+        wakeup = 0;
+    }
+#endif
+    now = nowNanoSec();
+    if (wakeup > now)
+      std::this_thread::sleep_for(std::chrono::nanoseconds(wakeup - now));
+  }
+  // Busy-wait for the remaining time
+  while ((now = nowNanoSec()) < deadline)
+  {
+  }
+  return now - deadline;
+}
@@ -58,9 +58,11 @@
  *
  */
 #include "sick_scan/ros_wrapper.h"
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include "sick_scan/multi_device_server.h"
 #include "sick_scan/test_server_thread.h"
 #include "sick_scan/utils.h"
 
@@ -76,6 +78,59 @@ int main(int argc, char** argv)
   int tcp_port_cola = 2111;    // For requests and to transmit settings to the localization controller: IP port number 2111 and 2112 to send telegrams and to request data, SOPAS CoLa-A or CoLa-B protocols
   ROS::param<int>(nh, "/sick_scan/test_server/result_telegrams_tcp_port", tcp_port_results, tcp_port_results);
   ROS::param<int>(nh, "/sick_scan/test_server/cola_telegrams_tcp_port", tcp_port_cola, tcp_port_cola);
+
+  // Multiple devices: configured by list of devices or by number of devices with consecutive ports or ip addresses
+  std::string devices;                     // list of devices, f.e. "port=2112 profile=mrs6xxx serial=1001; port=2113 scandatafiles=tim781s.sdl"
+  int device_count = 0;                    // number of identical devices, 0: single device (default)
+  bool device_consecutive_ips = false;     // true: devices listen to consecutive ip addresses, false: devices listen to consecutive ports
+  int device_serial_number = 0;            // serial number of the first device, 0: profile default
+  double start_scandata_delay = 1;         // delay between scandata activation ("LMCstartmeas" request) and first scandata message
+  sick_scan::MultiDeviceServer::DeviceConfig device_defaults;
+  device_defaults.ip_address = "127.0.0.1";
+  device_defaults.port = tcp_port_cola;
+  ROS::param<std::string>(nh, "/sick_scan_emulator/devices", devices, devices);
+  ROS::param<int>(nh, "/sick_scan_emulator/device_count", device_count, device_count);
+  ROS::param<std::string>(nh, "/sick_scan_emulator/device_base_ip", device_defaults.ip_address, device_defaults.ip_address);
+  ROS::param<int>(nh, "/sick_scan_emulator/device_base_port", device_defaults.port, device_defaults.port);
+  ROS::param<bool>(nh, "/sick_scan_emulator/device_consecutive_ips", device_consecutive_ips, device_consecutive_ips);
+  ROS::param<int>(nh, "/sick_scan_emulator/device_serial_number", device_serial_number, device_serial_number);
+  ROS::param<std::string>(nh, "/sick_scan_emulator/scandatafiles", device_defaults.scandatafiles, device_defaults.scandatafiles);
+  ROS::param<std::string>(nh, "/sick_scan_emulator/scandatatypes", device_defaults.scandatatypes, device_defaults.scandatatypes);
+  ROS::param<std::string>(nh, "/sick_scan_emulator/synthetic_scandata_profile", device_defaults.profile, device_defaults.profile);
+  ROS::param<double>(nh, "/sick_scan_emulator/synthetic_scandata_rate", device_defaults.rate, device_defaults.rate);
+  ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_beams", device_defaults.beams, device_defaults.beams);
+  ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_echos", device_defaults.echos, device_defaults.echos);
+  ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_rssi", device_defaults.rssi, device_defaults.rssi);
+  ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_encoders", device_defaults.encoders, device_defaults.encoders);
+  ROS::param<double>(nh, "/sick_scan/test_server/start_scandata_delay", start_scandata_delay, start_scandata_delay);
+  device_defaults.serial_number = (uint32_t)std::max(0, device_serial_number);
+  if(!devices.empty() || device_count > 0)
+  {
+    std::vector<sick_scan::MultiDeviceServer::DeviceConfig> device_configs;
+    if(!sick_scan::MultiDeviceServer::parseDeviceConfigs(devices, device_defaults, device_configs))
+    {
+      ROS_ERROR_STREAM("## ERROR sick_scan_emulator: invalid configuration \"" << devices << "\" of parameter devices, exit.");
+      ROS::deleteNode(nh);
+      return 1;
+    }
+    if(device_count > 0)
+      sick_scan::MultiDeviceServer::createDeviceConfigs(device_count, device_consecutive_ips, device_defaults, device_configs);
+    sick_scan::MultiDeviceServer multi_device_server(device_configs, start_scandata_delay);
+    if(!multi_device_server.start())
+    {
+      ROS_ERROR_STREAM("## ERROR sick_scan_emulator: failed to start " << device_configs.size() << " devices, exit.");
+      multi_device_server.stop();
+      ROS::deleteNode(nh);
+      return 1;
+    }
+    ROS::spin(nh);
+    ROS_INFO_STREAM("sick_scan_emulator finished.");
+    multi_device_server.stop();
+    ROS_INFO_STREAM("sick_scan_emulator exits.");
+    ROS::deleteNode(nh);
+    return 0;
+  }
+
   sick_scan::TestServerThread test_server_thread(nh, tcp_port_results, tcp_port_cola);
   
   // Subscribe to sim_loc_driver messages to monitor sim_loc_driver in error simulation mode
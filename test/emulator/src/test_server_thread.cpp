@@ -61,6 +61,9 @@
 #include "sick_scan/cola_transmitter.h"
 #include "sick_scan/pcapng_json_parser.h"
 #include "sick_scan/random_generator.h"
+#include "sick_scan/scandata_files.h"
+#include "sick_scan/scandata_generator.h"
+#include "sick_scan/scandata_pacer.h"
 #include "sick_scan/test_server_thread.h"
 #include "sick_scan/testcase_generator.h"
 #include "sick_scan/utils.h"
@@ -78,7 +81,8 @@ sick_scan::TestServerThread::TestServerThread(ROS::NodePtr nh, int ip_port_resul
   m_tcp_acceptor_results(m_ioservice, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), m_ip_port_results)),
   m_tcp_acceptor_cola(m_ioservice, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), m_ip_port_cola)),
   m_start_scandata_delay(1), m_result_telegram_rate(10), m_demo_move_in_circles(false), m_error_simulation_enabled(false), m_error_simulation_flag(NO_ERROR),
-  m_error_simulation_thread(0), m_error_simulation_thread_running(false)
+  m_error_simulation_thread(0), m_error_simulation_thread_running(false), m_synthetic_scandata_rate(-1), m_synthetic_scandata_beams(-1),
+  m_synthetic_scandata_echos(-1), m_synthetic_scandata_rssi(-1), m_synthetic_scandata_encoders(-1)
 {
   m_tcp_acceptor_results.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
   m_tcp_acceptor_cola.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
@@ -87,6 +91,28 @@ sick_scan::TestServerThread::TestServerThread(ROS::NodePtr nh, int ip_port_resul
 
     ROS::param<std::string>(nh, "/sick_scan_emulator/scandatafiles", m_scandatafiles, m_scandatafiles); // comma separated list of jsonfiles to emulate scandata messages, f.e. "tim781s_scandata.pcapng.json,tim781s_sopas.pcapng.json"
     ROS::param<std::string>(nh, "/sick_scan_emulator/scandatatypes", m_scandatatypes, m_scandatatypes); // comma separated list of scandata message types, f.e. "sSN LMDscandata,sSN LMDscandatamon"
+    ROS::param<std::string>(nh, "/sick_scan_emulator/synthetic_scandata_profile", m_synthetic_scandata_profile, m_synthetic_scandata_profile); // device profile of synthetic scandata, f.e. "mrs6xxx"
+    ROS::param<double>(nh, "/sick_scan_emulator/synthetic_scandata_rate", m_synthetic_scandata_rate, m_synthetic_scandata_rate); // scans per second, 0: as fast as possible, -1: scan frequency of the profile
+    ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_beams", m_synthetic_scandata_beams, m_synthetic_scandata_beams);
+    ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_echos", m_synthetic_scandata_echos, m_synthetic_scandata_echos);
+    ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_rssi", m_synthetic_scandata_rssi, m_synthetic_scandata_rssi);
+    ROS::param<int>(nh, "/sick_scan_emulator/synthetic_scandata_encoders", m_synthetic_scandata_encoders, m_synthetic_scandata_encoders);
+    std::string impairment_profile = "none"; // transport impairments of the scandata stream: none, fragmented, ethernet, wifi, congested or garbage
+    ROS::param<std::string>(nh, "/sick_scan_emulator/impairment_profile", impairment_profile, impairment_profile);
+    if(!sick_scan::TransportImpairment::getProfile(impairment_profile, m_impairment_profile))
+      ROS_WARN_STREAM("## ERROR TestServerThread: unknown impairment_profile \"" << impairment_profile << "\", supported profiles: " << sick_scan::TransportImpairment::profileNames() << ", scandata sent without impairments.");
+    int impairment_seed = (int)m_impairment_profile.seed;
+    ROS::param<double>(nh, "/sick_scan_emulator/impairment_fragment_probability", m_impairment_profile.fragment_probability, m_impairment_profile.fragment_probability);
+    ROS::param<int>(nh, "/sick_scan_emulator/impairment_max_fragments", m_impairment_profile.max_fragments, m_impairment_profile.max_fragments);
+    ROS::param<double>(nh, "/sick_scan_emulator/impairment_fragment_delay_usec", m_impairment_profile.fragment_delay_usec, m_impairment_profile.fragment_delay_usec);
+    ROS::param<int>(nh, "/sick_scan_emulator/impairment_burst_size", m_impairment_profile.burst_size, m_impairment_profile.burst_size);
+    ROS::param<double>(nh, "/sick_scan_emulator/impairment_delay_probability", m_impairment_profile.delay_probability, m_impairment_profile.delay_probability);
+    ROS::param<double>(nh, "/sick_scan_emulator/impairment_max_delay_usec", m_impairment_profile.max_delay_usec, m_impairment_profile.max_delay_usec);
+    ROS::param<double>(nh, "/sick_scan_emulator/impairment_bandwidth", m_impairment_profile.bandwidth, m_impairment_profile.bandwidth); // max. bandwidth in MB/s, 0: unlimited
+    ROS::param<double>(nh, "/sick_scan_emulator/impairment_garbage_probability", m_impairment_profile.garbage_probability, m_impairment_profile.garbage_probability);
+    ROS::param<int>(nh, "/sick_scan_emulator/impairment_max_garbage_bytes", m_impairment_profile.max_garbage_bytes, m_impairment_profile.max_garbage_bytes);
+    ROS::param<int>(nh, "/sick_scan_emulator/impairment_seed", impairment_seed, impairment_seed); // seed of the random impairments, 0: random seed
+    m_impairment_profile.seed = (uint32_t)std::max(0, impairment_seed);
     ROS::param<double>(nh, "/sick_scan/test_server/start_scandata_delay", m_start_scandata_delay, m_start_scandata_delay); // delay between scandata activation ("LMCstartmeas" request) and first scandata message, default: 1 second
     std::string result_testcases_topic = "/sick_scan/test_server/result_testcases"; // default topic to publish testcases with result port telegrams (type SickLocResultPortTestcaseMsg)
     ROS::param<double>(nh, "/sick_scan/test_server/result_telegrams_rate", m_result_telegram_rate, m_result_telegram_rate);
@@ -220,6 +246,8 @@ void sick_scan::TestServerThread::closeTcpConnections(bool force_shutdown)
         p_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both);
         p_socket->close();
       }
+      if(p_socket)
+        sick_scan::ColaTransmitter::releaseSocket(*p_socket);
     }
     catch(std::exception & exc)
     {
@@ -246,6 +274,7 @@ void sick_scan::TestServerThread::closeSocket(socket_ptr & p_socket)
     }
     if(p_socket)
     {
+      sick_scan::ColaTransmitter::releaseSocket(*p_socket);
       for(std::list<boost::asio::ip::tcp::socket*>::iterator socket_iter = m_tcp_sockets.begin(); socket_iter != m_tcp_sockets.end(); )
       {
         if(p_socket == *socket_iter)
@@ -536,8 +565,14 @@ void sick_scan::TestServerThread::runWorkerThreadColaCb(boost::asio::ip::tcp::so
  */
 void sick_scan::TestServerThread::runWorkerThreadScandataCb(boost::asio::ip::tcp::socket* p_socket)
 {
-  std::vector<sick_scan::JsonScanData> binary_messages;
+  sick_scan::ScandataFiles scandata_files; // scandata messages read from jsonfiles, binary scandata files or network captures
   ROS_INFO_STREAM("TestServerThread: worker thread sending scandata and scandatamon messages started.");
+  if(!m_synthetic_scandata_profile.empty())
+  {
+    runSyntheticScandata(p_socket);
+    m_tcp_send_scandata_thread_running = false;
+    return;
+  }
   if(m_scandatafiles.empty())
   {
      ROS_WARN_STREAM("## WARNING TestServerThread::runWorkerThreadScandataCb(): no scandata files configured, aborting worker thread to send scandata.");   
@@ -546,29 +581,17 @@ void sick_scan::TestServerThread::runWorkerThreadScandataCb(boost::asio::ip::tcp
   }
   if(ROS::ok() && m_tcp_send_scandata_thread_running)
   {
-    // Read scandata and scandatamon messages from jsonfile
-    std::vector<std::string> scandatafiles = sick_scan::PcapngJsonParser::split(m_scandatafiles, ',');
-    std::vector<std::string> scandatatypes = sick_scan::PcapngJsonParser::split(m_scandatatypes, ',');
-    double start_timestamp = 0;
-    for(int n = 0; n < scandatafiles.size(); n++)
-    {
-      if(!sick_scan::PcapngJsonParser::parseJsonfile(scandatafiles[n], scandatatypes, start_timestamp, binary_messages) || binary_messages.empty())
-      {
-        ROS_WARN_STREAM("## WARNING TestServerThread: error reading file \"" << scandatafiles[n] << "\".");   
-      }
-      else
-      {
-        ROS_INFO_STREAM("TestServerThread: file \"" << scandatafiles[n] << "\" successfully parsed, " << binary_messages.size() << " messages of types \"" << m_scandatatypes << "\".");
-        start_timestamp = binary_messages.back().timestamp + 0.01;
-      }
-    }
+    // Read scandata and scandatamon messages from jsonfiles, binary scandata files or network captures
+    scandata_files.read(m_scandatafiles, m_scandatatypes);
   }
+  const std::vector<sick_scan::ScandataFiles::ScandataFrame> & binary_messages = scandata_files.frames();
   if(binary_messages.empty())
   {
      ROS_WARN_STREAM("## WARNING TestServerThread::runWorkerThreadScandataCb(): no scandata found, aborting worker thread to send scandata.");   
      m_tcp_send_scandata_thread_running = false;
      return;
   }
+  sick_scan::TransportImpairment impairment(m_impairment_profile);
   ROS::sleep(m_start_scandata_delay); // delay between scandata activation ("LMCstartmeas" request) and first scandata message, default: 1 second
   double last_msg_timestamp = 0;
   int iTransmitErrorCnt = 0;
@@ -584,16 +607,17 @@ void sick_scan::TestServerThread::runWorkerThreadScandataCb(boost::asio::ip::tcp
       msg_cnt = std::min(1, (int)binary_messages.size() - 1);
       msg_cnt_delta *= -1;
     }
-    sick_scan::JsonScanData& binary_message = binary_messages[msg_cnt];
+    const sick_scan::ScandataFiles::ScandataFrame& binary_message = binary_messages[msg_cnt];
     ROS::sleep(std::max(0.001, std::abs(binary_message.timestamp - last_msg_timestamp)));
     // Send messages
     // ROS_DEBUG_STREAM("TestServerThread: sending scan data " << sick_scan::Utils::toHexString(binary_message.data));
-    ROS_INFO_STREAM("TestServerThread: sending " << binary_message.data.size() << " byte scan data " 
-      << sick_scan::Utils::toAsciiString(&binary_message.data[8], std::min(32, (int)binary_message.data.size() - 8)) << " ... ");
+    ROS_INFO_STREAM("TestServerThread: sending " << binary_message.size << " byte scan data "
+      << sick_scan::Utils::toAsciiString(binary_message.data + 8, std::min(32, (int)binary_message.size - 8)) << " ... ");
     ROS::Time send_timestamp = ROS::now();
-    if (!sick_scan::ColaTransmitter::send(*p_socket, binary_message.data, send_timestamp))
+    if (!impairment.send(*p_socket, binary_message.data, binary_message.size, send_timestamp))
     {
-      ROS_WARN_STREAM("## ERROR TestServerThread: failed to send cola response, ColaTransmitter::send() returned false, data hexdump: " << sick_scan::Utils::toHexString(binary_message.data));
+      ROS_WARN_STREAM("## ERROR TestServerThread: failed to send cola response, ColaTransmitter::send() returned false, data hexdump: "
+        << sick_scan::Utils::toHexString(std::vector<uint8_t>(binary_message.data, binary_message.data + binary_message.size)));
       iTransmitErrorCnt++;
       if(iTransmitErrorCnt >= 10)
       {
@@ -613,6 +637,70 @@ void sick_scan::TestServerThread::runWorkerThreadScandataCb(boost::asio::ip::tcp
   ROS_INFO_STREAM("TestServerThread: worker thread sending scandata and scandatamon messages finished.");
 }
 
+/*!
+ * Sends synthetic scandata telegrams of device profile m_synthetic_scandata_profile to the tcp client
+ * while m_tcp_send_scandata_thread_running is true.
+ * @param[in] p_socket socket to send scandata telegrams to the tcp client
+ */
+void sick_scan::TestServerThread::runSyntheticScandata(boost::asio::ip::tcp::socket* p_socket)
+{
+  sick_scan::ScandataGenerator::DeviceProfile profile;
+  if(!sick_scan::ScandataGenerator::getDeviceProfile(m_synthetic_scandata_profile, profile))
+  {
+    ROS_WARN_STREAM("## ERROR TestServerThread: unknown synthetic_scandata_profile \"" << m_synthetic_scandata_profile << "\", supported profiles: " << sick_scan::ScandataGenerator::deviceProfileNames());
+    return;
+  }
+  if(m_synthetic_scandata_beams > 0)
+    profile.num_beams = m_synthetic_scandata_beams;
+  if(m_synthetic_scandata_echos > 0)
+    profile.num_echos = m_synthetic_scandata_echos;
+  if(m_synthetic_scandata_rssi >= 0)
+    profile.rssi = (m_synthetic_scandata_rssi > 0);
+  if(m_synthetic_scandata_encoders >= 0)
+    profile.num_encoders = m_synthetic_scandata_encoders;
+  if(m_synthetic_scandata_rate >= 0)
+    profile.scan_frequency = m_synthetic_scandata_rate;
+  sick_scan::ScandataGenerator generator(profile);
+  sick_scan::ScandataPacer pacer(generator.telegramRate());
+  sick_scan::TransportImpairment impairment(m_impairment_profile);
+  ROS_INFO_STREAM("TestServerThread: sending synthetic scandata, profile " << profile.name << ": " << profile.num_layers << " layers, " << profile.num_beams << " beams, "
+    << profile.num_echos << " echos, " << (profile.rssi ? (profile.rssi_8bit ? "8 bit rssi, " : "16 bit rssi, ") : "no rssi, ") << profile.num_encoders << " encoder, "
+    << (generator.telegramRate() > 0 ? (std::to_string(generator.telegramRate()) + " telegrams per second") : std::string("max. rate (link saturation)")));
+  ROS::sleep(m_start_scandata_delay); // delay between scandata activation ("LMCstartmeas" request) and first scandata message, default: 1 second
+  uint64_t start_time = sick_scan::ScandataPacer::nowNanoSec(), report_time = start_time, report_telegrams = 0, report_bytes = 0, max_delay = 0;
+  int iTransmitErrorCnt = 0;
+  while(ROS::ok() && m_tcp_send_scandata_thread_running && p_socket)
+  {
+    max_delay = std::max(max_delay, pacer.wait());
+    uint64_t now = sick_scan::ScandataPacer::nowNanoSec();
+    const std::vector<uint8_t> & telegram = generator.nextTelegram((uint32_t)((now - start_time) / 1000));
+    ROS::Time send_timestamp;
+    if (!impairment.send(*p_socket, telegram.data(), telegram.size(), send_timestamp))
+    {
+      iTransmitErrorCnt++;
+      if(iTransmitErrorCnt >= 10)
+      {
+        ROS_WARN_STREAM("## ERROR TestServerThread: " << iTransmitErrorCnt << " transmission errors, stop sending synthetic scandata.");
+        break;
+      }
+      continue;
+    }
+    iTransmitErrorCnt = 0;
+    report_telegrams++;
+    report_bytes += telegram.size();
+    if(now - report_time >= 1000000000ULL) // report send rate once per second
+    {
+      double seconds = 1.0e-9 * (now - report_time);
+      ROS_INFO_STREAM("TestServerThread: synthetic scandata " << (report_telegrams / seconds) << " telegrams/s, " << (1.0e-6 * report_bytes / seconds) << " MB/s, max. delay "
+        << (1.0e-3 * max_delay) << " microseconds, " << pacer.numLate() << " telegrams late in total");
+      report_time = now;
+      report_telegrams = 0;
+      report_bytes = 0;
+      max_delay = 0;
+    }
+  }
+}
+
 /*!
  * Waits for a given time in seconds, as long as ROS::ok() and m_error_simulation_thread_running == true.
  * @param[in] seconds delay in seconds
@@ -0,0 +1,280 @@
+/*
+ * @brief TransportImpairment emulates an impaired network link (fragmentation, bursts, jitter, bandwidth limit, garbage)
+ *
+ * Copyright (C) 2021 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2021 SICK AG
+ *  Copyright 2021 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include "sick_scan/ros_wrapper.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "sick_scan/cola_transmitter.h"
+#include "sick_scan/scandata_pacer.h"
+#include "sick_scan/transport_impairment.h"
+
+/*!
+ * Returns the profile of a given name
+ * @param[in] name profile name: "none", "fragmented", "ethernet", "wifi", "congested" or "garbage"
+ * @param[out] profile impairment profile
+ * @return true on success, false if the profile name is unknown
+ */
+bool sick_scan::TransportImpairment::getProfile(const std::string & name, Profile & profile)
+{
+  profile = Profile();
+  profile.name = name;
+  if(name == "none" || name.empty())
+  {
+    profile.name = "none";
+  }
+  else if(name == "fragmented") // every telegram in up to 8 tcp segments
+  {
+    profile.fragment_probability = 1;
+    profile.max_fragments = 8;
+    profile.fragment_delay_usec = 50;
+  }
+  else if(name == "ethernet") // switched ethernet: occasional segmentation, small jitter
+  {
+    profile.fragment_probability = 0.1;
+    profile.max_fragments = 3;
+    profile.fragment_delay_usec = 10;
+    profile.max_delay_usec = 50;
+  }
+  else if(name == "wifi") // wifi: bursty delivery, large jitter, aggregated frames, limited bandwidth
+  {
+    profile.fragment_probability = 0.3;
+    profile.max_fragments = 4;
+    profile.fragment_delay_usec = 500;
+    profile.burst_size = 4;
+    profile.delay_probability = 0.1;
+    profile.max_delay_usec = 5000;
+    profile.bandwidth = 5;
+  }
+  else if(name == "congested") // congested link: low bandwidth, delayed and coalesced telegrams
+  {
+    profile.fragment_probability = 0.2;
+    profile.max_fragments = 4;
+    profile.fragment_delay_usec = 1000;
+    profile.delay_probability = 0.3;
+    profile.max_delay_usec = 20000;
+    profile.bandwidth = 1;
+  }
+  else if(name == "garbage") // garbage between telegrams
+  {
+    profile.garbage_probability = 0.5;
+    profile.max_garbage_bytes = 64;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * Returns a comma separated list of all profile names
+ */
+std::string sick_scan::TransportImpairment::profileNames(void)
+{
+  return "none, fragmented, ethernet, wifi, congested, garbage";
+}
+
+/*!
+ * TransportImpairment constructor
+ * @param[in] profile impairments
+ */
+sick_scan::TransportImpairment::TransportImpairment(const Profile & profile)
+: m_profile(profile), m_random_engine(profile.seed ? profile.seed : (uint32_t)std::chrono::steady_clock::now().time_since_epoch().count()),
+  m_num_pending(0), m_link_free_time(0), m_nodelay(false), m_statistics_time(sick_scan::ScandataPacer::nowNanoSec()),
+  m_num_telegrams(0), m_num_fragmented(0), m_num_coalesced(0), m_num_garbage_bytes(0), m_max_throttle_usec(0)
+{
+  m_profile.max_fragments = std::max(1, m_profile.max_fragments);
+  m_profile.burst_size = std::max(1, m_profile.burst_size);
+  if(active())
+  {
+    ROS_INFO_STREAM("TransportImpairment: profile " << m_profile.name << ", fragment probability " << m_profile.fragment_probability << ", max. " << m_profile.max_fragments
+      << " fragments, fragment delay " << m_profile.fragment_delay_usec << " usec, burst size " << m_profile.burst_size << ", delay probability " << m_profile.delay_probability
+      << ", max. jitter " << m_profile.max_delay_usec << " usec, bandwidth " << m_profile.bandwidth << " MB/s, garbage probability " << m_profile.garbage_probability
+      << ", max. " << m_profile.max_garbage_bytes << " garbage bytes");
+  }
+}
+
+/*!
+ * Returns true, if any impairment is configured, or false otherwise (telegrams are sent unchanged)
+ */
+bool sick_scan::TransportImpairment::active(void) const
+{
+  return (m_profile.fragment_probability > 0 && m_profile.max_fragments > 1) || m_profile.burst_size > 1 || m_profile.delay_probability > 0
+    || m_profile.max_delay_usec > 0 || m_profile.bandwidth > 0 || (m_profile.garbage_probability > 0 && m_profile.max_garbage_bytes > 0);
+}
+
+/*!
+ * Returns true with the given probability
+ */
+bool sick_scan::TransportImpairment::randomEvent(double probability)
+{
+  return probability > 0 && std::uniform_real_distribution<double>(0, 1)(m_random_engine) < probability;
+}
+
+/*!
+ * Sends a telegram with impairments. Telegrams held back for a burst or delayed telegrams are not sent
+ * immediately, but together with a following telegram.
+ * @param[in] socket socket to write to
+ * @param[in] data telegram
+ * @param[in] size number of bytes of the telegram
+ * @param[out] send_timestamp send timestamp (ros timestamp immediately before the first tcp write)
+ * @return true on success, false on failure
+ */
+bool sick_scan::TransportImpairment::send(boost::asio::ip::tcp::socket & socket, const uint8_t* data, size_t size, ROS::Time & send_timestamp)
+{
+  if(!active())
+    return sick_scan::ColaTransmitter::send(socket, data, size, send_timestamp);
+  if(!m_nodelay)
+  {
+    boost::system::error_code error_code;
+    socket.set_option(boost::asio::ip::tcp::no_delay(true), error_code); // each fragment in its own tcp segment
+    m_nodelay = true;
+  }
+  m_num_telegrams++;
+  // Garbage in front of the telegram. Garbage bytes never contain <STX>, i.e. the telegrams can be still be decoded.
+  if(m_profile.max_garbage_bytes > 0 && randomEvent(m_profile.garbage_probability))
+  {
+    int num_garbage_bytes = std::uniform_int_distribution<int>(1, m_profile.max_garbage_bytes)(m_random_engine);
+    std::uniform_int_distribution<int> garbage_distribution(0x03, 0xFF);
+    for(int n = 0; n < num_garbage_bytes; n++)
+      m_pending.push_back((uint8_t)garbage_distribution(m_random_engine));
+    m_num_garbage_bytes += num_garbage_bytes;
+  }
+  m_pending.insert(m_pending.end(), data, data + size);
+  m_num_pending++;
+  // Hold back the telegram until the burst is complete, or delay it and send it together with the next telegram
+  if(m_num_pending < m_profile.burst_size || (m_num_pending == m_profile.burst_size && randomEvent(m_profile.delay_probability)))
+  {
+    m_num_coalesced++;
+    send_timestamp = ROS::now();
+    return true;
+  }
+  // Jitter
+  if(m_profile.max_delay_usec > 0)
+  {
+    double delay_usec = std::uniform_real_distribution<double>(0, m_profile.max_delay_usec)(m_random_engine);
+    std::this_thread::sleep_for(std::chrono::nanoseconds((int64_t)(1000 * delay_usec)));
+  }
+  // Fragments at random byte boundaries
+  std::vector<size_t> fragment_sizes;
+  if(m_profile.max_fragments > 1 && m_pending.size() > 1 && randomEvent(m_profile.fragment_probability))
+  {
+    int num_fragments = std::uniform_int_distribution<int>(2, (int)std::min<size_t>(m_profile.max_fragments, m_pending.size()))(m_random_engine);
+    std::uniform_int_distribution<size_t> boundary_distribution(1, m_pending.size() - 1);
+    std::vector<size_t> boundaries;
+    while((int)boundaries.size() < num_fragments - 1)
+    {
+      size_t boundary = boundary_distribution(m_random_engine);
+      if(std::find(boundaries.begin(), boundaries.end(), boundary) == boundaries.end())
+        boundaries.push_back(boundary);
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.push_back(m_pending.size());
+    for(size_t n = 0, start = 0; n < boundaries.size(); start = boundaries[n], n++)
+      fragment_sizes.push_back(boundaries[n] - start);
+    m_num_fragmented++;
+  }
+  else
+  {
+    fragment_sizes.push_back(m_pending.size());
+  }
+  bool success = sick_scan::ColaTransmitter::sendFragments(socket, m_pending.data(), fragment_sizes,
+    [this](size_t fragment_idx, size_t fragment_size) { waitBeforeFragment(fragment_idx, fragment_size); }, send_timestamp);
+  m_pending.clear();
+  m_num_pending = 0;
+  logStatistics();
+  return success;
+}
+
+/*!
+ * Waits until the throttled link can send the next bytes, or after a fragment delay
+ * @param[in] fragment_idx index of the next fragment (delay between fragments if fragment_idx > 0)
+ * @param[in] fragment_size size of the next fragment in byte
+ */
+void sick_scan::TransportImpairment::waitBeforeFragment(size_t fragment_idx, size_t fragment_size)
+{
+  if(fragment_idx > 0 && m_profile.fragment_delay_usec > 0)
+    std::this_thread::sleep_for(std::chrono::nanoseconds((int64_t)(1000 * m_profile.fragment_delay_usec)));
+  if(m_profile.bandwidth > 0)
+  {
+    uint64_t now = sick_scan::ScandataPacer::nowNanoSec();
+    if(m_link_free_time > now) // link still busy with previous bytes
+    {
+      m_max_throttle_usec = std::max(m_max_throttle_usec, (m_link_free_time - now) / 1000);
+      std::this_thread::sleep_for(std::chrono::nanoseconds(m_link_free_time - now));
+      now = m_link_free_time;
+    }
+    m_link_free_time = now + (uint64_t)(1.0e3 * fragment_size / m_profile.bandwidth); // 1 MB/s = 1 byte per microsecond
+  }
+}
+
+/*!
+ * Logs the number of impaired telegrams since the last log
+ */
+void sick_scan::TransportImpairment::logStatistics(void)
+{
+  uint64_t now = sick_scan::ScandataPacer::nowNanoSec();
+  if(now - m_statistics_time < 1000000000ULL) // log once per second
+    return;
+  ROS_INFO_STREAM("TransportImpairment (" << m_profile.name << "): " << m_num_telegrams << " telegrams, " << m_num_fragmented << " fragmented, " << m_num_coalesced << " coalesced, "
+    << m_num_garbage_bytes << " garbage bytes, max. " << m_max_throttle_usec << " microseconds throttled");
+  m_statistics_time = now;
+  m_num_telegrams = 0;
+  m_num_fragmented = 0;
+  m_num_coalesced = 0;
+  m_num_garbage_bytes = 0;
+  m_max_throttle_usec = 0;
+}
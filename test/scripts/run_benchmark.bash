@@ -0,0 +1,127 @@
+#!/bin/bash
+#
+# End-to-end benchmark of sick_scan with sick_scan_emulator: runs emulator and driver headless for a list of device
+# profiles and measures frames per second, latency percentiles (sensor timestamp until pointcloud received), cpu
+# time and allocations of the driver per frame. Results are written as json to ./benchmark/benchmark_<revision>.json
+# (one object per device profile) for tracking across commits. Usage:
+#   ./run_benchmark.bash [duration_seconds [profile ...]]
+# Example:
+#   ./run_benchmark.bash 30 mrs6xxx_multi_echo tim5xx_binary
+# Set TIM5XX_ASCII_SCANDATA to a recording of a TiM5xx in cola ascii (*.pcapng, *.sdl or *.pcapng.json) to run the
+# ascii benchmark, the synthetic scandata of the emulator is cola binary only.
+# Set SICK_SCAN_DRIVER_PARAMS to run the driver with additional parameters and SICK_SCAN_BENCHMARK_TAG to keep the
+# results apart, f.e. to measure the jitter of the realtime mode:
+#   SICK_SCAN_DRIVER_PARAMS="rt_receive_cpu=2 rt_receive_priority=80 rt_spin_usec=200" SICK_SCAN_BENCHMARK_TAG=_rt ./run_benchmark.bash
+#
+pushd ../../../..
+source /opt/ros/melodic/setup.bash
+source ./install/setup.bash
+
+duration=30
+if [ $# -gt 0 ] ; then duration=$1 ; shift ; fi
+
+# Benchmark cases: name | scandata source of the emulator (profile:<device profile>, files:<scandatafiles> or none) | driver launch file | driver node name | cloud topic
+benchmark_cases=(
+  "tim5xx_binary|profile:tim5xx|sick_tim_5xx.launch|sick_tim_5xx|/cloud"
+  "tim5xx_ascii|files:$TIM5XX_ASCII_SCANDATA|sick_tim_5xx_ASCII.launch|sick_tim_5xx|/cloud"
+  "lms5xx|profile:lms5xx|sick_lms_5xx.launch|sick_lms_5xx|/cloud"
+  "mrs1xxx|profile:mrs1xxx|sick_mrs_1xxx.launch|sick_mrs_1xxx|/cloud"
+  "mrs6xxx_multi_echo|profile:mrs6xxx|sick_mrs_6xxx.launch|sick_mrs_6xxx|/cloud"
+  "rms3xx|none|sick_rms_3xx_emul.launch|sick_rms_3xx|/cloud_radar_rawtarget"
+)
+
+revision=`(cd ./src/sick_scan && git rev-parse --short HEAD 2>/dev/null)`
+if [ -z "$revision" ] ; then revision="unknown" ; fi
+mkdir -p ./benchmark
+revision=$revision$SICK_SCAN_BENCHMARK_TAG
+result_file=./benchmark/benchmark_$revision.jsonl
+rm -f $result_file
+malloc_counter_lib=""
+for lib in ./install/lib/libsick_scan_malloc_counter.so ./devel/lib/libsick_scan_malloc_counter.so ; do
+  if [ -f $lib ] ; then malloc_counter_lib=`realpath $lib` ; break ; fi
+done
+if [ -z "$malloc_counter_lib" ] ; then echo -e "run_benchmark.bash: libsick_scan_malloc_counter.so not found, allocations are not counted\n" ; fi
+
+# Start roscore if not yet running
+roscore_running=`(ps -elf | grep roscore | grep -v grep | wc -l)`
+if [ $roscore_running -lt 1 ] ; then
+  roscore &
+  sleep 3
+fi
+
+for benchmark_case in "${benchmark_cases[@]}" ; do
+  IFS='|' read -r name scandata launch_file node_name cloud_topic <<< "$benchmark_case"
+  if [ $# -gt 0 ] && [[ ! " $* " =~ " $name " ]] ; then continue ; fi
+  if [ "$scandata" == "files:" ] ; then
+    echo -e "run_benchmark.bash: no scandata files configured for $name, benchmark skipped\n"
+    continue
+  fi
+  echo -e "run_benchmark.bash: starting benchmark $name ($launch_file, $scandata, $duration seconds)\n"
+
+  # Start sick_scan emulator (without log output to reduce its cpu load)
+  rosparam delete /sick_scan_emulator > /dev/null 2>&1 # remove parameters of the previous benchmark
+  if [[ $scandata == profile:* ]] ; then
+    roslaunch sick_scan emulator_05_synthetic_scandata.launch profile:=${scandata#profile:} > /dev/null 2>&1 &
+    sleep 3
+  elif [[ $scandata == files:* ]] ; then
+    roslaunch sick_scan emulator_01_default.launch scandatafiles:="${scandata#files:}" > /dev/null 2>&1 &
+    sleep 3
+  fi
+
+  # Start sick_scan driver with profiling and allocation counter
+  rosparam set /$node_name/profiling_enable true
+  rosparam set /$node_name/profiling_dump_interval 0
+  for param in $SICK_SCAN_DRIVER_PARAMS ; do
+    rosparam set /$node_name/${param%%=*} ${param#*=}
+  done
+  malloc_counter_file=/tmp/sick_scan_malloc_counter_%p.txt
+  rm -f /tmp/sick_scan_malloc_counter_*.txt
+  if [ -n "$malloc_counter_lib" ] ; then
+    LD_PRELOAD=$malloc_counter_lib SICK_SCAN_MALLOC_COUNTER_FILE=$malloc_counter_file roslaunch sick_scan $launch_file hostname:=127.0.0.1 > /dev/null 2>&1 &
+  else
+    roslaunch sick_scan $launch_file hostname:=127.0.0.1 > /dev/null 2>&1 &
+  fi
+  sleep 3
+  driver_pid=`(pgrep -f "sick_generic_caller.*__name:=$node_name" | head -1)`
+  if [ -z "$driver_pid" ] ; then driver_pid=0 ; fi
+
+  # Measure
+  rosrun sick_scan sick_scan_benchmark _name:=$name _revision:=$revision _cloud_topic:=$cloud_topic _duration:=$duration _driver_pid:=$driver_pid \
+    _malloc_counter_file:=${malloc_counter_file/\%p/$driver_pid} _output_file:=$result_file
+  if [ $? -ne 0 ] ; then echo -e "## ERROR run_benchmark.bash: benchmark $name failed\n" ; fi
+
+  # Shutdown
+  rosnode kill -a > /dev/null 2>&1 ; sleep 1
+  killall sick_generic_caller > /dev/null 2>&1 ; sleep 1
+  killall sick_scan_emulator > /dev/null 2>&1 ; sleep 1
+  rosparam delete /$node_name 2>/dev/null
+done
+killall rosmaster ; sleep 1
+
+# Summary of the latency percentiles as markdown table, f.e. to compare runs with and without SICK_SCAN_DRIVER_PARAMS
+summary_file=./benchmark/benchmark_$revision.md
+echo "| profile | driver parameter | latency p50 [usec] | latency p99 [usec] | latency max [usec] | queue_wait p99 [usec] | queue_wait max [usec] |" > $summary_file
+echo "|---------|------------------|--------------------|--------------------|--------------------|-----------------------|-----------------------|" >> $summary_file
+if [ -f $result_file ] ; then
+  while read -r result ; do
+    name=`echo "$result" | sed -n 's/.*"name": "\([^"]*\)".*/\1/p'`
+    p50=`echo "$result" | sed -n 's/.*"latency_usec": {[^}]*"p50": \([0-9.]*\).*/\1/p'`
+    p99=`echo "$result" | sed -n 's/.*"latency_usec": {[^}]*"p99": \([0-9.]*\).*/\1/p'`
+    max=`echo "$result" | sed -n 's/.*"latency_usec": {[^}]*"max": \([0-9.]*\).*/\1/p'`
+    queue_p99=`echo "$result" | sed -n 's/.*"queue_wait_p99_usec": "\([0-9.]*\)".*/\1/p'`
+    queue_max=`echo "$result" | sed -n 's/.*"queue_wait_max_usec": "\([0-9.]*\)".*/\1/p'`
+    echo "| $name | ${SICK_SCAN_DRIVER_PARAMS:-default} | $p50 | $p99 | $max | $queue_p99 | $queue_max |" >> $summary_file
+  done < $result_file
+fi
+
+# Combine the results into one json document
+json_file=./benchmark/benchmark_$revision.json
+echo "{\"revision\": \"$revision\", \"date\": \"`date -Iseconds`\", \"host\": \"`hostname`\", \"duration_sec\": $duration, \"results\": [" > $json_file
+if [ -f $result_file ] ; then sed '$!s/$/,/' $result_file >> $json_file ; fi
+echo "]}" >> $json_file
+rm -f $result_file
+echo -e "run_benchmark.bash: benchmark finished, results in `realpath $json_file` and `realpath $summary_file`\n"
+cat $json_file
+cat $summary_file
+
+popd
@@ -0,0 +1,284 @@
+/*
+ * @brief End-to-end throughput and latency benchmark of the driver
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 18.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <sensor_msgs/PointCloud2.h>
+
+/*!
+\brief Measurements of one benchmark run: latencies from sensor timestamp to reception of the pointcloud, received
+frames and bytes, and the last profiling summary of the driver
+*/
+class BenchmarkStatistics
+{
+public:
+  BenchmarkStatistics() : m_measuring(false), m_bytes(0) {}
+
+  void start(void)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latencies.clear();
+    m_bytes = 0;
+    m_measuring = true;
+  }
+
+  void stop(void)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_measuring = false;
+  }
+
+  void cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud)
+  {
+    double latency_usec = 1.0e6 * (ros::Time::now() - cloud->header.stamp).toSec();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_measuring)
+    {
+      m_latencies.push_back(latency_usec);
+      m_bytes += cloud->data.size();
+    }
+  }
+
+  void diagnosticsCallback(const diagnostic_msgs::DiagnosticArrayConstPtr& diagnostics)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t n = 0; n < diagnostics->status.size(); n++)
+    {
+      if (diagnostics->status[n].name.find("profiling") != std::string::npos)
+      {
+        m_profiling.clear();
+        for (size_t m = 0; m < diagnostics->status[n].values.size(); m++)
+          m_profiling[diagnostics->status[n].values[m].key] = diagnostics->status[n].values[m].value;
+      }
+    }
+  }
+
+  size_t numFrames(void)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latencies.size();
+  }
+
+  std::mutex m_mutex;
+  bool m_measuring;
+  std::vector<double> m_latencies;
+  size_t m_bytes;
+  std::map<std::string, std::string> m_profiling;
+};
+
+/*!
+\brief Returns the cpu time (user + system) of a process in seconds, or -1 if the process is not found
+*/
+static double processCpuTime(int pid)
+{
+  std::ifstream stat_file("/proc/" + std::to_string(pid) + "/stat");
+  std::string stat;
+  if (pid <= 0 || !std::getline(stat_file, stat))
+    return -1;
+  size_t pos = stat.rfind(')'); // the process name may contain spaces
+  if (pos == std::string::npos)
+    return -1;
+  std::istringstream fields(stat.substr(pos + 2));
+  std::string field;
+  unsigned long long utime = 0, stime = 0;
+  for (int n = 3; n <= 15 && fields >> field; n++) // fields 14 and 15: utime and stime in clock ticks
+  {
+    if (n == 14)
+      utime = std::stoull(field);
+    else if (n == 15)
+      stime = std::stoull(field);
+  }
+  return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/*!
+\brief Reads the allocation counters written by libsick_scan_malloc_counter.so (number of allocations, number of
+frees, bytes allocated). Returns false if the counter file does not exist.
+*/
+static bool readMallocCounter(const std::string& filename, unsigned long long& num_allocs, unsigned long long& num_frees, unsigned long long& bytes)
+{
+  std::ifstream counter_file(filename);
+  return !filename.empty() && (counter_file >> num_allocs >> num_frees >> bytes);
+}
+
+/*!
+\brief Returns a json string literal
+*/
+static std::string jsonString(const std::string& value)
+{
+  std::string json = "\"";
+  for (size_t n = 0; n < value.size(); n++)
+  {
+    if (value[n] == '"' || value[n] == '\\')
+      json += '\\';
+    if ((unsigned char)value[n] >= 0x20)
+      json += value[n];
+  }
+  return json + "\"";
+}
+
+/*!
+\brief Returns a percentile of sorted values
+*/
+static double percentile(const std::vector<double>& sorted_values, double p)
+{
+  if (sorted_values.empty())
+    return 0;
+  return sorted_values[std::min(sorted_values.size() - 1, (size_t)(0.01 * p * sorted_values.size()))];
+}
+
+/*!
+\brief End-to-end benchmark of the driver. Subscribes to the pointcloud of the driver, waits for the warmup time and
+measures for the given duration:
+- frames per second and pointcloud bandwidth,
+- end-to-end latency percentiles (sensor timestamp of the pointcloud until reception),
+- cpu time of the driver process per frame (parameter driver_pid),
+- allocations of the driver process per frame (parameter malloc_counter_file, requires the driver to be started with
+  LD_PRELOAD=libsick_scan_malloc_counter.so and SICK_SCAN_MALLOC_COUNTER_FILE=<malloc_counter_file>),
+- the profiling summary of the driver (if the driver runs with profiling_enable).
+The result is printed as one json object and appended to parameter output_file, f.e.
+rosrun sick_scan sick_scan_benchmark _name:=mrs6xxx _cloud_topic:=/cloud _duration:=30 _driver_pid:=1234 _output_file:=/tmp/benchmark.json
+See test/scripts/run_benchmark.bash to launch emulator, driver and benchmark for a list of device profiles.
+*/
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "sick_scan_benchmark");
+  ros::NodeHandle nh, pn("~");
+  std::string name = "benchmark", cloud_topic = "/cloud", output_file, malloc_counter_file, revision;
+  double duration = 30, warmup = 5, timeout = 60;
+  int driver_pid = 0;
+  pn.param<std::string>("name", name, name);
+  pn.param<std::string>("cloud_topic", cloud_topic, cloud_topic);
+  pn.param<double>("duration", duration, duration);
+  pn.param<double>("warmup", warmup, warmup);
+  pn.param<double>("timeout", timeout, timeout); // max. time to wait for the first pointcloud
+  pn.param<int>("driver_pid", driver_pid, driver_pid);
+  pn.param<std::string>("malloc_counter_file", malloc_counter_file, malloc_counter_file);
+  pn.param<std::string>("output_file", output_file, output_file);
+  pn.param<std::string>("revision", revision, revision);
+
+  BenchmarkStatistics statistics;
+  ros::Subscriber cloud_sub = nh.subscribe(cloud_topic, 100, &BenchmarkStatistics::cloudCallback, &statistics, ros::TransportHints().tcpNoDelay());
+  ros::Subscriber diagnostics_sub = nh.subscribe("/diagnostics", 10, &BenchmarkStatistics::diagnosticsCallback, &statistics);
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  // Wait for the first pointcloud and the warmup time (pll synchronization, startup allocations)
+  ROS_INFO("sick_scan_benchmark %s: waiting for pointclouds on topic %s", name.c_str(), cloud_topic.c_str());
+  statistics.start();
+  ros::WallTime wait_start = ros::WallTime::now();
+  while (ros::ok() && statistics.numFrames() == 0 && (ros::WallTime::now() - wait_start).toSec() < timeout)
+    ros::WallDuration(0.01).sleep();
+  bool cloud_received = statistics.numFrames() > 0;
+  if (cloud_received)
+    ros::WallDuration(warmup).sleep();
+  else
+    ROS_ERROR("## ERROR sick_scan_benchmark %s: no pointcloud received on topic %s within %.0f seconds", name.c_str(), cloud_topic.c_str(), timeout);
+
+  // Measure
+  unsigned long long allocs_start = 0, frees_start = 0, bytes_start = 0, allocs_end = 0, frees_end = 0, bytes_end = 0;
+  bool malloc_counter = readMallocCounter(malloc_counter_file, allocs_start, frees_start, bytes_start);
+  double cpu_start = processCpuTime(driver_pid);
+  ros::WallTime measure_start = ros::WallTime::now();
+  statistics.start();
+  if (cloud_received)
+  {
+    ROS_INFO("sick_scan_benchmark %s: measuring for %.0f seconds", name.c_str(), duration);
+    while (ros::ok() && (ros::WallTime::now() - measure_start).toSec() < duration)
+      ros::WallDuration(0.01).sleep();
+  }
+  statistics.stop();
+  double measure_time = (ros::WallTime::now() - measure_start).toSec();
+  double cpu_end = processCpuTime(driver_pid);
+  malloc_counter = malloc_counter && readMallocCounter(malloc_counter_file, allocs_end, frees_end, bytes_end);
+  spinner.stop();
+
+  // Print and save the result as json
+  std::lock_guard<std::mutex> lock(statistics.m_mutex);
+  std::vector<double>& latencies = statistics.m_latencies;
+  size_t num_frames = latencies.size();
+  std::sort(latencies.begin(), latencies.end());
+  double latency_sum = 0;
+  for (size_t n = 0; n < num_frames; n++)
+    latency_sum += latencies[n];
+  std::ostringstream json;
+  json.setf(std::ios::fixed);
+  json.precision(3);
+  json << "{\"name\": " << jsonString(name) << ", \"revision\": " << jsonString(revision) << ", \"cloud_topic\": " << jsonString(cloud_topic)
+       << ", \"duration_sec\": " << measure_time << ", \"frames\": " << num_frames
+       << ", \"frames_per_sec\": " << (num_frames / std::max(measure_time, 1.0e-3))
+       << ", \"mbytes_per_sec\": " << (1.0e-6 * statistics.m_bytes / std::max(measure_time, 1.0e-3))
+       << ", \"latency_usec\": {\"mean\": " << (num_frames > 0 ? (latency_sum / num_frames) : 0) << ", \"p50\": " << percentile(latencies, 50)
+       << ", \"p90\": " << percentile(latencies, 90) << ", \"p99\": " << percentile(latencies, 99) << ", \"p99.9\": " << percentile(latencies, 99.9)
+       << ", \"max\": " << (num_frames > 0 ? latencies.back() : 0) << "}";
+  if (cpu_start >= 0 && cpu_end >= 0)
+  {
+    json << ", \"cpu_percent\": " << (100 * (cpu_end - cpu_start) / std::max(measure_time, 1.0e-3))
+         << ", \"cpu_usec_per_frame\": " << (num_frames > 0 ? (1.0e6 * (cpu_end - cpu_start) / num_frames) : 0);
+  }
+  if (malloc_counter)
+  {
+    json << ", \"allocs_per_frame\": " << (num_frames > 0 ? ((double)(allocs_end - allocs_start) / num_frames) : 0)
+         << ", \"alloc_bytes_per_frame\": " << (num_frames > 0 ? ((double)(bytes_end - bytes_start) / num_frames) : 0)
+         << ", \"frees_per_frame\": " << (num_frames > 0 ? ((double)(frees_end - frees_start) / num_frames) : 0);
+  }
+  if (!statistics.m_profiling.empty())
+  {
+    json << ", \"driver_profiling\": {";
+    for (std::map<std::string, std::string>::iterator iter = statistics.m_profiling.begin(); iter != statistics.m_profiling.end(); iter++)
+      json << (iter == statistics.m_profiling.begin() ? "" : ", ") << jsonString(iter->first) << ": " << jsonString(iter->second);
+    json << "}";
+  }
+  json << "}";
+  printf("%s\n", json.str().c_str());
+  if (!output_file.empty())
+  {
+    std::ofstream result_file(output_file, std::ios::app);
+    result_file << json.str() << std::endl;
+    if (!result_file)
+      ROS_ERROR("## ERROR sick_scan_benchmark: can't write to %s", output_file.c_str());
+  }
+  return (cloud_received && num_frames > 0) ? 0 : 1;
+}
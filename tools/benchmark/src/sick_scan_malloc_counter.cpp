@@ -0,0 +1,164 @@
+/*
+ * @brief Allocation counter preloaded into the driver for benchmarks
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 18.02.2021
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+/*
+ * Allocation counter for the benchmark. Preloaded into the driver process, it counts all allocations (malloc, calloc,
+ * realloc, memalign, posix_memalign, aligned_alloc and operator new, which calls malloc) and frees, and writes
+ * "<allocations> <frees> <bytes allocated>" to file $SICK_SCAN_MALLOC_COUNTER_FILE every 100 milliseconds.
+ * "%p" in the filename is replaced by the process id. Usage:
+ * LD_PRELOAD=libsick_scan_malloc_counter.so SICK_SCAN_MALLOC_COUNTER_FILE=/tmp/sick_scan_malloc_%p.txt roslaunch ...
+ * The counter uses the glibc allocator functions (__libc_malloc etc.) and is available on Linux with glibc only.
+ */
+
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t num, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void* __libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void* ptr);
+}
+
+static std::atomic<unsigned long long> s_num_allocs(0);
+static std::atomic<unsigned long long> s_num_frees(0);
+static std::atomic<unsigned long long> s_num_bytes(0);
+
+static inline void countAlloc(void* ptr, size_t size)
+{
+  if (ptr)
+  {
+    s_num_allocs.fetch_add(1, std::memory_order_relaxed);
+    s_num_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+extern "C"
+{
+  void* malloc(size_t size)
+  {
+    void* ptr = __libc_malloc(size);
+    countAlloc(ptr, size);
+    return ptr;
+  }
+
+  void* calloc(size_t num, size_t size)
+  {
+    void* ptr = __libc_calloc(num, size);
+    countAlloc(ptr, num * size);
+    return ptr;
+  }
+
+  void* realloc(void* ptr, size_t size)
+  {
+    void* new_ptr = __libc_realloc(ptr, size);
+    countAlloc(new_ptr, size);
+    if (ptr && new_ptr)
+      s_num_frees.fetch_add(1, std::memory_order_relaxed);
+    return new_ptr;
+  }
+
+  void* memalign(size_t alignment, size_t size)
+  {
+    void* ptr = __libc_memalign(alignment, size);
+    countAlloc(ptr, size);
+    return ptr;
+  }
+
+  int posix_memalign(void** ptr, size_t alignment, size_t size)
+  {
+    *ptr = __libc_memalign(alignment, size);
+    countAlloc(*ptr, size);
+    return *ptr ? 0 : 12; // ENOMEM
+  }
+
+  void* aligned_alloc(size_t alignment, size_t size)
+  {
+    void* ptr = __libc_memalign(alignment, size);
+    countAlloc(ptr, size);
+    return ptr;
+  }
+
+  void free(void* ptr)
+  {
+    if (ptr)
+      s_num_frees.fetch_add(1, std::memory_order_relaxed);
+    __libc_free(ptr);
+  }
+}
+
+/*
+ * Writes the counters periodically to $SICK_SCAN_MALLOC_COUNTER_FILE
+ */
+class MallocCounterWriter
+{
+public:
+  MallocCounterWriter()
+  {
+    const char* filename = getenv("SICK_SCAN_MALLOC_COUNTER_FILE");
+    if (!filename || !*filename)
+      return;
+    std::string counter_file(filename);
+    size_t pos = counter_file.find("%p");
+    if (pos != std::string::npos)
+      counter_file.replace(pos, 2, std::to_string(getpid()));
+    std::thread writer_thread([counter_file]()
+    {
+      std::string tmp_file = counter_file + ".tmp";
+      while (true)
+      {
+        FILE* fp = fopen(tmp_file.c_str(), "w");
+        if (fp)
+        {
+          fprintf(fp, "%llu %llu %llu\n", s_num_allocs.load(), s_num_frees.load(), s_num_bytes.load());
+          fclose(fp);
+          rename(tmp_file.c_str(), counter_file.c_str()); // readers never see a partially written file
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+    });
+    writer_thread.detach();
+  }
+};
+
+static MallocCounterWriter s_malloc_counter_writer;
@@ -0,0 +1,155 @@
+/*
+ * @brief Example and latency measurement for the C API
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sick_scan/sick_scan_api.h"
+
+#define MAX_LATENCIES 1000000
+
+static volatile int s_running = 1;
+
+static void signalHandler(int signum)
+{
+  (void)signum;
+  s_running = 0;
+}
+
+static int compareDouble(const void* a, const void* b)
+{
+  double d = *(const double*)a - *(const double*)b;
+  return (d < 0) ? -1 : ((d > 0) ? 1 : 0);
+}
+
+static void printLatencies(const char* name, double* latencies, size_t num_latencies)
+{
+  double sum = 0;
+  size_t n;
+  if (num_latencies == 0)
+    return;
+  qsort(latencies, num_latencies, sizeof(double), compareDouble);
+  for (n = 0; n < num_latencies; n++)
+    sum += latencies[n];
+  printf("%-22s mean=%.1f p50=%.1f p99=%.1f max=%.1f [usec]\n", name, sum / num_latencies, latencies[num_latencies / 2],
+         latencies[(size_t)(0.99 * (num_latencies - 1))], latencies[num_latencies - 1]);
+}
+
+/*
+** Example for the C API: connects to a device (or replays a recording), polls the scans from the ring buffer and
+** prints the latency from receiving the scan telegram until the application reads the scan. Usage:
+** sick_scan_api_example <hostname> [<port>] [<seconds>]
+** sick_scan_api_example <file.sdl|file.pcapng> [<speed>] [<repeat>]
+*/
+int main(int argc, char** argv)
+{
+  SickScanApiHandle handle;
+  SickScanApiScan scan;
+  double* decode_latencies;
+  double* poll_latencies;
+  size_t num_latencies = 0;
+  uint64_t num_scans = 0, num_dropped = 0, num_errors = 0, num_points = 0, start_time, end_time = 0;
+  int result;
+
+  if (argc < 2)
+  {
+    printf("Usage:\n  %s <hostname> [<port>] [<seconds>]\n  %s <file.sdl|file.pcapng> [<speed>] [<repeat>]\n", argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+  signal(SIGINT, signalHandler);
+  handle = SickScanApiCreate(16, 64 * 1024);
+  decode_latencies = (double*)malloc(MAX_LATENCIES * sizeof(double));
+  poll_latencies = (double*)malloc(MAX_LATENCIES * sizeof(double));
+  if (!handle || !decode_latencies || !poll_latencies)
+  {
+    printf("## ERROR sick_scan_api_example: out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  if (strstr(argv[1], ".sdl") || strstr(argv[1], ".pcap"))
+  {
+    double speed = (argc > 2) ? atof(argv[2]) : 1.0;
+    int repeat = (argc > 3) ? atoi(argv[3]) : 1;
+    result = SickScanApiReplay(handle, argv[1], speed, repeat);
+  }
+  else
+  {
+    int port = (argc > 2) ? atoi(argv[2]) : 2112;
+    double seconds = (argc > 3) ? atof(argv[3]) : 10;
+    result = SickScanApiConnect(handle, argv[1], port, 5000);
+    end_time = SickScanApiSystemTimeNanoSec() + (uint64_t)(1.0e9 * seconds);
+  }
+  if (result != SICK_SCAN_API_SUCCESS)
+  {
+    printf("## ERROR sick_scan_api_example: can't open %s (error %d)\n", argv[1], result);
+    SickScanApiRelease(handle);
+    return EXIT_FAILURE;
+  }
+
+  start_time = SickScanApiSystemTimeNanoSec();
+  while (s_running && (end_time == 0 || SickScanApiSystemTimeNanoSec() < end_time))
+  {
+    result = SickScanApiPollScan(handle, &scan, 100);
+    if (result == SICK_SCAN_API_SUCCESS)
+    {
+      uint64_t poll_time = SickScanApiSystemTimeNanoSec();
+      if (num_latencies < MAX_LATENCIES)
+      {
+        decode_latencies[num_latencies] = 1.0e-3 * (double)(scan.publish_time_nsec - scan.recv_time_nsec);
+        poll_latencies[num_latencies] = 1.0e-3 * (double)(poll_time - scan.recv_time_nsec);
+        num_latencies++;
+      }
+      num_points += scan.num_points;
+      SickScanApiReleaseScan(handle, &scan);
+    }
+    else if (!SickScanApiIsRunning(handle))
+    {
+      break;
+    }
+  }
+
+  SickScanApiGetStatistics(handle, &num_scans, &num_dropped, &num_errors);
+  printf("%.1f sec: %llu scans, %llu dropped, %llu errors, %llu points\n", 1.0e-9 * (double)(SickScanApiSystemTimeNanoSec() - start_time),
+         (unsigned long long)num_scans, (unsigned long long)num_dropped, (unsigned long long)num_errors, (unsigned long long)num_points);
+  printLatencies("receive to ring buffer", decode_latencies, num_latencies);
+  printLatencies("receive to application", poll_latencies, num_latencies);
+  SickScanApiDisconnect(handle);
+  SickScanApiRelease(handle);
+  free(decode_latencies);
+  free(poll_latencies);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/*
+ * @brief Scaling benchmark of the parallel pointcloud build
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 16.02.2021
+ *
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "sick_scan/sick_scan_decoded_scan.h"
+#include "sick_scan/sick_scan_thread_pool.h"
+
+/*!
+\brief Measures the runtime of the pointcloud build of a frame with 1 to max_threads threads.
+Usage: sick_scan_cloud_build_benchmark [num_layers=24] [num_echos=3] [num_beams=924] [max_threads=8] [num_frames=200] [min_beams_per_task=128]
+Default values correspond to a MRS6124 with 3 echos.
+*/
+int main(int argc, char** argv)
+{
+  int num_layers = (argc > 1) ? atoi(argv[1]) : 24;
+  int num_echos = (argc > 2) ? atoi(argv[2]) : 3;
+  int num_beams = (argc > 3) ? atoi(argv[3]) : 924;
+  int max_threads = (argc > 4) ? atoi(argv[4]) : 8;
+  int num_frames = (argc > 5) ? atoi(argv[5]) : 200;
+  int min_beams_per_task = (argc > 6) ? atoi(argv[6]) : 128;
+  const size_t point_step = 5 * sizeof(float); // x, y, z, intensity, time
+
+  // Synthetic decoded scans of all layers
+  std::vector<sick_scan::SickScanDecodedScan> layers(num_layers);
+  std::vector<int> echo_idx(num_echos);
+  for (int echo = 0; echo < num_echos; echo++)
+    echo_idx[echo] = echo;
+  for (int layer = 0; layer < num_layers; layer++)
+  {
+    std::vector<float> ranges(num_echos * num_beams), intensities(num_echos * num_beams);
+    for (size_t n = 0; n < ranges.size(); n++)
+    {
+      ranges[n] = 1.0f + 0.001f * (float)(n % 10000);
+      intensities[n] = (float)(n % 255);
+    }
+    layers[layer].assign(num_echos, ranges, intensities, ros::Time(), 1.0e-5f);
+    layers[layer].setAzimuth(-M_PI / 3, (2 * M_PI / 3) / num_beams, NULL);
+    layers[layer].setElevation((float)((layer - num_layers / 2) * M_PI / 180));
+  }
+  size_t echo_stride = num_beams * point_step;
+  size_t layer_stride = num_echos * echo_stride;
+  std::vector<uint8_t> cloud(num_layers * layer_stride);
+
+  printf("pointcloud build of %d layers x %d echos x %d beams (%d points per frame), %d frames\n",
+         num_layers, num_echos, num_beams, num_layers * num_echos * num_beams, num_frames);
+  printf("threads   usec/frame   Mpoints/s   speedup   stolen tasks/frame\n");
+  double usec_single_thread = 0;
+  for (int num_threads = 1; num_threads <= max_threads; num_threads++)
+  {
+    sick_scan::SickScanThreadPool pool(num_threads);
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < num_frames; frame++)
+    {
+      for (int layer = 0; layer < num_layers; layer++)
+      {
+        layers[layer].toCloudParallel(&pool, min_beams_per_task, num_echos, &echo_idx[0], &cloud[layer * layer_stride], point_step,
+                                      echo_stride, true, true, 0.0f);
+      }
+    }
+    double usec = 1.0e-3 * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count() / num_frames;
+    if (num_threads == 1)
+      usec_single_thread = usec;
+    printf("%7d   %10.1f   %9.1f   %7.2f   %18.1f\n", num_threads, usec, (double)num_layers * num_echos * num_beams / usec,
+           usec_single_thread / usec, (double)pool.getNumStolen() / num_frames);
+  }
+  return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * @brief Runtime of the voxel grid reduction compared to pcl::VoxelGrid
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 18.02.2021
+ *
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/PCLPointCloud2.h>
+#include <pcl_conversions/pcl_conversions.h>
+
+#include "sick_scan/sick_scan_cloud_reducer.h"
+#include "sick_scan/sick_scan_decoded_scan.h"
+
+/*!
+\brief Runtime of SickScanCloudReducer (voxel, decimation, range_bin) compared to pcl::VoxelGrid on the same frames.
+pcl::VoxelGrid is measured with and without the conversion between sensor_msgs::PointCloud2 and pcl::PCLPointCloud2,
+which a driver using pcl would need in addition.
+Usage: sick_scan_cloud_reduction_benchmark [num_layers=24] [num_echos=3] [num_beams=924] [voxel_size=0.1] [num_frames=100]
+Default values correspond to a MRS6124 with 3 echos.
+*/
+int main(int argc, char** argv)
+{
+  int num_layers = (argc > 1) ? atoi(argv[1]) : 24;
+  int num_echos = (argc > 2) ? atoi(argv[2]) : 3;
+  int num_beams = (argc > 3) ? atoi(argv[3]) : 924;
+  double voxel_size = (argc > 4) ? atof(argv[4]) : 0.1;
+  int num_frames = (argc > 5) ? atoi(argv[5]) : 100;
+  const int num_channels = 4; // x, y, z, intensity
+  const size_t point_step = num_channels * sizeof(float);
+
+  // Synthetic frame with all layers, rows ordered by echo and layer like the driver pointcloud
+  std::vector<int> echo_idx(num_echos);
+  for (int echo = 0; echo < num_echos; echo++)
+    echo_idx[echo] = echo;
+  sensor_msgs::PointCloud2 cloud;
+  cloud.header.frame_id = "cloud";
+  cloud.height = num_layers * num_echos;
+  cloud.width = num_beams;
+  cloud.is_bigendian = false;
+  cloud.is_dense = true;
+  cloud.point_step = point_step;
+  cloud.row_step = point_step * num_beams;
+  cloud.fields.resize(num_channels);
+  for (int i = 0; i < num_channels; i++)
+  {
+    std::string channelId[] = {"x", "y", "z", "intensity"};
+    cloud.fields[i].name = channelId[i];
+    cloud.fields[i].offset = i * sizeof(float);
+    cloud.fields[i].count = 1;
+    cloud.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+  }
+  cloud.data.resize((size_t)cloud.row_step * cloud.height);
+  size_t echo_stride = (size_t)cloud.row_step * num_layers;
+  for (int layer = 0; layer < num_layers; layer++)
+  {
+    std::vector<float> ranges(num_echos * num_beams), intensities(num_echos * num_beams);
+    for (size_t n = 0; n < ranges.size(); n++)
+    {
+      ranges[n] = 2.0f + 10.0f * (float)((n * 7919) % 1000) / 1000.0f;
+      intensities[n] = (float)(n % 255);
+    }
+    sick_scan::SickScanDecodedScan layer_scan;
+    layer_scan.assign(num_echos, ranges, intensities, ros::Time(), 1.0e-5f);
+    layer_scan.setAzimuth(-M_PI / 3, (2 * M_PI / 3) / num_beams, NULL);
+    layer_scan.setElevation((float)((layer - num_layers / 2) * M_PI / 180));
+    layer_scan.toCloud(num_echos, &echo_idx[0], &cloud.data[(size_t)layer * cloud.row_step], point_step, echo_stride, true, false, 0.0f, 0, num_beams);
+  }
+
+  printf("pointcloud reduction of %d layers x %d echos x %d beams (%d points per frame), voxel size %.3f m, %d frames\n",
+         num_layers, num_echos, num_beams, num_layers * num_echos * num_beams, voxel_size, num_frames);
+  printf("reduction                              usec/frame   points/frame\n");
+
+  // sick_scan reductions
+  const char* reductions[3] = { "voxel", "decimation", "range_bin" };
+  for (int n = 0; n < 3; n++)
+  {
+    sick_scan::SickScanCloudReducer reducer;
+    reducer.setReduction(reductions[n], 4, 10, voxel_size);
+    size_t num_points = 0;
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < num_frames; frame++)
+    {
+      const sensor_msgs::PointCloud2& reduced = reducer.reduce(cloud);
+      num_points = (size_t)reduced.width * reduced.height;
+    }
+    double usec = 1.0e-3 * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count() / num_frames;
+    printf("sick_scan %-28s %10.1f   %12zu\n", reductions[n], usec, num_points);
+  }
+
+  // pcl::VoxelGrid with the same voxel size, all fields are averaged like in SickScanCloudReducer
+  pcl::VoxelGrid<pcl::PCLPointCloud2> voxel_grid;
+  voxel_grid.setLeafSize((float)voxel_size, (float)voxel_size, (float)voxel_size);
+  voxel_grid.setDownsampleAllData(true);
+  pcl::PCLPointCloud2::Ptr pcl_cloud(new pcl::PCLPointCloud2());
+  pcl::PCLPointCloud2 pcl_reduced;
+  sensor_msgs::PointCloud2 reduced;
+  double usec_filter = 0;
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < num_frames; frame++)
+  {
+    pcl_conversions::toPCL(cloud, *pcl_cloud);
+    std::chrono::steady_clock::time_point filter_start_time = std::chrono::steady_clock::now();
+    voxel_grid.setInputCloud(pcl_cloud);
+    voxel_grid.filter(pcl_reduced);
+    usec_filter += 1.0e-3 * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - filter_start_time).count();
+    pcl_conversions::fromPCL(pcl_reduced, reduced);
+  }
+  double usec = 1.0e-3 * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count() / num_frames;
+  printf("pcl::VoxelGrid                         %10.1f   %12zu\n", usec_filter / num_frames, (size_t)reduced.width * reduced.height);
+  printf("pcl::VoxelGrid incl. conversion        %10.1f   %12zu\n", usec, (size_t)reduced.width * reduced.height);
+  return 0;
+}
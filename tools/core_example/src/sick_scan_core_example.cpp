@@ -0,0 +1,181 @@
+/*
+ * @brief Example for the ROS independent driver core
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sick_scan/sick_scan_core.h"
+#include "sick_scan/sick_scan_datagram_log.h"
+#include "sick_scan/sick_scan_pcapng_reader.h"
+
+static volatile bool s_running = true;
+
+static void signalHandler(int)
+{
+  s_running = false;
+}
+
+/*!
+\brief Counts the outputs of the driver core
+*/
+class CoreStatistics
+{
+public:
+  CoreStatistics() : num_scans(0), num_points(0), num_imu(0), num_field_events(0), num_telegrams(0) {}
+
+  void print(const sick_scan::SickScanCore& core, double duration_sec)
+  {
+    printf("%.1f sec: %llu telegrams, %llu scans (%.1f Hz), %llu points, %llu imu, %llu field events, %llu other telegrams, %llu errors, %.2f MB/s\n",
+           duration_sec, (unsigned long long)core.getNumTelegrams(), (unsigned long long)num_scans, num_scans / std::max(duration_sec, 1.0e-6),
+           (unsigned long long)num_points, (unsigned long long)num_imu, (unsigned long long)num_field_events, (unsigned long long)num_telegrams,
+           (unsigned long long)core.getNumErrors(), 1.0e-6 * core.getNumBytes() / std::max(duration_sec, 1.0e-6));
+  }
+
+  uint64_t num_scans;
+  uint64_t num_points;
+  uint64_t num_imu;
+  uint64_t num_field_events;
+  uint64_t num_telegrams;
+};
+
+/*!
+\brief Replays a datagram log (*.sdl) or network capture (*.pcapng, *.pcap) as fast as possible
+*/
+static bool replay(sick_scan::SickScanCore& core, const std::string& filename, int repeat)
+{
+  std::vector<std::vector<uint8_t> > datagrams;
+  uint32_t sec = 0, nsec = 0;
+  std::vector<uint8_t> datagram;
+  if (filename.size() > 4 && filename.substr(filename.size() - 4) == ".sdl")
+  {
+    sick_scan::SickScanDatagramLogReader reader;
+    if (!reader.open(filename))
+      return false;
+    for (size_t n = 0; n < reader.numDatagrams(); n++)
+      if (reader.read(n, sec, nsec, datagram))
+        datagrams.push_back(datagram);
+  }
+  else
+  {
+    sick_scan::SickScanPcapngReader reader;
+    if (!reader.open(filename))
+      return false;
+    while (reader.read(sec, nsec, datagram))
+      datagrams.push_back(datagram);
+  }
+  printf("sick_scan_core_example: replaying %zu datagrams from %s %d times\n", datagrams.size(), filename.c_str(), repeat);
+  for (int cnt = 0; s_running && cnt < repeat; cnt++)
+  {
+    for (size_t n = 0; n < datagrams.size(); n++)
+      core.processReceivedBytes(datagrams[n].data(), datagrams[n].size(), sick_scan::SickScanCore::systemTimeNanoSec());
+  }
+  return true;
+}
+
+/*!
+\brief Example for the ROS independent driver core: connects to a device (or replays a recording) and prints
+the number of decoded scans, points, imu and field evaluation messages. Usage:
+sick_scan_core_example <hostname> [<port>] [<seconds>] [--mirrored]
+sick_scan_core_example <file.sdl|file.pcapng> [<repeat>] [--mirrored]
+*/
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    printf("Usage:\n  %s <hostname> [<port>] [<seconds>] [--mirrored]\n  %s <file.sdl|file.pcapng> [<repeat>] [--mirrored]\n", argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> args;
+  bool mirrored = false;
+  for (int n = 1; n < argc; n++)
+  {
+    if (strcmp(argv[n], "--mirrored") == 0)
+      mirrored = true;
+    else
+      args.push_back(argv[n]);
+  }
+  signal(SIGINT, signalHandler);
+
+  CoreStatistics statistics;
+  sick_scan::SickScanCore core;
+  core.setScanMirroredAndShifted(mirrored);
+  core.setScanCallback([&statistics](const sick_scan::SickScanCoreScan& scan) { statistics.num_scans++; });
+  core.setCloudCallback([&statistics](const sick_scan::SickScanCoreCloud& cloud) { statistics.num_points += cloud.num_beams * cloud.num_echos; });
+  core.setImuCallback([&statistics](const sick_scan::SickScanCoreImu& imu) { statistics.num_imu++; });
+  core.setFieldEventCallback([&statistics](uint64_t, const std::vector<sick_scan::SickScanCoreFieldEvent>& fields) { statistics.num_field_events++; });
+  core.setTelegramCallback([&statistics](uint64_t, const uint8_t*, size_t) { statistics.num_telegrams++; });
+
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  const std::string& source = args[0];
+  if (source.find(".sdl") != std::string::npos || source.find(".pcap") != std::string::npos)
+  {
+    int repeat = (args.size() > 1) ? atoi(args[1].c_str()) : 1;
+    if (!replay(core, source, repeat))
+    {
+      printf("## ERROR sick_scan_core_example: can't read %s\n", source.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    int port = (args.size() > 1) ? atoi(args[1].c_str()) : 2112;
+    double seconds = (args.size() > 2) ? atof(args[2].c_str()) : 10;
+    if (!core.connect(source, port))
+    {
+      printf("## ERROR sick_scan_core_example: can't connect to %s:%d\n", source.c_str(), port);
+      return EXIT_FAILURE;
+    }
+    if (!core.startScandata())
+    {
+      printf("## ERROR sick_scan_core_example: failed to start scandata\n");
+      return EXIT_FAILURE;
+    }
+    start_time = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end_time = start_time + std::chrono::milliseconds((int64_t)(1000 * seconds));
+    while (s_running && core.isConnected() && std::chrono::steady_clock::now() < end_time)
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    core.stopScandata();
+    core.disconnect();
+  }
+  statistics.print(core, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+  return EXIT_SUCCESS;
+}
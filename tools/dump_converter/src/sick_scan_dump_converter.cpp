@@ -0,0 +1,62 @@
+/*
+ * @brief Converts binary DataDumper files to csv
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 03.02.2021
+ *
+ */
+
+#include <stdio.h>
+#include <string>
+
+#include "sick_scan/dataDumper.h"
+
+/*!
+\brief Converts a binary dump file written by DataDumper::startBinaryDump() to csv.
+Usage: sick_scan_dump_converter <binary dump file> [<csv output file>]
+*/
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    printf("Usage: %s <binary dump file> [<csv output file>]\n", argv[0]);
+    return 1;
+  }
+  std::string binFilename = argv[1];
+  std::string csvFilename = (argc > 2) ? argv[2] : (binFilename + ".csv");
+  int numRecords = DataDumper::convertBinaryDumpToCsv(binFilename, csvFilename);
+  if (numRecords < 0)
+  {
+    printf("## ERROR sick_scan_dump_converter: failed to convert \"%s\" to \"%s\"\n", binFilename.c_str(), csvFilename.c_str());
+    return 1;
+  }
+  printf("sick_scan_dump_converter: %d records converted from \"%s\" to \"%s\"\n", numRecords, binFilename.c_str(), csvFilename.c_str());
+  return 0;
+}
@@ -0,0 +1,536 @@
+/*
+ * @brief Microbenchmarks of parsers, cola framing and pointcloud build
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 19.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <ros/package.h>
+
+#include "sick_scan/sick_scan_common_tcp.h"
+#include "sick_scan/sick_generic_parser.h"
+#include "sick_scan/sick_generic_imu.h"
+#include "sick_scan/sick_generic_radar.h"
+#include "sick_scan/sick_scan_decoded_scan.h"
+#include "sick_scan/sick_scan_messages.h"
+#include "sick_scan/scandata_files.h"
+
+/*!
+\brief State of a microbenchmark run: the number of iterations to run, and the bytes, items and errors counted by the
+benchmark function. A benchmark function runs its operation m_iterations times on its inputs.
+*/
+class MicrobenchmarkState
+{
+public:
+  MicrobenchmarkState(size_t iterations) : m_iterations(iterations), m_bytes(0), m_items(0), m_errors(0) {}
+
+  size_t m_iterations;
+  uint64_t m_bytes;
+  uint64_t m_items;
+  uint64_t m_errors;
+};
+
+/*!
+\brief A named microbenchmark and its result
+*/
+class Microbenchmark
+{
+public:
+  Microbenchmark(const std::string& name, const std::function<void(MicrobenchmarkState&)>& function)
+    : m_name(name), m_function(function), m_iterations(0), m_nanosec_per_op(0), m_bytes_per_sec(0), m_items_per_sec(0), m_errors(0) {}
+
+  /*!
+  \brief Runs the benchmark function with an increasing number of iterations until it takes at least min_time seconds
+  (the iteration count is calibrated like google benchmark does), and saves the result of the last run
+  */
+  void run(double min_time)
+  {
+    size_t iterations = 1;
+    while (true)
+    {
+      MicrobenchmarkState state(iterations);
+      std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+      m_function(state);
+      double sec = 1.0e-9 * std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+      if (sec >= min_time || iterations >= 1000000000)
+      {
+        m_iterations = iterations;
+        m_nanosec_per_op = 1.0e9 * sec / iterations;
+        m_bytes_per_sec = (sec > 0) ? (state.m_bytes / sec) : 0;
+        m_items_per_sec = (sec > 0) ? (state.m_items / sec) : 0;
+        m_errors = state.m_errors;
+        return;
+      }
+      double multiplier = (sec > 0) ? std::min(10.0, 1.4 * min_time / sec) : 10.0;
+      iterations = std::max(iterations + 1, (size_t)(iterations * multiplier));
+    }
+  }
+
+  std::string m_name;
+  std::function<void(MicrobenchmarkState&)> m_function;
+  size_t m_iterations;
+  double m_nanosec_per_op;
+  double m_bytes_per_sec;
+  double m_items_per_sec;
+  uint64_t m_errors;
+};
+
+/*!
+\brief Reads big endian values from a cola binary telegram
+*/
+class BinaryTelegramReader
+{
+public:
+  BinaryTelegramReader(const std::vector<uint8_t>& telegram, size_t pos) : m_telegram(telegram), m_pos(pos), m_ok(true) {}
+
+  uint32_t readUInt(size_t bytes)
+  {
+    uint32_t value = 0;
+    if (m_pos + bytes > m_telegram.size())
+    {
+      m_ok = false;
+      return 0;
+    }
+    for (size_t n = 0; n < bytes; n++)
+      value = (value << 8) | m_telegram[m_pos++];
+    return value;
+  }
+
+  std::string readString(size_t bytes)
+  {
+    if (m_pos + bytes > m_telegram.size())
+    {
+      m_ok = false;
+      return "";
+    }
+    m_pos += bytes;
+    return std::string(m_telegram.begin() + m_pos - bytes, m_telegram.begin() + m_pos);
+  }
+
+  bool ok(void) const { return m_ok; }
+
+private:
+  const std::vector<uint8_t>& m_telegram;
+  size_t m_pos;
+  bool m_ok;
+};
+
+/*!
+\brief Converts a cola binary LMDscandata telegram into the corresponding cola ascii telegram without stx and etx,
+as parsed by SickGenericParser::parse_datagram. Encoder blocks are not converted (the ascii parser does not support
+encoders). Returns false, if the telegram is not a complete binary LMDscandata telegram.
+*/
+static bool binaryToAsciiScandata(const std::vector<uint8_t>& binary, std::string& ascii)
+{
+  const std::string command("sSN LMDscandata ");
+  if (binary.size() < 8 + command.size() || memcmp(&binary[8], command.data(), command.size()) != 0)
+    return false;
+  BinaryTelegramReader reader(binary, 8 + command.size());
+  std::stringstream fields;
+  fields << std::uppercase << std::hex << "sSN LMDscandata";
+  // version, device number, serial number, device status, telegram counter, scan counter, time since startup,
+  // time of transmission, input status, output status, reserved (layer angle), scan frequency, measurement frequency
+  const int header_field_bytes[] = { 2, 2, 4, 1, 1, 2, 2, 4, 4, 1, 1, 1, 1, 2, 4, 4 };
+  for (size_t n = 0; n < sizeof(header_field_bytes) / sizeof(header_field_bytes[0]); n++)
+    fields << " " << reader.readUInt(header_field_bytes[n]);
+  uint32_t num_encoders = reader.readUInt(2);
+  for (uint32_t n = 0; n < num_encoders; n++)
+  {
+    reader.readUInt(4); // encoder position
+    reader.readUInt(2); // encoder speed
+  }
+  fields << " 0";
+  for (int channel_bytes = 2; channel_bytes >= 1; channel_bytes--) // 16 bit channels, then 8 bit channels
+  {
+    uint32_t num_channels = reader.readUInt(2);
+    fields << " " << num_channels;
+    for (uint32_t channel = 0; channel < num_channels; channel++)
+    {
+      fields << " " << reader.readString(5); // channel name, f.e. "DIST1" or "RSSI1"
+      for (int n = 0; n < 3; n++)
+        fields << " " << reader.readUInt(4); // scale factor, scale offset, start angle
+      fields << " " << reader.readUInt(2); // angular step width
+      uint32_t num_data = reader.readUInt(2);
+      fields << " " << num_data;
+      for (uint32_t n = 0; n < num_data; n++)
+        fields << " " << reader.readUInt(channel_bytes);
+    }
+  }
+  fields << " 0 0 0 0 0"; // no position, device name, comment, time and event info
+  ascii = fields.str();
+  return reader.ok();
+}
+
+/*!
+\brief Returns true, if a telegram is a complete cola binary telegram with valid length and checksum
+*/
+static bool isValidColaBinary(const std::vector<uint8_t>& telegram)
+{
+  if (telegram.size() < 9 || telegram[0] != 0x02 || telegram[1] != 0x02 || telegram[2] != 0x02 || telegram[3] != 0x02)
+    return false;
+  uint32_t payload_length = ((uint32_t)telegram[4] << 24) | ((uint32_t)telegram[5] << 16) | ((uint32_t)telegram[6] << 8) | telegram[7];
+  if (telegram.size() != payload_length + 9)
+    return false;
+  uint8_t checksum = 0;
+  for (size_t n = 8; n < telegram.size() - 1; n++)
+    checksum ^= telegram[n];
+  return checksum == telegram.back();
+}
+
+/*!
+\brief Returns the payload of a cola ascii telegram between stx and etx, or an empty string for other telegrams
+*/
+static std::string colaAsciiPayload(const std::vector<uint8_t>& telegram)
+{
+  if (telegram.size() < 2 || telegram[0] != 0x02 || telegram[1] == 0x02)
+    return "";
+  std::vector<uint8_t>::const_iterator etx = std::find(telegram.begin() + 1, telegram.end(), 0x03);
+  return std::string(telegram.begin() + 1, etx);
+}
+
+static std::string jsonString(const std::string& value)
+{
+  std::string json = "\"";
+  for (size_t n = 0; n < value.size(); n++)
+  {
+    if (value[n] == '"' || value[n] == '\\')
+      json += '\\';
+    json += value[n];
+  }
+  return json + "\"";
+}
+
+/*!
+\brief Google benchmark style microbenchmarks of the parsers, the cola framing and the pointcloud build. Inputs are the
+telegrams of the emulator scandata corpus (jsonfiles, *.sdl or *.pcapng). Telegram types not found in the corpus
+(radar and imu for the default tim781s recordings) are synthesized. Each benchmark runs its operation until at least
+min_time seconds elapsed and reports the time per operation and the throughput.
+
+Usage: sick_scan_microbenchmark [--benchmark_filter=<regex>] [--benchmark_min_time=<sec>] [--benchmark_out=<jsonfile>]
+                                [--scandata=<files>] [--scanner_type=<type>]
+Example: rosrun sick_scan sick_scan_microbenchmark --benchmark_filter=cola_framing --benchmark_out=/tmp/microbenchmark.json
+
+A ros master is required, since the driver and the radar parser read parameters and advertise topics.
+*/
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "sick_scan_microbenchmark", ros::init_options::AnonymousName);
+  ros::NodeHandle nh;
+
+  std::string filter = ".*";
+  double min_time = 0.5;
+  std::string output_file;
+  std::string scandatafiles = ros::package::getPath("sick_scan") + "/test/emulator/scandata/20210125-tim781s-scandata.pcapng.json";
+  std::string scanner_type = SICK_SCANNER_TIM_7XXS_NAME;
+  for (int n = 1; n < argc; n++)
+  {
+    std::string arg = argv[n];
+    std::string value = arg.substr(std::min(arg.size(), arg.find('=') + 1));
+    if (arg.find("--benchmark_filter=") == 0)
+      filter = value;
+    else if (arg.find("--benchmark_min_time=") == 0)
+      min_time = std::stod(value);
+    else if (arg.find("--benchmark_out=") == 0)
+      output_file = value;
+    else if (arg.find("--scandata=") == 0)
+      scandatafiles = value;
+    else if (arg.find("--scanner_type=") == 0)
+      scanner_type = value;
+    else
+    {
+      printf("Usage: sick_scan_microbenchmark [--benchmark_filter=<regex>] [--benchmark_min_time=<sec>] [--benchmark_out=<jsonfile>] [--scandata=<files>] [--scanner_type=<type>]\n");
+      return 1;
+    }
+  }
+
+  // Telegrams of the scandata corpus
+  sick_scan::ScandataFiles scandata_files;
+  if (!scandata_files.read(scandatafiles, "sSN LMDscandata ,sSN LFErec ,sSN InertialMeasurementUnit ,sSN LMDradardata "))
+  {
+    ROS_ERROR_STREAM("## ERROR sick_scan_microbenchmark: could not read scandata from \"" << scandatafiles << "\"");
+    return 1;
+  }
+  std::vector<std::vector<uint8_t> > binary_scandata, lferec, imu, stream_telegrams;
+  std::vector<std::string> ascii_scandata, radar;
+  size_t stream_size = 0;
+  for (size_t n = 0; n < scandata_files.frames().size(); n++)
+  {
+    const sick_scan::ScandataFiles::ScandataFrame& frame = scandata_files.frames()[n];
+    std::vector<uint8_t> telegram(frame.data, frame.data + frame.size);
+    std::string ascii;
+    if (telegram.size() < 2 || (telegram[0] == 0x02 && telegram[1] == 0x02 && !isValidColaBinary(telegram)))
+      continue; // f.e. incomplete telegram at the end of a recording
+    if (sick_scan::ScandataFiles::isScandataType(frame.data, frame.size, std::vector<std::string>(1, "sSN LMDscandata ")))
+    {
+      if (binaryToAsciiScandata(telegram, ascii))
+      {
+        binary_scandata.push_back(telegram);
+        ascii_scandata.push_back(ascii);
+      }
+      else if (!(ascii = colaAsciiPayload(telegram)).empty())
+        ascii_scandata.push_back(ascii);
+    }
+    else if (sick_scan::ScandataFiles::isScandataType(frame.data, frame.size, std::vector<std::string>(1, "sSN LFErec ")))
+      lferec.push_back(telegram);
+    else if (sick_scan::ScandataFiles::isScandataType(frame.data, frame.size, std::vector<std::string>(1, "sSN InertialMeasurementUnit ")))
+      imu.push_back(telegram);
+    else if (!(ascii = colaAsciiPayload(telegram)).empty())
+      radar.push_back(ascii);
+    if (telegram[0] == 0x02 && telegram[1] == 0x02) // cola binary telegrams are concatenated to a tcp stream
+    {
+      stream_telegrams.push_back(telegram);
+      stream_size += telegram.size();
+    }
+  }
+  sick_scan::SickScanRadarSingleton* radar_parser = sick_scan::SickScanRadarSingleton::getInstance();
+  if (radar.empty())
+  {
+    std::vector<uint8_t> buffer(64 * 1024);
+    int length = 0;
+    radar_parser->simulateAsciiDatagram(&buffer[0], &length);
+    radar.push_back(colaAsciiPayload(std::vector<uint8_t>(buffer.begin(), buffer.begin() + length)));
+  }
+  if (imu.empty())
+  {
+    // Reference telegram of SickScanImu::imuParserTest()
+    const uint8_t imu_telegram[] = {
+      0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x58, 0x73, 0x53, 0x4e, 0x20, 0x49, 0x6e, 0x65, 0x72, 0x74, 0x69, 0x61, 0x6c, 0x4d, 0x65,
+      0x61, 0x73, 0x75, 0x72, 0x65, 0x6d, 0x65, 0x6e, 0x74, 0x55, 0x6e, 0x69, 0x74, 0x20, 0xbe, 0xa4, 0xe1, 0x1c, 0x3b, 0x6b, 0x5d, 0xe5,
+      0x41, 0x1c, 0x6e, 0xad, 0xbb, 0x0b, 0xa1, 0x6f, 0xbb, 0x0b, 0xa1, 0x6f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x7f, 0xec, 0x00, 0x3a, 0x60, 0x00, 0x00, 0x3c, 0xcd, 0x00, 0x00, 0x39, 0xa0,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x1c, 0x7e, 0x6c, 0x01, 0x20 };
+    imu.push_back(std::vector<uint8_t>(imu_telegram, imu_telegram + sizeof(imu_telegram)));
+  }
+  std::vector<uint8_t> stream;
+  stream.reserve(stream_size);
+  for (size_t n = 0; n < stream_telegrams.size(); n++)
+    stream.insert(stream.end(), stream_telegrams[n].begin(), stream_telegrams[n].end());
+  ROS_INFO("sick_scan_microbenchmark: %zu binary and %zu ascii LMDscandata, %zu LFErec, %zu imu and %zu radar telegrams, %zu byte cola stream",
+           binary_scandata.size(), ascii_scandata.size(), lferec.size(), imu.size(), radar.size(), stream.size());
+
+  // Driver instance without device connection (as in datagram replay mode), datagrams are pushed into its receive queue
+  sick_scan::SickGenericParser* parser = new sick_scan::SickGenericParser(scanner_type);
+  int timelimit = 5;
+  sick_scan::SickScanCommonTcp* scanner = new sick_scan::SickScanCommonTcp("127.0.0.1", "2112", timelimit, parser, 'B');
+  scanner->config_.sw_pll_only_publish = false; // replayed device timestamps would repeatedly reset the software pll
+  sick_scan::SickScanConfig config = sick_scan::SickScanConfig::__getDefault__();
+  size_t max_ascii_size = 0;
+  for (size_t n = 0; n < ascii_scandata.size(); n++)
+    max_ascii_size = std::max(max_ascii_size, ascii_scandata[n].size());
+  for (size_t n = 0; n < radar.size(); n++)
+    max_ascii_size = std::max(max_ascii_size, radar[n].size());
+  std::vector<char> ascii_buffer(max_ascii_size + 1); // ascii parsers tokenize in place, i.e. each telegram is copied before parsing
+
+  // Decoded scans for the pointcloud build
+  std::vector<sick_scan::SickScanDecodedScan> decoded_scans;
+  for (size_t n = 0; n < ascii_scandata.size() && decoded_scans.size() < 100; n++)
+  {
+    memcpy(&ascii_buffer[0], ascii_scandata[n].data(), ascii_scandata[n].size());
+    ascii_buffer[ascii_scandata[n].size()] = 0;
+    sensor_msgs::LaserScan msg;
+    int num_echos = 0, echo_mask = 0;
+    if (parser->parse_datagram(&ascii_buffer[0], ascii_scandata[n].size(), config, msg, num_echos, echo_mask) == sick_scan::ExitSuccess && num_echos > 0)
+    {
+      decoded_scans.push_back(sick_scan::SickScanDecodedScan());
+      decoded_scans.back().assign(num_echos, msg.ranges, msg.intensities, msg.header.stamp, msg.time_increment);
+      decoded_scans.back().setAzimuth(msg.angle_min, msg.angle_increment, NULL);
+      decoded_scans.back().setElevation(0);
+    }
+  }
+  size_t max_points = 0;
+  for (size_t n = 0; n < decoded_scans.size(); n++)
+    max_points = std::max(max_points, decoded_scans[n].numEchos() * decoded_scans[n].numBeams());
+  const size_t point_step = 4 * sizeof(float); // x, y, z, intensity
+  std::vector<uint8_t> cloud(max_points * point_step);
+  const int echo_idx[] = { 0, 1, 2, 3, 4 };
+
+  std::vector<Microbenchmark> benchmarks;
+  if (!ascii_scandata.empty())
+  {
+    benchmarks.push_back(Microbenchmark("SickGenericParser::parse_datagram/ascii_LMDscandata", [&](MicrobenchmarkState& state)
+    {
+      for (size_t n = 0; n < state.m_iterations; n++)
+      {
+        const std::string& telegram = ascii_scandata[n % ascii_scandata.size()];
+        memcpy(&ascii_buffer[0], telegram.data(), telegram.size());
+        ascii_buffer[telegram.size()] = 0;
+        sensor_msgs::LaserScan msg;
+        int num_echos = 0, echo_mask = 0;
+        if (parser->parse_datagram(&ascii_buffer[0], telegram.size(), config, msg, num_echos, echo_mask) != sick_scan::ExitSuccess)
+          state.m_errors++;
+        state.m_bytes += telegram.size();
+      }
+      state.m_items += state.m_iterations;
+    }));
+  }
+  if (!binary_scandata.empty())
+  {
+    benchmarks.push_back(Microbenchmark("SickScanCommon::loopOnce/binary_LMDscandata", [&](MicrobenchmarkState& state)
+    {
+      for (size_t n = 0; n < state.m_iterations; n++)
+      {
+        const std::vector<uint8_t>& telegram = binary_scandata[n % binary_scandata.size()];
+        scanner->recvQueue.push(sick_scan::DatagramWithTimeStamp(ros::Time::now(), telegram));
+        if (scanner->loopOnce() != sick_scan::ExitSuccess)
+          state.m_errors++;
+        state.m_bytes += telegram.size();
+      }
+      state.m_items += state.m_iterations;
+    }));
+  }
+  benchmarks.push_back(Microbenchmark("SickScanRadarSingleton::parseAsciiDatagram/LMDradardata", [&](MicrobenchmarkState& state)
+  {
+    for (size_t n = 0; n < state.m_iterations; n++)
+    {
+      const std::string& telegram = radar[n % radar.size()];
+      memcpy(&ascii_buffer[0], telegram.data(), telegram.size());
+      ascii_buffer[telegram.size()] = 0;
+      sick_scan::RadarScan msg;
+      std::vector<sick_scan::SickScanRadarObject> objects;
+      std::vector<sick_scan::SickScanRadarRawTarget> raw_targets;
+      if (radar_parser->parseAsciiDatagram(&ascii_buffer[0], telegram.size(), &msg, objects, raw_targets) != sick_scan::ExitSuccess)
+        state.m_errors++;
+      state.m_bytes += telegram.size();
+      state.m_items += objects.size() + raw_targets.size();
+    }
+  }));
+  benchmarks.push_back(Microbenchmark("SickScanImu::parseBinaryDatagram/InertialMeasurementUnit", [&](MicrobenchmarkState& state)
+  {
+    sick_scan::SickScanImu imu_parser(NULL);
+    for (size_t n = 0; n < state.m_iterations; n++)
+    {
+      std::vector<uint8_t>& telegram = imu[n % imu.size()];
+      sick_scan::SickScanImuValue value;
+      if (imu_parser.parseBinaryDatagram((char*)&telegram[0], telegram.size(), &value) != sick_scan::ExitSuccess)
+        state.m_errors++;
+      state.m_bytes += telegram.size();
+    }
+    state.m_items += state.m_iterations;
+  }));
+  if (!lferec.empty())
+  {
+    benchmarks.push_back(Microbenchmark("SickScanMessages::parseLFErecMsg/binary_LFErec", [&](MicrobenchmarkState& state)
+    {
+      for (size_t n = 0; n < state.m_iterations; n++)
+      {
+        std::vector<uint8_t>& telegram = lferec[n % lferec.size()];
+        sick_scan::LFErecMsg msg;
+        if (!sick_scan::SickScanMessages::parseLFErecMsg(ros::Time(), &telegram[0], telegram.size(), true, "cloud", msg))
+          state.m_errors++;
+        state.m_bytes += telegram.size();
+        state.m_items += msg.fields.size();
+      }
+    }));
+  }
+  if (!stream.empty())
+  {
+    const size_t segment_sizes[] = { 1460, 65536 }; // tcp segments of ethernet mtu, large reads
+    size_t stream_pos = 0; // the stream is continued by all runs, i.e. the receive buffer always holds the start of the next telegram
+    for (size_t segment_cnt = 0; segment_cnt < sizeof(segment_sizes) / sizeof(segment_sizes[0]); segment_cnt++)
+    {
+      size_t segment_size = segment_sizes[segment_cnt];
+      benchmarks.push_back(Microbenchmark("SickScanCommonTcp::readCallbackFunction/cola_framing_" + std::to_string(segment_size), [&, segment_size](MicrobenchmarkState& state)
+      {
+        for (size_t n = 0; n < state.m_iterations; n++)
+        {
+          UINT32 num_bytes = (UINT32)std::min(segment_size, stream.size() - stream_pos);
+          scanner->readCallbackFunction(&stream[stream_pos], num_bytes);
+          while (!scanner->recvQueue.isQueueEmpty())
+          {
+            scanner->recvQueue.pop();
+            state.m_items++;
+          }
+          state.m_bytes += num_bytes;
+          stream_pos = (stream_pos + num_bytes) % stream.size();
+        }
+      }));
+    }
+  }
+  if (!decoded_scans.empty())
+  {
+    benchmarks.push_back(Microbenchmark("SickScanDecodedScan::toCloud/LMDscandata", [&](MicrobenchmarkState& state)
+    {
+      for (size_t n = 0; n < state.m_iterations; n++)
+      {
+        const sick_scan::SickScanDecodedScan& scan = decoded_scans[n % decoded_scans.size()];
+        int num_echos = std::min(scan.numEchos(), 5);
+        scan.toCloud(num_echos, echo_idx, &cloud[0], point_step, scan.numBeams() * point_step, true, false, 0.0f, 0, scan.numBeams());
+        state.m_bytes += num_echos * scan.numBeams() * point_step;
+        state.m_items += num_echos * scan.numBeams();
+      }
+    }));
+  }
+
+  // Run all benchmarks matching the filter
+  std::regex filter_regex(filter);
+  printf("%-64s %14s %12s %12s %14s %8s\n", "Benchmark", "Time [ns]", "Iterations", "MB/s", "items/s", "errors");
+  printf("%s\n", std::string(129, '-').c_str());
+  std::stringstream json;
+  json << "{\"context\": {\"executable\": " << jsonString(argv[0]) << ", \"scandata\": " << jsonString(scandatafiles)
+       << ", \"scanner_type\": " << jsonString(scanner_type) << ", \"min_time\": " << min_time << "}, \"benchmarks\": [";
+  int num_results = 0;
+  for (size_t n = 0; n < benchmarks.size() && ros::ok(); n++)
+  {
+    Microbenchmark& benchmark = benchmarks[n];
+    if (!std::regex_search(benchmark.m_name, filter_regex))
+      continue;
+    benchmark.run(min_time);
+    printf("%-64s %14.1f %12zu %12.2f %14.1f %8llu\n", benchmark.m_name.c_str(), benchmark.m_nanosec_per_op, benchmark.m_iterations,
+           1.0e-6 * benchmark.m_bytes_per_sec, benchmark.m_items_per_sec, (unsigned long long)benchmark.m_errors);
+    json << (num_results++ > 0 ? ", " : "") << "{\"name\": " << jsonString(benchmark.m_name) << ", \"iterations\": " << benchmark.m_iterations
+         << ", \"real_time\": " << std::fixed << std::setprecision(1) << benchmark.m_nanosec_per_op << ", \"time_unit\": \"ns\""
+         << ", \"bytes_per_second\": " << benchmark.m_bytes_per_sec << ", \"items_per_second\": " << benchmark.m_items_per_sec
+         << ", \"errors\": " << benchmark.m_errors << "}";
+  }
+  json << "]}";
+  if (!output_file.empty())
+  {
+    std::ofstream output(output_file);
+    output << json.str() << std::endl;
+    ROS_INFO_STREAM("sick_scan_microbenchmark: results saved to \"" << output_file << "\"");
+  }
+  delete scanner;
+  delete parser;
+  return 0;
+}
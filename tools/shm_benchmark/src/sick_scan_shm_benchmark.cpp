@@ -0,0 +1,164 @@
+/*
+ * @brief Latency and throughput of the shared memory transport versus TCPROS
+ *
+ * Copyright (C) 2021, Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2021, SICK AG, Waldkirch
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Osnabrück University nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  Created on: 14.02.2021
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include "sick_scan/sick_scan_shm_ring.h"
+
+/*!
+\brief Latency statistics of a transport. Latencies are measured from the time the driver wrote the pointcloud into
+shared memory (directly after publishing it by ROS) until the pointcloud is received.
+*/
+class TransportStatistics
+{
+public:
+  TransportStatistics() : m_bytes(0) {}
+
+  void add(double latency_usec, size_t bytes)
+  {
+    m_latencies.push_back(latency_usec);
+    m_bytes += bytes;
+  }
+
+  void print(const char* name, double duration_sec)
+  {
+    if (m_latencies.empty())
+    {
+      printf("%-8s no pointclouds received\n", name);
+      return;
+    }
+    std::sort(m_latencies.begin(), m_latencies.end());
+    double sum = 0;
+    for (size_t n = 0; n < m_latencies.size(); n++)
+      sum += m_latencies[n];
+    printf("%-8s n=%zu mean=%.1f p50=%.1f p99=%.1f max=%.1f [usec] throughput=%.2f MB/s\n", name, m_latencies.size(),
+           sum / m_latencies.size(), m_latencies[m_latencies.size() / 2], m_latencies[(size_t)(0.99 * (m_latencies.size() - 1))],
+           m_latencies.back(), 1.0e-6 * m_bytes / duration_sec);
+  }
+
+protected:
+  std::vector<double> m_latencies;
+  size_t m_bytes;
+};
+
+static std::mutex s_mutex;
+static std::map<uint64_t, uint64_t> s_write_time_by_stamp; // write time of the pointclouds by their timestamp
+static TransportStatistics s_shm_statistics;
+static TransportStatistics s_ros_statistics;
+static std::map<uint64_t, std::pair<uint64_t, size_t> > s_ros_pending; // receive time and size of ros pointclouds received before their shared memory counterpart
+
+static void cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud)
+{
+  uint64_t receive_time = sick_scan::SickScanShmRingReader::systemTimeNanoSec();
+  uint64_t stamp = (uint64_t)cloud->header.stamp.sec * 1000000000ULL + cloud->header.stamp.nsec;
+  std::lock_guard<std::mutex> lock(s_mutex);
+  std::map<uint64_t, uint64_t>::iterator iter = s_write_time_by_stamp.find(stamp);
+  if (iter != s_write_time_by_stamp.end())
+  {
+    s_ros_statistics.add(1.0e-3 * (double)(int64_t)(receive_time - iter->second), cloud->data.size());
+    s_write_time_by_stamp.erase(s_write_time_by_stamp.begin(), ++iter);
+  }
+  else
+  {
+    s_ros_pending[stamp] = std::make_pair(receive_time, cloud->data.size());
+  }
+}
+
+/*!
+\brief Measures latency and throughput of pointclouds received by shared memory and by TCPROS on the same machine.
+Run the driver with parameter cloud_shm_name, e.g. cloud_shm_name:=/sick_scan_cloud, and start
+rosrun sick_scan sick_scan_shm_benchmark _shm_name:=/sick_scan_cloud _cloud_topic:=/cloud _duration:=30
+*/
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "sick_scan_shm_benchmark");
+  ros::NodeHandle nh, pn("~");
+  std::string shm_name = "/sick_scan_cloud", cloud_topic = "/cloud";
+  double duration = 30;
+  pn.param<std::string>("shm_name", shm_name, shm_name);
+  pn.param<std::string>("cloud_topic", cloud_topic, cloud_topic);
+  pn.param<double>("duration", duration, duration);
+
+  sick_scan::SickScanShmRingReader reader;
+  while (ros::ok() && !reader.open(shm_name))
+  {
+    ROS_INFO_THROTTLE(5.0, "sick_scan_shm_benchmark: waiting for shared memory %s", shm_name.c_str());
+    ros::Duration(0.1).sleep();
+  }
+  ros::Subscriber cloud_sub = nh.subscribe(cloud_topic, 10, cloudCallback, ros::TransportHints().tcpNoDelay());
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+  ROS_INFO("sick_scan_shm_benchmark: measuring shared memory %s and topic %s for %.0f seconds", shm_name.c_str(), cloud_topic.c_str(), duration);
+
+  sick_scan::SickScanShmCloudHeader header;
+  std::vector<uint8_t> data;
+  std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now() + std::chrono::milliseconds((int64_t)(1000 * duration));
+  while (ros::ok() && std::chrono::steady_clock::now() < end_time)
+  {
+    if (reader.read(header, data, 100))
+    {
+      uint64_t receive_time = sick_scan::SickScanShmRingReader::systemTimeNanoSec();
+      uint64_t stamp = (uint64_t)header.stamp_sec * 1000000000ULL + header.stamp_nsec;
+      std::lock_guard<std::mutex> lock(s_mutex);
+      s_shm_statistics.add(1.0e-3 * (double)(int64_t)(receive_time - header.write_time_nsec), data.size());
+      std::map<uint64_t, std::pair<uint64_t, size_t> >::iterator pending = s_ros_pending.find(stamp);
+      if (pending != s_ros_pending.end())
+      {
+        s_ros_statistics.add(1.0e-3 * (double)(int64_t)(pending->second.first - header.write_time_nsec), pending->second.second);
+        s_ros_pending.erase(s_ros_pending.begin(), ++pending);
+      }
+      else
+      {
+        s_write_time_by_stamp[stamp] = header.write_time_nsec;
+      }
+    }
+  }
+  spinner.stop();
+  std::lock_guard<std::mutex> lock(s_mutex);
+  s_shm_statistics.print("shm", duration);
+  s_ros_statistics.print("tcpros", duration);
+  printf("shm: %llu pointclouds skipped\n", (unsigned long long)reader.getNumSkipped());
+  return 0;
+}